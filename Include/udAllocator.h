@@ -0,0 +1,47 @@
+#ifndef UDALLOCATOR_H
+#define UDALLOCATOR_H
+//
+// Copyright (c) Euclideon Pty Ltd
+//
+// Pluggable backends servicing udAlloc, udRealloc and udFree
+//
+
+#include "udPlatform.h"
+
+// A backend is a table of functions that every udAlloc*/udRealloc*/udFree call is routed through.
+// Only one backend is active for the process, and it must be installed before the first allocation
+struct udAllocatorBackend
+{
+  const char *pName;
+  void *(*pAlloc)(size_t size, size_t alignment, udAllocationFlags flags, const char *pFile, int line);
+  void *(*pRealloc)(void *pMemory, size_t size, size_t alignment, const char *pFile, int line); // Null pMemory allocates, zero size frees and returns null
+  void (*pFree)(void *pMemory, const char *pFile, int line);
+  void (*pThreadExit)(); // Optional, releases any state the backend holds for the calling thread
+  size_t (*pUsableSize)(void *pMemory); // Optional, the bytes usable at pMemory
+  void (*pDeinit)(); // Optional, returns everything the backend holds to the system once all its blocks have been freed
+};
+
+// Install a backend (nullptr restores the system backend). Returns udR_NotAllowed once memory has been allocated
+udResult udAllocator_SetBackend(const udAllocatorBackend *pBackend);
+
+// Get the backend currently servicing allocations
+const udAllocatorBackend *udAllocator_GetBackend();
+
+// The default backend, using the C runtime (malloc/free). On Linux, blocks of 4MB or more and blocks big enough for their
+// page placement flags to apply are mapped directly instead, and grow with mremap so their pages move rather than being copied
+const udAllocatorBackend *udAllocator_SystemBackend();
+
+// A backend keeping per-thread caches of small blocks (up to 2KB, which ignore the page placement flags), so the common
+// small allocation path takes no lock. Freed small blocks are recycled through the caches rather than returned to the
+// system, and a thread's cache is handed back to the other threads as it exits (for threads not started by udThread,
+// except on Windows)
+const udAllocatorBackend *udAllocator_ThreadCacheBackend();
+
+// Release per-thread allocator state held for the calling thread, called automatically as udThreads exit
+void udAllocator_ThreadExit();
+
+// Release everything the active backend holds, including the calling thread's state. Only valid at shutdown, once
+// every block has been freed and every other thread has exited, such as at the end of main
+void udAllocator_Deinit();
+
+#endif // UDALLOCATOR_H
@@ -0,0 +1,47 @@
+#ifndef UDARENA_H
+#define UDARENA_H
+//
+// Copyright (c) Euclideon Pty Ltd
+//
+// A linear (region) allocator for data that shares a lifetime. Allocations bump a pointer through large
+// blocks and are never freed individually; everything is released at once by resetting or destroying the arena.
+// An arena is not thread safe, callers sharing one between threads must provide their own locking
+//
+
+#include "udPlatform.h"
+
+#define UDARENA_DEFAULT_BLOCK_SIZE (64 * 1024)
+
+struct udArena;
+
+// A position in the arena to later rewind to
+struct udArenaMark
+{
+  void *pBlock;
+  size_t used;
+};
+
+// Create an arena; blockSize is the size of each block requested from udAlloc (0 for UDARENA_DEFAULT_BLOCK_SIZE)
+udResult udArena_Create(udArena **ppArena, size_t blockSize = 0);
+
+// Free every block, releasing all memory allocated from the arena
+void udArena_Destroy(udArena **ppArena);
+
+// Allocate memory that remains valid until the arena is reset (past this allocation) or destroyed. Returns null on failure
+void *udArena_Alloc(udArena *pArena, size_t size, udAllocationFlags flags = udAF_None, size_t alignment = 2 * sizeof(void*));
+#define udArenaAllocType(pArena, type, count, flags) (type*)udArena_Alloc(pArena, sizeof(type) * (count), flags, alignof(type))
+
+// Duplicate a string into the arena, a non-zero charCount specifies the maximum characters copied. Null duplicates as null
+char *udArena_Strdup(udArena *pArena, const char *pStr, size_t charCount = 0);
+
+// Get a mark, and rewind to it, discarding everything allocated since. Blocks are kept for reuse rather than freed
+udArenaMark udArena_GetMark(udArena *pArena);
+void udArena_ResetToMark(udArena *pArena, udArenaMark mark);
+
+// Discard everything allocated from the arena, keeping its blocks for reuse
+void udArena_Reset(udArena *pArena);
+
+// Get the bytes handed out since creation or the last reset, and the total size of the blocks held (either may be null)
+void udArena_GetUsage(udArena *pArena, size_t *pBytesUsed, size_t *pBytesReserved);
+
+#endif // UDARENA_H
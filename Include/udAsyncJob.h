@@ -12,6 +12,7 @@
 #include "udResult.h"
 #include "udThread.h"
 #include "udPlatformUtil.h"
+#include "udCancelToken.h"
 
 // A simple interface to allow function calls to be easily made optionally background calls with one additional parameter
 
@@ -45,9 +46,25 @@ bool udAsyncJob_GetResultTimeout(udAsyncJob *pJobHandle, udResult *pResult, int
 // Set the result (increment semaphore)
 void udAsyncJob_SetResult(udAsyncJob *pJobHandle, udResult returnResult);
 
-// Set the pending flag (called internally by UDASYNC_CALLx macros)
+// Set the pending flag and reset the job's cancel token (called internally by UDASYNC_CALLx macros)
 void udAsyncJob_SetPending(udAsyncJob *pJobHandle);
 
+// Cancels the call in flight, which gives udR_Cancelled if it hadn't started or can poll the token to return early
+void udAsyncJob_Cancel(udAsyncJob *pJobHandle);
+
+// The job's token, the calling thread's current token while the call runs. It can be passed to udWorkerPool_AddCancellableTask
+// so cancelling the job also drops the work the call queued
+udCancelToken *udAsyncJob_GetCancelToken(udAsyncJob *pJobHandle);
+
+// Begin returns false (setting the result to udR_Cancelled) if the job was cancelled before the call started, otherwise makes the
+// job's token current until End sets the result (called internally by UDASYNC_CALLx macros)
+bool udAsyncJob_BeginCall(udAsyncJob *pJobHandle);
+void udAsyncJob_EndCall(udAsyncJob *pJobHandle, udResult returnResult);
+
+// Copy and free the parameters passed to the thread (called internally by UDASYNC_CALLx macros)
+void *udAsyncJob_DupParams(const void *pParams, size_t size);
+void udAsyncJob_FreeParams(void *pParams, size_t size);
+
 // Get the pending flag (used to determine if an async call is in flight)
 bool udAsyncJob_IsPending(udAsyncJob *pJobHandle);
 
@@ -72,7 +89,8 @@ const char *udAsyncPause_GetErrorContextString(udAsyncPause::Context errorContex
 #define UDASYNC_CALL(funcCall) if (pAsyncJob) {                                       \
   udThreadStart udajStartFunc = [=](void *) -> unsigned int                           \
   {                                                                                   \
-    udAsyncJob_SetResult(pAsyncJob, funcCall);                                        \
+    if (udAsyncJob_BeginCall(pAsyncJob))                                              \
+      udAsyncJob_EndCall(pAsyncJob, funcCall);                                        \
     return 0;                                                                         \
   };                                                                                  \
   udAsyncJob_SetPending(pAsyncJob);                                                   \
@@ -84,12 +102,13 @@ const char *udAsyncPause_GetErrorContextString(udAsyncPause::Context errorContex
                                 udAsyncJob *pAsyncJob; } udajParams =  { p0, pAsyncJob };                               \
             udThreadStart udajStartFunc = [](void *pData) -> unsigned                                                  \
             { UDAJParams *p = (UDAJParams*)pData;                                                                       \
-              udAsyncJob_SetResult(p->pAsyncJob, func(p->_p0, nullptr));                                                \
-              udFree(p);                                                                                                \
+              if (udAsyncJob_BeginCall(p->pAsyncJob))                                                                   \
+                udAsyncJob_EndCall(p->pAsyncJob, func(p->_p0, nullptr));                                                \
+              udAsyncJob_FreeParams(p, sizeof(*p));                                                                     \
               return 0;                                                                                                 \
             };                                                                                                          \
             udAsyncJob_SetPending(pAsyncJob);                                                                           \
-            return udThread_Create(nullptr, udajStartFunc, udMemDup(&udajParams, sizeof(udajParams), 0, udAF_None),     \
+            return udThread_Create(nullptr, udajStartFunc, udAsyncJob_DupParams(&udajParams, sizeof(udajParams)),       \
                                    udTCF_None, UDSTRINGIFY(func));                                                      \
         }
 #define UDASYNC_CALL2(func, t0, p0, t1, p1) if (pAsyncJob) {                                                            \
@@ -97,12 +116,13 @@ const char *udAsyncPause_GetErrorContextString(udAsyncPause::Context errorContex
                                 udAsyncJob *pAsyncJob; } udajParams =  { p0, p1, pAsyncJob };                           \
             udThreadStart udajStartFunc = [](void *pData) -> unsigned                                                  \
             { UDAJParams *p = (UDAJParams*)pData;                                                                       \
-              udAsyncJob_SetResult(p->pAsyncJob, func(p->_p0, p->_p1, nullptr));                                        \
-              udFree(p);                                                                                                \
+              if (udAsyncJob_BeginCall(p->pAsyncJob))                                                                   \
+                udAsyncJob_EndCall(p->pAsyncJob, func(p->_p0, p->_p1, nullptr));                                        \
+              udAsyncJob_FreeParams(p, sizeof(*p));                                                                     \
               return 0;                                                                                                 \
             };                                                                                                          \
             udAsyncJob_SetPending(pAsyncJob);                                                                           \
-            return udThread_Create(nullptr, udajStartFunc, udMemDup(&udajParams, sizeof(udajParams), 0, udAF_None),     \
+            return udThread_Create(nullptr, udajStartFunc, udAsyncJob_DupParams(&udajParams, sizeof(udajParams)),       \
                                    udTCF_None, UDSTRINGIFY(func));                                                      \
         }
 #define UDASYNC_CALL3(func, t0, p0, t1, p1, t2, p2) if (pAsyncJob) {                                                    \
@@ -110,12 +130,13 @@ const char *udAsyncPause_GetErrorContextString(udAsyncPause::Context errorContex
                                 udAsyncJob *pAsyncJob; } udajParams =  { p0, p1, p2, pAsyncJob };                       \
             udThreadStart udajStartFunc = [](void *pData) -> unsigned                                                  \
             { UDAJParams *p = (UDAJParams*)pData;                                                                       \
-              udAsyncJob_SetResult(p->pAsyncJob, func(p->_p0, p->_p1, p->_p2, nullptr));                                \
-              udFree(p);                                                                                                \
+              if (udAsyncJob_BeginCall(p->pAsyncJob))                                                                   \
+                udAsyncJob_EndCall(p->pAsyncJob, func(p->_p0, p->_p1, p->_p2, nullptr));                                \
+              udAsyncJob_FreeParams(p, sizeof(*p));                                                                     \
               return 0;                                                                                                 \
             };                                                                                                          \
             udAsyncJob_SetPending(pAsyncJob);                                                                           \
-            return udThread_Create(nullptr, udajStartFunc, udMemDup(&udajParams, sizeof(udajParams), 0, udAF_None),     \
+            return udThread_Create(nullptr, udajStartFunc, udAsyncJob_DupParams(&udajParams, sizeof(udajParams)),       \
                                    udTCF_None, UDSTRINGIFY(func));                                                      \
         }
 #define UDASYNC_CALL4(func, t0, p0, t1, p1, t2, p2, t3, p3) if (pAsyncJob) {                                            \
@@ -123,12 +144,13 @@ const char *udAsyncPause_GetErrorContextString(udAsyncPause::Context errorContex
                                 udAsyncJob *pAsyncJob; } udajParams =  { p0, p1, p2, p3, pAsyncJob };                   \
             udThreadStart udajStartFunc = [](void *pData) -> unsigned                                                  \
             { UDAJParams *p = (UDAJParams*)pData;                                                                       \
-              udAsyncJob_SetResult(p->pAsyncJob, func(p->_p0, p->_p1, p->_p2, p->_p3, nullptr));                        \
-              udFree(p);                                                                                                \
+              if (udAsyncJob_BeginCall(p->pAsyncJob))                                                                   \
+                udAsyncJob_EndCall(p->pAsyncJob, func(p->_p0, p->_p1, p->_p2, p->_p3, nullptr));                        \
+              udAsyncJob_FreeParams(p, sizeof(*p));                                                                     \
               return 0;                                                                                                 \
             };                                                                                                          \
             udAsyncJob_SetPending(pAsyncJob);                                                                           \
-            return udThread_Create(nullptr, udajStartFunc, udMemDup(&udajParams, sizeof(udajParams), 0, udAF_None),     \
+            return udThread_Create(nullptr, udajStartFunc, udAsyncJob_DupParams(&udajParams, sizeof(udajParams)),       \
                                    udTCF_None, UDSTRINGIFY(func));                                                      \
         }
 #define UDASYNC_CALL5(func, t0, p0, t1, p1, t2, p2, t3, p3, t4, p4) if (pAsyncJob) {                                    \
@@ -136,12 +158,13 @@ const char *udAsyncPause_GetErrorContextString(udAsyncPause::Context errorContex
                                 udAsyncJob *pAsyncJob; } udajParams =  { p0, p1, p2, p3, p4, pAsyncJob };               \
             udThreadStart udajStartFunc = [](void *pData) -> unsigned                                                  \
             { UDAJParams *p = (UDAJParams*)pData;                                                                       \
-              udAsyncJob_SetResult(p->pAsyncJob, func(p->_p0, p->_p1, p->_p2, p->_p3, p->_p4, nullptr));                \
-              udFree(p);                                                                                                \
+              if (udAsyncJob_BeginCall(p->pAsyncJob))                                                                   \
+                udAsyncJob_EndCall(p->pAsyncJob, func(p->_p0, p->_p1, p->_p2, p->_p3, p->_p4, nullptr));                \
+              udAsyncJob_FreeParams(p, sizeof(*p));                                                                     \
               return 0;                                                                                                 \
             };                                                                                                          \
             udAsyncJob_SetPending(pAsyncJob);                                                                           \
-            return udThread_Create(nullptr, udajStartFunc, udMemDup(&udajParams, sizeof(udajParams), 0, udAF_None),     \
+            return udThread_Create(nullptr, udajStartFunc, udAsyncJob_DupParams(&udajParams, sizeof(udajParams)),       \
                                    udTCF_None, UDSTRINGIFY(func));                                                      \
         }
 #define UDASYNC_CALL6(func, t0, p0, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5) if (pAsyncJob) {                            \
@@ -149,12 +172,13 @@ const char *udAsyncPause_GetErrorContextString(udAsyncPause::Context errorContex
                                 udAsyncJob *pAsyncJob; } udajParams =  { p0, p1, p2, p3, p4, p5, pAsyncJob };           \
             udThreadStart udajStartFunc = [](void *pData) -> unsigned                                                  \
             { UDAJParams *p = (UDAJParams*)pData;                                                                       \
-              udAsyncJob_SetResult(p->pAsyncJob, func(p->_p0, p->_p1, p->_p2, p->_p3, p->_p4, p->_p5, nullptr));        \
-              udFree(p);                                                                                                \
+              if (udAsyncJob_BeginCall(p->pAsyncJob))                                                                   \
+                udAsyncJob_EndCall(p->pAsyncJob, func(p->_p0, p->_p1, p->_p2, p->_p3, p->_p4, p->_p5, nullptr));        \
+              udAsyncJob_FreeParams(p, sizeof(*p));                                                                     \
               return 0;                                                                                                 \
             };                                                                                                          \
             udAsyncJob_SetPending(pAsyncJob);                                                                           \
-            return udThread_Create(nullptr, udajStartFunc, udMemDup(&udajParams, sizeof(udajParams), 0, udAF_None),     \
+            return udThread_Create(nullptr, udajStartFunc, udAsyncJob_DupParams(&udajParams, sizeof(udajParams)),       \
                                    udTCF_None, UDSTRINGIFY(func));                                                      \
         }
 #define UDASYNC_CALL7(func, t0, p0, t1, p1, t2, p2, t3, p3, t4, p4, t5, p5, t6, p6) if (pAsyncJob) {                    \
@@ -162,12 +186,13 @@ const char *udAsyncPause_GetErrorContextString(udAsyncPause::Context errorContex
                                 udAsyncJob *pAsyncJob; } udajParams =  { p0, p1, p2, p3, p4, p5, p6, pAsyncJob };       \
             udThreadStart udajStartFunc = [](void *pData) -> unsigned                                                  \
             { UDAJParams *p = (UDAJParams*)pData;                                                                       \
-              udAsyncJob_SetResult(p->pAsyncJob, func(p->_p0, p->_p1, p->_p2, p->_p3, p->_p4, p->_p5, p->_p6, nullptr));\
-              udFree(p);                                                                                                \
+              if (udAsyncJob_BeginCall(p->pAsyncJob))                                                                   \
+                udAsyncJob_EndCall(p->pAsyncJob, func(p->_p0, p->_p1, p->_p2, p->_p3, p->_p4, p->_p5, p->_p6, nullptr)); \
+              udAsyncJob_FreeParams(p, sizeof(*p));                                                                     \
               return 0;                                                                                                 \
             };                                                                                                          \
             udAsyncJob_SetPending(pAsyncJob);                                                                           \
-            return udThread_Create(nullptr, udajStartFunc, udMemDup(&udajParams, sizeof(udajParams), 0, udAF_None),     \
+            return udThread_Create(nullptr, udajStartFunc, udAsyncJob_DupParams(&udajParams, sizeof(udajParams)),       \
                                    udTCF_None, UDSTRINGIFY(func));                                                      \
         }
 
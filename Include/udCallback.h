@@ -59,7 +59,18 @@ struct udCallback<Result(Args...)>
   ~udCallback() { if (pPtr) pPtr->~udAbstractCallback(); }
 
   udCallback &operator=(const udCallback &other) { memcpy(buffer, other.buffer, sizeof(buffer)); if (other.pPtr) pPtr = (decltype(pPtr))buffer; else pPtr = nullptr; return *this; }
-  udCallback &operator=(udCallback &&other) noexcept { *this = std::move(other); return *this; }
+  udCallback &operator=(udCallback &&other) noexcept
+  {
+    if (this != &other)
+    {
+      if (pPtr)
+        pPtr->~udAbstractCallback();
+      memmove(buffer, other.buffer, sizeof(buffer));
+      pPtr = other.pPtr ? (decltype(pPtr))buffer : nullptr;
+      other.pPtr = nullptr;
+    }
+    return *this;
+  }
   udCallback &operator=(std::nullptr_t) noexcept { pPtr = nullptr; return *this; }
   template<typename T, std::enable_if_t<T::value, Result(Args...)> = 0>
   udCallback &operator=(T &&callback)
@@ -0,0 +1,37 @@
+#ifndef UDCANCELTOKEN_H
+#define UDCANCELTOKEN_H
+//
+// Copyright (c) Euclideon Pty Ltd
+//
+// A flag shared between the code that starts work and the work itself, so work that is no longer needed can be abandoned
+//
+// Work queued with a token (see udWorkerPool_AddCancellableTask) is dropped without running once the token is cancelled,
+// and work already running polls the token between steps. While a udWorkerPool task or udAsyncJob call runs its token is the
+// thread's current token, so deeper code can poll it without it being passed down. Tokens are reference counted, so one
+// may be destroyed while work holding it is still queued
+//
+
+#include "udResult.h"
+
+struct udCancelToken;
+
+udResult udCancelToken_Create(udCancelToken **ppToken);
+
+// Releases the caller's reference, the token is freed once no queued work holds it either
+void udCancelToken_Destroy(udCancelToken **ppToken);
+
+// Adds a reference released by udCancelToken_Destroy, for code that keeps the token beyond the caller's use of it
+udCancelToken *udCancelToken_AddReference(udCancelToken *pToken);
+
+// Cancels all work holding the token, until it is reset
+void udCancelToken_Cancel(udCancelToken *pToken);
+void udCancelToken_Reset(udCancelToken *pToken);
+
+// Returns false for a null token, so work started without one is never cancelled
+bool udCancelToken_IsCancelled(const udCancelToken *pToken);
+
+// Sets the calling thread's current token, returning the previous one so it can be restored
+udCancelToken *udCancelToken_SetCurrent(udCancelToken *pToken);
+udCancelToken *udCancelToken_GetCurrent();
+
+#endif // UDCANCELTOKEN_H
@@ -7,9 +7,17 @@
 //
 // A simple container for keeping potentially large arrays without large contiguous allocations
 //
+// Elements are constructed, moved and destroyed as C++ objects. Trivially copyable types are relocated, copied and
+// zeroed with memcpy/memmove/memset instead, selected at compile time
+//
 
 #include "udPlatform.h"
+#include "udPlatformUtil.h"
 #include "udResult.h"
+#include "udArena.h"
+#include <new>
+#include <utility>
+#include <type_traits>
 
 // --------------------------------------------------------------------------
 template <typename T>
@@ -24,41 +32,117 @@ struct udChunkedArrayIterator
   bool operator!=(const udChunkedArrayIterator<T> &rhs) const;
 };
 
+// A contiguous run of elements within one chunk
+template <typename T>
+struct udChunkedArraySpan
+{
+  T *pData;
+  size_t count;
+};
+
+// Iterates the runs of a range of elements, yielding one span per chunk
+template <typename T>
+struct udChunkedArraySpanIterator
+{
+  T *const *ppCurrChunk;
+  size_t currChunkElementIndex;
+  size_t remaining;
+  size_t chunkElementCount;
+
+  udChunkedArraySpanIterator<T> &operator++();
+  udChunkedArraySpan<T> operator*() const;
+  bool operator!=(const udChunkedArraySpanIterator<T> &rhs) const;
+};
+
+template <typename T>
+struct udChunkedArraySpans
+{
+  udChunkedArraySpanIterator<T> first;
+
+  udChunkedArraySpanIterator<T> begin() const { return first; }
+  udChunkedArraySpanIterator<T> end() const { return udChunkedArraySpanIterator<T>{ nullptr, 0, 0, first.chunkElementCount }; }
+};
+
+// --------------------------------------------------------------------------
+// Open addressed (linear probing) table of element indices, see udChunkedArray::EnableHashIndex
+struct udChunkedArrayHashSlot
+{
+  size_t entry;                                  // Element index + 1, zero for an empty slot
+  uint32_t hash;
+};
+
+struct udChunkedArrayHashIndex
+{
+  udChunkedArrayHashSlot *pSlots;
+  size_t slotMask;                               // Slot count - 1, the count is a power of 2 at least twice indexedCount
+  size_t compareLen;
+  size_t indexedCount;                           // Elements [0, indexedCount) are in the table, those after are added by the next FindIndex
+  bool valid;                                    // False once indices have shifted, so the next FindIndex rebuilds the table
+};
+
+udResult udChunkedArrayHashIndex_Reserve(udChunkedArrayHashIndex *pIndex, size_t count);
+void udChunkedArrayHashIndex_Reset(udChunkedArrayHashIndex *pIndex);
+void udChunkedArrayHashIndex_Insert(udChunkedArrayHashIndex *pIndex, size_t index, uint32_t hash);
+size_t udChunkedArrayHashIndex_FindSlot(const udChunkedArrayHashIndex *pIndex, size_t index, uint32_t hash); // Returns SIZE_MAX if index isn't in the table
+void udChunkedArrayHashIndex_RemoveSlot(udChunkedArrayHashIndex *pIndex, size_t slot);
+
 template <typename T>
 struct udChunkedArray
 {
-  udResult Init(size_t chunkElementCount);
-  udResult Deinit();
-  udResult Clear();
+  udResult Init(size_t chunkElementCount, udArena *pArena = nullptr); // With an arena, storage is allocated from it and released with it rather than by Deinit
+  udResult Deinit();                             // Destroys all elements and frees the storage
+  udResult Clear();                              // Destroys all elements, keeping the storage
 
   T &operator[](size_t index);
   const T &operator[](size_t index) const;
   T *GetElement(size_t index);
   const T *GetElement(size_t index) const;
-  size_t FindIndex(const T &element, size_t compareLen = sizeof(T)) const; // Linear search for matching element (first compareLen bytes compared)
+  size_t FindIndex(const T &element, size_t compareLen = sizeof(T)) const; // Search for the first matching element (first compareLen bytes compared), returns length if not found
   void SetElement(size_t index, const T &data);
 
+  // Optional hash index on the first compareLen bytes of each element, making FindIndex with the same compareLen O(1) expected
+  // rather than a linear search. SetElement, RemoveSwapLast, PopBack and Clear update it in place, and appended elements are
+  // added by the next FindIndex (so those from PushBack(T**) can be filled in first). Operations that shift the indices of
+  // existing elements (PushFront, PopFront, Insert, RemoveAt) leave it to be rebuilt by the next FindIndex.
+  // NOTE: Elements modified directly (operator[], GetElement, iterators) must be followed by InvalidateHashIndex
+  // NOTE: FindIndex updates the index, so concurrent calls need external synchronisation while it is enabled
+  udResult EnableHashIndex(size_t compareLen = sizeof(T));
+  void DisableHashIndex();
+  void InvalidateHashIndex()                     { if (pHashIndex) pHashIndex->valid = false; }
+
   udResult PushBack(const T &v);
-  udResult PushBack(T **ppElement);              // NOTE: Does not zero memory, can fail if memory allocation fails
+  udResult PushBack(T &&v);
+  udResult PushBack(T **ppElement);              // NOTE: Default constructs, so does not zero memory, can fail if memory allocation fails
   T *PushBack();                                 // DEPRECATED: Please use PushBack(const T&) or PushBack(T **)
+  template <typename... Args> udResult EmplaceBack(Args&&... args); // Construct the new element in place from args
 
   udResult PushFront(const T &v);
-  udResult PushFront(T **ppElement);             // NOTE: Does not zero memory, can fail if memory allocation fails
+  udResult PushFront(T &&v);
+  udResult PushFront(T **ppElement);             // NOTE: Default constructs, so does not zero memory, can fail if memory allocation fails
   T *PushFront();                                // DEPRECATED: Please use PushFront(const T&) or PushFront(T **)
+  template <typename... Args> udResult EmplaceFront(Args&&... args); // Construct the new element in place from args
 
   udResult Insert(size_t index, const T *pData = nullptr);  // Insert the element at index, pushing and moving all elements after to make space.
 
-  bool PopBack(T *pData = nullptr);              // Returns false if no element to pop
-  bool PopFront(T *pData = nullptr);             // Returns false if no element to pop
+  bool PopBack(T *pData = nullptr);              // Returns false if no element to pop, the element is moved to pData if supplied then destroyed
+  bool PopFront(T *pData = nullptr);             // Returns false if no element to pop, the element is moved to pData if supplied then destroyed
+
+  // Bulk versions, copying or moving a chunk-sized run at a time. The pops return the number of elements popped (at most count),
+  // moved to pData in array order if supplied
+  udResult PushBackRange(const T *pData, size_t count);
+  size_t PopBackRange(T *pData, size_t count);
+  size_t PopFrontRange(T *pData, size_t count);
   void RemoveAt(size_t index);                   // Remove the element at index, moving all elements after to fill the gap.
   void RemoveSwapLast(size_t index);             // Remove the element at index, swapping with the last element to ensure array is contiguous
 
   udResult ToArray(T *pArray, size_t arrayLength, size_t startIndex = 0, size_t count = 0) const; // Copy elements to an array supplied by caller
-  udResult ToArray(T **ppArray, size_t startIndex = 0, size_t count = 0) const;                   // Copy elements to an array allocated and returned to caller
+  udResult ToArray(T **ppArray, size_t startIndex = 0, size_t count = 0) const;                   // Copy elements to an array allocated and returned to caller, who must destroy non-trivial elements before freeing
 
-  udResult GrowBack(size_t numberOfNewElements); // Push back a number of new elements, zeroing the memory
+  udResult GrowBack(size_t numberOfNewElements); // Push back a number of new elements, zeroing the memory (value constructing non-trivial types)
   udResult ReserveBack(size_t newCapacity);      // Reserve memory for a given number of elements without changing 'length'  NOTE: Does not reduce in size
   udResult AddChunks(size_t numberOfNewChunks);  // Add a given number of chunks capacity without changing 'length'
+  udResult ShrinkToFit();                        // Free the chunks following the last in use (keeping at least one), no effect with an arena
+  udResult Compact();                            // Move the elements to the start of the first chunk, then ShrinkToFit, no effect with an arena
 
   // At element index, return the number of elements including index that follow in the same chunk (ie can be indexed directly)
   // Optionally, if elementsBehind is true, returns the the number of elements BEHIND index in the same chunk instead
@@ -71,6 +155,10 @@ struct udChunkedArray
   iterator begin();
   iterator end();
 
+  // Iterate count elements from startIndex (zero count for all that follow) as one span per chunk, eg for (auto span : array.Spans()) ...
+  udChunkedArraySpans<T> Spans(size_t startIndex = 0, size_t count = 0);
+  udChunkedArraySpans<const T> Spans(size_t startIndex = 0, size_t count = 0) const;
+
   enum { ptrArrayInc = 32};
 
   T **ppChunks;
@@ -80,6 +168,41 @@ struct udChunkedArray
 
   size_t length;
   size_t inset;
+
+  udArena *pArena;
+  udChunkedArrayHashIndex *pHashIndex;
+
+protected:
+  typedef std::is_trivially_copyable<T> IsTrivial;
+
+  udResult AllocBack(T **ppElement);             // Take storage for a new last element without constructing it
+  udResult AllocFront(T **ppElement);            // Take storage for a new first element without constructing it
+  void DestroyElements(size_t, size_t, std::true_type) {}
+  void DestroyElements(size_t index, size_t count, std::false_type);
+  static void ValueConstruct(T *pElement, size_t count, std::true_type) { memset(pElement, 0, count * sizeof(T)); }
+  static void ValueConstruct(T *pElement, size_t count, std::false_type);
+  udResult Insert(size_t index, const T *pData, std::true_type);
+  udResult Insert(size_t index, const T *pData, std::false_type);
+  void RemoveAt(size_t index, std::true_type);
+  void RemoveAt(size_t index, std::false_type);
+  static void CopyElements(T *pDest, const T *pSource, size_t count, std::true_type) { memcpy(pDest, pSource, count * sizeof(T)); }
+  static void CopyElements(T *pDest, const T *pSource, size_t count, std::false_type);
+  static void CopyConstruct(T *pDest, const T *pSource, size_t count, std::true_type) { memcpy(pDest, pSource, count * sizeof(T)); }
+  static void CopyConstruct(T *pDest, const T *pSource, size_t count, std::false_type);
+  static void MoveOutAndDestroy(T *pDest, T *pSource, size_t count, std::true_type) { if (pDest) memcpy(pDest, pSource, count * sizeof(T)); }
+  static void MoveOutAndDestroy(T *pDest, T *pSource, size_t count, std::false_type);
+  void RotateChunks(size_t count);               // Rotate the first count chunk pointers to the end
+  void CompactElements(std::true_type);
+  void CompactElements(std::false_type);
+  uint32_t HashIndexHash(const T *pElement) const { return udCrc32c(pElement, pHashIndex->compareLen); }
+  bool HashIndexSync() const;                    // Bring the table up to date with the array, false if it couldn't be allocated
+  void HashIndexRemove(size_t index);            // Remove an indexed element's entry, before it is changed or destroyed
+  void HashIndexTruncate(size_t newLength);      // Remove the entries of the indexed elements from newLength on
+
+  T *AllocChunk();
+  T **AllocPtrArray(size_t count);
+  size_t GrowPtrArraySize(size_t minSize) const;
+  void FreeStorage(void *pMemory);
 };
 
 // --------------------------------------------------------------------------
@@ -112,14 +235,41 @@ bool udChunkedArrayIterator<T>::operator!=(const udChunkedArrayIterator<T> &rhs)
   return !(ppCurrChunk == rhs.ppCurrChunk && currChunkElementIndex == rhs.currChunkElementIndex);
 }
 
+// --------------------------------------------------------------------------
+template <typename T>
+inline udChunkedArraySpanIterator<T> &udChunkedArraySpanIterator<T>::operator++()
+{
+  remaining -= udMin(chunkElementCount - currChunkElementIndex, remaining);
+  currChunkElementIndex = 0;
+  ++ppCurrChunk;
+  return *this;
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline udChunkedArraySpan<T> udChunkedArraySpanIterator<T>::operator*() const
+{
+  return udChunkedArraySpan<T>{ *ppCurrChunk + currChunkElementIndex, udMin(chunkElementCount - currChunkElementIndex, remaining) };
+}
+
+// --------------------------------------------------------------------------
+// Only the number remaining is compared, so any exhausted iterator equals end()
+template <typename T>
+inline bool udChunkedArraySpanIterator<T>::operator!=(const udChunkedArraySpanIterator<T> &rhs) const
+{
+  return remaining != rhs.remaining;
+}
+
 // --------------------------------------------------------------------------
 // Author: David Ely, May 2015
 template <typename T>
-inline udResult udChunkedArray<T>::Init(size_t a_chunkElementCount)
+inline udResult udChunkedArray<T>::Init(size_t a_chunkElementCount, udArena *a_pArena)
 {
   udResult result = udR_Success;
   size_t c = 0;
 
+  pArena = a_pArena;
+  pHashIndex = nullptr;
   ppChunks = nullptr;
   chunkElementCount = 0;
   chunkCount = 0;
@@ -137,21 +287,22 @@ inline udResult udChunkedArray<T>::Init(size_t a_chunkElementCount)
   else
     ptrArraySize = ptrArrayInc;
 
-  ppChunks = udAllocType(T*, ptrArraySize, udAF_Zero);
+  ppChunks = AllocPtrArray(ptrArraySize);
   UD_ERROR_NULL(ppChunks, udR_MemoryAllocationFailure);
 
   for (; c < chunkCount; ++c)
   {
-    ppChunks[c] = udAllocType(T, chunkElementCount, udAF_None);
+    ppChunks[c] = AllocChunk();
     UD_ERROR_NULL(ppChunks[c], udR_MemoryAllocationFailure);
   }
 
 epilogue:
-  if (result != udR_Success)
+  if (result != udR_Success && ppChunks)
   {
     for (size_t i = 0; i < c; ++i)
-      udFree(ppChunks[i]);
-    udFree(ppChunks);
+      FreeStorage(ppChunks[i]);
+    FreeStorage(ppChunks);
+    ppChunks = nullptr;
   }
 
   return result;
@@ -162,10 +313,15 @@ epilogue:
 template <typename T>
 inline udResult udChunkedArray<T>::Deinit()
 {
+  if (ppChunks)
+    DestroyElements(0, length, std::is_trivially_destructible<T>());
+
   for (size_t c = 0; c < chunkCount; ++c)
-    udFree(ppChunks[c]);
+    FreeStorage(ppChunks[c]);
 
-  udFree(ppChunks);
+  FreeStorage(ppChunks);
+  ppChunks = nullptr;
+  DisableHashIndex();
 
   chunkCount = 0;
   length = 0;
@@ -179,8 +335,11 @@ inline udResult udChunkedArray<T>::Deinit()
 template <typename T>
 inline udResult udChunkedArray<T>::Clear()
 {
+  DestroyElements(0, length, std::is_trivially_destructible<T>());
   length = 0;
   inset = 0;
+  if (pHashIndex)
+    udChunkedArrayHashIndex_Reset(pHashIndex);
 
   return udR_Success;
 }
@@ -194,13 +353,13 @@ inline udResult udChunkedArray<T>::AddChunks(size_t numberOfNewChunks)
 
   if (newChunkCount > ptrArraySize)
   {
-    size_t newPtrArraySize = ((newChunkCount + ptrArrayInc - 1) / ptrArrayInc) * ptrArrayInc;
-    T **newppChunks = udAllocType(T*, newPtrArraySize, udAF_Zero);
+    size_t newPtrArraySize = GrowPtrArraySize(newChunkCount);
+    T **newppChunks = AllocPtrArray(newPtrArraySize);
     if (!newppChunks)
       return udR_MemoryAllocationFailure;
 
     memcpy(newppChunks, ppChunks, ptrArraySize * sizeof(T*));
-    udFree(ppChunks);
+    FreeStorage(ppChunks);
 
     ppChunks = newppChunks;
     ptrArraySize = newPtrArraySize;
@@ -208,7 +367,7 @@ inline udResult udChunkedArray<T>::AddChunks(size_t numberOfNewChunks)
 
   for (size_t c = chunkCount; c < newChunkCount; ++c)
   {
-    ppChunks[c] = udAllocType(T, chunkElementCount, udAF_None);
+    ppChunks[c] = AllocChunk();
     if (!ppChunks[c])
     {
       chunkCount = c;
@@ -220,6 +379,52 @@ inline udResult udChunkedArray<T>::AddChunks(size_t numberOfNewChunks)
   return udR_Success;
 }
 
+// --------------------------------------------------------------------------
+template <typename T>
+inline udResult udChunkedArray<T>::ShrinkToFit()
+{
+  if (pArena)
+    return udR_Success;
+
+  size_t usedChunkCount = udMax((inset + length + chunkElementCount - 1) / chunkElementCount, (size_t)1);
+  for (size_t c = usedChunkCount; c < chunkCount; ++c)
+  {
+    FreeStorage(ppChunks[c]);
+    ppChunks[c] = nullptr;
+  }
+  chunkCount = udMin(chunkCount, usedChunkCount);
+
+  size_t newPtrArraySize = ((chunkCount + ptrArrayInc - 1) / ptrArrayInc) * ptrArrayInc;
+  if (newPtrArraySize < ptrArraySize)
+  {
+    T **ppNewChunks = AllocPtrArray(newPtrArraySize);
+    if (ppNewChunks) // Keeping the larger pointer array is harmless
+    {
+      memcpy(ppNewChunks, ppChunks, chunkCount * sizeof(T*));
+      FreeStorage(ppChunks);
+      ppChunks = ppNewChunks;
+      ptrArraySize = newPtrArraySize;
+    }
+  }
+
+  return udR_Success;
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline udResult udChunkedArray<T>::Compact()
+{
+  if (pArena) // Nothing could be released, so moving the elements gains nothing
+    return udR_Success;
+
+  if (inset)
+  {
+    CompactElements(IsTrivial());
+    inset = 0;
+  }
+  return ShrinkToFit();
+}
+
 // --------------------------------------------------------------------------
 // Author: Khan Maxfield, February 2016
 template <typename T>
@@ -228,39 +433,22 @@ inline udResult udChunkedArray<T>::GrowBack(size_t numberOfNewElements)
   if (numberOfNewElements == 0)
     return udR_InvalidParameter_;
 
-  size_t oldLength = inset + length;
-  size_t newLength = oldLength + numberOfNewElements;
-  size_t prevUsedChunkCount = (oldLength + chunkElementCount - 1) / chunkElementCount;
-
   udResult res = ReserveBack(length + numberOfNewElements);
   if (res != udR_Success)
     return res;
 
-  // Zero new elements
-  size_t newUsedChunkCount = (newLength + chunkElementCount - 1) / chunkElementCount;
-  size_t usedChunkDelta = newUsedChunkCount - prevUsedChunkCount;
-  size_t head = oldLength % chunkElementCount;
-
-  if (usedChunkDelta)
-  {
-    if (head)
-      memset(&ppChunks[prevUsedChunkCount - 1][head], 0, (chunkElementCount - head) * sizeof(T));
-
-    size_t tail = newLength % chunkElementCount;
-
-    for (size_t chunkIndex = prevUsedChunkCount; chunkIndex < (newUsedChunkCount - 1 + !tail); ++chunkIndex)
-      memset(ppChunks[chunkIndex], 0, sizeof(T) * chunkElementCount);
-
-    if (tail)
-      memset(&ppChunks[newUsedChunkCount - 1][0], 0, tail * sizeof(T));
-  }
-  else
+  // Zero (or value construct) the new elements a run at a time within each chunk
+  size_t newLength = length + numberOfNewElements;
+  while (length < newLength)
   {
-    memset(&ppChunks[prevUsedChunkCount - 1][head], 0, numberOfNewElements * sizeof(T));
+    size_t index = inset + length;
+    size_t runLen = chunkElementCount - (index % chunkElementCount);
+    if (runLen > newLength - length)
+      runLen = newLength - length;
+    ValueConstruct(&ppChunks[index / chunkElementCount][index % chunkElementCount], runLen, IsTrivial());
+    length += runLen;
   }
 
-  length += numberOfNewElements;
-
   return udR_Success;
 }
 
@@ -328,6 +516,20 @@ inline const T* udChunkedArray<T>::GetElement(size_t index) const
 template <typename T>
 inline size_t udChunkedArray<T>::FindIndex(const T &element, size_t compareLen) const
 {
+  if (pHashIndex && compareLen == pHashIndex->compareLen && HashIndexSync())
+  {
+    // Equal elements may share a probe sequence, so the whole sequence is checked for the lowest index
+    uint32_t hash = HashIndexHash(&element);
+    size_t found = length;
+    for (size_t slot = hash & pHashIndex->slotMask; pHashIndex->pSlots[slot].entry; slot = (slot + 1) & pHashIndex->slotMask)
+    {
+      const udChunkedArrayHashSlot &entry = pHashIndex->pSlots[slot];
+      if (entry.hash == hash && entry.entry - 1 < found && memcmp(&element, GetElement(entry.entry - 1), compareLen) == 0)
+        found = entry.entry - 1;
+    }
+    return found;
+  }
+
   size_t index = 0;
   while (index < length)
   {
@@ -349,15 +551,55 @@ template <typename T>
 inline void udChunkedArray<T>::SetElement(size_t index, const T &data)
 {
   UDASSERT(index < length, "Index out of bounds");
-  index += inset;
-  size_t chunkIndex = index / chunkElementCount;
-  ppChunks[chunkIndex][index % chunkElementCount] = data;
+  bool reindex = pHashIndex && pHashIndex->valid && index < pHashIndex->indexedCount;
+  if (reindex)
+    HashIndexRemove(index);
+
+  T *pElement = GetElement(index);
+  *pElement = data;
+
+  if (reindex && pHashIndex->valid)
+    udChunkedArrayHashIndex_Insert(pHashIndex, index, HashIndexHash(pElement));
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline udResult udChunkedArray<T>::EnableHashIndex(size_t compareLen)
+{
+  udResult result;
+
+  UD_ERROR_IF(compareLen == 0 || compareLen > sizeof(T), udR_InvalidParameter_);
+  if (!pHashIndex)
+  {
+    pHashIndex = udAllocType(udChunkedArrayHashIndex, 1, udAF_Zero);
+    UD_ERROR_NULL(pHashIndex, udR_MemoryAllocationFailure);
+  }
+  pHashIndex->compareLen = compareLen;
+  pHashIndex->valid = false;
+  UD_ERROR_IF(!HashIndexSync(), udR_MemoryAllocationFailure);
+  result = udR_Success;
+
+epilogue:
+  if (result != udR_Success)
+    DisableHashIndex();
+  return result;
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline void udChunkedArray<T>::DisableHashIndex()
+{
+  if (pHashIndex)
+  {
+    udFree(pHashIndex->pSlots);
+    udFree(pHashIndex);
+  }
 }
 
 // --------------------------------------------------------------------------
 // Author: Khan Maxfield, February 2016
 template <typename T>
-inline udResult udChunkedArray<T>::PushBack(T **ppElement)
+inline udResult udChunkedArray<T>::AllocBack(T **ppElement)
 {
   UDASSERT(ppElement, "parameter is null");
 
@@ -374,6 +616,18 @@ inline udResult udChunkedArray<T>::PushBack(T **ppElement)
   return udR_Success;
 }
 
+// --------------------------------------------------------------------------
+// Author: Khan Maxfield, February 2016
+template <typename T>
+inline udResult udChunkedArray<T>::PushBack(T **ppElement)
+{
+  udResult res = AllocBack(ppElement);
+  if (res == udR_Success)
+    new (*ppElement) T;
+
+  return res;
+}
+
 // --------------------------------------------------------------------------
 // Author: Khan Maxfield, February 2016
 template <typename T>
@@ -381,8 +635,8 @@ inline T *udChunkedArray<T>::PushBack()
 {
   T *pElement = nullptr;
 
-  if (PushBack(&pElement) == udR_Success)
-    memset(pElement, 0, sizeof(T));
+  if (AllocBack(&pElement) == udR_Success)
+    ValueConstruct(pElement, 1, IsTrivial());
 
   return pElement;
 }
@@ -394,9 +648,36 @@ inline udResult udChunkedArray<T>::PushBack(const T &v)
 {
   T *pElement = nullptr;
 
-  udResult res = PushBack(&pElement);
+  udResult res = AllocBack(&pElement);
+  if (res == udR_Success)
+    new (pElement) T(v);
+
+  return res;
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline udResult udChunkedArray<T>::PushBack(T &&v)
+{
+  T *pElement = nullptr;
+
+  udResult res = AllocBack(&pElement);
+  if (res == udR_Success)
+    new (pElement) T(std::move(v));
+
+  return res;
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+template <typename... Args>
+inline udResult udChunkedArray<T>::EmplaceBack(Args&&... args)
+{
+  T *pElement = nullptr;
+
+  udResult res = AllocBack(&pElement);
   if (res == udR_Success)
-    *pElement = v;
+    new (pElement) T(std::forward<Args>(args)...);
 
   return res;
 }
@@ -404,9 +685,10 @@ inline udResult udChunkedArray<T>::PushBack(const T &v)
 // --------------------------------------------------------------------------
 // Author: David Ely, March 2016
 template <typename T>
-inline udResult udChunkedArray<T>::PushFront(T **ppElement)
+inline udResult udChunkedArray<T>::AllocFront(T **ppElement)
 {
   UDASSERT(ppElement, "parameter is null");
+  InvalidateHashIndex();
 
   if (inset)
   {
@@ -419,14 +701,15 @@ inline udResult udChunkedArray<T>::PushFront(T **ppElement)
       // Are we out of pointers
       if ((chunkCount + 1) > ptrArraySize)
       {
-        T **ppNewChunks = udAllocType(T*, (ptrArraySize + ptrArrayInc), udAF_Zero);
+        size_t newPtrArraySize = GrowPtrArraySize(chunkCount + 1);
+        T **ppNewChunks = AllocPtrArray(newPtrArraySize);
         if (!ppNewChunks)
           return udR_MemoryAllocationFailure;
 
-        ptrArraySize += ptrArrayInc;
+        ptrArraySize = newPtrArraySize;
         memcpy(ppNewChunks + 1, ppChunks, chunkCount * sizeof(T*));
 
-        udFree(ppChunks);
+        FreeStorage(ppChunks);
         ppChunks = ppNewChunks;
       }
       else
@@ -443,7 +726,7 @@ inline udResult udChunkedArray<T>::PushFront(T **ppElement)
       }
       else
       {
-        T *pNewBlock = udAllocType(T, chunkElementCount, udAF_None);
+        T *pNewBlock = AllocChunk();
         if (!pNewBlock)
         {
           memmove(ppChunks, ppChunks + 1, chunkCount * sizeof(T*));
@@ -463,6 +746,18 @@ inline udResult udChunkedArray<T>::PushFront(T **ppElement)
   return udR_Success;
 }
 
+// --------------------------------------------------------------------------
+// Author: Khan Maxfield, February 2016
+template <typename T>
+inline udResult udChunkedArray<T>::PushFront(T **ppElement)
+{
+  udResult res = AllocFront(ppElement);
+  if (res == udR_Success)
+    new (*ppElement) T;
+
+  return res;
+}
+
 // --------------------------------------------------------------------------
 // Author: Khan Maxfield, February 2016
 template <typename T>
@@ -470,8 +765,8 @@ inline T *udChunkedArray<T>::PushFront()
 {
   T *pElement = nullptr;
 
-  if (PushFront(&pElement) == udR_Success)
-    memset(pElement, 0, sizeof(T));
+  if (AllocFront(&pElement) == udR_Success)
+    ValueConstruct(pElement, 1, IsTrivial());
 
   return pElement;
 }
@@ -483,9 +778,36 @@ inline udResult udChunkedArray<T>::PushFront(const T &v)
 {
   T *pElement = nullptr;
 
-  udResult res = PushFront(&pElement);
+  udResult res = AllocFront(&pElement);
+  if (res == udR_Success)
+    new (pElement) T(v);
+
+  return res;
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline udResult udChunkedArray<T>::PushFront(T &&v)
+{
+  T *pElement = nullptr;
+
+  udResult res = AllocFront(&pElement);
+  if (res == udR_Success)
+    new (pElement) T(std::move(v));
+
+  return res;
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+template <typename... Args>
+inline udResult udChunkedArray<T>::EmplaceFront(Args&&... args)
+{
+  T *pElement = nullptr;
+
+  udResult res = AllocFront(&pElement);
   if (res == udR_Success)
-    *pElement = v;
+    new (pElement) T(std::forward<Args>(args)...);
 
   return res;
 }
@@ -497,8 +819,11 @@ inline bool udChunkedArray<T>::PopBack(T *pDest)
 {
   if (length)
   {
+    HashIndexTruncate(length - 1);
+    T *pElement = GetElement(length - 1);
     if (pDest)
-      *pDest = *GetElement(length - 1);
+      *pDest = std::move(*pElement);
+    pElement->~T();
     --length;
 
     if (length == 0)
@@ -515,8 +840,11 @@ inline bool udChunkedArray<T>::PopFront(T *pDest)
 {
   if (length)
   {
+    InvalidateHashIndex();
+    T *pElement = GetElement(0);
     if (pDest)
-      *pDest = *GetElement(0);
+      *pDest = std::move(*pElement);
+    pElement->~T();
     ++inset;
     if (inset == chunkElementCount)
     {
@@ -538,6 +866,81 @@ inline bool udChunkedArray<T>::PopFront(T *pDest)
   return false;
 }
 
+// --------------------------------------------------------------------------
+template <typename T>
+inline udResult udChunkedArray<T>::PushBackRange(const T *pData, size_t count)
+{
+  UDASSERT(pData || !count, "parameter is null");
+
+  udResult res = ReserveBack(length + count);
+  if (res != udR_Success)
+    return res;
+
+  while (count)
+  {
+    size_t index = inset + length;
+    size_t runLen = udMin(chunkElementCount - (index % chunkElementCount), count);
+    CopyConstruct(&ppChunks[index / chunkElementCount][index % chunkElementCount], pData, runLen, IsTrivial());
+    pData += runLen;
+    count -= runLen;
+    length += runLen;
+  }
+
+  return udR_Success;
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline size_t udChunkedArray<T>::PopBackRange(T *pData, size_t count)
+{
+  count = udMin(count, length);
+  if (count == 0)
+    return 0;
+
+  HashIndexTruncate(length - count);
+  for (udChunkedArraySpan<T> span : Spans(length - count, count))
+  {
+    MoveOutAndDestroy(pData, span.pData, span.count, IsTrivial());
+    if (pData)
+      pData += span.count;
+  }
+
+  length -= count;
+  if (length == 0)
+    inset = 0;
+  return count;
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline size_t udChunkedArray<T>::PopFrontRange(T *pData, size_t count)
+{
+  count = udMin(count, length);
+  if (count == 0)
+    return 0;
+
+  InvalidateHashIndex();
+  for (udChunkedArraySpan<T> span : Spans(0, count))
+  {
+    MoveOutAndDestroy(pData, span.pData, span.count, IsTrivial());
+    if (pData)
+      pData += span.count;
+  }
+
+  // As with PopFront, emptied chunks are moved to the back for reuse
+  length -= count;
+  if (length == 0)
+  {
+    inset = 0;
+  }
+  else
+  {
+    RotateChunks((inset + count) / chunkElementCount);
+    inset = (inset + count) % chunkElementCount;
+  }
+  return count;
+}
+
 // --------------------------------------------------------------------------
 // Author: Samuel Surtees, October 2015
 template <typename T>
@@ -546,45 +949,59 @@ inline void udChunkedArray<T>::RemoveAt(size_t index)
   UDASSERT(index < length, "Index out of bounds");
 
   if (index == 0)
-  {
     PopFront();
-  }
   else if (index == (length - 1))
-  {
     PopBack();
-  }
   else
   {
-    index += inset;
+    InvalidateHashIndex();
+    RemoveAt(index, IsTrivial());
+  }
+}
 
-    size_t chunkIndex = index / chunkElementCount;
+// --------------------------------------------------------------------------
+// Author: Samuel Surtees, October 2015
+template <typename T>
+inline void udChunkedArray<T>::RemoveAt(size_t index, std::true_type)
+{
+  index += inset;
 
-    // Move within the chunk of the remove item
-    if ((index % chunkElementCount) != (chunkElementCount - 1)) // If there are items after the remove item
-      memmove(&ppChunks[chunkIndex][index % chunkElementCount], &ppChunks[chunkIndex][(index + 1) % chunkElementCount], sizeof(T) * (chunkElementCount - 1 - (index % chunkElementCount)));
+  size_t chunkIndex = index / chunkElementCount;
 
-    // Handle middle chunks
-    for (size_t i = (chunkIndex + 1); i < (chunkCount - 1); ++i)
-    {
-      // Move first item down
-      memcpy(&ppChunks[i - 1][chunkElementCount - 1], &ppChunks[i][0], sizeof(T));
+  // Move within the chunk of the remove item
+  if ((index % chunkElementCount) != (chunkElementCount - 1)) // If there are items after the remove item
+    memmove(&ppChunks[chunkIndex][index % chunkElementCount], &ppChunks[chunkIndex][(index + 1) % chunkElementCount], sizeof(T) * (chunkElementCount - 1 - (index % chunkElementCount)));
 
-      // Move remaining items
-      memmove(&ppChunks[i][0], &ppChunks[i][1], sizeof(T) * (chunkElementCount - 1));
-    }
+  // Handle middle chunks
+  for (size_t i = (chunkIndex + 1); i < (chunkCount - 1); ++i)
+  {
+    // Move first item down
+    memcpy(&ppChunks[i - 1][chunkElementCount - 1], &ppChunks[i][0], sizeof(T));
 
-    // Handle last chunk
-    if (chunkIndex != (chunkCount - 1))
-    {
-      // Move first item down
-      memcpy(&ppChunks[chunkCount - 2][chunkElementCount - 1], &ppChunks[chunkCount - 1][0], sizeof(T));
+    // Move remaining items
+    memmove(&ppChunks[i][0], &ppChunks[i][1], sizeof(T) * (chunkElementCount - 1));
+  }
 
-      // Move remaining items
-      memmove(&ppChunks[chunkCount - 1][0], &ppChunks[chunkCount - 1][1], sizeof(T) * ((length + (inset - 1)) % chunkElementCount));
-    }
+  // Handle last chunk
+  if (chunkIndex != (chunkCount - 1))
+  {
+    // Move first item down
+    memcpy(&ppChunks[chunkCount - 2][chunkElementCount - 1], &ppChunks[chunkCount - 1][0], sizeof(T));
 
-    PopBack();
+    // Move remaining items
+    memmove(&ppChunks[chunkCount - 1][0], &ppChunks[chunkCount - 1][1], sizeof(T) * ((length + (inset - 1)) % chunkElementCount));
   }
+
+  PopBack();
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline void udChunkedArray<T>::RemoveAt(size_t index, std::false_type)
+{
+  for (; index < length - 1; ++index)
+    (*this)[index] = std::move((*this)[index + 1]);
+  PopBack();
 }
 
 // --------------------------------------------------------------------------
@@ -593,11 +1010,35 @@ template <typename T>
 inline void udChunkedArray<T>::RemoveSwapLast(size_t index)
 {
   UDASSERT(index < length, "Index out of bounds");
+  size_t last = length - 1;
 
-  // Only copy the last element over if the element being removed isn't the last element
-  if (index != (length - 1))
-    SetElement(index, *GetElement(length - 1));
+  // The last element's entry moves with it, or if it hasn't been indexed yet it is added once in place
+  bool indexMoved = false;
+  if (index != last && pHashIndex && pHashIndex->valid && index < pHashIndex->indexedCount)
+  {
+    HashIndexRemove(index);
+    if (pHashIndex->valid && last < pHashIndex->indexedCount)
+    {
+      size_t slot = udChunkedArrayHashIndex_FindSlot(pHashIndex, last, HashIndexHash(GetElement(last)));
+      if (slot == SIZE_MAX)
+        pHashIndex->valid = false;
+      else
+        pHashIndex->pSlots[slot].entry = index + 1;
+      pHashIndex->indexedCount = last;
+    }
+    else
+    {
+      indexMoved = true;
+    }
+  }
+
+  // Only move the last element over if the element being removed isn't the last element
+  if (index != last)
+    (*this)[index] = std::move((*this)[last]);
   PopBack();
+
+  if (indexMoved && pHashIndex->valid)
+    udChunkedArrayHashIndex_Insert(pHashIndex, index, HashIndexHash(GetElement(index)));
 }
 
 // --------------------------------------------------------------------------
@@ -618,7 +1059,7 @@ inline udResult udChunkedArray<T>::ToArray(T *pArray, size_t arrayLength, size_t
     size_t runLen = GetElementRunLength(startIndex);
     if (runLen > count)
       runLen = count;
-    memcpy(pArray, GetElement(startIndex), runLen * sizeof(T));
+    CopyElements(pArray, GetElement(startIndex), runLen, IsTrivial());
     pArray += runLen;
     startIndex += runLen;
     count -= runLen;
@@ -644,9 +1085,15 @@ udResult udChunkedArray<T>::ToArray(T **ppArray, size_t startIndex, size_t count
 
   if (count)
   {
+    UD_ERROR_IF((startIndex + count) > length, udR_OutOfRange);
     pArray = udAllocType(T, count, udAF_None);
     UD_ERROR_NULL(pArray, udR_MemoryAllocationFailure);
-    UD_ERROR_CHECK(ToArray(pArray, count, startIndex, count));
+    T *pNext = pArray;
+    for (udChunkedArraySpan<const T> span : Spans(startIndex, count))
+    {
+      CopyConstruct(pNext, span.pData, span.count, IsTrivial());
+      pNext += span.count;
+    }
   }
   // Transfer ownership of array and assign success
   *ppArray = pArray;
@@ -664,7 +1111,16 @@ template <typename T>
 inline udResult udChunkedArray<T>::Insert(size_t index, const T *pData)
 {
   UDASSERT(index <= length, "Index out of bounds");
+  if (index < length)
+    InvalidateHashIndex();
+  return Insert(index, pData, IsTrivial());
+}
 
+// --------------------------------------------------------------------------
+// Author: Dave Pevreal, May 2018
+template <typename T>
+inline udResult udChunkedArray<T>::Insert(size_t index, const T *pData, std::true_type)
+{
   if (inset != 0 && (index + inset) < chunkElementCount)
   {
     // Special case: if inserting into the first chunk and there's an inset,
@@ -703,6 +1159,47 @@ inline udResult udChunkedArray<T>::Insert(size_t index, const T *pData)
   return udR_Success;
 }
 
+// --------------------------------------------------------------------------
+// Elements are moved one at a time towards whichever end the trivial version would grow, opening a gap at index
+template <typename T>
+inline udResult udChunkedArray<T>::Insert(size_t index, const T *pData, std::false_type)
+{
+  T *pElement = nullptr;
+  bool front = (inset != 0 && (index + inset) < chunkElementCount);
+  udResult result = front ? AllocFront(&pElement) : AllocBack(&pElement);
+  if (result != udR_Success)
+    return result;
+
+  if (front && index > 0)
+  {
+    new (pElement) T(std::move((*this)[1]));
+    for (size_t i = 1; i < index; ++i)
+      (*this)[i] = std::move((*this)[i + 1]);
+  }
+  else if (!front && index < length - 1)
+  {
+    new (pElement) T(std::move((*this)[length - 2]));
+    for (size_t i = length - 2; i > index; --i)
+      (*this)[i] = std::move((*this)[i - 1]);
+  }
+  else
+  {
+    // The new storage is the insertion point
+    if (pData)
+      new (pElement) T(*pData);
+    else
+      new (pElement) T();
+    return udR_Success;
+  }
+
+  if (pData)
+    (*this)[index] = *pData;
+  else
+    (*this)[index] = T();
+
+  return udR_Success;
+}
+
 // --------------------------------------------------------------------------
 // Author: Dave Pevreal, November 2017
 template <typename T>
@@ -735,4 +1232,207 @@ inline typename udChunkedArray<T>::iterator udChunkedArray<T>::end()
   return udChunkedArray<T>::iterator{ &ppChunks[(inset + length) / chunkElementCount], (inset + length) % chunkElementCount, chunkElementCount };
 }
 
+// --------------------------------------------------------------------------
+template <typename T>
+inline udChunkedArraySpans<T> udChunkedArray<T>::Spans(size_t startIndex, size_t count)
+{
+  UDASSERT(startIndex + count <= length, "Index out of bounds");
+  if (count == 0)
+    count = length - startIndex;
+  startIndex += inset;
+  return udChunkedArraySpans<T>{ { &ppChunks[startIndex / chunkElementCount], startIndex % chunkElementCount, count, chunkElementCount } };
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline udChunkedArraySpans<const T> udChunkedArray<T>::Spans(size_t startIndex, size_t count) const
+{
+  UDASSERT(startIndex + count <= length, "Index out of bounds");
+  if (count == 0)
+    count = length - startIndex;
+  startIndex += inset;
+  return udChunkedArraySpans<const T>{ { &ppChunks[startIndex / chunkElementCount], startIndex % chunkElementCount, count, chunkElementCount } };
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline void udChunkedArray<T>::DestroyElements(size_t index, size_t count, std::false_type)
+{
+  for (size_t i = 0; i < count; ++i)
+    GetElement(index + i)->~T();
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline void udChunkedArray<T>::ValueConstruct(T *pElement, size_t count, std::false_type)
+{
+  for (size_t i = 0; i < count; ++i)
+    new (&pElement[i]) T();
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline void udChunkedArray<T>::CopyElements(T *pDest, const T *pSource, size_t count, std::false_type)
+{
+  for (size_t i = 0; i < count; ++i)
+    pDest[i] = pSource[i];
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline void udChunkedArray<T>::CopyConstruct(T *pDest, const T *pSource, size_t count, std::false_type)
+{
+  for (size_t i = 0; i < count; ++i)
+    new (&pDest[i]) T(pSource[i]);
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline void udChunkedArray<T>::MoveOutAndDestroy(T *pDest, T *pSource, size_t count, std::false_type)
+{
+  for (size_t i = 0; i < count; ++i)
+  {
+    if (pDest)
+      pDest[i] = std::move(pSource[i]);
+    pSource[i].~T();
+  }
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline void udChunkedArray<T>::RotateChunks(size_t count)
+{
+  if (count == 0 || count >= chunkCount)
+    return;
+
+  // Rotate in place by reversing the two parts and then the whole
+  auto reverse = [](T **ppLo, T **ppHi)
+  {
+    for (; ppLo < ppHi; ++ppLo, --ppHi)
+    {
+      T *pTemp = *ppLo;
+      *ppLo = *ppHi;
+      *ppHi = pTemp;
+    }
+  };
+  reverse(ppChunks, ppChunks + count - 1);
+  reverse(ppChunks + count, ppChunks + chunkCount - 1);
+  reverse(ppChunks, ppChunks + chunkCount - 1);
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline void udChunkedArray<T>::CompactElements(std::true_type)
+{
+  size_t dest = 0;
+  size_t source = inset;
+  for (size_t remaining = length; remaining; )
+  {
+    size_t runLen = udMin(udMin(chunkElementCount - (dest % chunkElementCount), chunkElementCount - (source % chunkElementCount)), remaining);
+    memmove(&ppChunks[dest / chunkElementCount][dest % chunkElementCount], &ppChunks[source / chunkElementCount][source % chunkElementCount], runLen * sizeof(T));
+    dest += runLen;
+    source += runLen;
+    remaining -= runLen;
+  }
+}
+
+// --------------------------------------------------------------------------
+// Slots before inset hold no object yet so are move constructed, later ones hold an element already moved from
+template <typename T>
+inline void udChunkedArray<T>::CompactElements(std::false_type)
+{
+  for (size_t dest = 0; dest < length; ++dest)
+  {
+    size_t source = dest + inset;
+    T *pDest = &ppChunks[dest / chunkElementCount][dest % chunkElementCount];
+    T &sourceElement = ppChunks[source / chunkElementCount][source % chunkElementCount];
+    if (dest < inset)
+      new (pDest) T(std::move(sourceElement));
+    else
+      *pDest = std::move(sourceElement);
+  }
+  for (size_t i = udMax(inset, length); i < inset + length; ++i)
+    ppChunks[i / chunkElementCount][i % chunkElementCount].~T();
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline bool udChunkedArray<T>::HashIndexSync() const
+{
+  udChunkedArrayHashIndex *pIndex = pHashIndex;
+  if (!pIndex->valid)
+    udChunkedArrayHashIndex_Reset(pIndex);
+
+  if (pIndex->indexedCount < length)
+  {
+    if (udChunkedArrayHashIndex_Reserve(pIndex, length) != udR_Success)
+    {
+      pIndex->valid = false;
+      return false;
+    }
+    for (udChunkedArraySpan<const T> span : Spans(pIndex->indexedCount, length - pIndex->indexedCount))
+    {
+      for (size_t i = 0; i < span.count; ++i)
+        udChunkedArrayHashIndex_Insert(pIndex, pIndex->indexedCount++, HashIndexHash(&span.pData[i]));
+    }
+  }
+  return true;
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline void udChunkedArray<T>::HashIndexRemove(size_t index)
+{
+  size_t slot = udChunkedArrayHashIndex_FindSlot(pHashIndex, index, HashIndexHash(GetElement(index)));
+  if (slot == SIZE_MAX)
+    pHashIndex->valid = false; // Modified without InvalidateHashIndex, so start again
+  else
+    udChunkedArrayHashIndex_RemoveSlot(pHashIndex, slot);
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline void udChunkedArray<T>::HashIndexTruncate(size_t newLength)
+{
+  while (pHashIndex && pHashIndex->valid && pHashIndex->indexedCount > newLength)
+    HashIndexRemove(--pHashIndex->indexedCount);
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline T *udChunkedArray<T>::AllocChunk()
+{
+  if (pArena)
+    return udArenaAllocType(pArena, T, chunkElementCount, udAF_None);
+  return udAllocType(T, chunkElementCount, udAF_None);
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline T **udChunkedArray<T>::AllocPtrArray(size_t count)
+{
+  if (pArena)
+    return udArenaAllocType(pArena, T*, count, udAF_Zero);
+  return udAllocType(T*, count, udAF_Zero);
+}
+
+// --------------------------------------------------------------------------
+// Outgrown pointer arrays can't be returned to an arena, so they grow geometrically there to bound the waste
+template <typename T>
+inline size_t udChunkedArray<T>::GrowPtrArraySize(size_t minSize) const
+{
+  size_t newSize = ((minSize + ptrArrayInc - 1) / ptrArrayInc) * ptrArrayInc;
+  if (pArena && newSize < ptrArraySize * 2)
+    newSize = ptrArraySize * 2;
+  return newSize;
+}
+
+// --------------------------------------------------------------------------
+template <typename T>
+inline void udChunkedArray<T>::FreeStorage(void *pMemory)
+{
+  if (!pArena)
+    udFree(pMemory);
+}
+
 #endif // UDCHUNKEDARRAY_H
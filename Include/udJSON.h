@@ -11,6 +11,7 @@
 #include "udPlatform.h"
 #include "udChunkedArray.h"
 #include "udMath.h"
+#include "udStringUtil.h"
 
 #if !defined(UDVALUE_DEPRECATED)
 #define udValue udJSON
@@ -114,6 +115,13 @@ public:
   void Destroy();     // Free any memory associated, expects object to be constructed
   inline ~udJSON();
 
+  // Copies are shallow, sharing any memory with the original, so all but one must be Cleared rather than destroyed
+  udJSON(const udJSON &other) = default;
+  udJSON &operator=(const udJSON &other) = default;
+  // Moving transfers any memory, leaving the original void
+  inline udJSON(udJSON &&other);
+  inline udJSON &operator=(udJSON &&other);
+
   // Set the value
   inline void SetVoid();
   inline void Set(bool v);
@@ -121,9 +129,10 @@ public:
   inline void Set(double v);
 
   // Set to a more complex type requiring memory allocation
-  udResult SetString(const char *pStr, size_t charCount = 0); // non-zero charCount specifies maximum characters copied
-  udResult SetArray(); // A dynamic array of JSON elements, whose types can change per element
-  udResult SetObject();
+  // With an arena, the string or container storage is allocated from it; the arena must outlive the value
+  udResult SetString(const char *pStr, size_t charCount = 0, udArena *pArena = nullptr); // non-zero charCount specifies maximum characters copied
+  udResult SetArray(udArena *pArena = nullptr); // A dynamic array of JSON elements, whose types can change per element
+  udResult SetObject(udArena *pArena = nullptr);
 
   // Some convenience helpers to create an array of doubles
   udResult Set(const udDouble3 &v);
@@ -189,7 +198,9 @@ public:
   UD_PRINTF_FORMAT_FUNC(2) udResult Set(const char *pKeyExpression, ...);
 
   // Parse a string an assign the type/value, supporting string, integer and float/double, JSON or XML
-  udResult Parse(const char *pString, int *pCharCount = nullptr, int *pLineNumber = nullptr);
+  // With an arena, all strings, keys and containers parsed are allocated from it, so building (and with udArena_Destroy,
+  // releasing) a large document takes a handful of allocations. Destroy must still be called before the arena is released
+  udResult Parse(const char *pString, int *pCharCount = nullptr, int *pLineNumber = nullptr, udArena *pArena = nullptr);
 
   // Export to a JSON/XML string
   udResult Export(const char **ppText, udJSONExportOption option = udJEO_JSON) const;
@@ -204,8 +215,8 @@ public:
 protected:
   typedef udChunkedArray<const char*> LineList;
 
-  udResult ParseJSON(const char *pJSON, int *pCharCount, int *pLineNumber);
-  udResult ParseXML(const char *pJSON, int *pCharCount, int *pLineNumber);
+  udResult ParseJSON(const char *pJSON, int *pCharCount, int *pLineNumber, udArena *pArena);
+  udResult ParseXML(const char *pJSON, int *pCharCount, int *pLineNumber, udArena *pArena);
   udResult ToString(const char **ppStr, int indent, const char *pPre, const char *pPost, const char *pQuote, int escape) const;
   udResult ExportJSON(const char *pKey, LineList *pLines, int indent, bool strip, bool comma) const;
   udResult ExportXML(const char *pKey, LineList *pLines, int indent, bool strip) const;
@@ -220,6 +231,7 @@ protected:
     udJSONObject *pObject;
   } u;
   uint8_t dPrec; // Number of digits precision of the double value (0 = default, otherwise set when parsed)
+  uint8_t arenaString; // Non-zero when the string is allocated from a udArena, so isn't freed by Destroy (containers know their own arena)
   Type type;
 };
 
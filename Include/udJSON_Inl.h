@@ -2,10 +2,21 @@
 #define UDJSON_INL_H
 
 inline udJSON::udJSON()           { Clear(); }
-inline udJSON::udJSON(int64_t v)  { type = T_Int64;  u.i64Val = v; dPrec = 0; }
-inline udJSON::udJSON(double v)   { type = T_Double; u.dVal   = v; dPrec = 0; }
-inline void udJSON::Clear()        { type = T_Void;   u.i64Val = 0; dPrec = 0; } // Clear the value without freeing
+inline udJSON::udJSON(int64_t v)  { type = T_Int64;  u.i64Val = v; dPrec = 0; arenaString = 0; }
+inline udJSON::udJSON(double v)   { type = T_Double; u.dVal   = v; dPrec = 0; arenaString = 0; }
+inline void udJSON::Clear()        { type = T_Void;   u.i64Val = 0; dPrec = 0; arenaString = 0; } // Clear the value without freeing
 inline udJSON::~udJSON()          { Destroy(); }
+inline udJSON::udJSON(udJSON &&other) : u(other.u), dPrec(other.dPrec), arenaString(other.arenaString), type(other.type) { other.Clear(); }
+inline udJSON &udJSON::operator=(udJSON &&other)
+{
+  if (this != &other)
+  {
+    Destroy();
+    u = other.u; dPrec = other.dPrec; arenaString = other.arenaString; type = other.type;
+    other.Clear();
+  }
+  return *this;
+}
 
 // Set the value
 inline void udJSON::SetVoid()      { Destroy(); }
@@ -31,5 +42,5 @@ inline const udJSON *udJSON::GetMember(size_t index) const { return (type == T_O
 inline udJSONArray *udJSON::AsArray()     const { return (type == T_Array)   ? u.pArray  : nullptr; }
 inline udJSONObject *udJSON::AsObject()   const { return (type == T_Object)  ? u.pObject : nullptr; }
 inline udResult udJSON::ToString(const char **ppStr, bool escapeBackslashes) const { return ToString(ppStr, 0, "", "", "", escapeBackslashes); }
-inline udResult udJSON::ExtractAndVoid(const char **ppStr) { if (!ppStr) return udR_InvalidParameter_; if (type == T_String) { *ppStr = u.pStr; Clear(); return udR_Success; } return udR_ObjectTypeMismatch; }
+inline udResult udJSON::ExtractAndVoid(const char **ppStr) { if (!ppStr) return udR_InvalidParameter_; if (type == T_String) { *ppStr = arenaString ? udStrdup(u.pStr) : u.pStr; if (!*ppStr) return udR_MemoryAllocationFailure; Clear(); return udR_Success; } return udR_ObjectTypeMismatch; }
 #endif // UDJSON_INL_H
@@ -0,0 +1,201 @@
+#ifndef UDMPMCQUEUE_H
+#define UDMPMCQUEUE_H
+//
+// Copyright (c) Euclideon Pty Ltd
+//
+// Lock free bounded multiple producer, multiple consumer FIFO queue
+//
+// Each cell of a power of 2 sized ring holds a sequence number saying whether it is ready to be written or read on the
+// current lap of the ring, so a producer or consumer claims a position with a single compare exchange and never takes a lock
+// (after Dmitry Vyukov's bounded MPMC queue). Unlike udSafeDeque the capacity is fixed when created, and pushing to a full
+// queue fails rather than growing it
+//
+
+#include "udPlatform.h"
+#include "udResult.h"
+#include <new>
+#include <utility>
+#include <type_traits>
+
+#define UDMPMCQUEUE_CACHE_LINE_SIZE 64
+
+template <typename T>
+struct udMPMCQueueCell
+{
+  volatile int32_t sequence;
+  typename std::aligned_storage<sizeof(T), alignof(T)>::type data;
+};
+
+// The positions only ever increase (wrapping), and are kept on separate cache lines so producers and consumers don't contend
+template <typename T>
+struct udMPMCQueue
+{
+  udMPMCQueueCell<T> *pCells;
+  uint32_t mask;
+  char padding0[UDMPMCQUEUE_CACHE_LINE_SIZE];
+  volatile int32_t pushPosition;
+  char padding1[UDMPMCQUEUE_CACHE_LINE_SIZE - sizeof(int32_t)];
+  volatile int32_t popPosition;
+  char padding2[UDMPMCQUEUE_CACHE_LINE_SIZE - sizeof(int32_t)];
+};
+
+// Create a queue holding up to capacity elements, rounded up to a power of 2
+template <typename T>
+udResult udMPMCQueue_Create(udMPMCQueue<T> **ppQueue, uint32_t capacity);
+
+// Destroys any elements remaining in the queue
+template <typename T>
+void udMPMCQueue_Destroy(udMPMCQueue<T> **ppQueue);
+
+// Returns udR_CountExceeded if the queue is full, in which case v is left unchanged
+template <typename T>
+udResult udMPMCQueue_PushBack(udMPMCQueue<T> *pQueue, const T &v);
+template <typename T>
+udResult udMPMCQueue_PushBack(udMPMCQueue<T> *pQueue, T &&v);
+
+// Returns udR_ObjectNotFound if the queue is empty, otherwise the element is moved to pData if supplied then destroyed
+template <typename T>
+udResult udMPMCQueue_PopFront(udMPMCQueue<T> *pQueue, T *pData);
+
+// Returns the number of elements the queue can hold
+template <typename T>
+inline uint32_t udMPMCQueue_GetCapacity(const udMPMCQueue<T> *pQueue) { return pQueue->mask + 1; }
+
+// ----------------------------------------------------------------------------
+// Claim the cell at *pPosition if its sequence is that position plus offset, returns nullptr if the cell isn't ready because
+// the queue is full (pushing) or empty (popping). The positions wrap, so are compared by their difference
+template <typename T>
+inline udMPMCQueueCell<T> *udMPMCQueue_Claim(udMPMCQueue<T> *pQueue, volatile int32_t *pPosition, uint32_t offset, uint32_t *pClaimed)
+{
+  uint32_t position = (uint32_t)*pPosition;
+  for (;;)
+  {
+    udMPMCQueueCell<T> *pCell = &pQueue->pCells[position & pQueue->mask];
+    int32_t difference = (int32_t)((uint32_t)pCell->sequence - (position + offset));
+    if (difference == 0)
+    {
+      uint32_t previous = (uint32_t)udInterlockedCompareExchange(pPosition, (int32_t)(position + 1), (int32_t)position);
+      if (previous == position)
+      {
+        *pClaimed = position;
+        return pCell;
+      }
+      position = previous;
+    }
+    else if (difference < 0)
+    {
+      return nullptr; // Still to be read (or written) on the previous lap
+    }
+    else
+    {
+      position = (uint32_t)*pPosition; // Another thread claimed this position first
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+template <typename T, typename U>
+inline udResult udMPMCQueue_Push(udMPMCQueue<T> *pQueue, U &&v)
+{
+  uint32_t position;
+  udMPMCQueueCell<T> *pCell;
+
+  if (pQueue == nullptr)
+    return udR_InvalidParameter_;
+
+  pCell = udMPMCQueue_Claim(pQueue, &pQueue->pushPosition, 0, &position);
+  if (!pCell)
+    return udR_CountExceeded;
+
+  new (&pCell->data) T(std::forward<U>(v));
+  udMemoryBarrier(); // The element must be visible before the sequence says it can be read
+  pCell->sequence = (int32_t)(position + 1);
+  return udR_Success;
+}
+
+// ----------------------------------------------------------------------------
+template <typename T>
+udResult udMPMCQueue_Create(udMPMCQueue<T> **ppQueue, uint32_t capacity)
+{
+  udResult result;
+  udMPMCQueue<T> *pQueue = nullptr;
+  uint32_t cellCount = 2;
+
+  UD_ERROR_NULL(ppQueue, udR_InvalidParameter_);
+  UD_ERROR_IF(capacity == 0 || capacity > (1U << 30), udR_InvalidParameter_);
+  while (cellCount < capacity)
+    cellCount *= 2;
+
+  pQueue = udAllocType(udMPMCQueue<T>, 1, udAF_Zero);
+  UD_ERROR_NULL(pQueue, udR_MemoryAllocationFailure);
+  pQueue->pCells = udAllocType(udMPMCQueueCell<T>, cellCount, udAF_None);
+  UD_ERROR_NULL(pQueue->pCells, udR_MemoryAllocationFailure);
+  pQueue->mask = cellCount - 1;
+
+  // Each cell starts ready to be written on the first lap
+  for (uint32_t i = 0; i < cellCount; ++i)
+    pQueue->pCells[i].sequence = (int32_t)i;
+
+  *ppQueue = pQueue;
+  pQueue = nullptr;
+  result = udR_Success;
+
+epilogue:
+  udMPMCQueue_Destroy(&pQueue); // Will be nullptr on success
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+template <typename T>
+void udMPMCQueue_Destroy(udMPMCQueue<T> **ppQueue)
+{
+  if (ppQueue == nullptr || *ppQueue == nullptr)
+    return;
+
+  if ((*ppQueue)->pCells)
+  {
+    while (udMPMCQueue_PopFront(*ppQueue, (T*)nullptr) == udR_Success)
+      ;
+  }
+  udFree((*ppQueue)->pCells);
+  udFree(*ppQueue);
+}
+
+// ----------------------------------------------------------------------------
+template <typename T>
+inline udResult udMPMCQueue_PushBack(udMPMCQueue<T> *pQueue, const T &v)
+{
+  return udMPMCQueue_Push(pQueue, v);
+}
+
+// ----------------------------------------------------------------------------
+template <typename T>
+inline udResult udMPMCQueue_PushBack(udMPMCQueue<T> *pQueue, T &&v)
+{
+  return udMPMCQueue_Push(pQueue, std::move(v));
+}
+
+// ----------------------------------------------------------------------------
+template <typename T>
+inline udResult udMPMCQueue_PopFront(udMPMCQueue<T> *pQueue, T *pData)
+{
+  uint32_t position;
+  udMPMCQueueCell<T> *pCell;
+
+  if (pQueue == nullptr)
+    return udR_InvalidParameter_;
+
+  pCell = udMPMCQueue_Claim(pQueue, &pQueue->popPosition, 1, &position);
+  if (!pCell)
+    return udR_ObjectNotFound;
+
+  T *pElement = (T*)&pCell->data;
+  if (pData)
+    *pData = std::move(*pElement);
+  pElement->~T();
+  udMemoryBarrier(); // Finished with the element before the sequence says the cell can be written on the next lap
+  pCell->sequence = (int32_t)(position + pQueue->mask + 1);
+  return udR_Success;
+}
+
+#endif // UDMPMCQUEUE_H
@@ -0,0 +1,41 @@
+#ifndef UDMEMORYPROFILER_H
+#define UDMEMORYPROFILER_H
+//
+// Copyright (c) Euclideon Pty Ltd
+//
+// Sampling allocation profiler, attributing heap use to the udAlloc/udFree call sites that caused it
+//
+
+#include "udPlatform.h"
+
+class udJSON;
+
+// Roughly one allocation is sampled per this many bytes allocated by a thread
+#define UDMEMORYPROFILER_DEFAULT_SAMPLE_INTERVAL (512 * 1024)
+
+enum udMemoryProfilerSort
+{
+  udMPS_LiveBytes,  // Most bytes still allocated first
+  udMPS_AllocBytes, // Most bytes allocated first
+  udMPS_AllocCount, // Most allocations first, the sites churning the heap
+};
+
+// Set the average number of bytes allocated between samples; 1 samples every allocation and 0 disables sampling.
+// Counts reported are estimates scaled up from the samples taken. Call sites are the file/line passed through
+// IF_MEMORY_DEBUG, which is all builds unless UD_MEMORY_PROFILER is defined to 0
+void udMemoryProfiler_SetSampleInterval(size_t bytes);
+size_t udMemoryProfiler_GetSampleInterval();
+
+// Write the topN call sites (0 for all) to pReport as { "sampleInterval": n, "sites": [ { "file", "line", "allocCount",
+// "allocBytes", "freeCount", "freeBytes", "liveCount", "liveBytes" } ] }, ordered by sort
+udResult udMemoryProfiler_Report(udJSON *pReport, int topN = 0, udMemoryProfilerSort sort = udMPS_LiveBytes);
+
+// Discard everything recorded so far. Allocations sampled before the reset are no longer tracked when freed
+void udMemoryProfiler_Reset();
+
+// Hooks called by the udAlloc, udRealloc and udFree family and by udAllocator_ThreadExit
+void udMemoryProfiler_TrackAlloc(void *pMemory, size_t size, const char *pFile, int line);
+void udMemoryProfiler_TrackFree(void *pMemory);
+void udMemoryProfiler_ThreadExit();
+
+#endif // UDMEMORYPROFILER_H
@@ -0,0 +1,463 @@
+#ifndef UDPARALLEL_H
+#define UDPARALLEL_H
+//
+// Copyright (c) Euclideon Pty Ltd
+//
+// Data-parallel algorithms over udChunkedArray, run on the threads of a udWorkerPool together with the calling thread.
+// Arrays are divided into blocks of whole chunks, so no two threads write into the same chunk. The calling thread takes
+// blocks too, so these may be called from a task running on the same pool, and with a null pool everything runs serially
+//
+
+#include "udChunkedArray.h"
+#include "udWorkerPool.h"
+
+#define UDPARALLEL_BLOCKS_PER_THREAD 4 // Blocks per thread (including the caller), leaving room to balance uneven work
+#define UDPARALLEL_FIXED_BLOCK_SIZE 4096 // Elements per block of the reductions and scans, fixed so their results don't depend on the thread count
+#define UDPARALLEL_CACHE_LINE_SIZE 64
+
+// Calls func(blockIndex) for every block in [0, blockCount) on the pool's threads and the calling thread, returning once all have completed
+udResult udParallel_RunBlocks(udWorkerPool *pPool, size_t blockCount, udCallback<void(size_t)> func);
+
+// Calls func(element, index) for every element
+template <typename T, typename F>
+udResult udParallel_ForEach(udWorkerPool *pPool, udChunkedArray<T> &array, F func);
+
+// Sets *pResult to identity accumulated with accumulate(R, const T &) over every element. Each block of UDPARALLEL_FIXED_BLOCK_SIZE
+// elements accumulates from identity, then the block results are folded with combine(R, R) in array order, so the result
+// (floating point included) doesn't depend on thread timing or the number of threads
+template <typename T, typename R, typename FA, typename FC>
+udResult udParallel_Reduce(udWorkerPool *pPool, const udChunkedArray<T> &array, R *pResult, const R &identity, FA accumulate, FC combine);
+template <typename T, typename R, typename FA, typename FC>
+udResult udParallel_Reduce(udWorkerPool *pPool, const T *pData, size_t count, R *pResult, const R &identity, FA accumulate, FC combine);
+
+// Sets pOutput[i] to identity followed by pInput[0] to pInput[i] folded with op(T, T), pOutput may be pInput. Blocks are
+// scanned from the fold of the blocks before them, so like udParallel_Reduce the results are the same on any number of threads
+// The exclusive scan leaves pInput[i] out of pOutput[i], giving offsets to compact the output of a parallel filter
+// If supplied, *pTotal is set to the fold of every element
+template <typename T, typename F>
+udResult udParallel_InclusiveScan(udWorkerPool *pPool, const T *pInput, T *pOutput, size_t count, const T &identity, F op, T *pTotal = nullptr);
+template <typename T, typename F>
+udResult udParallel_ExclusiveScan(udWorkerPool *pPool, const T *pInput, T *pOutput, size_t count, const T &identity, F op, T *pTotal = nullptr);
+
+// Stable merge sort by less(a, b). Elements must be trivially copyable, and two temporary copies of the array are made
+template <typename T, typename F>
+udResult udParallel_Sort(udWorkerPool *pPool, udChunkedArray<T> &array, F less);
+
+// Sets pIndices[i] to the first index in the sorted array that isn't less(element, pKeys[i]), or array.length if there is none
+template <typename T, typename K, typename F>
+udResult udParallel_LowerBound(udWorkerPool *pPool, const udChunkedArray<T> &array, const K *pKeys, size_t keyCount, size_t *pIndices, F less);
+
+// Division of a chunked array into blocks of whole chunks
+struct udParallelBlocks
+{
+  size_t count;
+  size_t elementsPerBlock; // A multiple of the chunk size
+  size_t inset;
+  size_t length;
+};
+
+void udParallel_InitBlocks(udParallelBlocks *pBlocks, udWorkerPool *pPool, size_t inset, size_t length, size_t chunkElementCount);
+
+// ----------------------------------------------------------------------------
+inline void udParallel_GetBlockRange(const udParallelBlocks &blocks, size_t block, size_t *pStart, size_t *pEnd)
+{
+  size_t start = block * blocks.elementsPerBlock;
+  size_t end = start + blocks.elementsPerBlock;
+  *pStart = (start > blocks.inset) ? start - blocks.inset : 0;
+  *pEnd = udMin(end - blocks.inset, blocks.length);
+}
+
+// ----------------------------------------------------------------------------
+template <typename T, typename F>
+udResult udParallel_ForEach(udWorkerPool *pPool, udChunkedArray<T> &array, F func)
+{
+  udParallelBlocks blocks;
+  udParallel_InitBlocks(&blocks, pPool, array.inset, array.length, array.chunkElementCount);
+
+  return udParallel_RunBlocks(pPool, blocks.count, [&](size_t block)
+  {
+    size_t index, end;
+    udParallel_GetBlockRange(blocks, block, &index, &end);
+    for (udChunkedArraySpan<T> span : array.Spans(index, end - index))
+    {
+      for (size_t i = 0; i < span.count; ++i, ++index)
+        func(span.pData[i], index);
+    }
+  });
+}
+
+// ----------------------------------------------------------------------------
+// The result of one block, padded so threads writing neighbouring blocks' results don't share a cache line
+template <typename R>
+struct udParallelPartial
+{
+  R value;
+  char padding[UDPARALLEL_CACHE_LINE_SIZE - sizeof(R) % UDPARALLEL_CACHE_LINE_SIZE];
+};
+
+// ----------------------------------------------------------------------------
+template <typename R>
+udParallelPartial<R> *udParallel_CreatePartials(size_t count, const R &identity)
+{
+  udParallelPartial<R> *pPartials = (udParallelPartial<R>*)udAllocAligned(sizeof(udParallelPartial<R>) * (count + 1), UDPARALLEL_CACHE_LINE_SIZE, udAF_None);
+  for (size_t i = 0; pPartials && i < count; ++i)
+    new (&pPartials[i].value) R(identity);
+  return pPartials;
+}
+
+// ----------------------------------------------------------------------------
+template <typename R>
+void udParallel_DestroyPartials(udParallelPartial<R> **ppPartials, size_t count)
+{
+  if (*ppPartials == nullptr)
+    return;
+  for (size_t i = 0; i < count; ++i)
+    (*ppPartials)[i].value.~R();
+  udFree(*ppPartials);
+}
+
+// ----------------------------------------------------------------------------
+// Sets each partial to accumulateBlock(identity, start, end) for its block of UDPARALLEL_FIXED_BLOCK_SIZE elements of [0, count)
+template <typename R, typename F>
+udResult udParallel_AccumulateBlocks(udWorkerPool *pPool, size_t count, udParallelPartial<R> *pPartials, const R &identity, F &accumulateBlock)
+{
+  size_t blockCount = (count + UDPARALLEL_FIXED_BLOCK_SIZE - 1) / UDPARALLEL_FIXED_BLOCK_SIZE;
+  return udParallel_RunBlocks(pPool, blockCount, [&](size_t block)
+  {
+    size_t start = block * UDPARALLEL_FIXED_BLOCK_SIZE;
+    pPartials[block].value = accumulateBlock(identity, start, udMin(start + UDPARALLEL_FIXED_BLOCK_SIZE, count));
+  });
+}
+
+// ----------------------------------------------------------------------------
+// Reduction of [0, count) by fixed size blocks, accumulateBlock(R, start, end) accumulating the elements of a block
+template <typename R, typename FB, typename FC>
+udResult udParallel_ReduceBlocks(udWorkerPool *pPool, size_t count, R *pResult, const R &identity, FB accumulateBlock, FC &combine)
+{
+  udResult result;
+  size_t blockCount = (count + UDPARALLEL_FIXED_BLOCK_SIZE - 1) / UDPARALLEL_FIXED_BLOCK_SIZE;
+  udParallelPartial<R> *pPartials = nullptr;
+
+  UD_ERROR_NULL(pResult, udR_InvalidParameter_);
+  pPartials = udParallel_CreatePartials(blockCount, identity);
+  UD_ERROR_NULL(pPartials, udR_MemoryAllocationFailure);
+  UD_ERROR_CHECK(udParallel_AccumulateBlocks(pPool, count, pPartials, identity, accumulateBlock));
+
+  *pResult = identity;
+  for (size_t block = 0; block < blockCount; ++block)
+    *pResult = combine(std::move(*pResult), std::move(pPartials[block].value));
+
+epilogue:
+  udParallel_DestroyPartials(&pPartials, blockCount);
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+template <typename T, typename R, typename FA, typename FC>
+udResult udParallel_Reduce(udWorkerPool *pPool, const udChunkedArray<T> &array, R *pResult, const R &identity, FA accumulate, FC combine)
+{
+  return udParallel_ReduceBlocks(pPool, array.length, pResult, identity, [&](R partial, size_t start, size_t end)
+  {
+    for (udChunkedArraySpan<const T> span : array.Spans(start, end - start))
+    {
+      for (size_t i = 0; i < span.count; ++i)
+        partial = accumulate(std::move(partial), span.pData[i]);
+    }
+    return partial;
+  }, combine);
+}
+
+// ----------------------------------------------------------------------------
+template <typename T, typename R, typename FA, typename FC>
+udResult udParallel_Reduce(udWorkerPool *pPool, const T *pData, size_t count, R *pResult, const R &identity, FA accumulate, FC combine)
+{
+  if (count && !pData)
+    return udR_InvalidParameter_;
+
+  return udParallel_ReduceBlocks(pPool, count, pResult, identity, [&](R partial, size_t start, size_t end)
+  {
+    for (size_t i = start; i < end; ++i)
+      partial = accumulate(std::move(partial), pData[i]);
+    return partial;
+  }, combine);
+}
+
+// ----------------------------------------------------------------------------
+// Folds each block, turns the block folds into the fold of the blocks before each, then scans each block from that
+template <typename T, typename F>
+udResult udParallel_Scan(udWorkerPool *pPool, const T *pInput, T *pOutput, size_t count, const T &identity, F &op, T *pTotal, bool inclusive)
+{
+  udResult result;
+  size_t blockCount = (count + UDPARALLEL_FIXED_BLOCK_SIZE - 1) / UDPARALLEL_FIXED_BLOCK_SIZE;
+  udParallelPartial<T> *pPartials = nullptr;
+  T carry = identity;
+  auto foldBlock = [&](T partial, size_t start, size_t end)
+  {
+    for (size_t i = start; i < end; ++i)
+      partial = op(std::move(partial), pInput[i]);
+    return partial;
+  };
+
+  UD_ERROR_IF(count && (!pInput || !pOutput), udR_InvalidParameter_);
+  pPartials = udParallel_CreatePartials(blockCount, identity);
+  UD_ERROR_NULL(pPartials, udR_MemoryAllocationFailure);
+
+  // Only the blocks before the last are needed to start the others from
+  UD_ERROR_CHECK(udParallel_AccumulateBlocks(pPool, blockCount ? (blockCount - 1) * UDPARALLEL_FIXED_BLOCK_SIZE : 0, pPartials, identity, foldBlock));
+  for (size_t block = 0; block + 1 < blockCount; ++block)
+  {
+    T blockFold = std::move(pPartials[block].value);
+    pPartials[block].value = carry;
+    carry = op(std::move(carry), std::move(blockFold));
+  }
+  if (blockCount)
+    pPartials[blockCount - 1].value = std::move(carry);
+
+  result = udParallel_RunBlocks(pPool, blockCount, [&](size_t block)
+  {
+    size_t end = udMin((block + 1) * UDPARALLEL_FIXED_BLOCK_SIZE, count);
+    T running = pPartials[block].value;
+    for (size_t i = block * UDPARALLEL_FIXED_BLOCK_SIZE; i < end; ++i)
+    {
+      T value = pInput[i]; // Read before writing, as pOutput may be pInput
+      if (inclusive)
+      {
+        running = op(std::move(running), std::move(value));
+        pOutput[i] = running;
+      }
+      else
+      {
+        pOutput[i] = running;
+        running = op(std::move(running), std::move(value));
+      }
+    }
+    if (block + 1 == blockCount && pTotal)
+      *pTotal = std::move(running); // Continuing the last block's scan, so an inclusive scan's total is its last element
+  });
+  UD_ERROR_HANDLE();
+
+  if (pTotal && count == 0)
+    *pTotal = identity;
+
+epilogue:
+  udParallel_DestroyPartials(&pPartials, blockCount);
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+template <typename T, typename F>
+udResult udParallel_InclusiveScan(udWorkerPool *pPool, const T *pInput, T *pOutput, size_t count, const T &identity, F op, T *pTotal /*= nullptr*/)
+{
+  return udParallel_Scan(pPool, pInput, pOutput, count, identity, op, pTotal, true);
+}
+
+// ----------------------------------------------------------------------------
+template <typename T, typename F>
+udResult udParallel_ExclusiveScan(udWorkerPool *pPool, const T *pInput, T *pOutput, size_t count, const T &identity, F op, T *pTotal /*= nullptr*/)
+{
+  return udParallel_Scan(pPool, pInput, pOutput, count, identity, op, pTotal, false);
+}
+
+// ----------------------------------------------------------------------------
+// Output position of the merge of pLeft and pRight at which leftCount of pLeft's elements precede it. Equal elements take
+// from pLeft first, keeping the merge stable
+template <typename T, typename F>
+size_t udParallel_MergeSplit(const T *pLeft, size_t leftCount, const T *pRight, size_t rightCount, size_t outIndex, F &less)
+{
+  size_t lo = (outIndex > rightCount) ? outIndex - rightCount : 0;
+  size_t hi = udMin(outIndex, leftCount);
+  while (lo < hi)
+  {
+    size_t i = (lo + hi) / 2;
+    size_t j = outIndex - i;
+    if (j > 0 && !less(pRight[j - 1], pLeft[i]))
+      lo = i + 1;
+    else
+      hi = i;
+  }
+  return lo;
+}
+
+// ----------------------------------------------------------------------------
+// Write outputs [outStart, outEnd) of the stable merge of pLeft and pRight to pOut
+template <typename T, typename F>
+void udParallel_Merge(const T *pLeft, size_t leftCount, const T *pRight, size_t rightCount, T *pOut, size_t outStart, size_t outEnd, F &less)
+{
+  size_t i = udParallel_MergeSplit(pLeft, leftCount, pRight, rightCount, outStart, less);
+  size_t j = outStart - i;
+  size_t iEnd = udParallel_MergeSplit(pLeft, leftCount, pRight, rightCount, outEnd, less);
+  size_t jEnd = outEnd - iEnd;
+
+  T *pDest = pOut + outStart;
+  while (i < iEnd && j < jEnd)
+  {
+    if (less(pRight[j], pLeft[i]))
+      *pDest++ = pRight[j++];
+    else
+      *pDest++ = pLeft[i++];
+  }
+  // Only one side can have elements remaining
+  memcpy(pDest, pLeft + i, (iEnd - i) * sizeof(T));
+  memcpy(pDest, pRight + j, (jEnd - j) * sizeof(T));
+}
+
+// ----------------------------------------------------------------------------
+// Serial stable sort of pData[0, count), using pTemp[0, count) as scratch
+template <typename T, typename F>
+void udParallel_SortRange(T *pData, T *pTemp, size_t count, F &less)
+{
+  const size_t insertionRun = 16;
+
+  for (size_t runStart = 0; runStart < count; runStart += insertionRun)
+  {
+    size_t runEnd = udMin(runStart + insertionRun, count);
+    for (size_t i = runStart + 1; i < runEnd; ++i)
+    {
+      T value = pData[i];
+      size_t j = i;
+      for (; j > runStart && less(value, pData[j - 1]); --j)
+        pData[j] = pData[j - 1];
+      pData[j] = value;
+    }
+  }
+
+  T *pSource = pData;
+  T *pDest = pTemp;
+  for (size_t width = insertionRun; width < count; width *= 2)
+  {
+    for (size_t left = 0; left < count; left += width * 2)
+    {
+      size_t leftCount = udMin(width, count - left);
+      size_t rightCount = udMin(width, count - left - leftCount);
+      udParallel_Merge(pSource + left, leftCount, pSource + left + leftCount, rightCount, pDest + left, 0, leftCount + rightCount, less);
+    }
+    T *pSwap = pSource;
+    pSource = pDest;
+    pDest = pSwap;
+  }
+
+  if (pSource != pData)
+    memcpy(pData, pSource, count * sizeof(T));
+}
+
+// ----------------------------------------------------------------------------
+template <typename T, typename F>
+udResult udParallel_Sort(udWorkerPool *pPool, udChunkedArray<T> &array, F less)
+{
+  UDCOMPILEASSERT(std::is_trivially_copyable<T>::value, "udParallel_Sort requires trivially copyable elements");
+
+  udResult result;
+  udParallelBlocks blocks;
+  size_t count = array.length;
+  T *pBuffers[2] = {};
+  size_t *pRuns = nullptr;
+  size_t runCount, pieceSize;
+  int source = 0;
+
+  udParallel_InitBlocks(&blocks, pPool, array.inset, array.length, array.chunkElementCount);
+  UD_ERROR_IF(count < 2, udR_Success);
+
+  pBuffers[0] = udAllocType(T, count, udAF_None);
+  pBuffers[1] = udAllocType(T, count, udAF_None);
+  pRuns = udAllocType(size_t, blocks.count + 1, udAF_None);
+  UD_ERROR_NULL(pBuffers[0], udR_MemoryAllocationFailure);
+  UD_ERROR_NULL(pBuffers[1], udR_MemoryAllocationFailure);
+  UD_ERROR_NULL(pRuns, udR_MemoryAllocationFailure);
+
+  // Copy each block out and sort it, the blocks becoming the initial runs
+  result = udParallel_RunBlocks(pPool, blocks.count, [&](size_t block)
+  {
+    size_t start, end;
+    udParallel_GetBlockRange(blocks, block, &start, &end);
+    array.ToArray(pBuffers[0] + start, end - start, start, end - start);
+    udParallel_SortRange(pBuffers[0] + start, pBuffers[1] + start, end - start, less);
+  });
+  UD_ERROR_HANDLE();
+  for (size_t block = 0; block < blocks.count; ++block)
+    udParallel_GetBlockRange(blocks, block, &pRuns[block], &pRuns[block + 1]);
+  runCount = blocks.count;
+
+  // Merge pairs of runs until one remains. Every merge is split into pieces of similar size so the final merges still run in parallel
+  pieceSize = udMax((size_t)4096, count / ((udWorkerPool_GetThreadCount(pPool) + 1) * UDPARALLEL_BLOCKS_PER_THREAD));
+  while (runCount > 1)
+  {
+    const T *pSource = pBuffers[source];
+    T *pDest = pBuffers[source ^ 1];
+    size_t pairCount = (runCount + 1) / 2;
+    size_t largestPair = 0;
+    for (size_t pair = 0; pair < pairCount; ++pair)
+      largestPair = udMax(largestPair, pRuns[udMin(pair * 2 + 2, runCount)] - pRuns[pair * 2]);
+    size_t piecesPerPair = (largestPair + pieceSize - 1) / pieceSize;
+
+    result = udParallel_RunBlocks(pPool, pairCount * piecesPerPair, [&](size_t piece)
+    {
+      size_t pair = piece / piecesPerPair;
+      size_t left = pRuns[pair * 2];
+      size_t middle = pRuns[udMin(pair * 2 + 1, runCount)];
+      size_t right = pRuns[udMin(pair * 2 + 2, runCount)];
+      size_t pieceLength = (right - left + piecesPerPair - 1) / piecesPerPair;
+      size_t outStart = udMin((piece % piecesPerPair) * pieceLength, right - left);
+      size_t outEnd = udMin(outStart + pieceLength, right - left);
+      udParallel_Merge(pSource + left, middle - left, pSource + middle, right - middle, pDest + left, outStart, outEnd, less);
+    });
+    UD_ERROR_HANDLE();
+
+    for (size_t pair = 0; pair < pairCount; ++pair)
+      pRuns[pair + 1] = pRuns[udMin(pair * 2 + 2, runCount)];
+    runCount = pairCount;
+    source ^= 1;
+  }
+
+  // Copy back a block at a time, moving the elements out from under any hash index
+  array.InvalidateHashIndex();
+  result = udParallel_RunBlocks(pPool, blocks.count, [&](size_t block)
+  {
+    size_t start, end;
+    udParallel_GetBlockRange(blocks, block, &start, &end);
+    const T *pSorted = pBuffers[source] + start;
+    for (udChunkedArraySpan<T> span : array.Spans(start, end - start))
+    {
+      memcpy(span.pData, pSorted, span.count * sizeof(T));
+      pSorted += span.count;
+    }
+  });
+
+epilogue:
+  udFree(pBuffers[0]);
+  udFree(pBuffers[1]);
+  udFree(pRuns);
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+template <typename T, typename K, typename F>
+udResult udParallel_LowerBound(udWorkerPool *pPool, const udChunkedArray<T> &array, const K *pKeys, size_t keyCount, size_t *pIndices, F less)
+{
+  const size_t minKeysPerBlock = 256;
+  size_t blockCount = udMin((keyCount + minKeysPerBlock - 1) / minKeysPerBlock, (size_t)(udWorkerPool_GetThreadCount(pPool) + 1) * UDPARALLEL_BLOCKS_PER_THREAD);
+  size_t keysPerBlock = blockCount ? (keyCount + blockCount - 1) / blockCount : 0;
+
+  if (keyCount && (!pKeys || !pIndices))
+    return udR_InvalidParameter_;
+
+  return udParallel_RunBlocks(pPool, blockCount, [&](size_t block)
+  {
+    size_t keyEnd = udMin((block + 1) * keysPerBlock, keyCount);
+    for (size_t k = block * keysPerBlock; k < keyEnd; ++k)
+    {
+      size_t lo = 0;
+      size_t hi = array.length;
+      while (lo < hi)
+      {
+        size_t mid = (lo + hi) / 2;
+        if (less(array[mid], pKeys[k]))
+          lo = mid + 1;
+        else
+          hi = mid;
+      }
+      pIndices[k] = lo;
+    }
+  });
+}
+
+#endif // UDPARALLEL_H
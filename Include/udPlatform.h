@@ -147,6 +147,7 @@ inline int32_t udInterlockedPreDecrement(volatile int32_t *p) { return (int32_t)
 inline int32_t udInterlockedPostDecrement(volatile int32_t *p) { return (int32_t)_InterlockedDecrement((long*)p) + 1; }
 inline int32_t udInterlockedExchange(volatile int32_t *dest, int32_t exchange) { return (int32_t)_InterlockedExchange((volatile long*)dest, exchange); }
 inline int32_t udInterlockedCompareExchange(volatile int32_t *dest, int32_t exchange, int32_t comparand) { return (int32_t)_InterlockedCompareExchange((volatile long*)dest, exchange, comparand); }
+inline int64_t udInterlockedCompareExchange64(volatile int64_t *dest, int64_t exchange, int64_t comparand) { return (int64_t)_InterlockedCompareExchange64((volatile __int64*)dest, exchange, comparand); }
 # if UD_32BIT
 template <typename T, typename U>
 inline T *udInterlockedExchangePointer(T * volatile* dest, U *exchange) { return (T*)_InterlockedExchange((volatile long*)dest, (long)exchange); }
@@ -172,6 +173,7 @@ inline int32_t udInterlockedPreDecrement(volatile int32_t *p)  { return __sync_s
 inline int32_t udInterlockedPostDecrement(volatile int32_t *p) { return __sync_fetch_and_sub(p, 1); }
 inline int32_t udInterlockedExchange(volatile int32_t *dest, int32_t exchange) { return __sync_lock_test_and_set(dest, exchange); }
 inline int32_t udInterlockedCompareExchange(volatile int32_t *dest, int32_t exchange, int32_t comparand) { return __sync_val_compare_and_swap(dest, comparand, exchange); }
+inline int64_t udInterlockedCompareExchange64(volatile int64_t *dest, int64_t exchange, int64_t comparand) { return __sync_val_compare_and_swap(dest, comparand, exchange); }
 #if UDPLATFORM_LINUX && !defined(__clang__) && __GNUC__ < 5
 // We're just trying to ignore pedantic warnings on CentOS7 GCC due to function pointers being used in this function below
 # pragma GCC diagnostic push
@@ -248,7 +250,12 @@ protected:
 
 #define UDALIGN_POWEROF2(x,b) (((x)+(b)-1) & -(b))
 
-#ifdef __MEMORY_DEBUG__
+// The sampling allocation profiler (see udMemoryProfiler.h) needs call sites, so they're passed in all builds by default
+#ifndef UD_MEMORY_PROFILER
+# define UD_MEMORY_PROFILER 1
+#endif
+
+#if defined(__MEMORY_DEBUG__) || UD_MEMORY_PROFILER
 # define IF_MEMORY_DEBUG(x,y) x,y
 #else
 # define IF_MEMORY_DEBUG(x,y) nullptr,0
@@ -285,15 +292,26 @@ protected:
 
 UDFORCE_INLINE void *udSetZero(void *pMemory, size_t size) { memset(pMemory, 0, size); return pMemory; }
 
+// The page placement flags are hints honoured on Linux by the system and thread cache backends, for udAlloc and for
+// udAllocAligned with alignment up to the 2MB huge page size. Blocks below each flag's size threshold ignore it, which
+// includes every small block the thread cache backend keeps. Elsewhere, and for larger alignments, they fall back to a
+// regular allocation. Blocks allocated with them are still freed with udFree
 enum udAllocationFlags
 {
   udAF_None = 0,
-  udAF_Zero = 1
+  udAF_Zero = 1,
+  udAF_HugePages = 2,         // Blocks of 1MB or more are mapped on huge page boundaries and advised to use transparent huge pages
+  udAF_ExplicitHugePages = 4, // As udAF_HugePages but first trying the reserved huge page pool (MAP_HUGETLB)
+  udAF_NUMALocal = 8,         // Blocks of 64KB or more prefer memory on the NUMA node the calling thread is running on
+  udAF_NUMANodeMask = 0xFF00, // Blocks of 64KB or more prefer memory on a specific NUMA node, see udAF_NUMANode
 };
 
 // Inline of operator to allow flags to be combined and retain type-safety
 inline udAllocationFlags operator|(udAllocationFlags a, udAllocationFlags b) { return (udAllocationFlags)(int(a) | int(b)); }
 
+// Flag preferring memory on NUMA node 0-254
+inline udAllocationFlags udAF_NUMANode(int node) { return (udAllocationFlags)(((node + 1) & 0xFF) << 8); }
+
 void *_udMemDup(const void *pMemory, size_t size, size_t additionalBytes, udAllocationFlags flags, const char *pFile, int line);
 #define udMemDup(pMemory, size, additionalBytes, flags) _udMemDup(pMemory, size, additionalBytes, flags, IF_MEMORY_DEBUG(__FILE__, __LINE__))
 
@@ -351,12 +369,20 @@ void _udFreeSecure(T *&pMemory, size_t size, const char *pFile, int line)
 #define udAllocStack(type, count, flags)   ((flags & udAF_Zero) ? (type*)udSetZero(alloca(sizeof(type) * (count)), sizeof(type) * (count)) : (type*)alloca(sizeof(type) * (count)))
 #define udFreeStack(pMemory)
 
-// TODO: Remove these
-#define udMemoryDebugTrackingInit()
-#define udMemoryOutputLeaks()
-#define udMemoryOutputAllocInfo(pAlloc)
-#define udMemoryDebugTrackingDeinit()
-#define udMemoryDebugLogMemoryStats()
+#if UD_MEMORY_PROFILER
+// Debug output from the sampling allocation profiler, see udMemoryProfiler.h for the full interface
+void udMemoryDebugTrackingInit(); // Discard samples so far and start sampling if currently disabled
+void udMemoryOutputLeaks(); // Print call sites with sampled allocations that are yet to be freed
+void udMemoryOutputAllocInfo(const void *pAlloc); // Print the call site of an allocation, if it was sampled
+void udMemoryDebugTrackingDeinit(); // Stop sampling and discard samples
+void udMemoryDebugLogMemoryStats(); // Print the call sites with the most memory still allocated
+#else
+# define udMemoryDebugTrackingInit()
+# define udMemoryOutputLeaks()
+# define udMemoryOutputAllocInfo(pAlloc)
+# define udMemoryDebugTrackingDeinit()
+# define udMemoryDebugLogMemoryStats()
+#endif // UD_MEMORY_PROFILER
 #define udValidateHeap()
 
 #if UDPLATFORM_WINDOWS
@@ -0,0 +1,72 @@
+#ifndef UDPOOL_H
+#define UDPOOL_H
+//
+// Copyright (c) Euclideon Pty Ltd
+//
+// Fixed-size object pool. Elements are carved from slabs that grow geometrically and are only released when the
+// pool is deinitialised; free elements sit on a lock-free list whose head carries a tag so a pop can't be fooled by
+// an element being freed and reallocated underneath it (ABA). Optional per-thread magazines keep a few free elements
+// local to each thread so most allocations and frees don't touch the shared list at all.
+// Alloc and Free are thread safe, Init and Deinit are not and the pool must outlive every thread using it
+//
+
+#include "udPlatform.h"
+
+#define UDPOOL_DEFAULT_ELEMENTS_PER_SLAB 64 // Elements in the first slab, each slab after it doubles
+#define UDPOOL_MAX_SLABS 24
+#define UDPOOL_MAX_MAGAZINE_POOLS 16 // Pools that may use magazines at once, others silently fall back to the shared list
+#define UDPOOL_MAGAZINE_SIZE 32
+
+// The untyped pool, use udPool<T> below. A zeroed udPoolBase is a valid empty pool with default settings
+struct udPoolBase
+{
+  int64_t head;               // (tag << 32) | (index + 1) of the first free element, 0 when empty
+  int32_t growLock;
+  int32_t magazineId;         // 1-based slot in the magazine registry, 0 for none
+  int32_t generation;         // Identifies this incarnation of the pool to the magazines
+  uint32_t slabCount;
+  uint32_t slabShift;         // log2 of the elements in the first slab, 0 until configured
+  uint32_t elementSize;       // Stride of an element, fixed when the first slab is allocated
+  bool useMagazines;
+  void *pSlabs[UDPOOL_MAX_SLABS];
+};
+
+// Configure an empty pool; elementsPerSlab is rounded up to a power of 2 (0 for UDPOOL_DEFAULT_ELEMENTS_PER_SLAB)
+// and useMagazines gives each thread a small cache of free elements, at the cost of elements sitting idle in them
+void udPool_Init(udPoolBase *pPool, uint32_t elementsPerSlab, bool useMagazines);
+
+// Free every slab. No element allocated from the pool may be used after this
+void udPool_Deinit(udPoolBase *pPool);
+
+// Allocate an element of elementSize bytes aligned to elementAlignment (a power of 2), returns null on failure.
+// The size and alignment must be the same on every call for a given pool
+void *udPool_Alloc(udPoolBase *pPool, size_t elementSize, size_t elementAlignment, udAllocationFlags flags = udAF_None);
+
+// Return an element to the pool it was allocated from
+void udPool_Free(udPoolBase *pPool, void *pElement);
+
+// Get the number of elements allocated from the system so far, and those currently free (either may be null).
+// The free count walks the shared list and doesn't include elements held in magazines, it's intended for tests
+void udPool_GetUsage(udPoolBase *pPool, size_t *pCapacity, size_t *pFreeCount);
+
+// Return the calling thread's magazines to their pools; udThread calls this as its threads exit
+void udPool_ThreadExit();
+
+template <typename T>
+struct udPool : public udPoolBase
+{
+  // constexpr so a static pool is configured before any other static initialiser can use it
+  constexpr udPool(uint32_t elementsPerSlab = 0, bool useMagazines = false) : udPoolBase{ 0, 0, 0, 0, 0, SlabShift(elementsPerSlab ? elementsPerSlab : UDPOOL_DEFAULT_ELEMENTS_PER_SLAB), 0, useMagazines, {} } {}
+
+  void Init(uint32_t elementsPerSlab = 0, bool useMagazines = false) { udPool_Init(this, elementsPerSlab, useMagazines); }
+  void Deinit() { udPool_Deinit(this); }
+
+  // Allocate storage for a T, the constructor isn't run
+  T *Alloc(udAllocationFlags flags = udAF_None) { return (T*)udPool_Alloc(this, sizeof(T), alignof(T), flags); }
+  void Free(T *&pElement) { if (pElement) { udPool_Free(this, pElement); pElement = nullptr; } }
+
+private:
+  static constexpr uint32_t SlabShift(uint32_t elementsPerSlab, uint32_t shift = 1) { return (elementsPerSlab > (1U << shift)) ? SlabShift(elementsPerSlab, shift + 1) : shift; }
+};
+
+#endif // UDPOOL_H
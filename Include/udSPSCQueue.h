@@ -0,0 +1,344 @@
+#ifndef UDSPSCQUEUE_H
+#define UDSPSCQUEUE_H
+//
+// Copyright (c) Euclideon Pty Ltd
+//
+// Wait free bounded single producer, single consumer FIFO queue
+//
+// Exactly one thread may push and one thread may pop. Each side owns its position on its own cache line and keeps a copy
+// of the other side's position, only rereading it when the copy says the ring is full (or empty), so in steady streaming
+// the sides rarely touch each other's cache lines. The range versions publish a whole batch at once.
+// The Wait versions spin briefly then block on a semaphore that the other side only signals when it sees a waiter
+//
+
+#include "udPlatform.h"
+#include "udPlatformUtil.h"
+#include "udResult.h"
+#include "udThread.h"
+#include <new>
+#include <utility>
+
+#define UDSPSCQUEUE_CACHE_LINE_SIZE 64
+#define UDSPSCQUEUE_SPIN_COUNT 64
+
+template <typename T>
+struct udSPSCQueue
+{
+  T *pElements;
+  uint32_t mask;
+  udSemaphore *pPushReady;                       // Signalled for a producer waiting for space
+  udSemaphore *pPopReady;                        // Signalled for a consumer waiting for elements
+  char padding0[UDSPSCQUEUE_CACHE_LINE_SIZE];
+
+  // Written only by the producer
+  volatile uint32_t pushPosition;
+  uint32_t cachedPopPosition;
+  char padding1[UDSPSCQUEUE_CACHE_LINE_SIZE - 2 * sizeof(uint32_t)];
+
+  // Written only by the consumer
+  volatile uint32_t popPosition;
+  uint32_t cachedPushPosition;
+  char padding2[UDSPSCQUEUE_CACHE_LINE_SIZE - 2 * sizeof(uint32_t)];
+
+  // Rarely written, so checking them after each push or pop doesn't contend
+  volatile int32_t pushWaiting;
+  volatile int32_t popWaiting;
+  char padding3[UDSPSCQUEUE_CACHE_LINE_SIZE - 2 * sizeof(int32_t)];
+};
+
+// Create a queue holding up to capacity elements, rounded up to a power of 2
+template <typename T>
+udResult udSPSCQueue_Create(udSPSCQueue<T> **ppQueue, uint32_t capacity);
+
+// Destroys any elements remaining in the queue
+template <typename T>
+void udSPSCQueue_Destroy(udSPSCQueue<T> **ppQueue);
+
+// Producer only. Returns udR_CountExceeded if the queue is full, in which case v is left unchanged
+template <typename T>
+udResult udSPSCQueue_PushBack(udSPSCQueue<T> *pQueue, const T &v);
+template <typename T>
+udResult udSPSCQueue_PushBack(udSPSCQueue<T> *pQueue, T &&v);
+
+// Producer only. Waits up to waitMs for space, returning udR_Timeout if there was none
+template <typename T>
+udResult udSPSCQueue_PushBackWait(udSPSCQueue<T> *pQueue, const T &v, int waitMs = UDTHREAD_WAIT_INFINITE);
+template <typename T>
+udResult udSPSCQueue_PushBackWait(udSPSCQueue<T> *pQueue, T &&v, int waitMs = UDTHREAD_WAIT_INFINITE);
+
+// Producer only. Copies as many of the count elements as there is space for, returning the number pushed
+template <typename T>
+uint32_t udSPSCQueue_PushBackRange(udSPSCQueue<T> *pQueue, const T *pData, uint32_t count);
+
+// Consumer only. Returns udR_ObjectNotFound if the queue is empty, otherwise the element is moved to pData if supplied then destroyed
+template <typename T>
+udResult udSPSCQueue_PopFront(udSPSCQueue<T> *pQueue, T *pData);
+
+// Consumer only. Waits up to waitMs for an element, returning udR_Timeout if there was none
+template <typename T>
+udResult udSPSCQueue_PopFrontWait(udSPSCQueue<T> *pQueue, T *pData, int waitMs = UDTHREAD_WAIT_INFINITE);
+
+// Consumer only. Moves up to count elements to pData (if supplied) in order, returning the number popped
+template <typename T>
+uint32_t udSPSCQueue_PopFrontRange(udSPSCQueue<T> *pQueue, T *pData, uint32_t count);
+
+// Returns the number of elements the queue can hold
+template <typename T>
+inline uint32_t udSPSCQueue_GetCapacity(const udSPSCQueue<T> *pQueue) { return pQueue->mask + 1; }
+
+// ----------------------------------------------------------------------------
+// The space available to the producer, rereading the consumer's position when the cached copy doesn't show enough
+template <typename T>
+inline uint32_t udSPSCQueue_PushSpace(udSPSCQueue<T> *pQueue, uint32_t wanted)
+{
+  uint32_t space = pQueue->mask + 1 - (pQueue->pushPosition - pQueue->cachedPopPosition);
+  if (space < wanted)
+  {
+    pQueue->cachedPopPosition = pQueue->popPosition;
+    udMemoryBarrier(); // Don't reuse the cells until the consumer has finished with them
+    space = pQueue->mask + 1 - (pQueue->pushPosition - pQueue->cachedPopPosition);
+  }
+  return space;
+}
+
+// ----------------------------------------------------------------------------
+// The elements available to the consumer, rereading the producer's position when the cached copy doesn't show enough
+template <typename T>
+inline uint32_t udSPSCQueue_PopAvailable(udSPSCQueue<T> *pQueue, uint32_t wanted)
+{
+  uint32_t available = pQueue->cachedPushPosition - pQueue->popPosition;
+  if (available < wanted)
+  {
+    pQueue->cachedPushPosition = pQueue->pushPosition;
+    udMemoryBarrier(); // Don't read the cells before the producer's position says they were written
+    available = pQueue->cachedPushPosition - pQueue->popPosition;
+  }
+  return available;
+}
+
+// ----------------------------------------------------------------------------
+// Called after moving a position, signals the other side if it is blocked waiting
+inline void udSPSCQueue_Wake(volatile int32_t *pWaiting, udSemaphore *pSemaphore)
+{
+  udMemoryBarrier(); // The new position must be visible before the flag is read, as the waiter sets the flag before rechecking
+  if (*pWaiting && udInterlockedExchange(pWaiting, 0))
+    udIncrementSemaphore(pSemaphore);
+}
+
+// ----------------------------------------------------------------------------
+// Repeats tryOnce, spinning at first then blocking on pSemaphore with pWaiting set, until it succeeds or waitMs elapses
+template <typename F>
+inline udResult udSPSCQueue_Wait(volatile int32_t *pWaiting, udSemaphore *pSemaphore, int waitMs, F tryOnce)
+{
+  for (int spin = 0; spin < UDSPSCQUEUE_SPIN_COUNT; ++spin)
+  {
+    if (tryOnce())
+      return udR_Success;
+    if (waitMs == 0)
+      return udR_Timeout;
+    udYield();
+  }
+
+  uint64_t start = udPerfCounterStart();
+  for (;;)
+  {
+    udInterlockedExchange(pWaiting, 1);
+    udMemoryBarrier();
+    bool succeeded = tryOnce();
+    int remainingMs = UDTHREAD_WAIT_INFINITE;
+    if (!succeeded && waitMs != UDTHREAD_WAIT_INFINITE)
+      remainingMs = udMax(waitMs - (int)udPerfCounterMilliseconds(start), 0);
+    if (succeeded || udWaitSemaphore(pSemaphore, remainingMs) != 0)
+    {
+      // No longer waiting, but if the other side already cleared the flag its signal is on the way and must be taken
+      if (udInterlockedExchange(pWaiting, 0) == 0)
+        udWaitSemaphore(pSemaphore);
+      if (succeeded || tryOnce())
+        return udR_Success;
+      return udR_Timeout;
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+template <typename T, typename U>
+inline bool udSPSCQueue_Push(udSPSCQueue<T> *pQueue, U &&v)
+{
+  if (udSPSCQueue_PushSpace(pQueue, 1) == 0)
+    return false;
+
+  uint32_t position = pQueue->pushPosition;
+  new (&pQueue->pElements[position & pQueue->mask]) T(std::forward<U>(v));
+  udMemoryBarrier(); // The element must be visible before the position that says it can be read
+  pQueue->pushPosition = position + 1;
+  udSPSCQueue_Wake(&pQueue->popWaiting, pQueue->pPopReady);
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+template <typename T>
+inline bool udSPSCQueue_Pop(udSPSCQueue<T> *pQueue, T *pData)
+{
+  if (udSPSCQueue_PopAvailable(pQueue, 1) == 0)
+    return false;
+
+  uint32_t position = pQueue->popPosition;
+  T *pElement = &pQueue->pElements[position & pQueue->mask];
+  if (pData)
+    *pData = std::move(*pElement);
+  pElement->~T();
+  udMemoryBarrier(); // Finished with the element before the position that says the cell can be reused
+  pQueue->popPosition = position + 1;
+  udSPSCQueue_Wake(&pQueue->pushWaiting, pQueue->pPushReady);
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+template <typename T>
+udResult udSPSCQueue_Create(udSPSCQueue<T> **ppQueue, uint32_t capacity)
+{
+  udResult result;
+  udSPSCQueue<T> *pQueue = nullptr;
+  uint32_t count = 2;
+
+  UD_ERROR_NULL(ppQueue, udR_InvalidParameter_);
+  UD_ERROR_IF(capacity == 0 || capacity > (1U << 31), udR_InvalidParameter_);
+  while (count < capacity)
+    count *= 2;
+
+  pQueue = udAllocType(udSPSCQueue<T>, 1, udAF_Zero);
+  UD_ERROR_NULL(pQueue, udR_MemoryAllocationFailure);
+  pQueue->pElements = udAllocType(T, count, udAF_None);
+  UD_ERROR_NULL(pQueue->pElements, udR_MemoryAllocationFailure);
+  pQueue->mask = count - 1;
+  pQueue->pPushReady = udCreateSemaphore();
+  UD_ERROR_NULL(pQueue->pPushReady, udR_MemoryAllocationFailure);
+  pQueue->pPopReady = udCreateSemaphore();
+  UD_ERROR_NULL(pQueue->pPopReady, udR_MemoryAllocationFailure);
+
+  *ppQueue = pQueue;
+  pQueue = nullptr;
+  result = udR_Success;
+
+epilogue:
+  udSPSCQueue_Destroy(&pQueue); // Will be nullptr on success
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+template <typename T>
+void udSPSCQueue_Destroy(udSPSCQueue<T> **ppQueue)
+{
+  if (ppQueue == nullptr || *ppQueue == nullptr)
+    return;
+
+  udSPSCQueue<T> *pQueue = *ppQueue;
+  for (uint32_t position = pQueue->popPosition; position != pQueue->pushPosition; ++position)
+    pQueue->pElements[position & pQueue->mask].~T();
+
+  udDestroySemaphore(&pQueue->pPushReady);
+  udDestroySemaphore(&pQueue->pPopReady);
+  udFree(pQueue->pElements);
+  udFree(*ppQueue);
+}
+
+// ----------------------------------------------------------------------------
+template <typename T>
+inline udResult udSPSCQueue_PushBack(udSPSCQueue<T> *pQueue, const T &v)
+{
+  if (pQueue == nullptr)
+    return udR_InvalidParameter_;
+  return udSPSCQueue_Push(pQueue, v) ? udR_Success : udR_CountExceeded;
+}
+
+// ----------------------------------------------------------------------------
+template <typename T>
+inline udResult udSPSCQueue_PushBack(udSPSCQueue<T> *pQueue, T &&v)
+{
+  if (pQueue == nullptr)
+    return udR_InvalidParameter_;
+  return udSPSCQueue_Push(pQueue, std::move(v)) ? udR_Success : udR_CountExceeded;
+}
+
+// ----------------------------------------------------------------------------
+template <typename T>
+inline udResult udSPSCQueue_PushBackWait(udSPSCQueue<T> *pQueue, const T &v, int waitMs)
+{
+  if (pQueue == nullptr)
+    return udR_InvalidParameter_;
+  return udSPSCQueue_Wait(&pQueue->pushWaiting, pQueue->pPushReady, waitMs, [&]() { return udSPSCQueue_Push(pQueue, v); });
+}
+
+// ----------------------------------------------------------------------------
+template <typename T>
+inline udResult udSPSCQueue_PushBackWait(udSPSCQueue<T> *pQueue, T &&v, int waitMs)
+{
+  if (pQueue == nullptr)
+    return udR_InvalidParameter_;
+  return udSPSCQueue_Wait(&pQueue->pushWaiting, pQueue->pPushReady, waitMs, [&]() { return udSPSCQueue_Push(pQueue, std::move(v)); });
+}
+
+// ----------------------------------------------------------------------------
+template <typename T>
+inline uint32_t udSPSCQueue_PushBackRange(udSPSCQueue<T> *pQueue, const T *pData, uint32_t count)
+{
+  if (pQueue == nullptr || pData == nullptr)
+    return 0;
+
+  count = udMin(count, udSPSCQueue_PushSpace(pQueue, count));
+  if (count == 0)
+    return 0;
+
+  uint32_t position = pQueue->pushPosition;
+  for (uint32_t i = 0; i < count; ++i)
+    new (&pQueue->pElements[(position + i) & pQueue->mask]) T(pData[i]);
+  udMemoryBarrier();
+  pQueue->pushPosition = position + count;
+  udSPSCQueue_Wake(&pQueue->popWaiting, pQueue->pPopReady);
+  return count;
+}
+
+// ----------------------------------------------------------------------------
+template <typename T>
+inline udResult udSPSCQueue_PopFront(udSPSCQueue<T> *pQueue, T *pData)
+{
+  if (pQueue == nullptr)
+    return udR_InvalidParameter_;
+  return udSPSCQueue_Pop(pQueue, pData) ? udR_Success : udR_ObjectNotFound;
+}
+
+// ----------------------------------------------------------------------------
+template <typename T>
+inline udResult udSPSCQueue_PopFrontWait(udSPSCQueue<T> *pQueue, T *pData, int waitMs)
+{
+  if (pQueue == nullptr)
+    return udR_InvalidParameter_;
+  return udSPSCQueue_Wait(&pQueue->popWaiting, pQueue->pPopReady, waitMs, [&]() { return udSPSCQueue_Pop(pQueue, pData); });
+}
+
+// ----------------------------------------------------------------------------
+template <typename T>
+inline uint32_t udSPSCQueue_PopFrontRange(udSPSCQueue<T> *pQueue, T *pData, uint32_t count)
+{
+  if (pQueue == nullptr)
+    return 0;
+
+  count = udMin(count, udSPSCQueue_PopAvailable(pQueue, count));
+  if (count == 0)
+    return 0;
+
+  uint32_t position = pQueue->popPosition;
+  for (uint32_t i = 0; i < count; ++i)
+  {
+    T *pElement = &pQueue->pElements[(position + i) & pQueue->mask];
+    if (pData)
+      pData[i] = std::move(*pElement);
+    pElement->~T();
+  }
+  udMemoryBarrier();
+  pQueue->popPosition = position + count;
+  udSPSCQueue_Wake(&pQueue->pushWaiting, pQueue->pPushReady);
+  return count;
+}
+
+#endif // UDSPSCQUEUE_H
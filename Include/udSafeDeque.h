@@ -7,9 +7,13 @@
 //
 // Wraps udChunkedArray to provide a thread safe strict deque interface
 //
+// An optional capacity bounds the deque, so producers can be throttled to the consumers' speed. When full, PushBack and
+// PushFront fail with udR_CountExceeded and PushBackWait blocks (up to a timeout) until a pop makes room
+//
 
 #include "udResult.h"
 #include "udChunkedArray.h"
+#include "udPlatformUtil.h"
 #include "udThread.h"
 
 /// Thread safe double ended queue
@@ -18,12 +22,83 @@ struct udSafeDeque
 {
   udChunkedArray<T> chunkedArray;
   udMutex *pMutex = nullptr;
+  udConditionVariable *pNotEmpty = nullptr; // Signalled on push while waitingPoppers is non-zero
+  udConditionVariable *pNotFull = nullptr;  // Signalled on pop while waitingPushers is non-zero
+  int waitingPoppers = 0;
+  int waitingPushers = 0;
+  size_t capacity = 0;                      // Zero for unbounded
 };
 
+// ****************************************************************************
+// With the mutex held, waits up to waitMs on pCondition until ready() is true
+// Returns immediateResult if it isn't ready and waitMs is zero, or udR_Timeout if it didn't become ready in time
+template <typename T, typename F>
+inline udResult udSafeDeque_Wait(udSafeDeque<T> *pDeque, udConditionVariable *pCondition, int *pWaiting, int waitMs, udResult immediateResult, F ready)
+{
+  uint64_t start = udPerfCounterStart();
+  while (!ready())
+  {
+    int remainingMs = waitMs;
+    if (waitMs != UDTHREAD_WAIT_INFINITE)
+    {
+      remainingMs = waitMs - (int)udPerfCounterMilliseconds(start);
+      if (remainingMs <= 0)
+        return waitMs == 0 ? immediateResult : udR_Timeout;
+    }
+
+    ++*pWaiting;
+    udWaitConditionVariable(pCondition, pDeque->pMutex, remainingMs); // Timeouts and spurious wakes are handled by the loop
+    --*pWaiting;
+  }
+  return udR_Success;
+}
+
+// ****************************************************************************
+// With the mutex held, returns true if count more elements fit within the capacity
+template <typename T>
+inline bool udSafeDeque_HasSpace(const udSafeDeque<T> *pDeque, size_t count)
+{
+  return pDeque->capacity == 0 || pDeque->chunkedArray.length + count <= pDeque->capacity;
+}
+
+// ****************************************************************************
+// With the mutex held, waits up to waitMs for the deque to have an element
+template <typename T>
+inline udResult udSafeDeque_WaitNotEmpty(udSafeDeque<T> *pDeque, int waitMs)
+{
+  return udSafeDeque_Wait(pDeque, pDeque->pNotEmpty, &pDeque->waitingPoppers, waitMs, udR_ObjectNotFound, [pDeque]() { return pDeque->chunkedArray.length > 0; });
+}
+
+// ****************************************************************************
+// With the mutex held, waits up to waitMs for the deque to have space for an element
+template <typename T>
+inline udResult udSafeDeque_WaitNotFull(udSafeDeque<T> *pDeque, int waitMs)
+{
+  return udSafeDeque_Wait(pDeque, pDeque->pNotFull, &pDeque->waitingPushers, waitMs, udR_CountExceeded, [pDeque]() { return udSafeDeque_HasSpace(pDeque, 1); });
+}
+
+// ****************************************************************************
+// With the mutex held, wakes as many waiting poppers as there are new elements
+template <typename T>
+inline void udSafeDeque_SignalNotEmpty(udSafeDeque<T> *pDeque, size_t count)
+{
+  if (pDeque->waitingPoppers)
+    udSignalConditionVariable(pDeque->pNotEmpty, (int)udMin((size_t)pDeque->waitingPoppers, count));
+}
+
+// ****************************************************************************
+// With the mutex held, wakes as many waiting pushers as there are elements removed
+template <typename T>
+inline void udSafeDeque_SignalNotFull(udSafeDeque<T> *pDeque, size_t count)
+{
+  if (pDeque->waitingPushers)
+    udSignalConditionVariable(pDeque->pNotFull, (int)udMin((size_t)pDeque->waitingPushers, count));
+}
+
 // ****************************************************************************
 // Author: Paul Fox, November 2015
 template <typename T>
-udResult udSafeDeque_Create(udSafeDeque<T> **ppDeque, size_t elementCount)
+udResult udSafeDeque_Create(udSafeDeque<T> **ppDeque, size_t elementCount, size_t capacity = 0)
 {
   udResult result = udR_Failure_;
   udSafeDeque<T> *pDeque = nullptr;
@@ -37,7 +112,12 @@ udResult udSafeDeque_Create(udSafeDeque<T> **ppDeque, size_t elementCount)
   UD_ERROR_CHECK(pDeque->chunkedArray.Init(elementCount));
 
   pDeque->pMutex = udCreateMutex();
-  UD_ERROR_NULL(pDeque, udR_MemoryAllocationFailure);
+  UD_ERROR_NULL(pDeque->pMutex, udR_MemoryAllocationFailure);
+  pDeque->pNotEmpty = udCreateConditionVariable();
+  UD_ERROR_NULL(pDeque->pNotEmpty, udR_MemoryAllocationFailure);
+  pDeque->pNotFull = udCreateConditionVariable();
+  UD_ERROR_NULL(pDeque->pNotFull, udR_MemoryAllocationFailure);
+  pDeque->capacity = capacity;
 
   *ppDeque = pDeque;
   pDeque = nullptr;
@@ -57,6 +137,8 @@ void udSafeDeque_Destroy(udSafeDeque<T> **ppDeque)
     return;
 
   udDestroyMutex(&(*ppDeque)->pMutex);
+  udDestroyConditionVariable(&(*ppDeque)->pNotEmpty);
+  udDestroyConditionVariable(&(*ppDeque)->pNotFull);
   (*ppDeque)->chunkedArray.Deinit();
 
   udFree(*ppDeque);
@@ -75,7 +157,31 @@ inline udResult udSafeDeque_PushBack(udSafeDeque<T> *pDeque, const T &v)
   pMutex = udLockMutex(pDeque->pMutex);
 
   UD_ERROR_NULL(pMutex, udR_NotInitialized_);
+  UD_ERROR_IF(!udSafeDeque_HasSpace(pDeque, 1), udR_CountExceeded);
   UD_ERROR_CHECK(pDeque->chunkedArray.PushBack(v));
+  udSafeDeque_SignalNotEmpty(pDeque, 1);
+
+epilogue:
+  udReleaseMutex(pMutex);
+
+  return result;
+}
+
+// ****************************************************************************
+template <typename T>
+inline udResult udSafeDeque_PushBack(udSafeDeque<T> *pDeque, T &&v)
+{
+  udResult result = udR_Failure_;
+  udMutex *pMutex = nullptr;
+
+  UD_ERROR_NULL(pDeque, udR_InvalidParameter_);
+
+  pMutex = udLockMutex(pDeque->pMutex);
+
+  UD_ERROR_NULL(pMutex, udR_NotInitialized_);
+  UD_ERROR_IF(!udSafeDeque_HasSpace(pDeque, 1), udR_CountExceeded);
+  UD_ERROR_CHECK(pDeque->chunkedArray.PushBack(std::move(v)));
+  udSafeDeque_SignalNotEmpty(pDeque, 1);
 
 epilogue:
   udReleaseMutex(pMutex);
@@ -96,7 +202,31 @@ inline udResult udSafeDeque_PushFront(udSafeDeque<T> *pDeque, const T &v)
   pMutex = udLockMutex(pDeque->pMutex);
 
   UD_ERROR_NULL(pMutex, udR_NotInitialized_);
+  UD_ERROR_IF(!udSafeDeque_HasSpace(pDeque, 1), udR_CountExceeded);
   UD_ERROR_CHECK(pDeque->chunkedArray.PushFront(v));
+  udSafeDeque_SignalNotEmpty(pDeque, 1);
+
+epilogue:
+  udReleaseMutex(pMutex);
+
+  return result;
+}
+
+// ****************************************************************************
+template <typename T>
+inline udResult udSafeDeque_PushFront(udSafeDeque<T> *pDeque, T &&v)
+{
+  udResult result = udR_Failure_;
+  udMutex *pMutex = nullptr;
+
+  UD_ERROR_NULL(pDeque, udR_InvalidParameter_);
+
+  pMutex = udLockMutex(pDeque->pMutex);
+
+  UD_ERROR_NULL(pMutex, udR_NotInitialized_);
+  UD_ERROR_IF(!udSafeDeque_HasSpace(pDeque, 1), udR_CountExceeded);
+  UD_ERROR_CHECK(pDeque->chunkedArray.PushFront(std::move(v)));
+  udSafeDeque_SignalNotEmpty(pDeque, 1);
 
 epilogue:
   udReleaseMutex(pMutex);
@@ -118,6 +248,7 @@ inline udResult udSafeDeque_PopBack(udSafeDeque<T> *pDeque, T *pData)
 
   UD_ERROR_NULL(pMutex, udR_NotInitialized_);
   UD_ERROR_IF(!pDeque->chunkedArray.PopBack(pData), udR_ObjectNotFound);
+  udSafeDeque_SignalNotFull(pDeque, 1);
 
 epilogue:
   udReleaseMutex(pMutex);
@@ -139,6 +270,150 @@ inline udResult udSafeDeque_PopFront(udSafeDeque<T> *pDeque, T *pData)
 
   UD_ERROR_NULL(pMutex, udR_NotInitialized_);
   UD_ERROR_IF(!pDeque->chunkedArray.PopFront(pData), udR_ObjectNotFound);
+  udSafeDeque_SignalNotFull(pDeque, 1);
+
+epilogue:
+  udReleaseMutex(pMutex);
+
+  return result;
+}
+
+// ****************************************************************************
+// Waits up to waitMs for an element, returning udR_Timeout if there was none (or udR_ObjectNotFound with a zero waitMs)
+template <typename T>
+inline udResult udSafeDeque_PopFrontWait(udSafeDeque<T> *pDeque, T *pData, int waitMs = UDTHREAD_WAIT_INFINITE)
+{
+  udResult result = udR_Success;
+  udMutex *pMutex = nullptr;
+
+  UD_ERROR_NULL(pDeque, udR_InvalidParameter_);
+
+  pMutex = udLockMutex(pDeque->pMutex);
+
+  UD_ERROR_NULL(pMutex, udR_NotInitialized_);
+  UD_ERROR_CHECK(udSafeDeque_WaitNotEmpty(pDeque, waitMs));
+  pDeque->chunkedArray.PopFront(pData);
+  udSafeDeque_SignalNotFull(pDeque, 1);
+
+epilogue:
+  udReleaseMutex(pMutex);
+
+  return result;
+}
+
+// ****************************************************************************
+// Waits up to waitMs for an element, returning udR_Timeout if there was none (or udR_ObjectNotFound with a zero waitMs)
+template <typename T>
+inline udResult udSafeDeque_PopBackWait(udSafeDeque<T> *pDeque, T *pData, int waitMs = UDTHREAD_WAIT_INFINITE)
+{
+  udResult result = udR_Success;
+  udMutex *pMutex = nullptr;
+
+  UD_ERROR_NULL(pDeque, udR_InvalidParameter_);
+
+  pMutex = udLockMutex(pDeque->pMutex);
+
+  UD_ERROR_NULL(pMutex, udR_NotInitialized_);
+  UD_ERROR_CHECK(udSafeDeque_WaitNotEmpty(pDeque, waitMs));
+  pDeque->chunkedArray.PopBack(pData);
+  udSafeDeque_SignalNotFull(pDeque, 1);
+
+epilogue:
+  udReleaseMutex(pMutex);
+
+  return result;
+}
+
+// ****************************************************************************
+// Pushes count elements copied from pData under a single lock, failing with udR_CountExceeded unless all of them fit
+template <typename T>
+inline udResult udSafeDeque_PushBackBatch(udSafeDeque<T> *pDeque, const T *pData, size_t count)
+{
+  udResult result = udR_Failure_;
+  udMutex *pMutex = nullptr;
+
+  UD_ERROR_NULL(pDeque, udR_InvalidParameter_);
+  UD_ERROR_IF(pData == nullptr && count > 0, udR_InvalidParameter_);
+
+  pMutex = udLockMutex(pDeque->pMutex);
+
+  UD_ERROR_NULL(pMutex, udR_NotInitialized_);
+  UD_ERROR_IF(!udSafeDeque_HasSpace(pDeque, count), udR_CountExceeded);
+  UD_ERROR_CHECK(pDeque->chunkedArray.PushBackRange(pData, count));
+  udSafeDeque_SignalNotEmpty(pDeque, count);
+
+epilogue:
+  udReleaseMutex(pMutex);
+
+  return result;
+}
+
+// ****************************************************************************
+// Waits up to waitMs for at least one element then pops up to maxCount to pData under a single lock, setting *pCount to the number popped
+// Returns udR_Timeout if there were none (or udR_ObjectNotFound with a zero waitMs)
+template <typename T>
+inline udResult udSafeDeque_PopFrontBatch(udSafeDeque<T> *pDeque, T *pData, size_t maxCount, size_t *pCount, int waitMs = UDTHREAD_WAIT_INFINITE)
+{
+  udResult result = udR_Success;
+  udMutex *pMutex = nullptr;
+  size_t count = 0;
+
+  UD_ERROR_NULL(pDeque, udR_InvalidParameter_);
+  UD_ERROR_IF(maxCount == 0, udR_InvalidParameter_);
+
+  pMutex = udLockMutex(pDeque->pMutex);
+
+  UD_ERROR_NULL(pMutex, udR_NotInitialized_);
+  UD_ERROR_CHECK(udSafeDeque_WaitNotEmpty(pDeque, waitMs));
+  count = pDeque->chunkedArray.PopFrontRange(pData, maxCount);
+  udSafeDeque_SignalNotFull(pDeque, count);
+
+epilogue:
+  udReleaseMutex(pMutex);
+  if (pCount)
+    *pCount = count;
+
+  return result;
+}
+
+// ****************************************************************************
+// Waits up to waitMs for space in a bounded deque, returning udR_Timeout if there was none (or udR_CountExceeded with a zero waitMs)
+template <typename T>
+inline udResult udSafeDeque_PushBackWait(udSafeDeque<T> *pDeque, const T &v, int waitMs = UDTHREAD_WAIT_INFINITE)
+{
+  udResult result = udR_Failure_;
+  udMutex *pMutex = nullptr;
+
+  UD_ERROR_NULL(pDeque, udR_InvalidParameter_);
+
+  pMutex = udLockMutex(pDeque->pMutex);
+
+  UD_ERROR_NULL(pMutex, udR_NotInitialized_);
+  UD_ERROR_CHECK(udSafeDeque_WaitNotFull(pDeque, waitMs));
+  UD_ERROR_CHECK(pDeque->chunkedArray.PushBack(v));
+  udSafeDeque_SignalNotEmpty(pDeque, 1);
+
+epilogue:
+  udReleaseMutex(pMutex);
+
+  return result;
+}
+
+// ****************************************************************************
+template <typename T>
+inline udResult udSafeDeque_PushBackWait(udSafeDeque<T> *pDeque, T &&v, int waitMs = UDTHREAD_WAIT_INFINITE)
+{
+  udResult result = udR_Failure_;
+  udMutex *pMutex = nullptr;
+
+  UD_ERROR_NULL(pDeque, udR_InvalidParameter_);
+
+  pMutex = udLockMutex(pDeque->pMutex);
+
+  UD_ERROR_NULL(pMutex, udR_NotInitialized_);
+  UD_ERROR_CHECK(udSafeDeque_WaitNotFull(pDeque, waitMs));
+  UD_ERROR_CHECK(pDeque->chunkedArray.PushBack(std::move(v)));
+  udSafeDeque_SignalNotEmpty(pDeque, 1);
 
 epilogue:
   udReleaseMutex(pMutex);
@@ -0,0 +1,45 @@
+#ifndef UDSCRATCH_H
+#define UDSCRATCH_H
+//
+// Copyright (c) Euclideon Pty Ltd
+//
+// Per-thread scratch memory. Each thread has its own arena for frame allocations released by rewinding to a mark,
+// and a ring for short lived results (such as the udTempStr family) that are overwritten as the ring wraps.
+// Nothing is shared between threads so no call takes a lock, but memory must not be handed to another thread
+//
+
+#include "udArena.h"
+
+#define UDSCRATCH_RING_SIZE 4096     // Ring allocations remain valid until at least this many bytes more are taken
+#define UDSCRATCH_LARGE_COUNT 4      // Ring allocations over a quarter of the ring are heap blocks, recycled after this many more
+
+// Allocate from the calling thread's scratch arena; the memory remains valid until the thread rewinds past it
+// (normally by a udScratchScope ending) or exits. Returns null on failure
+void *udScratch_Alloc(size_t size, udAllocationFlags flags = udAF_None, size_t alignment = 2 * sizeof(void*));
+#define udScratchAllocType(type, count, flags) (type*)udScratch_Alloc(sizeof(type) * (count), flags, alignof(type))
+
+// Get a mark in the calling thread's scratch arena, and rewind to it, discarding everything allocated since
+udArenaMark udScratch_GetMark();
+void udScratch_ResetToMark(udArenaMark mark);
+
+// Allocate from the calling thread's ring, valid until the ring wraps over it. Returns null on failure
+char *udScratch_RingAlloc(size_t size);
+
+// Release the calling thread's scratch memory, invalidating everything allocated from it. udThread calls this as its
+// threads exit, and other threads release theirs automatically as they exit except on Windows. Exiting the process
+// doesn't release the main thread's, so call this from the main thread at shutdown before checking leaks
+void udScratch_ThreadExit();
+
+// A convenience class to rewind the scratch arena when the variable goes out of scope
+class udScratchScope
+{
+public:
+  udScratchScope() { m_mark = udScratch_GetMark(); }
+  ~udScratchScope() { udScratch_ResetToMark(m_mark); }
+protected:
+  udScratchScope(const udScratchScope &);
+  udScratchScope &operator=(const udScratchScope &);
+  udArenaMark m_mark;
+};
+
+#endif // UDSCRATCH_H
@@ -107,28 +107,33 @@ inline bool udStrEquali(const char *pStr1, const char *pStr2) { return udStrcmpi
 int udAddToStringTable(char *&pStringTable, uint32_t *pStringTableLength, const char *addString, bool knownUnique = false);
 
 // *********************************************************************
-// Some helper functions that make use of internal cycling buffers for convenience (threadsafe)
+// Some helper functions that make use of the calling thread's scratch ring for convenience (threadsafe, lock free)
 // The caller has the responsibility not to hold the pointer or do stupid
 // things with these functions. They are generally useful for passing a
-// string directly to a function, the buffer can be overwritten.
+// string directly to a function, the buffer is overwritten once the thread
+// has created around UDSCRATCH_RING_SIZE bytes of newer temporary strings.
+// Strings longer than a quarter of the ring (1KB) are kept in one of
+// UDSCRATCH_LARGE_COUNT (4) blocks instead, so they are overwritten once the
+// thread has created that many more long temporary strings, whatever their size.
+// All are invalid once the thread exits or calls udScratch_ThreadExit.
 // Do not assume the buffer can be used beyond the string null terminator
 // *********************************************************************
 
-// Create a temporary small string using one of a number of cycling static buffers
+// Create a temporary string of any length
 UD_PRINTF_FORMAT_FUNC(1) const char *udTempStr(const char *pFormat, ...);
 
-// Give back pretty version (ie with commas) of an int using one of a number of cycling static buffers
+// Give back pretty version (ie with commas) of an int as a temporary string
 const char *udTempStr_CommaInt(int64_t n);
 inline const char *udCommaInt(int64_t n) { return udTempStr_CommaInt(n); } // DEPRECATED NAME
 
 // Give back a double whose trailing zeroes are trimmed if possible (0 will trim decimal point also if possible)
 const char *udTempStr_TrimDouble(double v, int maxDecimalPlaces, int minDecimalPlaces = 0, bool undoRounding = false);
 
-// Give back a H:MM:SS format string, optionally trimming to MM:SS if hours is zero using one of a number of cycling static buffers
+// Give back a H:MM:SS format string, optionally trimming to MM:SS if hours is zero as a temporary string
 const char *udTempStr_ElapsedTime(int seconds, bool trimHours = true);
 inline const char *udSecondsToString(int seconds, bool trimHours = true) { return udTempStr_ElapsedTime(seconds, trimHours); } // DEPRECATED NAME
 
-// Return a human readable measurement string such as 1cm for 0.01, 2mm for 0.002 etc using one of a number of cycling static buffers
+// Return a human readable measurement string such as 1cm for 0.01, 2mm for 0.002 etc as a temporary string
 const char *udTempStr_HumanMeasurement(double measurement);
 
 
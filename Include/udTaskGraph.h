@@ -0,0 +1,39 @@
+#ifndef UDTASKGRAPH_H
+#define UDTASKGRAPH_H
+//
+// Copyright (c) Euclideon Pty Ltd
+//
+// Reusable graphs of dependent tasks run on a udWorkerPool
+//
+// Nodes are declared once with the dependencies between them, then each run starts the nodes with no predecessors and
+// every node queues its successors on the pool as it finishes the last of their predecessors, so a pipeline flows from
+// stage to stage without returning to the thread that started it. Every node of a run receives the same user data, so a
+// graph built for a pipeline can be run once per tile (one run at a time)
+//
+
+#include "udWorkerPool.h"
+
+struct udTaskGraph;
+
+udResult udTaskGraph_Create(udTaskGraph **ppGraph, udWorkerPool *pPool);
+
+// Waits for a run in progress before destroying the graph
+void udTaskGraph_Destroy(udTaskGraph **ppGraph);
+
+// Adds a node that calls func (which may be nullptr, to join dependencies) with the run's user data, setting *pNodeIndex
+// to the index used to add its dependencies. Nodes and dependencies can't be added while the graph is running
+udResult udTaskGraph_AddNode(udTaskGraph *pGraph, uint32_t *pNodeIndex, udWorkerPoolCallback func, udWorkerPoolPriority priority = udWPP_Normal);
+
+// The node after starts only once the node before (and any other predecessors) has finished
+udResult udTaskGraph_AddDependency(udTaskGraph *pGraph, uint32_t before, uint32_t after);
+
+// Starts a run of every node, returning udR_NotAllowed if a run is in progress or udR_InvalidConfiguration if the
+// dependencies form a cycle
+udResult udTaskGraph_Run(udTaskGraph *pGraph, void *pUserData = nullptr);
+
+// Waits for the run to finish as udWorkerPool_WaitGroup, returning udR_Timeout if waitMs passes first. If a node
+// couldn't be queued (the pool is shutting down or out of memory) it and the nodes after it didn't run, and the error
+// is returned once the rest of the run has finished
+udResult udTaskGraph_Wait(udTaskGraph *pGraph, int waitMs = UDTHREAD_WAIT_INFINITE, bool helpWithTasks = false);
+
+#endif // UDTASKGRAPH_H
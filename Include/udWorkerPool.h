@@ -7,20 +7,103 @@
 //
 // Handles fire and forget work by pooling and processing async
 //
+// Each worker thread keeps its own queue of tasks, taking its newest task first and stealing the oldest from a random other
+// worker when it runs out. Tasks added from outside the pool go to a shared queue the workers take from in order
+//
+// Delayed and periodic tasks wait in a hierarchical timer wheel serviced by a single timer thread, which the pool starts
+// when the first of them is added. Adding and cancelling them take constant time however many are waiting
+//
 
 #include "udResult.h"
 #include "udCallback.h"
+#include "udThread.h"
 
 // Function definition for async and marshalled work
 using udWorkerPoolCallback = udCallback<void(void *)>;
 struct udWorkerPool;
+struct udCancelToken; // See udCancelToken.h
+class udJSON;
+struct udWorkerPoolGroup; // A batch of tasks that can be waited on together
+
+// Each priority has its own lane of queued tasks
+enum udWorkerPoolPriority
+{
+  udWPP_Interactive, // Work something is waiting on now, e.g. tiles in view
+  udWPP_Normal,
+  udWPP_Background, // Bulk work such as prefetching or conversion
+
+  udWPP_Count
+};
+
+// How threads choose which lane to take their next task from
+enum udWorkerPoolSchedule
+{
+  udWPS_Strict,   // Always the highest priority lane with a task queued
+  udWPS_Weighted, // Each thread shares its tasks between the lanes with queued tasks in proportion to their weights
+};
+
+struct udWorkerPoolLaneMetrics
+{
+  int queuedTasks;     // Tasks currently waiting to start
+  int peakQueuedTasks; // The most tasks waiting at once since the pool was created
+  uint32_t addedTasks;     // Wraps
+  uint32_t completedTasks; // Wraps
+  uint32_t cancelledTasks; // Wraps, dropped without running as their token was cancelled
+};
 
 udResult udWorkerPool_Create(udWorkerPool **ppPool, uint8_t totalThreads, const char *pThreadNamePrefix = "udWorkerPool");
 void udWorkerPool_Destroy(udWorkerPool **ppPool);
 
 // Adds a function to run on a background thread, optionally with userdata. If clearMemory is true, it will call udFree on pUserData after running
+// Tasks added from one of the pool's own threads are queued on that thread, so tasks spawning more tasks stay local
 udResult udWorkerPool_AddTask(udWorkerPool *pPool, udWorkerPoolCallback func, void *pUserData = nullptr, bool clearMemory = true, udWorkerPoolCallback postFunction = nullptr);
 
+// As udWorkerPool_AddTask (which uses udWPP_Normal) but queued in the lane for priority
+udResult udWorkerPool_AddPriorityTask(udWorkerPool *pPool, udWorkerPoolPriority priority, udWorkerPoolCallback func, void *pUserData = nullptr, bool clearMemory = true, udWorkerPoolCallback postFunction = nullptr);
+
+// As udWorkerPool_AddPriorityTask, but once pToken is cancelled the task is dropped without running (pUserData is still freed
+// if clearMemory, and postFunction isn't run). While running, pToken is the thread's current token for the task to poll
+udResult udWorkerPool_AddCancellableTask(udWorkerPool *pPool, udCancelToken *pToken, udWorkerPoolPriority priority, udWorkerPoolCallback func, void *pUserData = nullptr, bool clearMemory = true, udWorkerPoolCallback postFunction = nullptr);
+
+// Sets how threads choose between the lanes, udWPS_Strict by default. The weights are per priority and must be at least 1,
+// if pWeights is nullptr for udWPS_Weighted the weights are 16, 4, 1
+udResult udWorkerPool_SetSchedule(udWorkerPool *pPool, udWorkerPoolSchedule schedule, const uint8_t pWeights[udWPP_Count] = nullptr);
+
+// Reports the queue depth and counts of tasks through the lane for priority
+udResult udWorkerPool_GetLaneMetrics(udWorkerPool *pPool, udWorkerPoolPriority priority, udWorkerPoolLaneMetrics *pMetrics);
+
+// A group may be reused once its tasks are finished, and must be destroyed before its pool
+udResult udWorkerPool_CreateGroup(udWorkerPoolGroup **ppGroup, udWorkerPool *pPool);
+
+// Waits for the group's outstanding tasks before destroying it
+void udWorkerPool_DestroyGroup(udWorkerPoolGroup **ppGroup);
+
+// As udWorkerPool_AddPriorityTask, the task is finished once func has run and any postFunction is queued
+udResult udWorkerPool_AddGroupTask(udWorkerPoolGroup *pGroup, udWorkerPoolPriority priority, udWorkerPoolCallback func, void *pUserData = nullptr, bool clearMemory = true, udWorkerPoolCallback postFunction = nullptr);
+
+// Sleeps until every task added to the group has finished, returns udR_Timeout if waitMs passes first
+// If helpWithTasks the calling thread first runs queued tasks (not only the group's) until there are none left to take,
+// which a worker thread waiting on a group must do to avoid waiting on tasks queued behind itself
+udResult udWorkerPool_WaitGroup(udWorkerPoolGroup *pGroup, int waitMs = UDTHREAD_WAIT_INFINITE, bool helpWithTasks = false);
+
+// Returns the number of the group's tasks not yet finished
+int udWorkerPool_GetGroupTaskCount(udWorkerPoolGroup *pGroup);
+
+// Calls body(rangeBegin, rangeEnd) for ranges covering [begin, end) on the pool's threads and the calling thread, returning
+// once all are done. Ranges are halved as threads take them (never below grain indices), so uneven work still spreads out
+// without a task per index. May be called from the pool's own tasks, and with a null pool runs on the calling thread
+udResult udWorkerPool_ParallelFor(udWorkerPool *pPool, size_t begin, size_t end, size_t grain, udCallback<void(size_t, size_t)> body);
+
+// Queues func (with pUserData, which the caller owns) to run after delayMs, then every periodMs if periodMs isn't zero.
+// Timing is to the millisecond but a run may start later when the pool is busy. A periodic task still queued or running when
+// it is next due skips that run. If pTimer isn't nullptr it is set to a handle for udWorkerPool_CancelTimedTask, and with
+// a group each run counts as one of the group's tasks, so cancelling then waiting on the group ensures no run is in progress
+udResult udWorkerPool_AddTimedTask(udWorkerPool *pPool, uint64_t *pTimer, uint32_t delayMs, uint32_t periodMs, udWorkerPoolCallback func, void *pUserData = nullptr, udWorkerPoolPriority priority = udWPP_Normal, udWorkerPoolGroup *pGroup = nullptr);
+
+// Stops any further runs of the task, including one queued that hasn't started. Returns udR_ObjectNotFound once a task that
+// runs once has finished or the task was already cancelled
+udResult udWorkerPool_CancelTimedTask(udWorkerPool *pPool, uint64_t timer);
+
 // This must be run on the main thread, handles marshalling work back from worker threads if required
 // The parameter can be used to limit how much work is done each time this is called
 // Returns udR_NothingToDo if no work was done- otherwise udR_Success
@@ -29,4 +112,22 @@ udResult udWorkerPool_DoPostWork(udWorkerPool *pPool, int processLimit = 0);
 // Returns true if there are workers currently processing tasks or if workers should be processing tasks
 bool udWorkerPool_HasActiveWorkers(udWorkerPool *pPool);
 
+// Runs the next queued task on the calling thread, so a thread waiting on tasks it queued can help rather than block
+// Returns udR_NothingToDo if no task was queued- otherwise udR_Success
+udResult udWorkerPool_TryDoWork(udWorkerPool *pPool);
+
+// Starts (clearing anything recorded before) or stops recording scheduler metrics in the worker threads. Each thread keeps its
+// own histograms of the queue depth as it takes a task, and of how long its tasks waited and ran. Tasks run by other threads
+// (e.g. helping in udWorkerPool_WaitGroup) aren't recorded
+udResult udWorkerPool_SetMetricsEnabled(udWorkerPool *pPool, bool enabled);
+
+// Writes what has been recorded to pReport as { "recording", "elapsedMs", "threads": [ { "queueDepth", "waitMicroseconds",
+// "runMicroseconds", "sleeps", "utilisation" } ], "total": { "queueDepth", "waitMicroseconds", "runMicroseconds", "sleeps" } },
+// where each histogram is { "count", "sum", "buckets": [] }. Bucket 0 counts zeros and bucket i values from 2^(i-1) up to 2^i,
+// with trailing empty buckets left out. Utilisation is the fraction of the elapsed time the thread spent running tasks
+udResult udWorkerPool_ReportMetrics(udWorkerPool *pPool, udJSON *pReport);
+
+// Returns the number of worker threads, zero for a null pool
+int udWorkerPool_GetThreadCount(udWorkerPool *pPool);
+
 #endif // udWorkerPool_h__
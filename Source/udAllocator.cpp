@@ -0,0 +1,365 @@
+#include "udAllocator.h"
+#include "udThread.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if !UDPLATFORM_WINDOWS
+# include <pthread.h>
+#endif
+
+// Small blocks are rounded up to a power of two size class and carved from slabs. Every block is preceded by
+// a header recording its size class, so a free can find its bin without a lookup. Each thread keeps a bin of
+// free blocks per size class; only moving batches between a thread bin and the shared central bin takes a lock.
+// Slabs are kept on a list so the backend's deinit can return them to the system
+#define UDTC_CLASS_MIN_SHIFT  4                                  // Smallest size class is 16 bytes
+#define UDTC_CLASS_COUNT      8                                  // Largest size class is 2KB
+#define UDTC_CLASS_MAX_SIZE   (size_t(1) << (UDTC_CLASS_MIN_SHIFT + UDTC_CLASS_COUNT - 1))
+#define UDTC_HEADER_SIZE      16                                 // Keeps user memory 16 byte aligned
+#define UDTC_BATCH_COUNT      32                                 // Blocks moved between a thread and the central bin at a time
+#define UDTC_MAX_THREAD_COUNT (UDTC_BATCH_COUNT * 4)             // Free blocks a thread keeps per class before returning a batch
+#define UDTC_LARGE_CLASS      0xFFFFFFFF
+
+struct udThreadCacheHeader
+{
+  uint32_t sizeClass; // UDTC_LARGE_CLASS for blocks allocated from the system backend
+  uint32_t offset;    // Large blocks only, bytes from the system allocation to the user memory
+  size_t size;        // Large blocks only, bytes requested
+};
+UDCOMPILEASSERT(sizeof(udThreadCacheHeader) <= UDTC_HEADER_SIZE, "Thread cache header too large");
+
+struct udThreadCacheFreeBlock
+{
+  udThreadCacheFreeBlock *pNext;
+};
+
+struct udThreadCacheBin
+{
+  udThreadCacheFreeBlock *pHead;
+  size_t count;
+};
+
+struct udThreadCacheCentralBin
+{
+  volatile int32_t lock;
+  udThreadCacheFreeBlock *volatile pHead; // Volatile as it's peeked without the lock
+  size_t count;
+};
+
+struct udThreadCacheSlab
+{
+  udThreadCacheSlab *pNext;
+};
+UDCOMPILEASSERT(sizeof(udThreadCacheSlab) <= UDTC_HEADER_SIZE, "Thread cache slab header too large");
+
+static UDTHREADLOCAL udThreadCacheBin t_udThreadCacheBins[UDTC_CLASS_COUNT];
+static udThreadCacheCentralBin s_udThreadCacheCentralBins[UDTC_CLASS_COUNT];
+static volatile int32_t s_udThreadCacheSlabLock;
+static udThreadCacheSlab *s_pThreadCacheSlabs;
+
+// ----------------------------------------------------------------------------
+static inline void udThreadCache_Lock(volatile int32_t *pLock)
+{
+  while (udInterlockedCompareExchange(pLock, 1, 0) != 0)
+    udYield();
+}
+
+// ----------------------------------------------------------------------------
+static inline void udThreadCache_Unlock(volatile int32_t *pLock)
+{
+  udInterlockedExchange(pLock, 0);
+}
+
+// ----------------------------------------------------------------------------
+static inline udThreadCacheHeader *udThreadCache_GetHeader(void *pMemory)
+{
+  return (udThreadCacheHeader*)((uint8_t*)pMemory - UDTC_HEADER_SIZE);
+}
+
+// ----------------------------------------------------------------------------
+static inline uint32_t udThreadCache_SizeClass(size_t size)
+{
+  uint32_t sizeClass = 0;
+  while ((size_t(1) << (UDTC_CLASS_MIN_SHIFT + sizeClass)) < size)
+    ++sizeClass;
+  return sizeClass;
+}
+
+// ----------------------------------------------------------------------------
+// Move up to count blocks from the thread bin to the central bin
+static void udThreadCache_ReleaseBlocks(uint32_t sizeClass, size_t count)
+{
+  udThreadCacheBin *pBin = &t_udThreadCacheBins[sizeClass];
+  if (!pBin->pHead || !count)
+    return;
+
+  udThreadCacheFreeBlock *pFirst = pBin->pHead;
+  udThreadCacheFreeBlock *pLast = pFirst;
+  size_t moved = 1;
+  while (moved < count && pLast->pNext)
+  {
+    pLast = pLast->pNext;
+    ++moved;
+  }
+  pBin->pHead = pLast->pNext;
+  pBin->count -= moved;
+
+  udThreadCacheCentralBin *pCentral = &s_udThreadCacheCentralBins[sizeClass];
+  udThreadCache_Lock(&pCentral->lock);
+  pLast->pNext = pCentral->pHead;
+  pCentral->pHead = pFirst;
+  pCentral->count += moved;
+  udThreadCache_Unlock(&pCentral->lock);
+}
+
+static void udThreadCache_ThreadExit();
+
+#if !UDPLATFORM_WINDOWS
+// Threads not started by udThread release their bins through a key destructor as they exit
+static pthread_key_t s_udThreadCacheKey;
+static pthread_once_t s_udThreadCacheKeyOnce = PTHREAD_ONCE_INIT;
+static bool s_udThreadCacheKeyCreated = false;
+static UDTHREADLOCAL bool t_udThreadCacheKeySet;
+
+// ----------------------------------------------------------------------------
+static void udThreadCache_KeyDestructor(void *)
+{
+  udThreadCache_ThreadExit();
+}
+
+// ----------------------------------------------------------------------------
+static void udThreadCache_CreateKey()
+{
+  s_udThreadCacheKeyCreated = (pthread_key_create(&s_udThreadCacheKey, udThreadCache_KeyDestructor) == 0);
+}
+#endif
+
+// ----------------------------------------------------------------------------
+// Refill an empty thread bin from the central bin, or carve a new slab if the central bin is also empty
+static bool udThreadCache_Refill(uint32_t sizeClass)
+{
+  udThreadCacheBin *pBin = &t_udThreadCacheBins[sizeClass];
+  udThreadCacheCentralBin *pCentral = &s_udThreadCacheCentralBins[sizeClass];
+
+#if !UDPLATFORM_WINDOWS
+  if (!t_udThreadCacheKeySet)
+  {
+    // Any non-null value, the destructor only needs to run
+    pthread_once(&s_udThreadCacheKeyOnce, udThreadCache_CreateKey);
+    if (s_udThreadCacheKeyCreated)
+      pthread_setspecific(s_udThreadCacheKey, pBin);
+    t_udThreadCacheKeySet = true;
+  }
+#endif
+
+  if (pCentral->pHead) // Unlocked peek to avoid taking the lock when there's nothing to take
+  {
+    udThreadCache_Lock(&pCentral->lock);
+    udThreadCacheFreeBlock *pFirst = pCentral->pHead;
+    if (pFirst)
+    {
+      udThreadCacheFreeBlock *pLast = pFirst;
+      size_t moved = 1;
+      while (moved < UDTC_BATCH_COUNT && pLast->pNext)
+      {
+        pLast = pLast->pNext;
+        ++moved;
+      }
+      pCentral->pHead = pLast->pNext;
+      pCentral->count -= moved;
+      udThreadCache_Unlock(&pCentral->lock);
+
+      pLast->pNext = pBin->pHead;
+      pBin->pHead = pFirst;
+      pBin->count += moved;
+      return true;
+    }
+    udThreadCache_Unlock(&pCentral->lock);
+  }
+
+  // The slab's link takes the place of a block header, keeping the blocks 16 byte aligned
+  size_t blockSize = UDTC_HEADER_SIZE + (size_t(1) << (UDTC_CLASS_MIN_SHIFT + sizeClass));
+  udThreadCacheSlab *pSlab = (udThreadCacheSlab*)malloc(UDTC_HEADER_SIZE + blockSize * UDTC_BATCH_COUNT);
+  if (!pSlab)
+    return false;
+
+  udThreadCache_Lock(&s_udThreadCacheSlabLock);
+  pSlab->pNext = s_pThreadCacheSlabs;
+  s_pThreadCacheSlabs = pSlab;
+  udThreadCache_Unlock(&s_udThreadCacheSlabLock);
+
+  uint8_t *pBlocks = (uint8_t*)pSlab + UDTC_HEADER_SIZE;
+  for (size_t i = 0; i < UDTC_BATCH_COUNT; ++i)
+  {
+    udThreadCacheHeader *pHeader = (udThreadCacheHeader*)(pBlocks + i * blockSize);
+    pHeader->sizeClass = sizeClass;
+    pHeader->offset = UDTC_HEADER_SIZE;
+    pHeader->size = 0;
+
+    udThreadCacheFreeBlock *pBlock = (udThreadCacheFreeBlock*)((uint8_t*)pHeader + UDTC_HEADER_SIZE);
+    pBlock->pNext = pBin->pHead;
+    pBin->pHead = pBlock;
+  }
+  pBin->count += UDTC_BATCH_COUNT;
+
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Large blocks come from the system backend, so they're mapped and honour the placement flags the same way
+static void *udThreadCache_AllocLarge(size_t size, size_t alignment, udAllocationFlags flags, const char *pFile, int line)
+{
+  if (alignment < UDTC_HEADER_SIZE)
+    alignment = UDTC_HEADER_SIZE;
+
+  // The system backend zeroes the block when asked, which leaves fresh mappings untouched
+  uint8_t *pSystem = (uint8_t*)udAllocator_SystemBackend()->pAlloc(size + UDTC_HEADER_SIZE + alignment, sizeof(size_t), flags, pFile, line);
+  if (!pSystem)
+    return nullptr;
+
+  uint8_t *pMemory = (uint8_t*)UDALIGN_POWEROF2((uintptr_t)(pSystem + UDTC_HEADER_SIZE), alignment);
+  udThreadCacheHeader *pHeader = udThreadCache_GetHeader(pMemory);
+  pHeader->sizeClass = UDTC_LARGE_CLASS;
+  pHeader->offset = (uint32_t)(pMemory - pSystem);
+  pHeader->size = size;
+
+  return pMemory;
+}
+
+// ----------------------------------------------------------------------------
+static void *udThreadCache_Alloc(size_t size, size_t alignment, udAllocationFlags flags, const char *pFile, int line)
+{
+  if (size > UDTC_CLASS_MAX_SIZE || alignment > UDTC_HEADER_SIZE)
+    return udThreadCache_AllocLarge(size, alignment, flags, pFile, line);
+
+  uint32_t sizeClass = udThreadCache_SizeClass(size);
+  udThreadCacheBin *pBin = &t_udThreadCacheBins[sizeClass];
+  if (!pBin->pHead && !udThreadCache_Refill(sizeClass))
+    return nullptr;
+
+  udThreadCacheFreeBlock *pBlock = pBin->pHead;
+  pBin->pHead = pBlock->pNext;
+  --pBin->count;
+
+  if (flags & udAF_Zero)
+    memset(pBlock, 0, size);
+
+  return pBlock;
+}
+
+// ----------------------------------------------------------------------------
+static void udThreadCache_Free(void *pMemory, const char *pFile, int line)
+{
+  if (!pMemory)
+    return;
+
+  udThreadCacheHeader *pHeader = udThreadCache_GetHeader(pMemory);
+  if (pHeader->sizeClass == UDTC_LARGE_CLASS)
+  {
+    udAllocator_SystemBackend()->pFree((uint8_t*)pMemory - pHeader->offset, pFile, line);
+    return;
+  }
+
+  udThreadCacheBin *pBin = &t_udThreadCacheBins[pHeader->sizeClass];
+  udThreadCacheFreeBlock *pBlock = (udThreadCacheFreeBlock*)pMemory;
+  pBlock->pNext = pBin->pHead;
+  pBin->pHead = pBlock;
+  if (++pBin->count > UDTC_MAX_THREAD_COUNT)
+    udThreadCache_ReleaseBlocks(pHeader->sizeClass, UDTC_BATCH_COUNT);
+}
+
+// ----------------------------------------------------------------------------
+static void *udThreadCache_Realloc(void *pMemory, size_t size, size_t alignment, const char *pFile, int line)
+{
+  if (!pMemory)
+    return udThreadCache_Alloc(size, alignment, udAF_None, pFile, line);
+
+  if (!size)
+  {
+    udThreadCache_Free(pMemory, pFile, line);
+    return nullptr;
+  }
+
+  udThreadCacheHeader *pHeader = udThreadCache_GetHeader(pMemory);
+  size_t oldSize;
+  if (pHeader->sizeClass == UDTC_LARGE_CLASS)
+  {
+    // Blocks without extra alignment padding can be resized by the system backend, which remaps large blocks
+    if (pHeader->offset == UDTC_HEADER_SIZE && alignment <= UDTC_HEADER_SIZE && size > UDTC_CLASS_MAX_SIZE)
+    {
+      uint8_t *pSystem = (uint8_t*)udAllocator_SystemBackend()->pRealloc((uint8_t*)pMemory - UDTC_HEADER_SIZE, size + UDTC_HEADER_SIZE, sizeof(size_t), pFile, line);
+      if (!pSystem)
+        return nullptr;
+      ((udThreadCacheHeader*)pSystem)->size = size;
+      return pSystem + UDTC_HEADER_SIZE;
+    }
+    oldSize = pHeader->size;
+  }
+  else
+  {
+    oldSize = size_t(1) << (UDTC_CLASS_MIN_SHIFT + pHeader->sizeClass);
+    if (size <= oldSize && alignment <= UDTC_HEADER_SIZE)
+      return pMemory;
+  }
+
+  void *pNewMemory = udThreadCache_Alloc(size, alignment, udAF_None, pFile, line);
+  if (pNewMemory)
+  {
+    memcpy(pNewMemory, pMemory, udMin(oldSize, size));
+    udThreadCache_Free(pMemory, pFile, line);
+  }
+  return pNewMemory;
+}
+
+// ----------------------------------------------------------------------------
+static void udThreadCache_ThreadExit()
+{
+  for (uint32_t sizeClass = 0; sizeClass < UDTC_CLASS_COUNT; ++sizeClass)
+    udThreadCache_ReleaseBlocks(sizeClass, t_udThreadCacheBins[sizeClass].count);
+}
+
+// ----------------------------------------------------------------------------
+// Return every slab to the system. All blocks must have been freed and every other thread that used the backend
+// must have released its bins, the calling thread's bins are released here
+static void udThreadCache_Deinit()
+{
+  udThreadCache_ThreadExit();
+
+  for (uint32_t sizeClass = 0; sizeClass < UDTC_CLASS_COUNT; ++sizeClass)
+  {
+    udThreadCacheCentralBin *pCentral = &s_udThreadCacheCentralBins[sizeClass];
+    udThreadCache_Lock(&pCentral->lock);
+    pCentral->pHead = nullptr;
+    pCentral->count = 0;
+    udThreadCache_Unlock(&pCentral->lock);
+  }
+
+  udThreadCache_Lock(&s_udThreadCacheSlabLock);
+  udThreadCacheSlab *pSlab = s_pThreadCacheSlabs;
+  s_pThreadCacheSlabs = nullptr;
+  udThreadCache_Unlock(&s_udThreadCacheSlabLock);
+
+  while (pSlab)
+  {
+    udThreadCacheSlab *pNext = pSlab->pNext;
+    free(pSlab);
+    pSlab = pNext;
+  }
+}
+
+// ----------------------------------------------------------------------------
+static size_t udThreadCache_UsableSize(void *pMemory)
+{
+  udThreadCacheHeader *pHeader = udThreadCache_GetHeader(pMemory);
+  if (pHeader->sizeClass == UDTC_LARGE_CLASS)
+    return pHeader->size;
+  return size_t(1) << (UDTC_CLASS_MIN_SHIFT + pHeader->sizeClass);
+}
+
+static const udAllocatorBackend s_udThreadCacheAllocatorBackend = { "ThreadCache", udThreadCache_Alloc, udThreadCache_Realloc, udThreadCache_Free, udThreadCache_ThreadExit, udThreadCache_UsableSize, udThreadCache_Deinit };
+
+// ----------------------------------------------------------------------------
+const udAllocatorBackend *udAllocator_ThreadCacheBackend()
+{
+  return &s_udThreadCacheAllocatorBackend;
+}
@@ -0,0 +1,210 @@
+#include "udArena.h"
+
+#include <string.h>
+
+struct udArenaBlock
+{
+  udArenaBlock *pNext;
+  size_t size; // Bytes available following the header
+  size_t used;
+  size_t reserved; // Pads the header so the data following it has the alignment of udAlloc
+};
+
+struct udArena
+{
+  udArenaBlock *pFirst;
+  udArenaBlock *pCurrent; // Blocks after the current block are empty and kept for reuse
+  size_t blockSize;
+};
+
+// ----------------------------------------------------------------------------
+static inline uint8_t *udArena_BlockData(udArenaBlock *pBlock)
+{
+  return (uint8_t*)(pBlock + 1);
+}
+
+// ----------------------------------------------------------------------------
+udResult udArena_Create(udArena **ppArena, size_t blockSize)
+{
+  udResult result;
+  udArena *pArena = nullptr;
+
+  UD_ERROR_NULL(ppArena, udR_InvalidParameter_);
+
+  pArena = udAllocType(udArena, 1, udAF_Zero);
+  UD_ERROR_NULL(pArena, udR_MemoryAllocationFailure);
+
+  pArena->blockSize = blockSize ? blockSize : UDARENA_DEFAULT_BLOCK_SIZE;
+
+  *ppArena = pArena;
+  pArena = nullptr;
+  result = udR_Success;
+
+epilogue:
+  udFree(pArena);
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+void udArena_Destroy(udArena **ppArena)
+{
+  if (ppArena == nullptr || *ppArena == nullptr)
+    return;
+
+  udArena *pArena = *ppArena;
+  *ppArena = nullptr;
+
+  while (pArena->pFirst)
+  {
+    udArenaBlock *pNext = pArena->pFirst->pNext;
+    udFree(pArena->pFirst);
+    pArena->pFirst = pNext;
+  }
+  udFree(pArena);
+}
+
+// ----------------------------------------------------------------------------
+// Move to the next retained block if it has room for minSize bytes, otherwise insert a new block after the current one
+static udArenaBlock *udArena_NextBlock(udArena *pArena, size_t minSize)
+{
+  udArenaBlock *pNext = pArena->pCurrent ? pArena->pCurrent->pNext : pArena->pFirst;
+  if (pNext && pNext->size >= minSize)
+  {
+    pNext->used = 0;
+    pArena->pCurrent = pNext;
+    return pNext;
+  }
+
+  size_t size = udMax(pArena->blockSize, minSize);
+  udArenaBlock *pBlock = (udArenaBlock*)udAlloc(sizeof(udArenaBlock) + size);
+  if (!pBlock)
+    return nullptr;
+
+  pBlock->size = size;
+  pBlock->used = 0;
+  pBlock->pNext = pNext;
+  if (pArena->pCurrent)
+    pArena->pCurrent->pNext = pBlock;
+  else
+    pArena->pFirst = pBlock;
+  pArena->pCurrent = pBlock;
+
+  return pBlock;
+}
+
+// ----------------------------------------------------------------------------
+void *udArena_Alloc(udArena *pArena, size_t size, udAllocationFlags flags, size_t alignment)
+{
+  if (!pArena || !alignment || (alignment & (alignment - 1)))
+    return nullptr;
+
+  udArenaBlock *pBlock = pArena->pCurrent;
+  uint8_t *pMemory = nullptr;
+  if (pBlock)
+  {
+    uint8_t *pData = udArena_BlockData(pBlock);
+    pMemory = (uint8_t*)UDALIGN_POWEROF2((uintptr_t)(pData + pBlock->used), alignment);
+    if ((size_t)(pMemory - pData) + size > pBlock->size)
+      pMemory = nullptr;
+  }
+
+  if (!pMemory)
+  {
+    pBlock = udArena_NextBlock(pArena, size + alignment);
+    if (!pBlock)
+      return nullptr;
+    pMemory = (uint8_t*)UDALIGN_POWEROF2((uintptr_t)udArena_BlockData(pBlock), alignment);
+  }
+
+  pBlock->used = (size_t)(pMemory - udArena_BlockData(pBlock)) + size;
+  if (flags & udAF_Zero)
+    memset(pMemory, 0, size);
+
+  return pMemory;
+}
+
+// ----------------------------------------------------------------------------
+char *udArena_Strdup(udArena *pArena, const char *pStr, size_t charCount)
+{
+  if (!pStr)
+    return nullptr;
+
+  size_t len = 0;
+  if (charCount)
+  {
+    while (len < charCount && pStr[len])
+      ++len;
+  }
+  else
+  {
+    len = strlen(pStr);
+  }
+
+  char *pDup = (char*)udArena_Alloc(pArena, len + 1, udAF_None, 1);
+  if (pDup)
+  {
+    memcpy(pDup, pStr, len);
+    pDup[len] = 0;
+  }
+  return pDup;
+}
+
+// ----------------------------------------------------------------------------
+udArenaMark udArena_GetMark(udArena *pArena)
+{
+  udArenaMark mark = { nullptr, 0 };
+  if (pArena && pArena->pCurrent)
+  {
+    mark.pBlock = pArena->pCurrent;
+    mark.used = pArena->pCurrent->used;
+  }
+  return mark;
+}
+
+// ----------------------------------------------------------------------------
+void udArena_ResetToMark(udArena *pArena, udArenaMark mark)
+{
+  if (!pArena)
+    return;
+
+  if (mark.pBlock)
+  {
+    pArena->pCurrent = (udArenaBlock*)mark.pBlock;
+    pArena->pCurrent->used = mark.used;
+  }
+  else
+  {
+    pArena->pCurrent = pArena->pFirst;
+    if (pArena->pCurrent)
+      pArena->pCurrent->used = 0;
+  }
+}
+
+// ----------------------------------------------------------------------------
+void udArena_Reset(udArena *pArena)
+{
+  udArenaMark start = { nullptr, 0 };
+  udArena_ResetToMark(pArena, start);
+}
+
+// ----------------------------------------------------------------------------
+void udArena_GetUsage(udArena *pArena, size_t *pBytesUsed, size_t *pBytesReserved)
+{
+  size_t used = 0;
+  size_t reserved = 0;
+  bool pastCurrent = (pArena == nullptr || pArena->pCurrent == nullptr);
+
+  for (udArenaBlock *pBlock = pArena ? pArena->pFirst : nullptr; pBlock; pBlock = pBlock->pNext)
+  {
+    if (!pastCurrent)
+      used += pBlock->used;
+    reserved += pBlock->size;
+    if (pBlock == pArena->pCurrent)
+      pastCurrent = true;
+  }
+
+  if (pBytesUsed)
+    *pBytesUsed = used;
+  if (pBytesReserved)
+    *pBytesReserved = reserved;
+}
@@ -1,5 +1,8 @@
 #include "udAsyncJob.h"
 #include "udThread.h"
+#include "udPool.h"
+
+#include <string.h>
 
 #define RESULT_SENTINAL -1 // A sentinal value used to determine when valid result has been written
 #define RESULT_PENDING  -2 // A sentinal value used to determine when async call has been made and not returned
@@ -9,8 +12,21 @@ struct udAsyncJob
   udSemaphore *pSemaphore;
   volatile int32_t returnResult;
   udInterlockedBool pending;
+  udCancelToken *pCancelToken;
 };
 
+// Parameter blocks are copied per call, so are pooled in a few size classes with larger ones going to the heap
+template <size_t size>
+struct udAsyncJobParamBlock
+{
+  alignas(16) uint8_t data[size];
+};
+
+static udPool<udAsyncJob> s_jobPool(0, true);
+static udPool<udAsyncJobParamBlock<64>> s_params64Pool;
+static udPool<udAsyncJobParamBlock<128>> s_params128Pool;
+static udPool<udAsyncJobParamBlock<256>> s_params256Pool;
+
 // ****************************************************************************
 // Author: Dave Pevreal, March 2018
 udResult udAsyncJob_Create(udAsyncJob **ppJobHandle)
@@ -18,10 +34,11 @@ udResult udAsyncJob_Create(udAsyncJob **ppJobHandle)
   udResult result;
   udAsyncJob *pJob = nullptr;
 
-  pJob = udAllocType(udAsyncJob, 1, udAF_Zero);
+  pJob = s_jobPool.Alloc(udAF_Zero);
   UD_ERROR_NULL(pJob, udR_MemoryAllocationFailure);
   pJob->pSemaphore = udCreateSemaphore();
   UD_ERROR_NULL(pJob->pSemaphore, udR_MemoryAllocationFailure);
+  UD_ERROR_CHECK(udCancelToken_Create(&pJob->pCancelToken));
   udInterlockedExchange(&pJob->returnResult, RESULT_SENTINAL);
   pJob->pending = false;
   *ppJobHandle = pJob;
@@ -93,7 +110,43 @@ bool udAsyncJob_GetResultTimeout(udAsyncJob *pJobHandle, udResult *pResult, int
 void udAsyncJob_SetPending(udAsyncJob *pJobHandle)
 {
   if (pJobHandle)
+  {
+    udCancelToken_Reset(pJobHandle->pCancelToken);
     pJobHandle->pending = true;
+  }
+}
+
+// ****************************************************************************
+void udAsyncJob_Cancel(udAsyncJob *pJobHandle)
+{
+  if (pJobHandle)
+    udCancelToken_Cancel(pJobHandle->pCancelToken);
+}
+
+// ****************************************************************************
+udCancelToken *udAsyncJob_GetCancelToken(udAsyncJob *pJobHandle)
+{
+  return (pJobHandle) ? pJobHandle->pCancelToken : nullptr;
+}
+
+// ****************************************************************************
+bool udAsyncJob_BeginCall(udAsyncJob *pJobHandle)
+{
+  if (pJobHandle && udCancelToken_IsCancelled(pJobHandle->pCancelToken))
+  {
+    udAsyncJob_SetResult(pJobHandle, udR_Cancelled);
+    return false;
+  }
+
+  udCancelToken_SetCurrent(udAsyncJob_GetCancelToken(pJobHandle));
+  return true;
+}
+
+// ****************************************************************************
+void udAsyncJob_EndCall(udAsyncJob *pJobHandle, udResult returnResult)
+{
+  udCancelToken_SetCurrent(nullptr); // The thread may be cached and reused
+  udAsyncJob_SetResult(pJobHandle, returnResult);
 }
 
 // ****************************************************************************
@@ -111,10 +164,42 @@ void udAsyncJob_Destroy(udAsyncJob **ppJobHandle)
   if (ppJobHandle && *ppJobHandle)
   {
     udDestroySemaphore(&(*ppJobHandle)->pSemaphore);
-    udFree(*ppJobHandle);
+    udCancelToken_Destroy(&(*ppJobHandle)->pCancelToken);
+    s_jobPool.Free(*ppJobHandle);
   }
 }
 
+// ****************************************************************************
+void *udAsyncJob_DupParams(const void *pParams, size_t size)
+{
+  void *pCopy;
+  if (size <= 64)
+    pCopy = s_params64Pool.Alloc();
+  else if (size <= 128)
+    pCopy = s_params128Pool.Alloc();
+  else if (size <= 256)
+    pCopy = s_params256Pool.Alloc();
+  else
+    return udMemDup(pParams, size, 0, udAF_None);
+
+  if (pCopy)
+    memcpy(pCopy, pParams, size);
+  return pCopy;
+}
+
+// ****************************************************************************
+void udAsyncJob_FreeParams(void *pParams, size_t size)
+{
+  if (size <= 64)
+    udPool_Free(&s_params64Pool, pParams);
+  else if (size <= 128)
+    udPool_Free(&s_params128Pool, pParams);
+  else if (size <= 256)
+    udPool_Free(&s_params256Pool, pParams);
+  else
+    udFree(pParams);
+}
+
 // ****************************************************************************
 // Author: Dave Pevreal, February 2019
 void udAsyncPause_RequestPause(udAsyncPause *pPause)
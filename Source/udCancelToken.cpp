@@ -0,0 +1,85 @@
+#include "udCancelToken.h"
+
+#include "udPlatform.h"
+
+struct udCancelToken
+{
+  volatile int32_t references;
+  volatile int32_t cancelled; // Read without an interlocked operation, as it is polled often
+};
+
+static UDTHREADLOCAL udCancelToken *t_pCurrentToken;
+
+// ----------------------------------------------------------------------------
+udResult udCancelToken_Create(udCancelToken **ppToken)
+{
+  udResult result;
+  udCancelToken *pToken = nullptr;
+
+  UD_ERROR_NULL(ppToken, udR_InvalidParameter_);
+
+  pToken = udAllocType(udCancelToken, 1, udAF_Zero);
+  UD_ERROR_NULL(pToken, udR_MemoryAllocationFailure);
+  pToken->references = 1;
+
+  *ppToken = pToken;
+  result = udR_Success;
+
+epilogue:
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+void udCancelToken_Destroy(udCancelToken **ppToken)
+{
+  if (ppToken == nullptr || *ppToken == nullptr)
+    return;
+
+  udCancelToken *pToken = *ppToken;
+  *ppToken = nullptr;
+
+  if (udInterlockedPreDecrement(&pToken->references) == 0)
+    udFree(pToken);
+}
+
+// ----------------------------------------------------------------------------
+udCancelToken *udCancelToken_AddReference(udCancelToken *pToken)
+{
+  if (pToken)
+    udInterlockedPreIncrement(&pToken->references);
+  return pToken;
+}
+
+// ----------------------------------------------------------------------------
+void udCancelToken_Cancel(udCancelToken *pToken)
+{
+  if (pToken)
+    udInterlockedExchange(&pToken->cancelled, 1);
+}
+
+// ----------------------------------------------------------------------------
+void udCancelToken_Reset(udCancelToken *pToken)
+{
+  if (pToken)
+    udInterlockedExchange(&pToken->cancelled, 0);
+}
+
+// ----------------------------------------------------------------------------
+bool udCancelToken_IsCancelled(const udCancelToken *pToken)
+{
+  return pToken && pToken->cancelled != 0;
+}
+
+// ----------------------------------------------------------------------------
+udCancelToken *udCancelToken_SetCurrent(udCancelToken *pToken)
+{
+  udCancelToken *pPrevious = t_pCurrentToken;
+  t_pCurrentToken = pToken;
+  return pPrevious;
+}
+
+// ----------------------------------------------------------------------------
+udCancelToken *udCancelToken_GetCurrent()
+{
+  return t_pCurrentToken;
+}
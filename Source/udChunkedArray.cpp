@@ -0,0 +1,84 @@
+#include "udChunkedArray.h"
+
+#define UDCHUNKEDARRAY_HASH_MIN_SLOTS 16
+
+// ----------------------------------------------------------------------------
+udResult udChunkedArrayHashIndex_Reserve(udChunkedArrayHashIndex *pIndex, size_t count)
+{
+  udResult result;
+  udChunkedArrayHashSlot *pOldSlots = pIndex->pSlots;
+  size_t oldSlotCount = pOldSlots ? pIndex->slotMask + 1 : 0;
+  size_t slotCount = udMax(oldSlotCount, (size_t)UDCHUNKEDARRAY_HASH_MIN_SLOTS);
+
+  // Kept at most half full, so probe sequences stay short
+  while (slotCount < count * 2)
+    slotCount *= 2;
+  UD_ERROR_IF(slotCount == oldSlotCount, udR_Success);
+
+  pIndex->pSlots = udAllocType(udChunkedArrayHashSlot, slotCount, udAF_Zero);
+  if (!pIndex->pSlots)
+  {
+    pIndex->pSlots = pOldSlots;
+    UD_ERROR_SET(udR_MemoryAllocationFailure);
+  }
+  pIndex->slotMask = slotCount - 1;
+
+  for (size_t slot = 0; slot < oldSlotCount; ++slot)
+  {
+    if (pOldSlots[slot].entry)
+      udChunkedArrayHashIndex_Insert(pIndex, pOldSlots[slot].entry - 1, pOldSlots[slot].hash);
+  }
+  udFree(pOldSlots);
+  result = udR_Success;
+
+epilogue:
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+void udChunkedArrayHashIndex_Reset(udChunkedArrayHashIndex *pIndex)
+{
+  if (pIndex->pSlots)
+    memset(pIndex->pSlots, 0, (pIndex->slotMask + 1) * sizeof(udChunkedArrayHashSlot));
+  pIndex->indexedCount = 0;
+  pIndex->valid = true;
+}
+
+// ----------------------------------------------------------------------------
+void udChunkedArrayHashIndex_Insert(udChunkedArrayHashIndex *pIndex, size_t index, uint32_t hash)
+{
+  size_t slot = hash & pIndex->slotMask;
+  while (pIndex->pSlots[slot].entry)
+    slot = (slot + 1) & pIndex->slotMask;
+  pIndex->pSlots[slot].entry = index + 1;
+  pIndex->pSlots[slot].hash = hash;
+}
+
+// ----------------------------------------------------------------------------
+size_t udChunkedArrayHashIndex_FindSlot(const udChunkedArrayHashIndex *pIndex, size_t index, uint32_t hash)
+{
+  for (size_t slot = hash & pIndex->slotMask; pIndex->pSlots[slot].entry; slot = (slot + 1) & pIndex->slotMask)
+  {
+    if (pIndex->pSlots[slot].entry == index + 1)
+      return slot;
+  }
+  return SIZE_MAX;
+}
+
+// ----------------------------------------------------------------------------
+// Backward shift deletion, moving each following entry of the probe sequence into the gap unless its home slot lies between
+// the gap and itself, so no tombstones are needed
+void udChunkedArrayHashIndex_RemoveSlot(udChunkedArrayHashIndex *pIndex, size_t slot)
+{
+  size_t gap = slot;
+  for (size_t next = (gap + 1) & pIndex->slotMask; pIndex->pSlots[next].entry; next = (next + 1) & pIndex->slotMask)
+  {
+    size_t home = pIndex->pSlots[next].hash & pIndex->slotMask;
+    if (((next - home) & pIndex->slotMask) >= ((next - gap) & pIndex->slotMask))
+    {
+      pIndex->pSlots[gap] = pIndex->pSlots[next];
+      gap = next;
+    }
+  }
+  pIndex->pSlots[gap].entry = 0;
+}
@@ -145,7 +145,7 @@ udResult udCompression_Inflate(void *pDest, size_t destSize, const void *pSource
     ldComp = libdeflate_alloc_decompressor();
     UD_ERROR_NULL(ldComp, udR_MemoryAllocationFailure);
 
-    pTemp = (pDest == pSource) ? udAlloc(destSize) : pDest;
+    pTemp = (pDest == pSource) ? udAllocFlags(destSize, udAF_HugePages) : pDest;
     UD_ERROR_NULL(pTemp, udR_MemoryAllocationFailure);
 
     lresult = libdeflate_deflate_decompress(ldComp, pSource, sourceSize, pTemp, destSize, &inflatedSize);
@@ -163,7 +163,7 @@ udResult udCompression_Inflate(void *pDest, size_t destSize, const void *pSource
     ldComp = libdeflate_alloc_decompressor();
     UD_ERROR_NULL(ldComp, udR_MemoryAllocationFailure);
 
-    pTemp = (pDest == pSource) ? udAlloc(destSize) : pDest;
+    pTemp = (pDest == pSource) ? udAllocFlags(destSize, udAF_HugePages) : pDest;
     UD_ERROR_NULL(pTemp, udR_MemoryAllocationFailure);
 
     lresult = libdeflate_zlib_decompress(ldComp, pSource, sourceSize, pTemp, destSize, &inflatedSize);
@@ -181,7 +181,7 @@ udResult udCompression_Inflate(void *pDest, size_t destSize, const void *pSource
     ldComp = libdeflate_alloc_decompressor();
     UD_ERROR_NULL(ldComp, udR_MemoryAllocationFailure);
 
-    pTemp = (pDest == pSource) ? udAlloc(destSize) : pDest;
+    pTemp = (pDest == pSource) ? udAllocFlags(destSize, udAF_HugePages) : pDest;
     UD_ERROR_NULL(pTemp, udR_MemoryAllocationFailure);
 
     lresult = libdeflate_gzip_decompress(ldComp, pSource, sourceSize, pTemp, destSize, &inflatedSize);
@@ -50,7 +50,7 @@ udResult udFile_GenericLoad(udFile *pFile, void **ppMemory, int64_t *pFileLength
 
   if (length)
   {
-    pMemory = (char*)udAlloc((size_t)length + 1); // Note always allocating 1 extra byte
+    pMemory = (char*)udAllocFlags((size_t)length + 1, udAF_HugePages); // Note always allocating 1 extra byte
     UD_ERROR_CHECK(udFile_Read(pFile, pMemory, (size_t)length, 0, udFSW_SeekCur, &actualRead));
     UD_ERROR_IF(actualRead != (size_t)length, udR_ReadFailure);
   }
@@ -260,7 +260,7 @@ udResult udImageStreaming_Save(const udImage *pImage, udImageStreamingOnDisk **p
 
   if (ppOnDisk)
   {
-    pOnDisk = (udImageStreamingOnDisk *)udAlloc(saveSize);
+    pOnDisk = (udImageStreamingOnDisk *)udAllocFlags(saveSize, udAF_HugePages);
     UD_ERROR_NULL(pOnDisk, udR_MemoryAllocationFailure);
     memset(pOnDisk, 0, sizeof(udImageStreamingOnDisk));
     pOnDisk->fourcc = udImageStreaming::Fourcc;
@@ -271,7 +271,7 @@ udResult udImageStreaming_Save(const udImage *pImage, udImageStreamingOnDisk **p
     pOnDisk->offsetToMip0 = (uint16_t)sizeof(udImageStreamingOnDisk);
 
     // Make a 24-bit copy of the source image
-    p24BitData = udAllocType(uint8_t, pImage->width * pImage->height * 3, udAF_None);
+    p24BitData = udAllocType(uint8_t, pImage->width * pImage->height * 3, udAF_HugePages);
     UD_ERROR_NULL(p24BitData, udR_MemoryAllocationFailure);
     pOut = p24BitData;
     pIn = (uint8_t*)(pImage->pImageData);
@@ -77,27 +77,49 @@ public:
 };
 
 
+// ****************************************************************************
+// Keys are allocated from the object's arena when it has one, so they're released with it rather than freed
+static const char *udJSON_DupKey(udJSONObject *pObject, const char *pKey, size_t charCount = 0)
+{
+  if (pObject->pArena)
+    return udArena_Strdup(pObject->pArena, pKey, charCount);
+  return (charCount) ? udStrndup(pKey, charCount) : udStrdup(pKey);
+}
+
+// ****************************************************************************
+static void udJSON_FreeKey(udJSONObject *pObject, udJSONKVPair *pItem)
+{
+  if (pObject->pArena)
+    pItem->pKey = nullptr;
+  else
+    udFree(pItem->pKey);
+}
+
 // ****************************************************************************
 // Author: Dave Pevreal, April 2017
 void udJSON::Destroy()
 {
   if (type == T_String)
   {
-    udFree(u.pStr);
+    if (!arenaString)
+      udFree(u.pStr);
   }
   else if (type == T_Object)
   {
+    udArena *pArena = u.pObject->pArena;
     for (size_t i = 0; i < u.pObject->length; ++i)
     {
       udJSONKVPair *pItem = u.pObject->GetElement(i);
-      udFree(pItem->pKey);
+      udJSON_FreeKey(u.pObject, pItem);
       pItem->value.Destroy();
     }
     u.pObject->Deinit();
-    udFree(u.pObject);
+    if (!pArena)
+      udFree(u.pObject);
   }
   else if (type == T_Array)
   {
+    udArena *pArena = u.pArray->pArena;
     for (size_t i = 0; i < u.pArray->length; ++i)
     {
       udJSON *pChild = u.pArray->GetElement(i);
@@ -105,23 +127,29 @@ void udJSON::Destroy()
         pChild->Destroy();
     }
     u.pArray->Deinit();
-    udFree(u.pArray);
+    if (!pArena)
+      udFree(u.pArray);
   }
 
   type = T_Void;
   u.i64Val = 0;
   dPrec = 0;
+  arenaString = 0;
 }
 
 // ****************************************************************************
 // Author: Dave Pevreal, April 2017
-udResult udJSON::SetString(const char *pStr, size_t charCount)
+udResult udJSON::SetString(const char *pStr, size_t charCount, udArena *pArena)
 {
   Destroy();
-  u.pStr = (charCount) ? udStrndup(pStr, charCount) : udStrdup(pStr);
+  if (pArena)
+    u.pStr = udArena_Strdup(pArena, pStr, charCount);
+  else
+    u.pStr = (charCount) ? udStrndup(pStr, charCount) : udStrdup(pStr);
   if (u.pStr)
   {
     type = T_String;
+    arenaString = (pArena != nullptr);
     return udR_Success;
   }
   return udR_MemoryAllocationFailure;
@@ -129,15 +157,15 @@ udResult udJSON::SetString(const char *pStr, size_t charCount)
 
 // ****************************************************************************
 // Author: Dave Pevreal, April 2017
-udResult udJSON::SetArray()
+udResult udJSON::SetArray(udArena *pArena)
 {
   udResult result;
   udJSONArray *pTempArray = nullptr;
   Destroy();
 
-  pTempArray = udAllocType(udJSONArray, 1, udAF_Zero);
+  pTempArray = pArena ? udArenaAllocType(pArena, udJSONArray, 1, udAF_Zero) : udAllocType(udJSONArray, 1, udAF_Zero);
   UD_ERROR_NULL(pTempArray, udR_MemoryAllocationFailure);
-  result = pTempArray->Init(32);
+  result = pTempArray->Init(32, pArena);
   UD_ERROR_HANDLE();
 
   type = T_Array;
@@ -146,21 +174,22 @@ udResult udJSON::SetArray()
   result = udR_Success;
 
 epilogue:
-  udFree(pTempArray);
+  if (!pArena)
+    udFree(pTempArray);
   return result;
 }
 
 // ****************************************************************************
 // Author: Dave Pevreal, April 2017
-udResult udJSON::SetObject()
+udResult udJSON::SetObject(udArena *pArena)
 {
   udResult result;
   udJSONObject *pTempObject = nullptr;
   Destroy();
 
-  pTempObject = udAllocType(udJSONObject, 1, udAF_Zero);
+  pTempObject = pArena ? udArenaAllocType(pArena, udJSONObject, 1, udAF_Zero) : udAllocType(udJSONObject, 1, udAF_Zero);
   UD_ERROR_NULL(pTempObject, udR_MemoryAllocationFailure);
-  result = pTempObject->Init(32);
+  result = pTempObject->Init(32, pArena);
   UD_ERROR_HANDLE();
 
   type = T_Object;
@@ -169,7 +198,8 @@ udResult udJSON::SetObject()
   result = udR_Success;
 
 epilogue:
-  udFree(pTempObject);
+  if (!pArena)
+    udFree(pTempObject);
   return result;
 }
 
@@ -588,9 +618,17 @@ static udResult udJSON_ProcessArrayOperator(const udJSON *pRoot, const udJSON **
       {
         udJSONKVPair *pKVP = pRoot->AsObject()->PushBack();
         UD_ERROR_NULL(pKVP, udR_MemoryAllocationFailure);
-        pKVP->pKey = searchExp.AsString();
-        searchExp.Clear(); // We're taking the string memory
         pKVP->value.Clear();
+        if (pRoot->AsObject()->pArena)
+        {
+          pKVP->pKey = udJSON_DupKey(pRoot->AsObject(), searchExp.AsString());
+          UD_ERROR_NULL(pKVP->pKey, udR_MemoryAllocationFailure);
+        }
+        else
+        {
+          pKVP->pKey = searchExp.AsString();
+          searchExp.Clear(); // We're taking the string memory
+        }
         pV = &pKVP->value;
       }
       if (ppValue)
@@ -829,7 +867,7 @@ static udResult udJSON_SetVA(udJSON *pRoot, udJSON *pSetToValue, const char *pKe
             if (pRoot->IsObject())
             {
               udJSONKVPair *pItem = pRoot->AsObject()->GetElement(index);
-              udFree(pItem->pKey);
+              udJSON_FreeKey(pRoot->AsObject(), pItem);
               pItem->value.Destroy();
               pRoot->AsObject()->RemoveAt(index);
             }
@@ -868,7 +906,7 @@ static udResult udJSON_SetVA(udJSON *pRoot, udJSON *pSetToValue, const char *pKe
           udJSONKVPair *pKVP = pObject->PushBack();
           UD_ERROR_NULL(pKVP, udR_MemoryAllocationFailure);
           pKVP->value.Clear();
-          pKVP->pKey = udStrdup(exp.pKey);
+          pKVP->pKey = udJSON_DupKey(pObject, exp.pKey);
           UD_ERROR_NULL(pKVP->pKey, udR_MemoryAllocationFailure);
           pV = &pKVP->value;
         }
@@ -877,7 +915,7 @@ static udResult udJSON_SetVA(udJSON *pRoot, udJSON *pSetToValue, const char *pKe
           UD_ERROR_NULL(pV, udR_ObjectNotFound);
           // Found the member, and it needs to be removed
           udJSONKVPair *pKVP = pObject->GetElement(index);
-          udFree(pKVP->pKey);
+          udJSON_FreeKey(pObject, pKVP);
           pKVP->value.Destroy();
           pObject->RemoveAt(index);
           pV = nullptr;
@@ -926,7 +964,7 @@ udResult udJSON::Set(udJSON *pValue, const char *pKeyExpression, ...)
 
 // ****************************************************************************
 // Author: Dave Pevreal, April 2017
-udResult udJSON::Parse(const char *pString, int *pCharCount, int *pLineNumber)
+udResult udJSON::Parse(const char *pString, int *pCharCount, int *pLineNumber, udArena *pArena)
 {
   udResult result;
   int tempLineNumber;
@@ -942,14 +980,14 @@ udResult udJSON::Parse(const char *pString, int *pCharCount, int *pLineNumber)
   if (*pString == '{' || *pString == '[')
   {
     int charCount;
-    result = ParseJSON(pString, &charCount, pLineNumber);
+    result = ParseJSON(pString, &charCount, pLineNumber, pArena);
     UD_ERROR_HANDLE();
     totalCharCount += charCount;
   }
   else if (*pString == '<')
   {
     int charCount;
-    result = ParseXML(pString, &charCount, pLineNumber);
+    result = ParseXML(pString, &charCount, pLineNumber, pArena);
     UD_ERROR_HANDLE();
     totalCharCount += charCount;
   }
@@ -958,7 +996,7 @@ udResult udJSON::Parse(const char *pString, int *pCharCount, int *pLineNumber)
     size_t endPos = udStrMatchBrace(pString, '\\');
     // Force a parse error if the string isn't quoted properly
     UD_ERROR_IF(pString[endPos - 1] != pString[0], udR_ParseError);
-    char *pStr = udAllocType(char, endPos, udAF_None);
+    char *pStr = pArena ? udArenaAllocType(pArena, char, endPos, udAF_None) : udAllocType(char, endPos, udAF_None);
     UD_ERROR_NULL(pStr, udR_MemoryAllocationFailure);
     size_t di = 0;
     for (size_t si = 1; si < (endPos - 1); ++si)
@@ -993,6 +1031,7 @@ udResult udJSON::Parse(const char *pString, int *pCharCount, int *pLineNumber)
     pStr[di] = 0;
     type = T_String;
     u.pStr = pStr;
+    arenaString = (pArena != nullptr);
     totalCharCount += (int)endPos;
   }
   else
@@ -1478,7 +1517,7 @@ epilogue:
 
 // ----------------------------------------------------------------------------
 // Author: Dave Pevreal, April 2017
-udResult udJSON::ParseJSON(const char *pJSON, int *pCharCount, int *pLineNumber)
+udResult udJSON::ParseJSON(const char *pJSON, int *pCharCount, int *pLineNumber, udArena *pArena)
 {
   udResult result = udR_Success;
   const char *pStartPointer = pJSON; // Just used to calculate and assign pCharCount
@@ -1491,7 +1530,7 @@ udResult udJSON::ParseJSON(const char *pJSON, int *pCharCount, int *pLineNumber)
   if (*pJSON == '{')
   {
     // Handle an embedded JSON object
-    result = SetObject();
+    result = SetObject(pArena);
     UD_ERROR_HANDLE();
     pJSON = udStrSkipWhiteSpace(pJSON + 1, nullptr, pLineNumber);
     while (*pJSON != '}')
@@ -1504,7 +1543,7 @@ udResult udJSON::ParseJSON(const char *pJSON, int *pCharCount, int *pLineNumber)
 
       udJSON k; // Temporaries
       UD_ERROR_IF(*pJSON != '"' && *pJSON != '\'', udR_ParseError);
-      result = k.Parse(pJSON, &charCount); // Use parser to get the key string for convenience
+      result = k.Parse(pJSON, &charCount, nullptr, pArena); // Use parser to get the key string for convenience, allocated as the object's keys are
       UD_ERROR_HANDLE();
       UD_ERROR_IF(!k.IsString(), udR_ParseError);
       pJSON = udStrSkipWhiteSpace(pJSON + charCount, nullptr, pLineNumber);
@@ -1517,7 +1556,7 @@ udResult udJSON::ParseJSON(const char *pJSON, int *pCharCount, int *pLineNumber)
       pJSON = udStrSkipWhiteSpace(pJSON + 1, nullptr, pLineNumber);
 
       // Parse the type, it could be an object, array, or simple type
-      result = pItem->value.ParseJSON(pJSON, &charCount, pLineNumber);
+      result = pItem->value.ParseJSON(pJSON, &charCount, pLineNumber, pArena);
       UD_ERROR_HANDLE();
       pJSON = udStrSkipWhiteSpace(pJSON + charCount, nullptr, pLineNumber);
 
@@ -1532,7 +1571,7 @@ udResult udJSON::ParseJSON(const char *pJSON, int *pCharCount, int *pLineNumber)
   else if (*pJSON == '[')
   {
     // Handle an array of values
-    result = SetArray();
+    result = SetArray(pArena);
     UD_ERROR_HANDLE();
     pJSON = udStrSkipWhiteSpace(pJSON + 1, nullptr, pLineNumber);
     while (*pJSON != ']')
@@ -1541,7 +1580,7 @@ udResult udJSON::ParseJSON(const char *pJSON, int *pCharCount, int *pLineNumber)
       result = AsArray()->PushBack(&pNextItem);
       UD_ERROR_HANDLE();
       pNextItem->Clear();
-      result = pNextItem->ParseJSON(pJSON, &charCount, pLineNumber);
+      result = pNextItem->ParseJSON(pJSON, &charCount, pLineNumber, pArena);
       UD_ERROR_HANDLE();
       pJSON = udStrSkipWhiteSpace(pJSON + charCount, nullptr, pLineNumber);
       if (*pJSON != ']' && *pJSON != ',')
@@ -1554,7 +1593,7 @@ udResult udJSON::ParseJSON(const char *pJSON, int *pCharCount, int *pLineNumber)
   else
   {
     // Case where the JSON is actually just a value
-    result = Parse(pJSON, &charCount);
+    result = Parse(pJSON, &charCount, nullptr, pArena);
     if (result == udR_ParseError)
       udDebugPrintf("Error parsing JSON text, line %d: ...%.30s...\n", *pLineNumber, pJSON);
     UD_ERROR_HANDLE();
@@ -1570,7 +1609,7 @@ epilogue:
 
 // ----------------------------------------------------------------------------
 // Author: Dave Pevreal, June 2017
-static udResult ParseXMLString(const char **ppStr, const char *pXML, int *pCharCount)
+static udResult ParseXMLString(const char **ppStr, const char *pXML, int *pCharCount, udArena *pArena)
 {
   udResult result;
   int charCount = 0;
@@ -1592,7 +1631,7 @@ static udResult ParseXMLString(const char **ppStr, const char *pXML, int *pCharC
     charCount = (int)(pTerm - pXML);
   }
 
-  pStr = udAllocType(char, charCount + 1, udAF_None);
+  pStr = pArena ? udArenaAllocType(pArena, char, charCount + 1, udAF_None) : udAllocType(char, charCount + 1, udAF_None);
   UD_ERROR_NULL(pStr, udR_MemoryAllocationFailure);
   for (int si = 0; si < charCount;)
   {
@@ -1628,13 +1667,14 @@ static udResult ParseXMLString(const char **ppStr, const char *pXML, int *pCharC
 epilogue:
   if (pCharCount)
     *pCharCount = charCount + extraChars;
-  udFree(pStr);
+  if (!pArena)
+    udFree(pStr);
   return result;
 }
 
 // ----------------------------------------------------------------------------
 // Author: Dave Pevreal, May 2017
-udResult udJSON::ParseXML(const char *pXML, int *pCharCount, int *pLineNumber)
+udResult udJSON::ParseXML(const char *pXML, int *pCharCount, int *pLineNumber, udArena *pArena)
 {
   udResult result = udR_Success;
   const char *pStartPointer = pXML; // Just used to calculate and assign pCharCount
@@ -1663,7 +1703,7 @@ udResult udJSON::ParseXML(const char *pXML, int *pCharCount, int *pLineNumber)
   UD_ERROR_IF(*pXML != '<', udR_ParseError);
   if (!IsObject())
   {
-    result = SetObject();
+    result = SetObject(pArena);
     UD_ERROR_HANDLE();
   }
   pXML = udStrSkipWhiteSpace(pXML + 1, nullptr, pLineNumber);
@@ -1680,9 +1720,9 @@ udResult udJSON::ParseXML(const char *pXML, int *pCharCount, int *pLineNumber)
     // Case where the tag hasn't been encountered before, so create an object for it
     udJSONKVPair *pKVP = AsObject()->PushBack();
     UD_ERROR_NULL(pKVP, udR_MemoryAllocationFailure);
-    pKVP->pKey = udStrdup(pElementName);
+    pKVP->pKey = udJSON_DupKey(AsObject(), pElementName);
     pKVP->value.Clear();  // Initialise without prior destruction
-    pKVP->value.SetObject();
+    pKVP->value.SetObject(pArena);
     pElement = &pKVP->value;
   }
   else
@@ -1692,7 +1732,7 @@ udResult udJSON::ParseXML(const char *pXML, int *pCharCount, int *pLineNumber)
       // Exactly one of the element has been encountered already, so we must convert it to an array
       tempValue = *pElement;
       pElement->Clear(); // Clear rather than destroy because tempValue is now owning the memory
-      result = pElement->SetArray();
+      result = pElement->SetArray(pArena);
       UD_ERROR_HANDLE();
       result = pElement->AsArray()->PushBack(tempValue);
       UD_ERROR_HANDLE();
@@ -1702,7 +1742,7 @@ udResult udJSON::ParseXML(const char *pXML, int *pCharCount, int *pLineNumber)
     pElement = pElement->AsArray()->PushBack();
     UD_ERROR_NULL(pElement, udR_MemoryAllocationFailure);
     pElement->Clear();
-    pElement->SetObject();
+    pElement->SetObject(pArena);
     UD_ERROR_HANDLE();
   }
   UD_ERROR_IF(!pElement->IsObject(), udR_InternalError); // Just to be sure
@@ -1717,12 +1757,13 @@ udResult udJSON::ParseXML(const char *pXML, int *pCharCount, int *pLineNumber)
       // Found an attribute
       udJSONKVPair *pAttr = pElement->AsObject()->PushBack();
       UD_ERROR_NULL(pAttr, udR_MemoryAllocationFailure);
-      pAttr->pKey = udStrndup(pXML, len);
+      pAttr->pKey = udJSON_DupKey(pElement->AsObject(), pXML, len);
       pXML = udStrSkipWhiteSpace(pXML + len + 1, nullptr, pLineNumber);
       pAttr->value.Clear();
-      result = ParseXMLString(&pAttr->value.u.pStr, pXML, &charCount);
+      result = ParseXMLString(&pAttr->value.u.pStr, pXML, &charCount, pArena);
       UD_ERROR_HANDLE();
       pAttr->value.type = T_String;
+      pAttr->value.arenaString = (pArena != nullptr);
       pXML = udStrSkipWhiteSpace(pXML + charCount, nullptr, pLineNumber);
     }
     else if (*pXML == '/')
@@ -1746,7 +1787,7 @@ udResult udJSON::ParseXML(const char *pXML, int *pCharCount, int *pLineNumber)
         // An embedded tag (a subobject)
         int lineCount = 0;
         // Call parseXML directly because Parse would destroy the element first
-        result = pElement->ParseXML(pXML, &charCount, &lineCount);
+        result = pElement->ParseXML(pXML, &charCount, &lineCount, pArena);
         UD_ERROR_HANDLE();
         if (pLineNumber)
           *pLineNumber += lineCount - 1;
@@ -1768,12 +1809,13 @@ udResult udJSON::ParseXML(const char *pXML, int *pCharCount, int *pLineNumber)
         }
         udJSONKVPair *pAttr = pElement->AsObject()->PushBack();
         UD_ERROR_NULL(pAttr, udR_MemoryAllocationFailure);
-        pAttr->pKey = udStrdup(CONTENT_MEMBER);
+        pAttr->pKey = udJSON_DupKey(pElement->AsObject(), CONTENT_MEMBER);
         UD_ERROR_NULL(pAttr->pKey, udR_MemoryAllocationFailure);
         pAttr->value.Clear();
-        ParseXMLString(&pAttr->value.u.pStr, pXML, nullptr);
+        ParseXMLString(&pAttr->value.u.pStr, pXML, nullptr, pArena);
         UD_ERROR_NULL(pAttr->value.u.pStr, udR_MemoryAllocationFailure);
         pAttr->value.type = T_String;
+        pAttr->value.arenaString = (pArena != nullptr);
         if (cData)
           len += 3; // Skip the closing ]]>
         pXML = udStrSkipWhiteSpace(pXML + len, nullptr, pLineNumber);
@@ -1799,7 +1841,7 @@ udResult udJSON::ParseXML(const char *pXML, int *pCharCount, int *pLineNumber)
     else if (pElement->MemberCount() == 0)
     {
       // Empty arrays are exported as empty tags, so here we apply the reverse to retain the information
-      pElement->SetArray();
+      pElement->SetArray(pArena);
     }
   }
   else if (pElement->MemberCount() == 0)
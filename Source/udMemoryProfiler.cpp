@@ -0,0 +1,524 @@
+#include "udMemoryProfiler.h"
+#include "udDebug.h"
+#include "udJSON.h"
+#include "udStringUtil.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if UD_MEMORY_PROFILER
+
+// Each thread counts down the bytes it allocates and samples the allocation that takes the count below zero,
+// so the common path is a thread local subtract and compare. Samples are recorded against the call site in a
+// table owned by the thread, and the sampled pointer is remembered so the free can be attributed to the same
+// site. Frees are recorded in the freeing thread's table, so every table only ever has a single writer
+#define UDMP_SITE_COUNT     1024 // Call sites tracked per thread, further sites are grouped as "<other>"
+#define UDMP_SITE_LOAD_MAX  (UDMP_SITE_COUNT * 3 / 4)
+#define UDMP_SAMPLE_SHIFT   14   // Slots for sampled allocations yet to be freed
+#define UDMP_SAMPLE_COUNT   (1 << UDMP_SAMPLE_SHIFT)
+#define UDMP_SAMPLE_PROBES  8    // Slots searched for a pointer, keeps the free path to a single cache line
+
+struct udMemoryProfilerSite
+{
+  const char *pFile; // Null for an unused slot
+  int line;
+  uint64_t allocCount;
+  uint64_t allocBytes;
+  uint64_t freeCount;
+  uint64_t freeBytes;
+};
+
+struct udMemoryProfilerThreadTable
+{
+  udMemoryProfilerThreadTable *pNext;
+  volatile int32_t inUse; // Claimed by a thread, tables are recycled as threads exit
+  int siteCount;
+  udMemoryProfilerSite other;
+  udMemoryProfilerSite sites[UDMP_SITE_COUNT];
+};
+
+struct udMemoryProfilerSample
+{
+  const char *pFile;
+  int line;
+  size_t size;    // Actual size of the allocation
+  uint64_t count; // Estimated allocations this sample represents
+  uint64_t bytes; // Estimated bytes this sample represents
+};
+
+static const char s_udMemoryProfilerUnknownFile[] = "<unknown>";
+static const char s_udMemoryProfilerOtherFile[] = "<other>";
+
+static volatile size_t s_udMemoryProfilerSampleInterval = UDMEMORYPROFILER_DEFAULT_SAMPLE_INTERVAL;
+static udMemoryProfilerThreadTable * volatile s_pUdMemoryProfilerTables;
+static void * volatile s_pUdMemoryProfilerSampled[UDMP_SAMPLE_COUNT];
+static udMemoryProfilerSample s_udMemoryProfilerSamples[UDMP_SAMPLE_COUNT];
+static volatile int32_t s_udMemoryProfilerLiveSamples;
+
+static UDTHREADLOCAL int64_t t_udMemoryProfilerBytesUntilSample;
+static UDTHREADLOCAL size_t t_udMemoryProfilerInterval; // Interval the countdown was started with
+static UDTHREADLOCAL uint32_t t_udMemoryProfilerRandom;
+static UDTHREADLOCAL udMemoryProfilerThreadTable *t_pUdMemoryProfilerTable;
+
+// ----------------------------------------------------------------------------
+static inline size_t udMemoryProfiler_SampleSlot(const void *pMemory)
+{
+  uint64_t hash = (uint64_t)((uintptr_t)pMemory >> 4) * 0x9E3779B97F4A7C15ULL;
+  return (size_t)(hash >> (64 - UDMP_SAMPLE_SHIFT)) & ~(size_t)(UDMP_SAMPLE_PROBES - 1);
+}
+
+// ----------------------------------------------------------------------------
+// Tables are allocated from the C runtime directly, as the profiler is called from within udAlloc
+static udMemoryProfilerThreadTable *udMemoryProfiler_GetThreadTable()
+{
+  if (t_pUdMemoryProfilerTable)
+    return t_pUdMemoryProfilerTable;
+
+  for (udMemoryProfilerThreadTable *pTable = s_pUdMemoryProfilerTables; pTable; pTable = pTable->pNext)
+  {
+    if (udInterlockedCompareExchange(&pTable->inUse, 1, 0) == 0)
+    {
+      t_pUdMemoryProfilerTable = pTable;
+      return pTable;
+    }
+  }
+
+  udMemoryProfilerThreadTable *pTable = (udMemoryProfilerThreadTable*)calloc(1, sizeof(udMemoryProfilerThreadTable));
+  if (!pTable)
+    return nullptr;
+  pTable->inUse = 1;
+  pTable->other.pFile = s_udMemoryProfilerOtherFile;
+
+  udMemoryProfilerThreadTable *pHead;
+  do
+  {
+    pHead = s_pUdMemoryProfilerTables;
+    pTable->pNext = pHead;
+  } while (udInterlockedCompareExchangePointer(&s_pUdMemoryProfilerTables, pTable, pHead) != pHead);
+
+  t_pUdMemoryProfilerTable = pTable;
+  return pTable;
+}
+
+// ----------------------------------------------------------------------------
+// Sites are keyed by the file pointer here to keep recording cheap, the report merges them by file name
+static udMemoryProfilerSite *udMemoryProfiler_GetSite(udMemoryProfilerThreadTable *pTable, const char *pFile, int line)
+{
+  size_t index = (size_t)((((uint64_t)(uintptr_t)pFile) ^ ((uint64_t)line << 32)) * 0x9E3779B97F4A7C15ULL >> 32) & (UDMP_SITE_COUNT - 1);
+  for (;;)
+  {
+    udMemoryProfilerSite *pSite = &pTable->sites[index];
+    if (pSite->pFile == pFile && pSite->line == line)
+      return pSite;
+
+    if (pSite->pFile == nullptr)
+    {
+      if (pTable->siteCount >= UDMP_SITE_LOAD_MAX)
+        return &pTable->other;
+
+      // The file is written last as it marks the slot used for udMemoryProfiler_Report on other threads
+      pSite->line = line;
+      udMemoryBarrier();
+      pSite->pFile = pFile;
+      ++pTable->siteCount;
+      return pSite;
+    }
+
+    index = (index + 1) & (UDMP_SITE_COUNT - 1);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Jitter the distance to the next sample so allocation patterns that repeat can't alias with the interval
+static int64_t udMemoryProfiler_NextSampleDistance(size_t interval)
+{
+  if (!t_udMemoryProfilerRandom)
+    t_udMemoryProfilerRandom = (uint32_t)(uintptr_t)&t_udMemoryProfilerRandom | 1;
+  t_udMemoryProfilerRandom ^= t_udMemoryProfilerRandom << 13;
+  t_udMemoryProfilerRandom ^= t_udMemoryProfilerRandom >> 17;
+  t_udMemoryProfilerRandom ^= t_udMemoryProfilerRandom << 5;
+  return (int64_t)udMax((size_t)1, interval / 2 + t_udMemoryProfilerRandom % interval);
+}
+
+// ----------------------------------------------------------------------------
+static void udMemoryProfiler_Sample(void *pMemory, size_t size, const char *pFile, int line, size_t interval)
+{
+  if (t_udMemoryProfilerInterval != interval)
+  {
+    // The interval has changed since this thread last sampled, so the countdown is restarted at the new interval
+    t_udMemoryProfilerInterval = interval;
+    t_udMemoryProfilerBytesUntilSample = udMemoryProfiler_NextSampleDistance(interval) - (int64_t)size;
+    if (t_udMemoryProfilerBytesUntilSample > 0)
+      return;
+  }
+  t_udMemoryProfilerBytesUntilSample = udMemoryProfiler_NextSampleDistance(interval);
+
+  udMemoryProfilerThreadTable *pTable = udMemoryProfiler_GetThreadTable();
+  if (!pTable)
+    return;
+
+  size_t slot = udMemoryProfiler_SampleSlot(pMemory);
+  size_t i = 0;
+  for (; i < UDMP_SAMPLE_PROBES; ++i)
+  {
+    if (udInterlockedCompareExchangePointer(&s_pUdMemoryProfilerSampled[slot + i], pMemory, nullptr) == nullptr)
+      break;
+  }
+  if (i == UDMP_SAMPLE_PROBES)
+    return; // Nowhere to remember the pointer, skip this sample rather than miscount its free
+
+  if (!pFile)
+    pFile = s_udMemoryProfilerUnknownFile;
+
+  // An allocation of size bytes is sampled with a probability of about size/interval, so it stands in for interval bytes
+  udMemoryProfilerSample *pSample = &s_udMemoryProfilerSamples[slot + i];
+  pSample->pFile = pFile;
+  pSample->line = line;
+  pSample->size = size;
+  pSample->bytes = udMax(size, interval);
+  pSample->count = size ? pSample->bytes / size : 1;
+  udInterlockedPreIncrement(&s_udMemoryProfilerLiveSamples);
+
+  udMemoryProfilerSite *pSite = udMemoryProfiler_GetSite(pTable, pFile, line);
+  pSite->allocCount += pSample->count;
+  pSite->allocBytes += pSample->bytes;
+}
+
+// ----------------------------------------------------------------------------
+void udMemoryProfiler_TrackAlloc(void *pMemory, size_t size, const char *pFile, int line)
+{
+  size_t interval = s_udMemoryProfilerSampleInterval;
+  if (!pMemory || !interval)
+    return;
+
+  t_udMemoryProfilerBytesUntilSample -= (int64_t)size;
+  if (t_udMemoryProfilerBytesUntilSample > 0 && t_udMemoryProfilerInterval == interval)
+    return;
+
+  udMemoryProfiler_Sample(pMemory, size, pFile, line, interval);
+}
+
+// ----------------------------------------------------------------------------
+void udMemoryProfiler_TrackFree(void *pMemory)
+{
+  if (!pMemory || !s_udMemoryProfilerLiveSamples)
+    return;
+
+  size_t slot = udMemoryProfiler_SampleSlot(pMemory);
+  for (size_t i = 0; i < UDMP_SAMPLE_PROBES; ++i)
+  {
+    if (s_pUdMemoryProfilerSampled[slot + i] != pMemory)
+      continue;
+
+    // Copy the sample before releasing the slot, another allocation may claim it immediately
+    udMemoryProfilerSample sample = s_udMemoryProfilerSamples[slot + i];
+    if (udInterlockedCompareExchangePointer(&s_pUdMemoryProfilerSampled[slot + i], nullptr, pMemory) != pMemory)
+      return; // Lost to udMemoryProfiler_Reset
+    udInterlockedPreDecrement(&s_udMemoryProfilerLiveSamples);
+
+    udMemoryProfilerThreadTable *pTable = udMemoryProfiler_GetThreadTable();
+    if (pTable)
+    {
+      udMemoryProfilerSite *pSite = udMemoryProfiler_GetSite(pTable, sample.pFile, sample.line);
+      pSite->freeCount += sample.count;
+      pSite->freeBytes += sample.bytes;
+    }
+    return;
+  }
+}
+
+// ----------------------------------------------------------------------------
+void udMemoryProfiler_ThreadExit()
+{
+  udMemoryProfilerThreadTable *pTable = t_pUdMemoryProfilerTable;
+  if (pTable)
+  {
+    t_pUdMemoryProfilerTable = nullptr;
+    udInterlockedExchange(&pTable->inUse, 0);
+  }
+}
+
+// ----------------------------------------------------------------------------
+void udMemoryProfiler_SetSampleInterval(size_t bytes)
+{
+  s_udMemoryProfilerSampleInterval = bytes;
+}
+
+// ----------------------------------------------------------------------------
+size_t udMemoryProfiler_GetSampleInterval()
+{
+  return s_udMemoryProfilerSampleInterval;
+}
+
+// ----------------------------------------------------------------------------
+void udMemoryProfiler_Reset()
+{
+  for (size_t i = 0; i < UDMP_SAMPLE_COUNT; ++i)
+  {
+    void *pMemory = s_pUdMemoryProfilerSampled[i];
+    if (pMemory && udInterlockedCompareExchangePointer(&s_pUdMemoryProfilerSampled[i], nullptr, pMemory) == pMemory)
+      udInterlockedPreDecrement(&s_udMemoryProfilerLiveSamples);
+  }
+
+  // Counters are cleared in place; the sites stay claimed so threads writing to them concurrently remain safe
+  for (udMemoryProfilerThreadTable *pTable = s_pUdMemoryProfilerTables; pTable; pTable = pTable->pNext)
+  {
+    pTable->other.allocCount = pTable->other.allocBytes = pTable->other.freeCount = pTable->other.freeBytes = 0;
+    for (int i = 0; i < UDMP_SITE_COUNT; ++i)
+    {
+      udMemoryProfilerSite *pSite = &pTable->sites[i];
+      pSite->allocCount = pSite->allocBytes = pSite->freeCount = pSite->freeBytes = 0;
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+static inline uint64_t udMemoryProfiler_LiveCount(const udMemoryProfilerSite *pSite) { return pSite->allocCount > pSite->freeCount ? pSite->allocCount - pSite->freeCount : 0; }
+static inline uint64_t udMemoryProfiler_LiveBytes(const udMemoryProfilerSite *pSite) { return pSite->allocBytes > pSite->freeBytes ? pSite->allocBytes - pSite->freeBytes : 0; }
+
+// ----------------------------------------------------------------------------
+static int udMemoryProfiler_CompareUint64(uint64_t a, uint64_t b) { return (a < b) ? 1 : (a > b) ? -1 : 0; }
+static int udMemoryProfiler_CompareLiveBytes(const void *pA, const void *pB) { return udMemoryProfiler_CompareUint64(udMemoryProfiler_LiveBytes((const udMemoryProfilerSite*)pA), udMemoryProfiler_LiveBytes((const udMemoryProfilerSite*)pB)); }
+static int udMemoryProfiler_CompareAllocBytes(const void *pA, const void *pB) { return udMemoryProfiler_CompareUint64(((const udMemoryProfilerSite*)pA)->allocBytes, ((const udMemoryProfilerSite*)pB)->allocBytes); }
+static int udMemoryProfiler_CompareAllocCount(const void *pA, const void *pB) { return udMemoryProfiler_CompareUint64(((const udMemoryProfilerSite*)pA)->allocCount, ((const udMemoryProfilerSite*)pB)->allocCount); }
+
+// ----------------------------------------------------------------------------
+// The same file can be recorded through different pointers, e.g. a header instantiated in several translation units,
+// so merged sites are hashed and compared by the file name rather than the pointer
+static inline uint64_t udMemoryProfiler_HashSite(const char *pFile, int line)
+{
+  uint64_t hash = 0xCBF29CE484222325ULL; // FNV-1a
+  for (; *pFile; ++pFile)
+    hash = (hash ^ (uint8_t)*pFile) * 0x100000001B3ULL;
+  return (hash ^ (uint64_t)line) * 0x9E3779B97F4A7C15ULL;
+}
+
+// ----------------------------------------------------------------------------
+// Merge the sites of all thread tables, combining sites recorded by more than one thread or through more than one
+// pointer to the same file name
+static udResult udMemoryProfiler_MergeSites(udMemoryProfilerSite **ppSites, size_t *pSiteCount)
+{
+  udResult result;
+  udMemoryProfilerSite *pSites = nullptr;
+  int32_t *pLookup = nullptr;
+  size_t capacity = 1; // The combined "<other>" site
+  size_t lookupMask = 0;
+  size_t siteCount = 0;
+
+  for (udMemoryProfilerThreadTable *pTable = s_pUdMemoryProfilerTables; pTable; pTable = pTable->pNext)
+    capacity += UDMP_SITE_LOAD_MAX;
+
+  pSites = udAllocType(udMemoryProfilerSite, capacity, udAF_Zero);
+  UD_ERROR_NULL(pSites, udR_MemoryAllocationFailure);
+
+  lookupMask = UDALIGN_POWEROF2(capacity * 2, 16) - 1;
+  while (lookupMask & (lookupMask + 1))
+    lookupMask |= lookupMask >> 1;
+  pLookup = udAllocType(int32_t, lookupMask + 1, udAF_None);
+  UD_ERROR_NULL(pLookup, udR_MemoryAllocationFailure);
+  memset(pLookup, 0xFF, sizeof(int32_t) * (lookupMask + 1));
+
+  pSites[siteCount++].pFile = s_udMemoryProfilerOtherFile;
+  for (udMemoryProfilerThreadTable *pTable = s_pUdMemoryProfilerTables; pTable; pTable = pTable->pNext)
+  {
+    pSites[0].allocCount += pTable->other.allocCount;
+    pSites[0].allocBytes += pTable->other.allocBytes;
+    pSites[0].freeCount += pTable->other.freeCount;
+    pSites[0].freeBytes += pTable->other.freeBytes;
+
+    for (int i = 0; i < UDMP_SITE_COUNT; ++i)
+    {
+      const udMemoryProfilerSite *pSite = &pTable->sites[i];
+      const char *pFile = pSite->pFile;
+      if (!pFile || (!pSite->allocCount && !pSite->freeCount))
+        continue;
+      udMemoryBarrier();
+
+      size_t index = (size_t)(udMemoryProfiler_HashSite(pFile, pSite->line) >> 32) & lookupMask;
+      while (pLookup[index] >= 0 && (pSites[pLookup[index]].line != pSite->line || !udStrEqual(pSites[pLookup[index]].pFile, pFile)))
+        index = (index + 1) & lookupMask;
+
+      udMemoryProfilerSite *pMerged;
+      if (pLookup[index] >= 0)
+      {
+        pMerged = &pSites[pLookup[index]];
+      }
+      else
+      {
+        if (siteCount == capacity) // A thread has claimed sites since the capacity was calculated
+          continue;
+        pLookup[index] = (int32_t)siteCount;
+        pMerged = &pSites[siteCount++];
+        pMerged->pFile = pFile;
+        pMerged->line = pSite->line;
+      }
+      pMerged->allocCount += pSite->allocCount;
+      pMerged->allocBytes += pSite->allocBytes;
+      pMerged->freeCount += pSite->freeCount;
+      pMerged->freeBytes += pSite->freeBytes;
+    }
+  }
+
+  if (!pSites[0].allocCount && !pSites[0].freeCount)
+    pSites[0] = pSites[--siteCount];
+
+  *ppSites = pSites;
+  pSites = nullptr;
+  *pSiteCount = siteCount;
+  result = udR_Success;
+
+epilogue:
+  udFree(pLookup);
+  udFree(pSites);
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+udResult udMemoryProfiler_Report(udJSON *pReport, int topN, udMemoryProfilerSort sort)
+{
+  udResult result;
+  udMemoryProfilerSite *pSites = nullptr;
+  size_t siteCount = 0;
+  udJSON site;
+  udJSON file;
+
+  UD_ERROR_NULL(pReport, udR_InvalidParameter_);
+  UD_ERROR_CHECK(udMemoryProfiler_MergeSites(&pSites, &siteCount));
+
+  switch (sort)
+  {
+  case udMPS_LiveBytes: qsort(pSites, siteCount, sizeof(udMemoryProfilerSite), udMemoryProfiler_CompareLiveBytes); break;
+  case udMPS_AllocBytes: qsort(pSites, siteCount, sizeof(udMemoryProfilerSite), udMemoryProfiler_CompareAllocBytes); break;
+  case udMPS_AllocCount: qsort(pSites, siteCount, sizeof(udMemoryProfilerSite), udMemoryProfiler_CompareAllocCount); break;
+  default: UD_ERROR_SET(udR_InvalidParameter_);
+  }
+
+  if (topN > 0 && (size_t)topN < siteCount)
+    siteCount = (size_t)topN;
+
+  pReport->Destroy();
+  UD_ERROR_CHECK(pReport->Set("sampleInterval = %llu", (unsigned long long)s_udMemoryProfilerSampleInterval));
+  UD_ERROR_CHECK(pReport->Set("sites = []"));
+  for (size_t i = 0; i < siteCount; ++i)
+  {
+    const udMemoryProfilerSite *pSite = &pSites[i];
+    // The file is set as a value rather than through the expression so path separators aren't read as escapes
+    UD_ERROR_CHECK(file.SetString(pSite->pFile));
+    UD_ERROR_CHECK(site.Set(&file, "file"));
+    UD_ERROR_CHECK(site.Set("line = %d", pSite->line));
+    UD_ERROR_CHECK(site.Set("allocCount = %llu", (unsigned long long)pSite->allocCount));
+    UD_ERROR_CHECK(site.Set("allocBytes = %llu", (unsigned long long)pSite->allocBytes));
+    UD_ERROR_CHECK(site.Set("freeCount = %llu", (unsigned long long)pSite->freeCount));
+    UD_ERROR_CHECK(site.Set("freeBytes = %llu", (unsigned long long)pSite->freeBytes));
+    UD_ERROR_CHECK(site.Set("liveCount = %llu", (unsigned long long)udMemoryProfiler_LiveCount(pSite)));
+    UD_ERROR_CHECK(site.Set("liveBytes = %llu", (unsigned long long)udMemoryProfiler_LiveBytes(pSite)));
+    UD_ERROR_CHECK(pReport->Set(&site, "sites[]"));
+  }
+  result = udR_Success;
+
+epilogue:
+  site.Destroy();
+  file.Destroy();
+  udFree(pSites);
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+void udMemoryDebugTrackingInit()
+{
+  udMemoryProfiler_Reset();
+  if (!s_udMemoryProfilerSampleInterval)
+    s_udMemoryProfilerSampleInterval = UDMEMORYPROFILER_DEFAULT_SAMPLE_INTERVAL;
+}
+
+// ----------------------------------------------------------------------------
+void udMemoryDebugTrackingDeinit()
+{
+  s_udMemoryProfilerSampleInterval = 0;
+  udMemoryProfiler_Reset();
+}
+
+// ----------------------------------------------------------------------------
+void udMemoryOutputLeaks()
+{
+  udJSON report;
+  if (udMemoryProfiler_Report(&report, 0, udMPS_LiveBytes) != udR_Success)
+    return;
+
+  const udJSON &sites = report.Get("sites");
+  for (size_t i = 0; i < sites.ArrayLength(); ++i)
+  {
+    const udJSON &site = sites.Get("[%d]", (int)i);
+    if (site.Get("liveBytes").AsInt64() == 0)
+      break;
+    udDebugPrintf("%s(%d): ~%lld bytes in ~%lld allocations not freed\n", site.Get("file").AsString(), site.Get("line").AsInt(), (long long)site.Get("liveBytes").AsInt64(), (long long)site.Get("liveCount").AsInt64());
+  }
+  report.Destroy();
+}
+
+// ----------------------------------------------------------------------------
+void udMemoryOutputAllocInfo(const void *pAlloc)
+{
+  if (pAlloc)
+  {
+    size_t slot = udMemoryProfiler_SampleSlot(pAlloc);
+    for (size_t i = 0; i < UDMP_SAMPLE_PROBES; ++i)
+    {
+      if (s_pUdMemoryProfilerSampled[slot + i] == pAlloc)
+      {
+        const udMemoryProfilerSample &sample = s_udMemoryProfilerSamples[slot + i];
+        udDebugPrintf("%s(%d): %p is a sampled allocation of %llu bytes\n", sample.pFile, sample.line, pAlloc, (unsigned long long)sample.size);
+        return;
+      }
+    }
+  }
+  udDebugPrintf("%p is not a sampled allocation\n", pAlloc);
+}
+
+// ----------------------------------------------------------------------------
+void udMemoryDebugLogMemoryStats()
+{
+  udJSON report;
+  if (udMemoryProfiler_Report(&report, 10, udMPS_LiveBytes) != udR_Success)
+    return;
+
+  const udJSON &sites = report.Get("sites");
+  udDebugPrintf("Allocation sites with the most memory in use (estimated from 1 sample per %lld bytes allocated):\n", (long long)report.Get("sampleInterval").AsInt64());
+  for (size_t i = 0; i < sites.ArrayLength(); ++i)
+  {
+    const udJSON &site = sites.Get("[%d]", (int)i);
+    udDebugPrintf("  %s(%d): ~%lld bytes live in ~%lld allocations, ~%lld allocations totalling ~%lld bytes\n", site.Get("file").AsString(), site.Get("line").AsInt(),
+      (long long)site.Get("liveBytes").AsInt64(), (long long)site.Get("liveCount").AsInt64(), (long long)site.Get("allocCount").AsInt64(), (long long)site.Get("allocBytes").AsInt64());
+  }
+  report.Destroy();
+}
+
+#else
+
+// ----------------------------------------------------------------------------
+void udMemoryProfiler_SetSampleInterval(size_t bytes)
+{
+  udUnused(bytes);
+}
+
+// ----------------------------------------------------------------------------
+size_t udMemoryProfiler_GetSampleInterval()
+{
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+udResult udMemoryProfiler_Report(udJSON *pReport, int topN, udMemoryProfilerSort sort)
+{
+  udUnused(pReport);
+  udUnused(topN);
+  udUnused(sort);
+  return udR_Unsupported;
+}
+
+// ----------------------------------------------------------------------------
+void udMemoryProfiler_Reset()
+{
+}
+
+#endif // UD_MEMORY_PROFILER
@@ -0,0 +1,115 @@
+#include "udParallel.h"
+#include "udNew.h"
+#include "udThread.h"
+
+// Shared by the calling thread and the pool tasks. The last task to finish signals pDone before releasing its reference,
+// so whichever of the caller and that task releases last frees the job
+struct udParallelJob
+{
+  udCallback<void(size_t)> func;
+  udSemaphore *pDone;
+  int32_t blockCount;
+  volatile int32_t nextBlock;
+  volatile int32_t pendingTasks;
+  volatile int32_t refCount;
+};
+
+// ----------------------------------------------------------------------------
+static void udParallel_Work(udParallelJob *pJob)
+{
+  int32_t block;
+  while ((block = udInterlockedPostIncrement(&pJob->nextBlock)) < pJob->blockCount)
+    pJob->func((size_t)block);
+}
+
+// ----------------------------------------------------------------------------
+static void udParallel_Release(udParallelJob *pJob)
+{
+  if (udInterlockedPreDecrement(&pJob->refCount) == 0)
+  {
+    udDestroySemaphore(&pJob->pDone);
+    udDelete(pJob);
+  }
+}
+
+// ----------------------------------------------------------------------------
+static void udParallel_Task(void *pData)
+{
+  udParallelJob *pJob = (udParallelJob*)pData;
+  udParallel_Work(pJob);
+  if (udInterlockedPreDecrement(&pJob->pendingTasks) == 0)
+    udIncrementSemaphore(pJob->pDone);
+  udParallel_Release(pJob);
+}
+
+// ----------------------------------------------------------------------------
+udResult udParallel_RunBlocks(udWorkerPool *pPool, size_t blockCount, udCallback<void(size_t)> func)
+{
+  udResult result;
+  udParallelJob *pJob = nullptr;
+  int taskCount;
+
+  UD_ERROR_IF(blockCount > INT32_MAX, udR_InvalidParameter_);
+
+  // The calling thread takes a share, so one block or no workers needs no tasks
+  taskCount = udMin(udWorkerPool_GetThreadCount(pPool), (int)blockCount - 1);
+  if (taskCount <= 0)
+  {
+    for (size_t block = 0; block < blockCount; ++block)
+      func(block);
+    UD_ERROR_SET(udR_Success);
+  }
+
+  pJob = udNewNoParams(udParallelJob);
+  UD_ERROR_NULL(pJob, udR_MemoryAllocationFailure);
+  pJob->func = func;
+  pJob->pDone = udCreateSemaphore();
+  pJob->blockCount = (int32_t)blockCount;
+  pJob->nextBlock = 0;
+  pJob->pendingTasks = taskCount;
+  pJob->refCount = 1 + taskCount;
+  if (!pJob->pDone)
+  {
+    udDelete(pJob);
+    UD_ERROR_SET(udR_MemoryAllocationFailure);
+  }
+
+  for (int i = 0; i < taskCount; ++i)
+  {
+    if (udWorkerPool_AddTask(pPool, udParallel_Task, pJob, false) != udR_Success)
+    {
+      // The blocks are left to the tasks already queued and the calling thread, so drop those that weren't
+      udInterlockedAdd(&pJob->refCount, i - taskCount);
+      if (udInterlockedAdd(&pJob->pendingTasks, i - taskCount) == 0)
+        udIncrementSemaphore(pJob->pDone);
+      break;
+    }
+  }
+
+  // Once the blocks are all taken, help with the pool's queue until the tasks have finished, as they may be queued
+  // behind other work (or this may be a task of the same pool, whose threads are all waiting in the same way)
+  udParallel_Work(pJob);
+  while (pJob->pendingTasks > 0)
+  {
+    if (udWorkerPool_TryDoWork(pPool) != udR_Success)
+      udWaitSemaphore(pJob->pDone);
+  }
+  udParallel_Release(pJob);
+  result = udR_Success;
+
+epilogue:
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+void udParallel_InitBlocks(udParallelBlocks *pBlocks, udWorkerPool *pPool, size_t inset, size_t length, size_t chunkElementCount)
+{
+  size_t usedChunks = (inset + length + chunkElementCount - 1) / chunkElementCount;
+  size_t targetBlocks = (size_t)(udWorkerPool_GetThreadCount(pPool) + 1) * UDPARALLEL_BLOCKS_PER_THREAD;
+  size_t chunksPerBlock = udMax((usedChunks + targetBlocks - 1) / targetBlocks, (size_t)1);
+
+  pBlocks->count = length ? (usedChunks + chunksPerBlock - 1) / chunksPerBlock : 0;
+  pBlocks->elementsPerBlock = chunksPerBlock * chunkElementCount;
+  pBlocks->inset = inset;
+  pBlocks->length = length;
+}
@@ -1,4 +1,6 @@
 #include "udPlatform.h"
+#include "udAllocator.h"
+#include "udMemoryProfiler.h"
 #include "udThread.h"
 #include <stdlib.h>
 #include <string.h>
@@ -9,6 +11,18 @@
 # include <sys/sysctl.h>
 #endif
 
+#if UDPLATFORM_OSX || UDPLATFORM_IOS || UDPLATFORM_IOS_SIMULATOR
+# include <malloc/malloc.h>
+#elif !UDPLATFORM_WINDOWS && !UDPLATFORM_NACL
+# include <malloc.h>
+#endif
+
+#if UDPLATFORM_LINUX
+# include <sys/mman.h>
+# include <sys/syscall.h>
+# include <unistd.h>
+#endif
+
 #if !UDPLATFORM_WINDOWS
 # if defined(__i386__) || defined(__amd64__)
 #   include <cpuid.h>
@@ -16,8 +30,13 @@
 #endif
 
 #define __BREAK_ON_MEMORY_ALLOCATION_FAILURE 0
-#define DebugTrackMemoryAlloc(pMemory, size, pFile, line) udUnused(pMemory); udUnused(size); udUnused(pFile); udUnused(line);
-#define DebugTrackMemoryFree(pMemory, pFile, line) udUnused(pMemory); udUnused(pFile); udUnused(line);
+#if UD_MEMORY_PROFILER
+# define DebugTrackMemoryAlloc(pMemory, size, pFile, line) udMemoryProfiler_TrackAlloc(pMemory, size, pFile, line);
+# define DebugTrackMemoryFree(pMemory, pFile, line) udMemoryProfiler_TrackFree(pMemory); udUnused(pFile); udUnused(line);
+#else
+# define DebugTrackMemoryAlloc(pMemory, size, pFile, line) udUnused(pMemory); udUnused(size); udUnused(pFile); udUnused(line);
+# define DebugTrackMemoryFree(pMemory, pFile, line) udUnused(pMemory); udUnused(pFile); udUnused(line);
+#endif // UD_MEMORY_PROFILER
 
 
 // ----------------------------------------------------------------------------
@@ -34,15 +53,577 @@ void *_udMemDup(const void *pMemory, size_t size, size_t additionalBytes, udAllo
 }
 
 #define UD_DEFAULT_ALIGNMENT (8)
+
+#if UDPLATFORM_LINUX
+// The system backend maps large blocks, and blocks big enough for their page placement flags to apply, directly rather
+// than taking them from the heap, and grows them with mremap so the pages move rather than being copied. A mapped block's user memory
+// starts its mapping, and every mapped block is recorded in a registry keyed by that address, which is how a free
+// or realloc tells mapped blocks from heap blocks
+# define UD_MAPPED_LARGE_SIZE (4 * 1024 * 1024)
+# define UD_MAPPED_NUMA_SIZE (64 * 1024) // Smaller blocks ignore the NUMA flags rather than each taking a mapping and a syscall
+# define UD_MAPPED_PAGE_SIZE 4096
+# define UD_HUGE_PAGE_SIZE (2 * 1024 * 1024)
+# define UD_MPOL_PREFERRED 1
+# define UD_MAPPED_FILTER_SHIFT 10
+
+struct udMappedBlock
+{
+  uint8_t *pMemory; // Start of the mapping, null for an empty registry slot
+  size_t mappedSize;
+  size_t size;
+  udAllocationFlags flags;
+};
+
+static volatile int32_t s_udMappedLock;
+static size_t s_udMappedCount;
+static udMappedBlock *s_pMappedBlocks;   // Open addressed hash table, kept at most half full
+static size_t s_udMappedCapacity;
+static volatile int32_t s_udMappedFilter[1 << UD_MAPPED_FILTER_SHIFT]; // Mapped blocks per address hash, read without the lock
+
+// ----------------------------------------------------------------------------
+static inline void udMapped_Lock()
+{
+  while (udInterlockedCompareExchange(&s_udMappedLock, 1, 0) != 0)
+    udYield();
+}
+
+// ----------------------------------------------------------------------------
+static inline void udMapped_Unlock()
+{
+  udInterlockedExchange(&s_udMappedLock, 0);
+}
+
+// ----------------------------------------------------------------------------
+static inline size_t udMapped_HomeSlot(const void *pMemory)
+{
+  return (size_t)(((uint64_t)((uintptr_t)pMemory / UD_MAPPED_PAGE_SIZE) * 0x9E3779B97F4A7C15ULL) >> 32) & (s_udMappedCapacity - 1);
+}
+
+// ----------------------------------------------------------------------------
+// Counts for the registered blocks whose address hashes to each filter entry, so most heap blocks (including page
+// aligned ones) are known not to be mapped without taking the registry lock
+static inline volatile int32_t *udMapped_FilterEntry(const void *pMemory)
+{
+  return &s_udMappedFilter[((uint64_t)((uintptr_t)pMemory / UD_MAPPED_PAGE_SIZE) * 0x9E3779B97F4A7C15ULL) >> (64 - UD_MAPPED_FILTER_SHIFT)];
+}
+
+// ----------------------------------------------------------------------------
+// False if pMemory is certainly not a mapped block, the registry must be checked otherwise
+static inline bool udMapped_MayBeMapped(const void *pMemory)
+{
+  return pMemory && !((uintptr_t)pMemory & (UD_MAPPED_PAGE_SIZE - 1)) && *udMapped_FilterEntry(pMemory) != 0;
+}
+
+// ----------------------------------------------------------------------------
+// Registry lock must be held, returns SIZE_MAX if pMemory isn't registered
+static size_t udMapped_FindSlot(const void *pMemory)
+{
+  if (!s_udMappedCapacity)
+    return SIZE_MAX;
+
+  for (size_t slot = udMapped_HomeSlot(pMemory); s_pMappedBlocks[slot].pMemory; slot = (slot + 1) & (s_udMappedCapacity - 1))
+  {
+    if (s_pMappedBlocks[slot].pMemory == pMemory)
+      return slot;
+  }
+  return SIZE_MAX;
+}
+
+// ----------------------------------------------------------------------------
+// Registry lock must be held and the table must have room
+static void udMapped_InsertLocked(const udMappedBlock &block)
+{
+  size_t slot = udMapped_HomeSlot(block.pMemory);
+  while (s_pMappedBlocks[slot].pMemory)
+    slot = (slot + 1) & (s_udMappedCapacity - 1);
+  s_pMappedBlocks[slot] = block;
+}
+
+// ----------------------------------------------------------------------------
+// Registry lock must be held. Later blocks in the probe run are shifted back into the hole so lookups never stop early
+static void udMapped_RemoveLocked(size_t hole)
+{
+  size_t mask = s_udMappedCapacity - 1;
+  for (size_t slot = (hole + 1) & mask; s_pMappedBlocks[slot].pMemory; slot = (slot + 1) & mask)
+  {
+    size_t home = udMapped_HomeSlot(s_pMappedBlocks[slot].pMemory);
+    bool homeInRun = (hole < slot) ? (home > hole && home <= slot) : (home > hole || home <= slot);
+    if (!homeInRun)
+    {
+      s_pMappedBlocks[hole] = s_pMappedBlocks[slot];
+      hole = slot;
+    }
+  }
+  s_pMappedBlocks[hole].pMemory = nullptr;
+}
+
+// ----------------------------------------------------------------------------
+static bool udMapped_Register(const udMappedBlock &block)
+{
+  udMapped_Lock();
+  if ((s_udMappedCount + 1) * 2 > s_udMappedCapacity)
+  {
+    size_t oldCapacity = s_udMappedCapacity;
+    udMappedBlock *pOldBlocks = s_pMappedBlocks;
+    size_t capacity = oldCapacity ? oldCapacity * 2 : 64;
+    udMappedBlock *pBlocks = (udMappedBlock*)calloc(capacity, sizeof(udMappedBlock));
+    if (!pBlocks)
+    {
+      udMapped_Unlock();
+      return false;
+    }
+
+    s_pMappedBlocks = pBlocks;
+    s_udMappedCapacity = capacity;
+    for (size_t i = 0; i < oldCapacity; ++i)
+    {
+      if (pOldBlocks[i].pMemory)
+        udMapped_InsertLocked(pOldBlocks[i]);
+    }
+    free(pOldBlocks);
+  }
+  udMapped_InsertLocked(block);
+  udInterlockedPreIncrement(udMapped_FilterEntry(block.pMemory));
+  ++s_udMappedCount;
+  udMapped_Unlock();
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Fills in pBlock if pMemory is a mapped block, only taking the lock when the filter can't rule it out
+static bool udMapped_Find(const void *pMemory, udMappedBlock *pBlock)
+{
+  if (!udMapped_MayBeMapped(pMemory))
+    return false;
+
+  udMapped_Lock();
+  size_t slot = udMapped_FindSlot(pMemory);
+  if (slot != SIZE_MAX)
+    *pBlock = s_pMappedBlocks[slot];
+  udMapped_Unlock();
+  return slot != SIZE_MAX;
+}
+
+// ----------------------------------------------------------------------------
+static void udMapped_BindNode(void *pBase, size_t mappedSize, udAllocationFlags flags)
+{
+  unsigned int node = 0;
+  if (flags & udAF_NUMANodeMask)
+  {
+    node = ((flags & udAF_NUMANodeMask) >> 8) - 1;
+  }
+  else
+  {
+    unsigned int cpu;
+    if (syscall(SYS_getcpu, &cpu, &node, nullptr) != 0)
+      return;
+  }
+
+  // Preferred rather than bound, so the kernel falls back to other nodes when this one is full. Failure (no NUMA
+  // support, or the node doesn't exist) leaves the default first-touch placement
+  unsigned long nodeMask[4] = {};
+  if (node >= sizeof(nodeMask) * 8)
+    return;
+  nodeMask[node / (sizeof(unsigned long) * 8)] = 1UL << (node % (sizeof(unsigned long) * 8));
+  syscall(SYS_mbind, pBase, mappedSize, UD_MPOL_PREFERRED, nodeMask, sizeof(nodeMask) * 8 + 1, 0);
+}
+
+// ----------------------------------------------------------------------------
+static inline bool udMapped_UseHugePages(size_t size, udAllocationFlags flags)
+{
+  return (flags & (udAF_HugePages | udAF_ExplicitHugePages)) && size >= UD_HUGE_PAGE_SIZE / 2;
+}
+
+// ----------------------------------------------------------------------------
+static inline size_t udMapped_MappedSize(size_t size, udAllocationFlags flags)
+{
+  return UDALIGN_POWEROF2(udMax(size, (size_t)1), udMapped_UseHugePages(size, flags) ? UD_HUGE_PAGE_SIZE : UD_MAPPED_PAGE_SIZE);
+}
+
+// ----------------------------------------------------------------------------
+// Returns null if the size and flags don't call for a mapped block, the alignment is beyond the huge page size or the
+// mapping fails, the caller then uses the heap
+static void *udMapped_Alloc(size_t size, size_t alignment, udAllocationFlags flags)
+{
+  bool hugePages = udMapped_UseHugePages(size, flags);
+  bool numa = (flags & (udAF_NUMALocal | udAF_NUMANodeMask)) && size >= UD_MAPPED_NUMA_SIZE;
+  if ((!hugePages && !numa && size < UD_MAPPED_LARGE_SIZE) || alignment > UD_HUGE_PAGE_SIZE || size > SIZE_MAX - UD_HUGE_PAGE_SIZE * 2)
+    return nullptr;
+
+  size_t mappedSize = udMapped_MappedSize(size, flags);
+  size_t mapAlignment = hugePages ? UD_HUGE_PAGE_SIZE : alignment;
+  uint8_t *pBase = (uint8_t*)MAP_FAILED;
+# ifdef MAP_HUGETLB
+  if (hugePages && (flags & udAF_ExplicitHugePages))
+    pBase = (uint8_t*)mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+# endif
+  if (pBase == MAP_FAILED && mapAlignment > UD_MAPPED_PAGE_SIZE)
+  {
+    // Over-map and trim to the alignment; for huge pages this lets every huge page sized extent of the block be a huge page
+    uint8_t *pRaw = (uint8_t*)mmap(nullptr, mappedSize + mapAlignment, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pRaw == MAP_FAILED)
+      return nullptr;
+    pBase = (uint8_t*)UDALIGN_POWEROF2((uintptr_t)pRaw, mapAlignment);
+    if (pBase != pRaw)
+      munmap(pRaw, (size_t)(pBase - pRaw));
+    munmap(pBase + mappedSize, (size_t)(pRaw + mapAlignment - pBase));
+# ifdef MADV_HUGEPAGE
+    if (hugePages)
+      madvise(pBase, mappedSize, MADV_HUGEPAGE);
+# endif
+  }
+  else if (pBase == MAP_FAILED)
+  {
+    pBase = (uint8_t*)mmap(nullptr, mappedSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (pBase == MAP_FAILED)
+      return nullptr;
+  }
+
+  if (numa)
+    udMapped_BindNode(pBase, mappedSize, flags);
+
+  // Fresh mappings are zeroed, so udAF_Zero needs nothing further
+  udMappedBlock block = { pBase, mappedSize, size, flags };
+  if (!udMapped_Register(block))
+  {
+    munmap(pBase, mappedSize);
+    return nullptr;
+  }
+  return pBase;
+}
+
+// ----------------------------------------------------------------------------
+// Returns false if pMemory isn't a mapped block
+static bool udMapped_Free(void *pMemory)
+{
+  if (!udMapped_MayBeMapped(pMemory))
+    return false;
+
+  udMapped_Lock();
+  size_t slot = udMapped_FindSlot(pMemory);
+  udMappedBlock block = {};
+  if (slot != SIZE_MAX)
+  {
+    block = s_pMappedBlocks[slot];
+    udMapped_RemoveLocked(slot);
+    udInterlockedPreDecrement(udMapped_FilterEntry(pMemory));
+    --s_udMappedCount;
+  }
+  udMapped_Unlock();
+
+  // Unmapped only once unregistered, so the address can't be mapped and registered again while still recorded
+  if (slot != SIZE_MAX)
+    munmap(block.pMemory, block.mappedSize);
+  return slot != SIZE_MAX;
+}
+
+// ----------------------------------------------------------------------------
+// Resize a mapped block in place or with mremap, returns null if the block must be copied instead
+static void *udMapped_Resize(const udMappedBlock &block, size_t size, size_t alignment)
+{
+  if (alignment > UD_MAPPED_PAGE_SIZE || size > SIZE_MAX - UD_HUGE_PAGE_SIZE * 2)
+    return nullptr;
+
+  udMappedBlock resized = block;
+  resized.size = size;
+  resized.mappedSize = udMapped_MappedSize(size, block.flags);
+
+  // The lock is held across the remap so the registry entry moves with the mapping, before the old address can be
+  // mapped again by another thread
+  udMapped_Lock();
+  if (resized.mappedSize <= block.mappedSize)
+  {
+    // Shrinking unmaps the tail; this fails for reserved huge pages when not on a huge page boundary, which only
+    // means the pages are kept
+    if (resized.mappedSize == block.mappedSize || munmap(block.pMemory + resized.mappedSize, block.mappedSize - resized.mappedSize) != 0)
+      resized.mappedSize = block.mappedSize;
+  }
+  else
+  {
+    // Growing remaps the pages, the kernel moves the mapping if it can't be extended where it is
+    resized.pMemory = (uint8_t*)mremap(block.pMemory, block.mappedSize, resized.mappedSize, MREMAP_MAYMOVE);
+    if (resized.pMemory == MAP_FAILED)
+    {
+      udMapped_Unlock();
+      return nullptr;
+    }
+  }
+  udMapped_RemoveLocked(udMapped_FindSlot(block.pMemory));
+  udMapped_InsertLocked(resized);
+  if (resized.pMemory != block.pMemory)
+  {
+    udInterlockedPreIncrement(udMapped_FilterEntry(resized.pMemory));
+    udInterlockedPreDecrement(udMapped_FilterEntry(block.pMemory));
+  }
+  udMapped_Unlock();
+
+  if (resized.pMemory != block.pMemory || resized.mappedSize > block.mappedSize)
+  {
+    if (resized.flags & (udAF_NUMALocal | udAF_NUMANodeMask))
+      udMapped_BindNode(resized.pMemory, resized.mappedSize, resized.flags);
+# ifdef MADV_HUGEPAGE
+    if (udMapped_UseHugePages(size, resized.flags))
+      madvise(resized.pMemory, resized.mappedSize, MADV_HUGEPAGE);
+# endif
+  }
+  return resized.pMemory;
+}
+
+static void *udAllocator_SystemAlloc(size_t size, size_t alignment, udAllocationFlags flags, const char *pFile, int line);
+
+// ----------------------------------------------------------------------------
+// Returns false if pMemory is null or a heap block and the result stays on the heap, otherwise *ppResult is the
+// reallocated block. Null and heap blocks reaching UD_MAPPED_LARGE_SIZE are mapped, as udAlloc would, so later
+// growth doesn't copy
+static bool udMapped_Realloc(void *pMemory, size_t size, size_t alignment, void **ppResult)
+{
+  udMappedBlock block;
+  if (!udMapped_Find(pMemory, &block))
+  {
+    if (size < UD_MAPPED_LARGE_SIZE)
+      return false;
+
+    void *pNewMemory = udMapped_Alloc(size, alignment, udAF_None);
+    if (!pNewMemory)
+      return false;
+    if (pMemory)
+    {
+      memcpy(pNewMemory, pMemory, udMin(malloc_usable_size(pMemory), size));
+      free(pMemory);
+    }
+    *ppResult = pNewMemory;
+    return true;
+  }
+
+  if (!size)
+  {
+    udMapped_Free(pMemory);
+    *ppResult = nullptr;
+    return true;
+  }
+
+  *ppResult = udMapped_Resize(block, size, alignment);
+  if (*ppResult)
+    return true;
+
+  // Remapping failed or a larger alignment was requested, fall back to a copy
+  *ppResult = udAllocator_SystemAlloc(size, alignment, (udAllocationFlags)(block.flags & ~udAF_Zero), nullptr, 0);
+  if (*ppResult)
+  {
+    memcpy(*ppResult, pMemory, udMin(block.size, size));
+    udMapped_Free(pMemory);
+  }
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+static bool udMapped_UsableSize(void *pMemory, size_t *pSize)
+{
+  udMappedBlock block;
+  if (!udMapped_Find(pMemory, &block))
+    return false;
+  *pSize = block.mappedSize;
+  return true;
+}
+
+// ----------------------------------------------------------------------------
+// Release the registry once nothing is mapped
+static void udMapped_Deinit()
+{
+  udMapped_Lock();
+  if (!s_udMappedCount)
+  {
+    free(s_pMappedBlocks);
+    s_pMappedBlocks = nullptr;
+    s_udMappedCapacity = 0;
+  }
+  udMapped_Unlock();
+}
+#else
+static inline void *udMapped_Alloc(size_t, size_t, udAllocationFlags) { return nullptr; }
+static inline bool udMapped_Free(void *) { return false; }
+static inline bool udMapped_Realloc(void *, size_t, size_t, void **) { return false; }
+static inline bool udMapped_UsableSize(void *, size_t *) { return false; }
+static inline void udMapped_Deinit() {}
+#endif // UDPLATFORM_LINUX
+
 // ----------------------------------------------------------------------------
 // Author: David Ely
-void *_udAlloc(size_t size, udAllocationFlags flags, const char *pFile, int line)
+static void *udAllocator_SystemAlloc(size_t size, size_t alignment, udAllocationFlags flags, const char *pFile, int line)
 {
 #if defined(_MSC_VER)
-  void *pMemory = (flags & udAF_Zero) ? _aligned_recalloc_dbg(nullptr, size, 1, UD_DEFAULT_ALIGNMENT, pFile, line) : _aligned_malloc_dbg(size, UD_DEFAULT_ALIGNMENT, pFile, line);
-#else
+  void *pMemory = (flags & udAF_Zero) ? _aligned_recalloc_dbg(nullptr, size, 1, alignment, pFile, line) : _aligned_malloc_dbg(size, alignment, pFile, line);
+#elif UDPLATFORM_NACL
+  udUnused(alignment); udUnused(pFile); udUnused(line);
   void *pMemory = (flags & udAF_Zero) ? calloc(size, 1) : malloc(size);
+#elif defined(__GNUC__)
+  udUnused(pFile); udUnused(line);
+  void *pMemory = udMapped_Alloc(size, alignment, flags);
+  if (!pMemory && alignment <= UD_DEFAULT_ALIGNMENT)
+  {
+    pMemory = (flags & udAF_Zero) ? calloc(size, 1) : malloc(size);
+  }
+  else if (!pMemory)
+  {
+    int err = posix_memalign(&pMemory, alignment, size + alignment);
+    if (err != 0)
+      return nullptr;
+
+    if (flags & udAF_Zero)
+      memset(pMemory, 0, size);
+  }
+#else
+# error "Unsupported platform!"
+#endif
+
+  return pMemory;
+}
+
+// ----------------------------------------------------------------------------
+// Author: David Ely
+static void *udAllocator_SystemRealloc(void *pMemory, size_t size, size_t alignment, const char *pFile, int line)
+{
+#if defined(_MSC_VER)
+  pMemory = _aligned_realloc_dbg(pMemory, size, alignment, pFile, line);
+#elif UDPLATFORM_NACL
+  udUnused(alignment); udUnused(pFile); udUnused(line);
+  pMemory = realloc(pMemory, size);
+#elif defined(__GNUC__)
+  void *pMapped;
+  if (udMapped_Realloc(pMemory, size, alignment, &pMapped))
+  {
+    pMemory = pMapped;
+  }
+  else if (alignment <= UD_DEFAULT_ALIGNMENT || !size)
+  {
+    pMemory = realloc(pMemory, size);
+  }
+  else if (!pMemory)
+  {
+    pMemory = udAllocator_SystemAlloc(size, alignment, udAF_None, pFile, line);
+  }
+  else
+  {
+    // There is no aligned realloc, so allocate and copy as much of the old block as fits
+    void *pNewMem = udAllocator_SystemAlloc(size, alignment, udAF_None, pFile, line);
+    if (pNewMem)
+    {
+# if UDPLATFORM_OSX || UDPLATFORM_IOS || UDPLATFORM_IOS_SIMULATOR
+      size_t oldSize = malloc_size(pMemory);
+# else
+      size_t oldSize = malloc_usable_size(pMemory);
+# endif
+      memcpy(pNewMem, pMemory, udMin(oldSize, size));
+      free(pMemory);
+    }
+    pMemory = pNewMem;
+  }
+#else
+# error "Unsupported platform!"
+#endif
+
+  return pMemory;
+}
+
+// ----------------------------------------------------------------------------
+// Author: David Ely
+static void udAllocator_SystemFree(void *pMemory, const char *pFile, int line)
+{
+  udUnused(pFile);
+  udUnused(line);
+#if defined(_MSC_VER)
+  _aligned_free_dbg(pMemory);
+#else
+  if (!udMapped_Free(pMemory))
+    free(pMemory);
 #endif // defined(_MSC_VER)
+}
+
+#if defined(__GNUC__) && !UDPLATFORM_NACL
+// ----------------------------------------------------------------------------
+static size_t udAllocator_SystemUsableSize(void *pMemory)
+{
+  size_t mappedSize;
+  if (udMapped_UsableSize(pMemory, &mappedSize))
+    return mappedSize;
+
+# if UDPLATFORM_OSX || UDPLATFORM_IOS || UDPLATFORM_IOS_SIMULATOR
+  return malloc_size(pMemory);
+# else
+  return malloc_usable_size(pMemory);
+# endif
+}
+#else
+# define udAllocator_SystemUsableSize nullptr
+#endif
+
+// ----------------------------------------------------------------------------
+static void udAllocator_SystemDeinit()
+{
+  udMapped_Deinit();
+}
+
+static const udAllocatorBackend s_udSystemAllocatorBackend = { "System", udAllocator_SystemAlloc, udAllocator_SystemRealloc, udAllocator_SystemFree, nullptr, udAllocator_SystemUsableSize, udAllocator_SystemDeinit };
+static const udAllocatorBackend *s_pAllocatorBackend = &s_udSystemAllocatorBackend;
+static volatile bool s_udAllocatorInUse = false; // Set by the first allocation, after which the backend can't be changed
+
+// ----------------------------------------------------------------------------
+udResult udAllocator_SetBackend(const udAllocatorBackend *pBackend)
+{
+  if (pBackend == nullptr)
+    pBackend = &s_udSystemAllocatorBackend;
+
+  if (pBackend == s_pAllocatorBackend)
+    return udR_Success;
+
+  if (pBackend->pAlloc == nullptr || pBackend->pRealloc == nullptr || pBackend->pFree == nullptr)
+    return udR_InvalidParameter_;
+
+  if (s_udAllocatorInUse)
+    return udR_NotAllowed;
+
+  s_pAllocatorBackend = pBackend;
+  return udR_Success;
+}
+
+// ----------------------------------------------------------------------------
+const udAllocatorBackend *udAllocator_GetBackend()
+{
+  return s_pAllocatorBackend;
+}
+
+// ----------------------------------------------------------------------------
+const udAllocatorBackend *udAllocator_SystemBackend()
+{
+  return &s_udSystemAllocatorBackend;
+}
+
+// ----------------------------------------------------------------------------
+void udAllocator_ThreadExit()
+{
+#if UD_MEMORY_PROFILER
+  udMemoryProfiler_ThreadExit();
+#endif // UD_MEMORY_PROFILER
+  if (s_pAllocatorBackend->pThreadExit)
+    s_pAllocatorBackend->pThreadExit();
+}
+
+// ----------------------------------------------------------------------------
+void udAllocator_Deinit()
+{
+  udAllocator_ThreadExit();
+  if (s_pAllocatorBackend->pDeinit)
+    s_pAllocatorBackend->pDeinit();
+}
+
+// ----------------------------------------------------------------------------
+// Author: David Ely
+void *_udAlloc(size_t size, udAllocationFlags flags, const char *pFile, int line)
+{
+  if (!s_udAllocatorInUse)
+    s_udAllocatorInUse = true;
+
+  void *pMemory = s_pAllocatorBackend->pAlloc(size, UD_DEFAULT_ALIGNMENT, flags, pFile, line);
 
   DebugTrackMemoryAlloc(pMemory, size, pFile, line);
 
@@ -60,8 +641,13 @@ void *_udAlloc(size_t size, udAllocationFlags flags, const char *pFile, int line
 // Author: David Ely
 void *_udAllocAligned(size_t size, size_t alignment, udAllocationFlags flags, const char *pFile, int line)
 {
-#if defined(_MSC_VER)
-  void *pMemory =  (flags & udAF_Zero) ? _aligned_recalloc_dbg(nullptr, size, 1, alignment, pFile, line) : _aligned_malloc_dbg(size, alignment, pFile, line);
+  if (!s_udAllocatorInUse)
+    s_udAllocatorInUse = true;
+
+  if (alignment < sizeof(size_t))
+    alignment = sizeof(size_t);
+
+  void *pMemory = s_pAllocatorBackend->pAlloc(size, alignment, flags, pFile, line);
 
 #if __BREAK_ON_MEMORY_ALLOCATION_FAILURE
   if (!pMemory)
@@ -71,28 +657,6 @@ void *_udAllocAligned(size_t size, size_t alignment, udAllocationFlags flags, co
   }
 #endif // __BREAK_ON_MEMORY_ALLOCATION_FAILURE
 
-#elif UDPLATFORM_NACL
-  void *pMemory =  (flags & udAF_Zero) ? calloc(size, 1) : malloc(size);
-
-#elif defined(__GNUC__)
-  if (alignment < sizeof(size_t))
-  {
-    alignment = sizeof(size_t);
-  }
-  void *pMemory;
-  int err = posix_memalign(&pMemory, alignment, size + alignment);
-  if (err != 0)
-  {
-    return nullptr;
-  }
-
-  if (flags & udAF_Zero)
-  {
-    memset(pMemory, 0, size);
-  }
-#else
-# error "Unsupported platform!"
-#endif
   DebugTrackMemoryAlloc(pMemory, size, pFile, line);
 
   return pMemory;
@@ -102,12 +666,11 @@ void *_udAllocAligned(size_t size, size_t alignment, udAllocationFlags flags, co
 // Author: David Ely
 void *_udRealloc(void *pMemory, size_t size, const char *pFile, int line)
 {
+  if (!s_udAllocatorInUse)
+    s_udAllocatorInUse = true;
+
   DebugTrackMemoryFree(pMemory, pFile, line);
-#if defined(_MSC_VER)
-  pMemory =  _aligned_realloc_dbg(pMemory, size, UD_DEFAULT_ALIGNMENT, pFile, line);
-#else
-  pMemory = realloc(pMemory, size);
-#endif // defined(_MSC_VER)
+  pMemory = s_pAllocatorBackend->pRealloc(pMemory, size, UD_DEFAULT_ALIGNMENT, pFile, line);
 
 #if __BREAK_ON_MEMORY_ALLOCATION_FAILURE
   if (!pMemory)
@@ -126,9 +689,15 @@ void *_udRealloc(void *pMemory, size_t size, const char *pFile, int line)
 // Author: David Ely
 void *_udReallocAligned(void *pMemory, size_t size, size_t alignment, const char *pFile, int line)
 {
+  if (!s_udAllocatorInUse)
+    s_udAllocatorInUse = true;
+
+  if (alignment < sizeof(size_t))
+    alignment = sizeof(size_t);
+
   DebugTrackMemoryFree(pMemory, pFile, line);
-#if defined(_MSC_VER)
-  pMemory = _aligned_realloc_dbg(pMemory, size, alignment, pFile, line);
+  pMemory = s_pAllocatorBackend->pRealloc(pMemory, size, alignment, pFile, line);
+
 #if __BREAK_ON_MEMORY_ALLOCATION_FAILURE
   if (!pMemory)
   {
@@ -136,26 +705,6 @@ void *_udReallocAligned(void *pMemory, size_t size, size_t alignment, const char
     __debugbreak();
   }
 #endif // __BREAK_ON_MEMORY_ALLOCATION_FAILURE
-#elif UDPLATFORM_NACL
-  pMemory = realloc(pMemory, size);
-#elif defined(__GNUC__)
-  if (!pMemory)
-  {
-    pMemory = _udAllocAligned(size, alignment, udAF_None, pFile, line);
-  }
-  else
-  {
-    void *pNewMem = _udAllocAligned(size, alignment, udAF_None, pFile, line);
-
-    size_t *pSize = (size_t*)((uint8_t*)pMemory - sizeof(size_t));
-    memcpy(pNewMem, pMemory, *pSize);
-    _udFree(pMemory, pFile, line);
-
-    return pNewMem;
-  }
-#else
-# error "Unsupported platform!"
-#endif
   DebugTrackMemoryAlloc(pMemory, size, pFile, line);
 
 
@@ -167,11 +716,7 @@ void *_udReallocAligned(void *pMemory, size_t size, size_t alignment, const char
 void _udFreeInternal(void * pMemory, const char *pFile, int line)
 {
   DebugTrackMemoryFree(pMemory, pFile, line);
-#if defined(_MSC_VER)
-  _aligned_free_dbg(pMemory);
-#else
-  free(pMemory);
-#endif // defined(_MSC_VER)
+  s_pAllocatorBackend->pFree(pMemory, pFile, line);
 }
 
 // ----------------------------------------------------------------------------
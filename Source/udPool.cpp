@@ -0,0 +1,341 @@
+#include "udPool.h"
+
+#include <string.h>
+
+#define UDPOOL_MAX_INDEX 0xFFFFFFFEU // Indices are stored +1 in 32 bits so 0 can terminate the list
+
+// A thread's cache of free element indices for one pool
+struct udPoolMagazine
+{
+  udPoolBase *pPool;
+  int32_t generation;
+  uint32_t count;
+  uint32_t indices[UDPOOL_MAGAZINE_SIZE];
+};
+
+static udPoolBase *volatile s_pMagazinePools[UDPOOL_MAX_MAGAZINE_POOLS];
+static volatile int32_t s_poolGeneration;
+static UDTHREADLOCAL udPoolMagazine t_poolMagazines[UDPOOL_MAX_MAGAZINE_POOLS];
+
+// ----------------------------------------------------------------------------
+static inline uint32_t udPool_HighBit(uint32_t value)
+{
+#if defined(_MSC_VER)
+  unsigned long bit;
+  _BitScanReverse(&bit, value);
+  return (uint32_t)bit;
+#else
+  return 31 - (uint32_t)__builtin_clz(value);
+#endif
+}
+
+// ----------------------------------------------------------------------------
+// Slab n holds (1 << (slabShift + n)) elements, so it starts at index ((1 << n) - 1) << slabShift
+static inline uint32_t udPool_SlabFirstIndex(const udPoolBase *pPool, uint32_t slab)
+{
+  return ((1U << slab) - 1) << pPool->slabShift;
+}
+
+// ----------------------------------------------------------------------------
+static inline uint8_t *udPool_Element(const udPoolBase *pPool, uint32_t index)
+{
+  uint32_t slab = udPool_HighBit((index >> pPool->slabShift) + 1);
+  return (uint8_t*)pPool->pSlabs[slab] + (size_t)(index - udPool_SlabFirstIndex(pPool, slab)) * pPool->elementSize;
+}
+
+// ----------------------------------------------------------------------------
+// A free element holds the index + 1 of the next free element in its first 4 bytes
+static inline volatile uint32_t &udPool_Next(const udPoolBase *pPool, uint32_t index)
+{
+  return *(volatile uint32_t*)udPool_Element(pPool, index);
+}
+
+// ----------------------------------------------------------------------------
+static uint32_t udPool_IndexOf(const udPoolBase *pPool, const void *pElement)
+{
+  // The newest slab is the largest so is checked first
+  for (uint32_t slab = pPool->slabCount; slab-- > 0;)
+  {
+    const uint8_t *pSlab = (const uint8_t*)pPool->pSlabs[slab];
+    size_t offset = (size_t)((const uint8_t*)pElement - pSlab);
+    if ((const uint8_t*)pElement >= pSlab && offset < ((size_t)pPool->elementSize << (pPool->slabShift + slab)))
+      return udPool_SlabFirstIndex(pPool, slab) + (uint32_t)(offset / pPool->elementSize);
+  }
+  UDASSERT(false, "Element was not allocated from this pool");
+  return UDPOOL_MAX_INDEX;
+}
+
+// ----------------------------------------------------------------------------
+static inline int64_t udPool_MakeHead(int64_t oldHead, uint32_t link)
+{
+  // Every change bumps the tag in the upper 32 bits, which is what makes the compare-exchange ABA safe
+  return (int64_t)(((((uint64_t)oldHead >> 32) + 1) << 32) | link);
+}
+
+// ----------------------------------------------------------------------------
+// Push the elements firstIndex..lastIndex, already linked together, onto the shared list with a single exchange
+static void udPool_PushLinked(udPoolBase *pPool, uint32_t firstIndex, uint32_t lastIndex)
+{
+  volatile int64_t *pHead = &pPool->head;
+  volatile uint32_t &lastNext = udPool_Next(pPool, lastIndex);
+  for (;;)
+  {
+    int64_t head = *pHead;
+    lastNext = (uint32_t)head;
+    if (udInterlockedCompareExchange64(pHead, udPool_MakeHead(head, firstIndex + 1), head) == head)
+      return;
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Link pIndices[0..count) together and push them
+static void udPool_PushIndices(udPoolBase *pPool, const uint32_t *pIndices, uint32_t count)
+{
+  for (uint32_t i = 0; i + 1 < count; ++i)
+    udPool_Next(pPool, pIndices[i]) = pIndices[i + 1] + 1;
+  udPool_PushLinked(pPool, pIndices[0], pIndices[count - 1]);
+}
+
+// ----------------------------------------------------------------------------
+// Pop up to maxCount elements from the shared list with a single exchange, returns the number popped
+static uint32_t udPool_PopIndices(udPoolBase *pPool, uint32_t *pIndices, uint32_t maxCount)
+{
+  volatile int64_t *pHead = &pPool->head;
+  for (;;)
+  {
+    int64_t head = *pHead;
+    uint32_t link = (uint32_t)head;
+    if (!link)
+      return 0;
+
+    // Another thread may pop and overwrite these elements while they're walked, any links read are then garbage
+    // but the exchange fails because the tag moved on. Garbage links must still be kept inside the slabs
+    uint32_t capacity = udPool_SlabFirstIndex(pPool, *(volatile uint32_t*)&pPool->slabCount);
+    uint32_t count = 0;
+    while (link && count < maxCount && link <= capacity)
+    {
+      pIndices[count++] = link - 1;
+      link = udPool_Next(pPool, link - 1);
+    }
+    if (count == 0)
+      continue;
+
+    if (udInterlockedCompareExchange64(pHead, udPool_MakeHead(head, link), head) == head)
+      return count;
+  }
+}
+
+// ----------------------------------------------------------------------------
+static void udPool_GrowLock(udPoolBase *pPool)
+{
+  while (udInterlockedCompareExchange(&pPool->growLock, 1, 0) != 0)
+    udYield();
+}
+
+// ----------------------------------------------------------------------------
+static void udPool_GrowUnlock(udPoolBase *pPool)
+{
+  udInterlockedExchange(&pPool->growLock, 0);
+}
+
+// ----------------------------------------------------------------------------
+// Allocate the next slab and push all its elements, unless another thread has refilled the list in the meantime
+static udResult udPool_Grow(udPoolBase *pPool, size_t elementSize, size_t elementAlignment)
+{
+  udResult result;
+  uint32_t slab, firstIndex, count;
+  uint8_t *pSlab = nullptr;
+
+  udPool_GrowLock(pPool);
+  UD_ERROR_IF(*(volatile int64_t*)&pPool->head & 0xFFFFFFFF, udR_Success);
+
+  if (pPool->slabCount == 0)
+  {
+    UD_ERROR_IF(elementAlignment == 0 || (elementAlignment & (elementAlignment - 1)), udR_InvalidParameter_);
+    if (pPool->slabShift == 0)
+      pPool->slabShift = udPool_HighBit(UDPOOL_DEFAULT_ELEMENTS_PER_SLAB);
+    pPool->elementSize = (uint32_t)UDALIGN_POWEROF2(udMax(elementSize, sizeof(uint32_t)), elementAlignment);
+
+    if (pPool->useMagazines && pPool->magazineId == 0)
+    {
+      for (int i = 0; i < UDPOOL_MAX_MAGAZINE_POOLS && pPool->magazineId == 0; ++i)
+      {
+        if (udInterlockedCompareExchangePointer(&s_pMagazinePools[i], pPool, nullptr) == nullptr)
+        {
+          pPool->generation = udInterlockedPreIncrement(&s_poolGeneration);
+          pPool->magazineId = i + 1;
+        }
+      }
+    }
+  }
+
+  slab = pPool->slabCount;
+  UD_ERROR_IF(slab >= UDPOOL_MAX_SLABS || pPool->slabShift + slab >= 32, udR_MemoryAllocationFailure);
+  firstIndex = udPool_SlabFirstIndex(pPool, slab);
+  count = 1U << (pPool->slabShift + slab);
+  UD_ERROR_IF(count > UDPOOL_MAX_INDEX - firstIndex, udR_MemoryAllocationFailure);
+
+  pSlab = (uint8_t*)udAllocAligned((size_t)count * pPool->elementSize, udMax(elementAlignment, (size_t)16), udAF_None);
+  UD_ERROR_NULL(pSlab, udR_MemoryAllocationFailure);
+
+  pPool->pSlabs[slab] = pSlab;
+  for (uint32_t i = 0; i + 1 < count; ++i)
+    *(uint32_t*)(pSlab + (size_t)i * pPool->elementSize) = firstIndex + i + 2;
+  udInterlockedExchange((volatile int32_t*)&pPool->slabCount, (int32_t)(slab + 1));
+
+  udPool_PushLinked(pPool, firstIndex, firstIndex + count - 1);
+  result = udR_Success;
+
+epilogue:
+  udPool_GrowUnlock(pPool);
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+// Get the calling thread's magazine for the pool, emptying it if it was left over from a pool since deinitialised
+static inline udPoolMagazine *udPool_GetMagazine(udPoolBase *pPool)
+{
+  if (pPool->magazineId == 0)
+    return nullptr;
+
+  udPoolMagazine *pMagazine = &t_poolMagazines[pPool->magazineId - 1];
+  if (pMagazine->pPool != pPool || pMagazine->generation != pPool->generation)
+  {
+    pMagazine->pPool = pPool;
+    pMagazine->generation = pPool->generation;
+    pMagazine->count = 0;
+  }
+  return pMagazine;
+}
+
+// ----------------------------------------------------------------------------
+void udPool_Init(udPoolBase *pPool, uint32_t elementsPerSlab, bool useMagazines)
+{
+  if (!pPool)
+    return;
+
+  memset(pPool, 0, sizeof(*pPool));
+  if (elementsPerSlab == 0)
+    elementsPerSlab = UDPOOL_DEFAULT_ELEMENTS_PER_SLAB;
+  pPool->slabShift = udPool_HighBit(udMax(elementsPerSlab, 2U) * 2 - 1);
+  pPool->useMagazines = useMagazines;
+}
+
+// ----------------------------------------------------------------------------
+void udPool_Deinit(udPoolBase *pPool)
+{
+  if (!pPool)
+    return;
+
+  if (pPool->magazineId)
+    udInterlockedExchangePointer(&s_pMagazinePools[pPool->magazineId - 1], nullptr);
+  for (uint32_t slab = 0; slab < pPool->slabCount; ++slab)
+    udFree(pPool->pSlabs[slab]);
+
+  // Keep the configuration so the pool can be used again
+  uint32_t slabShift = pPool->slabShift;
+  bool useMagazines = pPool->useMagazines;
+  memset(pPool, 0, sizeof(*pPool));
+  pPool->slabShift = slabShift;
+  pPool->useMagazines = useMagazines;
+}
+
+// ----------------------------------------------------------------------------
+void *udPool_Alloc(udPoolBase *pPool, size_t elementSize, size_t elementAlignment, udAllocationFlags flags)
+{
+  if (!pPool)
+    return nullptr;
+
+  udPoolMagazine *pMagazine = udPool_GetMagazine(pPool);
+  uint32_t index;
+  if (pMagazine && pMagazine->count)
+  {
+    index = pMagazine->indices[--pMagazine->count];
+  }
+  else
+  {
+    for (;;)
+    {
+      if (pMagazine)
+      {
+        // Refill half the magazine so the frees that follow have room before spilling back
+        pMagazine->count = udPool_PopIndices(pPool, pMagazine->indices, UDPOOL_MAGAZINE_SIZE / 2);
+        if (pMagazine->count)
+        {
+          index = pMagazine->indices[--pMagazine->count];
+          break;
+        }
+      }
+      else if (udPool_PopIndices(pPool, &index, 1))
+      {
+        break;
+      }
+
+      if (udPool_Grow(pPool, elementSize, elementAlignment) != udR_Success)
+        return nullptr;
+      if (!pMagazine)
+        pMagazine = udPool_GetMagazine(pPool); // The first grow registers the pool for magazines
+    }
+  }
+
+  void *pElement = udPool_Element(pPool, index);
+  if (flags & udAF_Zero)
+    memset(pElement, 0, elementSize);
+  return pElement;
+}
+
+// ----------------------------------------------------------------------------
+void udPool_Free(udPoolBase *pPool, void *pElement)
+{
+  if (!pPool || !pElement)
+    return;
+
+  uint32_t index = udPool_IndexOf(pPool, pElement);
+  if (index == UDPOOL_MAX_INDEX)
+    return;
+
+  udPoolMagazine *pMagazine = udPool_GetMagazine(pPool);
+  if (!pMagazine)
+  {
+    udPool_PushLinked(pPool, index, index);
+    return;
+  }
+
+  if (pMagazine->count == UDPOOL_MAGAZINE_SIZE)
+  {
+    pMagazine->count = UDPOOL_MAGAZINE_SIZE / 2;
+    udPool_PushIndices(pPool, pMagazine->indices + pMagazine->count, UDPOOL_MAGAZINE_SIZE - pMagazine->count);
+  }
+  pMagazine->indices[pMagazine->count++] = index;
+}
+
+// ----------------------------------------------------------------------------
+void udPool_GetUsage(udPoolBase *pPool, size_t *pCapacity, size_t *pFreeCount)
+{
+  size_t capacity = 0;
+  size_t freeCount = 0;
+  if (pPool)
+  {
+    capacity = udPool_SlabFirstIndex(pPool, pPool->slabCount);
+    for (uint32_t link = (uint32_t)pPool->head; link; link = udPool_Next(pPool, link - 1))
+      ++freeCount;
+  }
+
+  if (pCapacity)
+    *pCapacity = capacity;
+  if (pFreeCount)
+    *pFreeCount = freeCount;
+}
+
+// ----------------------------------------------------------------------------
+void udPool_ThreadExit()
+{
+  for (int i = 0; i < UDPOOL_MAX_MAGAZINE_POOLS; ++i)
+  {
+    udPoolMagazine *pMagazine = &t_poolMagazines[i];
+    // Only return elements to a pool that's still registered, one deinitialised already freed them
+    if (pMagazine->count && s_pMagazinePools[i] == pMagazine->pPool && pMagazine->pPool->generation == pMagazine->generation)
+      udPool_PushIndices(pMagazine->pPool, pMagazine->indices, pMagazine->count);
+    memset(pMagazine, 0, sizeof(*pMagazine));
+  }
+}
@@ -0,0 +1,134 @@
+#include "udScratch.h"
+
+#if !UDPLATFORM_WINDOWS
+# include <pthread.h>
+#endif
+
+#define UDSCRATCH_ARENA_BLOCK_SIZE (16 * 1024)
+#define UDSCRATCH_RING_ALIGNMENT 8
+
+struct udScratchThread
+{
+  udArena *pArena;
+  size_t ringHead;
+  int largeIndex;
+  char *pLarge[UDSCRATCH_LARGE_COUNT];
+  size_t largeSize[UDSCRATCH_LARGE_COUNT];
+  char ring[UDSCRATCH_RING_SIZE];
+};
+
+static UDTHREADLOCAL udScratchThread *t_pScratch;
+
+// ----------------------------------------------------------------------------
+static void udScratch_Release(udScratchThread *pScratch)
+{
+  udArena_Destroy(&pScratch->pArena);
+  for (char *&pLarge : pScratch->pLarge)
+    udFree(pLarge);
+  udFree(pScratch);
+}
+
+#if !UDPLATFORM_WINDOWS
+// Threads not started by udThread release their scratch through a key destructor as they exit
+static pthread_key_t s_udScratchKey;
+static pthread_once_t s_udScratchKeyOnce = PTHREAD_ONCE_INIT;
+static bool s_udScratchKeyCreated = false;
+
+// ----------------------------------------------------------------------------
+static void udScratch_KeyDestructor(void *pScratch)
+{
+  t_pScratch = nullptr;
+  udScratch_Release((udScratchThread*)pScratch);
+}
+
+// ----------------------------------------------------------------------------
+static void udScratch_CreateKey()
+{
+  s_udScratchKeyCreated = (pthread_key_create(&s_udScratchKey, udScratch_KeyDestructor) == 0);
+}
+#endif
+
+// ----------------------------------------------------------------------------
+static udScratchThread *udScratch_Get()
+{
+  if (!t_pScratch)
+  {
+    t_pScratch = udAllocType(udScratchThread, 1, udAF_Zero);
+#if !UDPLATFORM_WINDOWS
+    pthread_once(&s_udScratchKeyOnce, udScratch_CreateKey);
+    if (t_pScratch && s_udScratchKeyCreated)
+      pthread_setspecific(s_udScratchKey, t_pScratch);
+#endif
+  }
+  return t_pScratch;
+}
+
+// ----------------------------------------------------------------------------
+void *udScratch_Alloc(size_t size, udAllocationFlags flags, size_t alignment)
+{
+  udScratchThread *pScratch = udScratch_Get();
+  if (!pScratch)
+    return nullptr;
+  if (!pScratch->pArena && udArena_Create(&pScratch->pArena, UDSCRATCH_ARENA_BLOCK_SIZE) != udR_Success)
+    return nullptr;
+  return udArena_Alloc(pScratch->pArena, size, flags, alignment);
+}
+
+// ----------------------------------------------------------------------------
+udArenaMark udScratch_GetMark()
+{
+  // A thread without an arena yet gets the null mark, which rewinds to the start
+  return udArena_GetMark(t_pScratch ? t_pScratch->pArena : nullptr);
+}
+
+// ----------------------------------------------------------------------------
+void udScratch_ResetToMark(udArenaMark mark)
+{
+  if (t_pScratch)
+    udArena_ResetToMark(t_pScratch->pArena, mark);
+}
+
+// ----------------------------------------------------------------------------
+char *udScratch_RingAlloc(size_t size)
+{
+  udScratchThread *pScratch = udScratch_Get();
+  if (!pScratch)
+    return nullptr;
+
+  if (size <= UDSCRATCH_RING_SIZE / 4)
+  {
+    if (pScratch->ringHead + size > UDSCRATCH_RING_SIZE)
+      pScratch->ringHead = 0;
+    char *pMemory = pScratch->ring + pScratch->ringHead;
+    pScratch->ringHead = UDALIGN_POWEROF2(pScratch->ringHead + size, UDSCRATCH_RING_ALIGNMENT);
+    return pMemory;
+  }
+
+  // Too large to share the ring without overwriting many recent results, so cycle through a few heap blocks instead
+  int index = pScratch->largeIndex;
+  if (pScratch->largeSize[index] < size)
+  {
+    char *pLarge = (char*)udRealloc(pScratch->pLarge[index], size);
+    if (!pLarge)
+      return nullptr;
+    pScratch->pLarge[index] = pLarge;
+    pScratch->largeSize[index] = size;
+  }
+  pScratch->largeIndex = (index + 1) % UDSCRATCH_LARGE_COUNT;
+  return pScratch->pLarge[index];
+}
+
+// ----------------------------------------------------------------------------
+void udScratch_ThreadExit()
+{
+  udScratchThread *pScratch = t_pScratch;
+  if (!pScratch)
+    return;
+
+  t_pScratch = nullptr;
+#if !UDPLATFORM_WINDOWS
+  if (s_udScratchKeyCreated)
+    pthread_setspecific(s_udScratchKey, nullptr);
+#endif
+  udScratch_Release(pScratch);
+}
@@ -1,6 +1,7 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include "udStringUtil.h"
 #include "udMath.h"
+#include "udScratch.h"
 
 #include <ctype.h>
 #include <string.h>
@@ -797,53 +798,35 @@ int udAddToStringTable(char *&pStringTable, uint32_t *pStringTableLength, const
   return offset;
 }
 
-#define SMALLSTRING_BUFFER_COUNT 32
-#define SMALLSTRING_BUFFER_SIZE 64
-static char s_smallStringBuffers[SMALLSTRING_BUFFER_COUNT][SMALLSTRING_BUFFER_SIZE]; // 32 cycling buffers of 64 characters
-static volatile int32_t s_smallStringBufferIndex = 0;  // Cycling index, always and with (SMALLSTRING_BUFFER_COUNT-1) to get buffer index
+#define TEMPSTR_STACK_SIZE 256 // Strings up to this length are formatted once, on the stack, then copied to the ring
+#define TEMPSTR_NUMBER_SIZE 64
 
-                                                       // ****************************************************************************
-                                                       // Author: Dave Pevreal, May 2018
+// ****************************************************************************
+// Author: Dave Pevreal, May 2018
 const char *udTempStr(const char *pFormat, ...)
 {
-  int32_t bufIndex = udInterlockedPostIncrement(&s_smallStringBufferIndex) & (SMALLSTRING_BUFFER_COUNT - 1);
-  size_t bufferSize = SMALLSTRING_BUFFER_SIZE;
-
-retry:
-  UDASSERT(bufIndex < SMALLSTRING_BUFFER_COUNT, "buffer index out of range");
-  UDASSERT(bufIndex * SMALLSTRING_BUFFER_SIZE + bufferSize <= (int)sizeof(s_smallStringBuffers), "bufferSize would lead to overrun");
-  char *pBuf = s_smallStringBuffers[bufIndex];
+  char buffer[TEMPSTR_STACK_SIZE];
   va_list args;
   va_start(args, pFormat);
-  int charCount = udSprintfVA(pBuf, bufferSize, pFormat, args);
+  int charCount = udSprintfVA(buffer, sizeof(buffer), pFormat, args);
   va_end(args);
+  if (charCount < 0)
+    return "";
 
-  if (charCount >= (int)bufferSize && bufferSize < (SMALLSTRING_BUFFER_COUNT * SMALLSTRING_BUFFER_SIZE))
+  char *pBuf = udScratch_RingAlloc((size_t)charCount + 1);
+  if (!pBuf)
+    return "";
+
+  if (charCount < (int)sizeof(buffer))
   {
-    // The output buffer wasn't big enough, so look for a series of contiguous buffers
-    // To keep things simple, attempt to undo the allocation done on the first line of the function
-    int previous = bufIndex | (s_smallStringBufferIndex & ~(SMALLSTRING_BUFFER_COUNT - 1));
-    // Reset to previous iff current value is exactly previous + 1
-    udInterlockedCompareExchange(&s_smallStringBufferIndex, previous, previous + 1);
-
-    int requiredBufferCount = udMin(SMALLSTRING_BUFFER_COUNT, (charCount + SMALLSTRING_BUFFER_SIZE) / SMALLSTRING_BUFFER_SIZE);
-    bufferSize = requiredBufferCount * SMALLSTRING_BUFFER_SIZE;
-    // Try to allocate a number of sequential buffers, understanding that another thread can allocate one also
-    while ((((bufIndex = s_smallStringBufferIndex) & (SMALLSTRING_BUFFER_COUNT - 1)) + requiredBufferCount) <= SMALLSTRING_BUFFER_COUNT)
-    {
-      if (udInterlockedCompareExchange(&s_smallStringBufferIndex, bufIndex + requiredBufferCount, bufIndex) == bufIndex)
-      {
-        // The bufIndex has upper bits set for the compareExchange, clear them before retrying
-        bufIndex &= (SMALLSTRING_BUFFER_COUNT - 1);
-        goto retry;
-      }
-    }
-    // We need to wrap and hopefully no other thread is still using their string.
-    if (requiredBufferCount > (s_smallStringBufferIndex & (SMALLSTRING_BUFFER_COUNT - 1)))
-      udDebugPrintf("Warning: very long string (%d chars) created using udTempStr - NOT THREADSAFE\n", charCount + 1);
-    s_smallStringBufferIndex = requiredBufferCount;
-    bufIndex = 0;
-    goto retry;
+    memcpy(pBuf, buffer, (size_t)charCount + 1);
+  }
+  else
+  {
+    // Too long for the stack buffer, so format again directly into an allocation of the right size
+    va_start(args, pFormat);
+    udSprintfVA(pBuf, (size_t)charCount + 1, pFormat, args);
+    va_end(args);
   }
   return pBuf;
 }
@@ -852,7 +835,9 @@ retry:
 // Author: Dave Pevreal, October 2015
 const char *udTempStr_CommaInt(int64_t n)
 {
-  char *pBuf = s_smallStringBuffers[udInterlockedPostIncrement(&s_smallStringBufferIndex) & (SMALLSTRING_BUFFER_COUNT - 1)];
+  char *pBuf = udScratch_RingAlloc(TEMPSTR_NUMBER_SIZE);
+  if (!pBuf)
+    return "";
   uint64_t v = (uint64_t)n;
 
   int i = 0;
@@ -888,8 +873,10 @@ const char *udTempStr_CommaInt(int64_t n)
 // Author: Dave Pevreal, September 2018
 const char *udTempStr_TrimDouble(double v, int maxDecimalPlaces, int minDecimalPlaces, bool undoRounding)
 {
-  char *pBuf = s_smallStringBuffers[udInterlockedPostIncrement(&s_smallStringBufferIndex) & (SMALLSTRING_BUFFER_COUNT - 1)];
-  udStrFtoa(pBuf, SMALLSTRING_BUFFER_SIZE, v, maxDecimalPlaces + (undoRounding ? 1 : 0));
+  char *pBuf = udScratch_RingAlloc(TEMPSTR_NUMBER_SIZE);
+  if (!pBuf)
+    return "";
+  udStrFtoa(pBuf, TEMPSTR_NUMBER_SIZE, v, maxDecimalPlaces + (undoRounding ? 1 : 0));
   size_t pointIndex;
   if (udStrchr(pBuf, ".", &pointIndex))
   {
@@ -0,0 +1,248 @@
+#include "udTaskGraph.h"
+
+#include "udChunkedArray.h"
+#include "udPlatformUtil.h"
+
+struct udTaskGraphNode
+{
+  udTaskGraph *pGraph;
+  udWorkerPoolCallback function;
+  udWorkerPoolPriority priority;
+  uint32_t predecessorCount;
+  volatile int32_t remainingPredecessors; // Counted down during a run, the node is queued when it reaches zero
+  uint32_t firstSuccessor; // Into pSuccessors, valid once the graph is prepared
+  uint32_t successorCount;
+};
+
+struct udTaskGraphEdge
+{
+  uint32_t before;
+  uint32_t after;
+};
+
+struct udTaskGraph
+{
+  udWorkerPool *pPool;
+  udWorkerPoolGroup *pGroup; // Tasks of the current run
+  udChunkedArray<udTaskGraphNode> nodes; // Chunked so the nodes don't move as more are added
+  udChunkedArray<udTaskGraphEdge> edges;
+  uint32_t *pSuccessors; // Node indices grouped by predecessor
+  bool prepared;
+  void *pRunData;
+  volatile int32_t runResult; // udResult of the current run, the first node that couldn't be queued sets it
+};
+
+// ----------------------------------------------------------------------------
+// Builds the successor lists from the edges, then checks every node can be reached by removing nodes with no remaining
+// predecessors, which leaves the nodes of any cycle behind
+static udResult udTaskGraph_Prepare(udTaskGraph *pGraph)
+{
+  udResult result;
+  uint32_t nodeCount = (uint32_t)pGraph->nodes.length;
+  uint32_t *pReady = nullptr;
+  uint32_t readyCount = 0;
+
+  UD_ERROR_IF(pGraph->prepared, udR_Success);
+
+  udFree(pGraph->pSuccessors);
+  pGraph->pSuccessors = udAllocType(uint32_t, pGraph->edges.length + 1, udAF_None);
+  pReady = udAllocType(uint32_t, nodeCount + 1, udAF_None);
+  UD_ERROR_NULL(pGraph->pSuccessors, udR_MemoryAllocationFailure);
+  UD_ERROR_NULL(pReady, udR_MemoryAllocationFailure);
+
+  for (udTaskGraphNode &node : pGraph->nodes)
+  {
+    node.predecessorCount = 0;
+    node.successorCount = 0;
+  }
+  for (const udTaskGraphEdge &edge : pGraph->edges)
+  {
+    ++pGraph->nodes[edge.before].successorCount;
+    ++pGraph->nodes[edge.after].predecessorCount;
+  }
+
+  {
+    uint32_t first = 0;
+    for (udTaskGraphNode &node : pGraph->nodes)
+    {
+      node.firstSuccessor = first;
+      first += node.successorCount;
+      node.successorCount = 0; // Counted back up as the lists are filled
+    }
+  }
+  for (const udTaskGraphEdge &edge : pGraph->edges)
+  {
+    udTaskGraphNode &node = pGraph->nodes[edge.before];
+    pGraph->pSuccessors[node.firstSuccessor + node.successorCount++] = edge.after;
+  }
+
+  for (uint32_t i = 0; i < nodeCount; ++i)
+  {
+    pGraph->nodes[i].remainingPredecessors = (int32_t)pGraph->nodes[i].predecessorCount;
+    if (pGraph->nodes[i].predecessorCount == 0)
+      pReady[readyCount++] = i;
+  }
+  for (uint32_t next = 0; next < readyCount; ++next)
+  {
+    const udTaskGraphNode &node = pGraph->nodes[pReady[next]];
+    for (uint32_t s = 0; s < node.successorCount; ++s)
+    {
+      uint32_t successor = pGraph->pSuccessors[node.firstSuccessor + s];
+      if (--pGraph->nodes[successor].remainingPredecessors == 0)
+        pReady[readyCount++] = successor;
+    }
+  }
+  UD_ERROR_IF(readyCount != nodeCount, udR_InvalidConfiguration);
+
+  pGraph->prepared = true;
+  result = udR_Success;
+
+epilogue:
+  udFree(pReady);
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+static void udTaskGraph_RunNode(void *pData)
+{
+  udTaskGraphNode *pNode = (udTaskGraphNode*)pData;
+  udTaskGraph *pGraph = pNode->pGraph;
+
+  if (pNode->function)
+    pNode->function(pGraph->pRunData);
+
+  // Queued as part of this node's task, so the group can't finish in between
+  for (uint32_t s = 0; s < pNode->successorCount; ++s)
+  {
+    udTaskGraphNode *pSuccessor = &pGraph->nodes[pGraph->pSuccessors[pNode->firstSuccessor + s]];
+    if (udInterlockedPreDecrement(&pSuccessor->remainingPredecessors) == 0)
+    {
+      // The successor and everything after it won't run, which is reported by udTaskGraph_Wait
+      udResult result = udWorkerPool_AddGroupTask(pGraph->pGroup, pSuccessor->priority, udTaskGraph_RunNode, pSuccessor, false);
+      if (result != udR_Success)
+        udInterlockedCompareExchange(&pGraph->runResult, (int32_t)result, (int32_t)udR_Success);
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+udResult udTaskGraph_Create(udTaskGraph **ppGraph, udWorkerPool *pPool)
+{
+  udResult result;
+  udTaskGraph *pGraph = nullptr;
+
+  UD_ERROR_NULL(ppGraph, udR_InvalidParameter_);
+  UD_ERROR_NULL(pPool, udR_InvalidParameter_);
+
+  pGraph = udAllocType(udTaskGraph, 1, udAF_Zero);
+  UD_ERROR_NULL(pGraph, udR_MemoryAllocationFailure);
+  pGraph->pPool = pPool;
+  UD_ERROR_CHECK(pGraph->nodes.Init(32));
+  UD_ERROR_CHECK(pGraph->edges.Init(64));
+  UD_ERROR_CHECK(udWorkerPool_CreateGroup(&pGraph->pGroup, pPool));
+
+  *ppGraph = pGraph;
+  pGraph = nullptr;
+  result = udR_Success;
+
+epilogue:
+  udTaskGraph_Destroy(&pGraph);
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+void udTaskGraph_Destroy(udTaskGraph **ppGraph)
+{
+  if (ppGraph == nullptr || *ppGraph == nullptr)
+    return;
+
+  udTaskGraph *pGraph = *ppGraph;
+  *ppGraph = nullptr;
+
+  udWorkerPool_DestroyGroup(&pGraph->pGroup);
+  pGraph->nodes.Deinit();
+  pGraph->edges.Deinit();
+  udFree(pGraph->pSuccessors);
+  udFree(pGraph);
+}
+
+// ----------------------------------------------------------------------------
+udResult udTaskGraph_AddNode(udTaskGraph *pGraph, uint32_t *pNodeIndex, udWorkerPoolCallback func, udWorkerPoolPriority priority /*= udWPP_Normal*/)
+{
+  udResult result;
+  udTaskGraphNode *pNode = nullptr;
+
+  UD_ERROR_NULL(pGraph, udR_InvalidParameter_);
+  UD_ERROR_NULL(pNodeIndex, udR_InvalidParameter_);
+  UD_ERROR_IF(priority < 0 || priority >= udWPP_Count, udR_InvalidParameter_);
+  UD_ERROR_IF(pGraph->nodes.length >= UINT32_MAX, udR_CountExceeded);
+  UD_ERROR_IF(udWorkerPool_GetGroupTaskCount(pGraph->pGroup) > 0, udR_NotAllowed);
+
+  UD_ERROR_CHECK(pGraph->nodes.PushBack(&pNode));
+  pNode->pGraph = pGraph;
+  pNode->function = std::move(func);
+  pNode->priority = priority;
+  *pNodeIndex = (uint32_t)(pGraph->nodes.length - 1);
+  pGraph->prepared = false;
+  result = udR_Success;
+
+epilogue:
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+udResult udTaskGraph_AddDependency(udTaskGraph *pGraph, uint32_t before, uint32_t after)
+{
+  udResult result;
+  udTaskGraphEdge edge = { before, after };
+
+  UD_ERROR_NULL(pGraph, udR_InvalidParameter_);
+  UD_ERROR_IF(before >= pGraph->nodes.length || after >= pGraph->nodes.length, udR_OutOfRange);
+  UD_ERROR_IF(before == after, udR_InvalidParameter_);
+  UD_ERROR_IF(udWorkerPool_GetGroupTaskCount(pGraph->pGroup) > 0, udR_NotAllowed);
+
+  UD_ERROR_CHECK(pGraph->edges.PushBack(edge));
+  pGraph->prepared = false;
+  result = udR_Success;
+
+epilogue:
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+udResult udTaskGraph_Run(udTaskGraph *pGraph, void *pUserData /*= nullptr*/)
+{
+  udResult result;
+
+  UD_ERROR_NULL(pGraph, udR_InvalidParameter_);
+  UD_ERROR_IF(udWorkerPool_GetGroupTaskCount(pGraph->pGroup) > 0, udR_NotAllowed);
+  UD_ERROR_CHECK(udTaskGraph_Prepare(pGraph));
+
+  pGraph->pRunData = pUserData;
+  pGraph->runResult = udR_Success;
+  for (udTaskGraphNode &node : pGraph->nodes)
+    node.remainingPredecessors = (int32_t)node.predecessorCount;
+
+  // Nothing has been queued yet, so the counts are all set before any node can run
+  for (udTaskGraphNode &node : pGraph->nodes)
+  {
+    if (node.predecessorCount == 0)
+      UD_ERROR_CHECK(udWorkerPool_AddGroupTask(pGraph->pGroup, node.priority, udTaskGraph_RunNode, &node, false));
+  }
+  result = udR_Success;
+
+epilogue:
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+udResult udTaskGraph_Wait(udTaskGraph *pGraph, int waitMs /*= UDTHREAD_WAIT_INFINITE*/, bool helpWithTasks /*= false*/)
+{
+  if (pGraph == nullptr)
+    return udR_InvalidParameter_;
+
+  udResult result = udWorkerPool_WaitGroup(pGraph->pGroup, waitMs, helpWithTasks);
+  if (result == udR_Success)
+    result = (udResult)pGraph->runResult;
+  return result;
+}
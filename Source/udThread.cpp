@@ -1,4 +1,7 @@
 #include "udThread.h"
+#include "udAllocator.h"
+#include "udPool.h"
+#include "udScratch.h"
 
 #if UDPLATFORM_WINDOWS
 //
@@ -70,6 +73,7 @@ struct udThread
   udSemaphore *pCacheSemaphore; // Semaphore is non-null only while on the cached thread list
   volatile int32_t refCount;
 };
+static udPool<udThread> s_threadPool(MAX_CACHED_THREADS);
 
 // ----------------------------------------------------------------------------
 static uint32_t udThread_Bootstrap(udThread *pThread)
@@ -128,6 +132,11 @@ static uint32_t udThread_Bootstrap(udThread *pThread)
   if (pThread)
     udThread_Destroy(&pThread);
 
+  // Last thing before exiting, release anything the scratch, pools and allocator are holding for this thread
+  udScratch_ThreadExit();
+  udPool_ThreadExit();
+  udAllocator_ThreadExit();
+
   return threadReturnValue;
 }
 
@@ -155,7 +164,7 @@ udResult udThread_Create(udThread **ppThread, udThreadStart threadStarter, void
   }
   else
   {
-    pThread = udAllocType(udThread, 1, udAF_Zero);
+    pThread = s_threadPool.Alloc(udAF_Zero);
     UD_ERROR_NULL(pThread, udR_MemoryAllocationFailure);
     pThread->pCacheSemaphore = udCreateSemaphore();
 #if DEBUG_CACHE
@@ -231,7 +240,7 @@ void udThread_Destroy(udThread **ppThread)
 #if UDPLATFORM_WINDOWS
       CloseHandle(pThread->handle);
 #endif
-      udFree(pThread);
+      s_threadPool.Free(pThread);
     }
   }
 }
@@ -1,41 +1,514 @@
 #include "udWorkerPool.h"
 
 #include "udSafeDeque.h"
+#include "udCancelToken.h"
 
 #include "udChunkedArray.h"
 #include "udPlatformUtil.h"
+#include "udPool.h"
 #include "udThread.h"
 #include "udMath.h"
 #include "udStringUtil.h"
+#include "udJSON.h"
+
+#define UDWORKERPOOL_RING_INITIAL_SIZE 256
+#define UDWORKERPOOL_SPIN_ROUNDS 64 // Rounds of looking for a task before a thread sleeps
+#define UDWORKERPOOL_CACHE_LINE_SIZE 64
+#define UDWORKERPOOL_RANGES_PER_THREAD 4 // Ranges ParallelFor starts with per thread, including the caller
+#define UDWORKERPOOL_STEAL_SPLITS 2 // Extra halvings of a stolen range, so the work of a busy thread spreads further
+#define UDWORKERPOOL_TIMER_SLOT_BITS 6
+#define UDWORKERPOOL_TIMER_SLOTS (1 << UDWORKERPOOL_TIMER_SLOT_BITS)
+#define UDWORKERPOOL_TIMER_LEVELS 4 // Levels of 64 one millisecond slots cover about 4.6 hours, longer delays wait on the top level
+#define UDWORKERPOOL_TIMER_REBASE_MS 3600000 // Restarts the timer clock before its float milliseconds lose precision
+#define UDWORKERPOOL_HISTOGRAM_BUCKETS 32 // Bucket 0 counts zeros and bucket i values in [2^(i-1), 2^i), the last also counts any larger
+
+struct udWorkerPoolTask
+{
+  udWorkerPoolCallback function;
+  udWorkerPoolCallback postFunction; // runs on main thread
+  void *pDataBlock;
+  bool freeDataBlock;
+  udWorkerPoolPriority priority;
+  udWorkerPoolGroup *pGroup;
+  udCancelToken *pCancelToken; // A reference held until the task is freed
+  uint64_t queuedTime; // Perf counter when queued while metrics are recorded, otherwise zero
+};
+
+// The storage of a deque. Outgrown rings are kept until the pool is destroyed, as a thief may still be reading one
+struct udWorkerPoolRing
+{
+  udWorkerPoolRing *pPrevious;
+  uint32_t mask;
+  udWorkerPoolTask **ppTasks;
+};
+
+// Chase-Lev work stealing deque. The owning thread pushes and pops at the bottom, any other thread steals from the top.
+// The positions wrap, so are compared by their difference
+struct udWorkerPoolDeque
+{
+  volatile int32_t top;
+  char padding0[UDWORKERPOOL_CACHE_LINE_SIZE - sizeof(int32_t)];
+  volatile int32_t bottom;
+  udWorkerPoolRing *volatile pRing;
+  char padding1[UDWORKERPOOL_CACHE_LINE_SIZE];
+};
+
+// Written only by the owning thread, so a report read meanwhile may be mid update
+struct udWorkerPoolHistogram
+{
+  volatile uint64_t counts[UDWORKERPOOL_HISTOGRAM_BUCKETS];
+  volatile uint64_t sum;
+};
+
+struct udWorkerPoolThreadMetrics
+{
+  udWorkerPoolHistogram queueDepth; // Tasks still queued in every lane as each task was taken
+  udWorkerPoolHistogram waitMicroseconds; // From queued to started
+  udWorkerPoolHistogram runMicroseconds;
+  volatile uint64_t sleeps;
+  volatile int32_t generation; // The pool's metricsGeneration these were recorded in, older counts are stale
+};
 
 struct udWorkerPoolThread
 {
   udWorkerPool *pPool;
   udThread *pThread;
+  uint32_t randomState;
+  uint8_t laneCredits[udWPP_Count]; // Tasks left to take from each lane before the weights are applied again
+  udWorkerPoolDeque deques[udWPP_Count];
+  udWorkerPoolThreadMetrics metrics;
 };
 
-struct udWorkerPoolTask
+// A delayed or periodic task, linked into a slot of the timer wheel while waiting to be queued
+struct udWorkerPoolTimerNode
 {
+  udWorkerPool *pPool;
+  udWorkerPoolTimerNode *pPrevious;
+  udWorkerPoolTimerNode *pNext; // The next free node once freed
+  uint64_t expiry; // In timer ticks
+  uint32_t periodMs; // Zero for a task that runs once
+  uint32_t generation; // Raised as the node is freed, so handles to the task it was stop matching
+  uint32_t index;
+  uint8_t level;
+  uint8_t slot;
+  bool inWheel;
+  bool runQueued; // Until the run finishes, a periodic task due again meanwhile skips that run
+  bool cancelled;
+  udWorkerPoolPriority priority;
+  udWorkerPoolGroup *pGroup;
   udWorkerPoolCallback function;
-  udWorkerPoolCallback postFunction; // runs on main thread
-  void *pDataBlock;
-  bool freeDataBlock;
+  void *pUserData;
+};
+
+struct udWorkerPoolLane
+{
+  udSafeDeque<udWorkerPoolTask*> *pInjectedTasks; // Tasks added from threads that aren't the pool's
+  volatile int32_t queuedTasks; // Raised before a task is queued so a lane at zero can be skipped
+  volatile int32_t peakQueuedTasks;
+  volatile int32_t addedTasks;
+  volatile int32_t completedTasks;
+  volatile int32_t cancelledTasks;
+  uint8_t weight;
+  char padding[UDWORKERPOOL_CACHE_LINE_SIZE];
 };
 
 struct udWorkerPool
 {
-  udSafeDeque<udWorkerPoolTask> *pQueuedTasks;
+  udWorkerPoolLane lanes[udWPP_Count];
+  udWorkerPoolSchedule schedule;
   udSafeDeque<udWorkerPoolTask> *pQueuedPostTasks;
+  udPool<udWorkerPoolTask> taskPool;
 
   udSemaphore *pSemaphore;
-  volatile int32_t activeThreads;
+  volatile int32_t sleepingThreads; // Threads that may be waiting on pSemaphore, each wake claims one
+  volatile int32_t pendingTasks;    // Tasks queued or running
 
   uint8_t totalThreads;
   udWorkerPoolThread *pThreadData;
 
   udInterlockedBool isRunning;
+  volatile bool recordMetrics;
+  volatile int32_t metricsGeneration; // Raised each time recording starts
+  uint64_t metricsStart; // Perf counter when recording last started
+
+  // Delayed and periodic tasks wait in a hierarchical timer wheel serviced by pTimerThread, started with the first of them
+  // Everything below is protected by pTimerMutex
+  udMutex *pTimerMutex;
+  udConditionVariable *pTimersChanged;
+  udThread *pTimerThread;
+  udChunkedArray<udWorkerPoolTimerNode> timerNodes; // Chunked so the nodes don't move as more are added
+  udWorkerPoolTimerNode *pFreeTimers;
+  udWorkerPoolTimerNode *pTimerSlots[UDWORKERPOOL_TIMER_LEVELS][UDWORKERPOOL_TIMER_SLOTS];
+  uint64_t occupiedTimerSlots[UDWORKERPOOL_TIMER_LEVELS]; // A bit per slot with timers in it
+  uint64_t timerTick; // The next tick the wheel will process
+  uint64_t timerWakeTick; // When the timer thread next wakes, UINT64_MAX if only when signalled
+  uint64_t timerClockStart;
+  uint64_t timerClockTicks; // Ticks counted before timerClockStart
 };
 
+struct udWorkerPoolGroup
+{
+  udWorkerPool *pPool;
+  volatile int32_t outstandingTasks; // Only ever taken to zero with pMutex held, see udWorkerPool_FinishGroupTask
+  int waitingThreads; // Protected by pMutex
+  udMutex *pMutex;
+  udConditionVariable *pFinished;
+};
+
+struct udWorkerPoolParallelFor
+{
+  udWorkerPoolGroup *pGroup;
+  udCallback<void(size_t, size_t)> body;
+  size_t grain;
+};
+
+struct udWorkerPoolRange
+{
+  udWorkerPoolParallelFor *pJob;
+  size_t begin;
+  size_t end;
+  int splits; // Halvings left before the range is run whole
+  udWorkerPoolThread *pOwner; // The thread that queued the range, nullptr if not one of the pool's
+};
+
+static UDTHREADLOCAL udWorkerPoolThread *t_pWorkerThread; // Set while the thread is one of a pool's
+
+// ----------------------------------------------------------------------------
+static udWorkerPoolRing *udWorkerPool_CreateRing(uint32_t size)
+{
+  udWorkerPoolRing *pRing = (udWorkerPoolRing*)udAlloc(sizeof(udWorkerPoolRing) + size * sizeof(udWorkerPoolTask*));
+  if (pRing)
+  {
+    pRing->pPrevious = nullptr;
+    pRing->mask = size - 1;
+    pRing->ppTasks = (udWorkerPoolTask**)(pRing + 1);
+  }
+  return pRing;
+}
+
+// ----------------------------------------------------------------------------
+static void udWorkerPool_DestroyRings(udWorkerPoolDeque *pDeque)
+{
+  udWorkerPoolRing *pRing = pDeque->pRing;
+  while (pRing)
+  {
+    udWorkerPoolRing *pPrevious = pRing->pPrevious;
+    udFree(pRing);
+    pRing = pPrevious;
+  }
+  pDeque->pRing = nullptr;
+}
+
+// ----------------------------------------------------------------------------
+// Owner only
+static udResult udWorkerPool_DequePush(udWorkerPoolDeque *pDeque, udWorkerPoolTask *pTask)
+{
+  uint32_t bottom = (uint32_t)pDeque->bottom;
+  uint32_t top = (uint32_t)pDeque->top;
+  udWorkerPoolRing *pRing = pDeque->pRing;
+
+  if (bottom - top > pRing->mask)
+  {
+    udWorkerPoolRing *pLarger = udWorkerPool_CreateRing((pRing->mask + 1) * 2);
+    if (!pLarger)
+      return udR_MemoryAllocationFailure;
+    for (uint32_t i = top; i != bottom; ++i)
+      pLarger->ppTasks[i & pLarger->mask] = pRing->ppTasks[i & pRing->mask];
+    pLarger->pPrevious = pRing;
+    udMemoryBarrier(); // The copied tasks must be visible before the ring is
+    pDeque->pRing = pLarger;
+    pRing = pLarger;
+  }
+
+  pRing->ppTasks[bottom & pRing->mask] = pTask;
+  udMemoryBarrier(); // The task must be visible before the bottom that lets a thief take it
+  pDeque->bottom = (int32_t)(bottom + 1);
+  return udR_Success;
+}
+
+// ----------------------------------------------------------------------------
+// Owner only, takes the most recently pushed task
+static udWorkerPoolTask *udWorkerPool_DequePop(udWorkerPoolDeque *pDeque)
+{
+  uint32_t bottom = (uint32_t)pDeque->bottom - 1;
+  udWorkerPoolRing *pRing = pDeque->pRing;
+  pDeque->bottom = (int32_t)bottom;
+  udMemoryBarrier(); // Thieves must see the bottom claimed before top is read
+
+  uint32_t top = (uint32_t)pDeque->top;
+  int32_t remaining = (int32_t)(bottom - top);
+  udWorkerPoolTask *pTask = nullptr;
+  if (remaining >= 0)
+  {
+    pTask = pRing->ppTasks[bottom & pRing->mask];
+    if (remaining > 0)
+      return pTask;
+
+    // The last task, which a thief may be taking at the same time
+    if (udInterlockedCompareExchange(&pDeque->top, (int32_t)(top + 1), (int32_t)top) != (int32_t)top)
+      pTask = nullptr;
+  }
+  pDeque->bottom = (int32_t)(bottom + 1);
+  return pTask;
+}
+
+// ----------------------------------------------------------------------------
+// Any thread, takes the oldest task. Returns nullptr if empty or another thread took the task first
+static udWorkerPoolTask *udWorkerPool_DequeSteal(udWorkerPoolDeque *pDeque)
+{
+  uint32_t top = (uint32_t)pDeque->top;
+  udMemoryBarrier();
+  uint32_t bottom = (uint32_t)pDeque->bottom;
+  if ((int32_t)(bottom - top) <= 0)
+    return nullptr;
+
+  udMemoryBarrier(); // Read the ring and task only after the bottom that covers them
+  udWorkerPoolRing *pRing = pDeque->pRing;
+  udWorkerPoolTask *pTask = pRing->ppTasks[top & pRing->mask];
+  if (udInterlockedCompareExchange(&pDeque->top, (int32_t)(top + 1), (int32_t)top) != (int32_t)top)
+    return nullptr;
+  return pTask;
+}
+
+// ----------------------------------------------------------------------------
+// Try each other thread's deque, starting from a random one so thieves spread out
+static udWorkerPoolTask *udWorkerPool_Steal(udWorkerPool *pPool, udWorkerPoolThread *pThief, int lane, uint32_t *pRandomState)
+{
+  uint32_t random = *pRandomState;
+  random ^= random << 13;
+  random ^= random >> 17;
+  random ^= random << 5;
+  *pRandomState = random;
+
+  for (int i = 0; i < pPool->totalThreads; ++i)
+  {
+    udWorkerPoolThread *pVictim = &pPool->pThreadData[(random + i) % pPool->totalThreads];
+    if (pVictim == pThief)
+      continue;
+    udWorkerPoolTask *pTask = udWorkerPool_DequeSteal(&pVictim->deques[lane]);
+    if (pTask)
+      return pTask;
+  }
+  return nullptr;
+}
+
+// ----------------------------------------------------------------------------
+static udWorkerPoolTask *udWorkerPool_FindLaneTask(udWorkerPool *pPool, udWorkerPoolThread *pThread, int lane, uint32_t *pRandomState)
+{
+  udWorkerPoolLane *pLane = &pPool->lanes[lane];
+  udWorkerPoolTask *pTask = nullptr;
+  if (pThread)
+    pTask = udWorkerPool_DequePop(&pThread->deques[lane]);
+  if (!pTask && pLane->pInjectedTasks->chunkedArray.length) // Unlocked peek, the pop checks properly
+    udSafeDeque_PopFront(pLane->pInjectedTasks, &pTask);
+  if (!pTask)
+    pTask = udWorkerPool_Steal(pPool, pThread, lane, pRandomState);
+  if (pTask)
+    udInterlockedPreDecrement(&pLane->queuedTasks);
+  return pTask;
+}
+
+// ----------------------------------------------------------------------------
+// Orders the lanes to look in for the next task, highest priority first. Given the thread (when weighted) the lanes it still
+// has credit for come first
+static void udWorkerPool_OrderLanes(udWorkerPoolThread *pThread, int order[udWPP_Count])
+{
+  int count = 0;
+  for (int lane = 0; lane < udWPP_Count; ++lane)
+  {
+    if (pThread && pThread->laneCredits[lane] > 0)
+      order[count++] = lane;
+  }
+  for (int lane = 0; lane < udWPP_Count; ++lane)
+  {
+    if (!pThread || pThread->laneCredits[lane] == 0)
+      order[count++] = lane;
+  }
+}
+
+// ----------------------------------------------------------------------------
+// pThread is the calling thread if it is one of the pool's, otherwise nullptr
+static udWorkerPoolTask *udWorkerPool_FindTask(udWorkerPool *pPool, udWorkerPoolThread *pThread, uint32_t *pRandomState)
+{
+  bool weighted = (pThread && pPool->schedule == udWPS_Weighted);
+  int order[udWPP_Count];
+  udWorkerPool_OrderLanes(weighted ? pThread : nullptr, order);
+
+  for (int lane : order)
+  {
+    if (pPool->lanes[lane].queuedTasks <= 0)
+      continue;
+
+    udWorkerPoolTask *pTask = udWorkerPool_FindLaneTask(pPool, pThread, lane, pRandomState);
+    if (!pTask)
+      continue;
+
+    // Taking a task without credit means every lane with work has used its share, so the shares start again
+    if (weighted && pThread->laneCredits[lane] == 0)
+    {
+      for (int i = 0; i < udWPP_Count; ++i)
+        pThread->laneCredits[i] = pPool->lanes[i].weight;
+    }
+    if (weighted)
+      --pThread->laneCredits[lane];
+    return pTask;
+  }
+  return nullptr;
+}
+
+// ----------------------------------------------------------------------------
+// Called after queueing a task, wakes a sleeping thread if there is one
+static void udWorkerPool_WakeThread(udWorkerPool *pPool)
+{
+  udMemoryBarrier(); // The task must be visible before checking for sleepers, who announce themselves then look for tasks
+  int32_t sleeping = pPool->sleepingThreads;
+  while (sleeping > 0)
+  {
+    int32_t previous = udInterlockedCompareExchange(&pPool->sleepingThreads, sleeping - 1, sleeping);
+    if (previous == sleeping)
+    {
+      udIncrementSemaphore(pPool->pSemaphore);
+      return;
+    }
+    sleeping = previous;
+  }
+}
+
+// ----------------------------------------------------------------------------
+// A thread that announced itself as sleeping but didn't take a wake withdraws the announcement, or if every announcement
+// has already been claimed it takes the wake that is on its way
+static void udWorkerPool_CancelSleep(udWorkerPool *pPool)
+{
+  for (;;)
+  {
+    int32_t sleeping = pPool->sleepingThreads;
+    if (sleeping == 0)
+    {
+      udWaitSemaphore(pPool->pSemaphore);
+      return;
+    }
+    if (udInterlockedCompareExchange(&pPool->sleepingThreads, sleeping - 1, sleeping) == sleeping)
+      return;
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Tasks are counted down without the mutex until the last, which wakes any waiting threads. Holding the mutex for the last
+// means a waiter that sees zero knows this thread is finished with the group, so the group can be destroyed
+static void udWorkerPool_FinishGroupTask(udWorkerPoolGroup *pGroup)
+{
+  int32_t outstanding = pGroup->outstandingTasks;
+  while (outstanding > 1)
+  {
+    int32_t previous = udInterlockedCompareExchange(&pGroup->outstandingTasks, outstanding - 1, outstanding);
+    if (previous == outstanding)
+      return;
+    outstanding = previous;
+  }
+
+  udLockMutex(pGroup->pMutex);
+  if (udInterlockedPreDecrement(&pGroup->outstandingTasks) == 0 && pGroup->waitingThreads > 0)
+    udSignalConditionVariable(pGroup->pFinished, pGroup->waitingThreads);
+  udReleaseMutex(pGroup->pMutex);
+}
+
+// ----------------------------------------------------------------------------
+static void udWorkerPool_FreeTask(udWorkerPool *pPool, udWorkerPoolTask *pTask)
+{
+  udCancelToken_Destroy(&pTask->pCancelToken);
+  pTask->~udWorkerPoolTask();
+  pPool->taskPool.Free(pTask);
+}
+
+// ----------------------------------------------------------------------------
+// Frees a task that will never run, which still counts as finished for its group
+static void udWorkerPool_DropTask(udWorkerPool *pPool, udWorkerPoolTask *pTask)
+{
+  if (pTask->freeDataBlock)
+    udFree(pTask->pDataBlock);
+  if (pTask->pGroup)
+    udWorkerPool_FinishGroupTask(pTask->pGroup);
+  udWorkerPool_FreeTask(pPool, pTask);
+}
+
+// ----------------------------------------------------------------------------
+static void udWorkerPool_RunTask(udWorkerPool *pPool, udWorkerPoolTask *pTask)
+{
+  // Cancelled tasks are dropped as they are taken, rather than searched for in the deques of other threads
+  if (udCancelToken_IsCancelled(pTask->pCancelToken))
+  {
+    udInterlockedPreIncrement(&pPool->lanes[pTask->priority].cancelledTasks);
+    udWorkerPool_DropTask(pPool, pTask);
+    udInterlockedPreDecrement(&pPool->pendingTasks);
+    return;
+  }
+
+  if (pTask->function)
+  {
+    udCancelToken *pPreviousToken = udCancelToken_SetCurrent(pTask->pCancelToken); // Restored as a task can run others while it waits
+    pTask->function(pTask->pDataBlock);
+    udCancelToken_SetCurrent(pPreviousToken);
+  }
+
+  if (pTask->postFunction)
+  {
+    // The token reference is released with the task below, and the group may be gone before the post work runs
+    udWorkerPoolTask postTask = std::move(*pTask);
+    postTask.pCancelToken = nullptr;
+    postTask.pGroup = nullptr;
+    udSafeDeque_PushBack(pPool->pQueuedPostTasks, std::move(postTask));
+  }
+  else if (pTask->freeDataBlock)
+    udFree(pTask->pDataBlock);
+
+  udInterlockedPreIncrement(&pPool->lanes[pTask->priority].completedTasks);
+  if (pTask->pGroup)
+    udWorkerPool_FinishGroupTask(pTask->pGroup);
+  udWorkerPool_FreeTask(pPool, pTask);
+  udInterlockedPreDecrement(&pPool->pendingTasks);
+}
+
+// ----------------------------------------------------------------------------
+static void udWorkerPool_AddToHistogram(udWorkerPoolHistogram *pHistogram, uint64_t value)
+{
+  int bucket = 0;
+  while (bucket < UDWORKERPOOL_HISTOGRAM_BUCKETS - 1 && (value >> bucket) != 0)
+    ++bucket;
+  ++pHistogram->counts[bucket];
+  pHistogram->sum += value;
+}
+
+// ----------------------------------------------------------------------------
+// Each thread clears its own metrics the first time it records after recording restarts, so they only have one writer
+static udWorkerPoolThreadMetrics *udWorkerPool_GetThreadMetrics(udWorkerPool *pPool, udWorkerPoolThread *pThread)
+{
+  int32_t generation = pPool->metricsGeneration;
+  if (pThread->metrics.generation != generation)
+  {
+    memset((void*)&pThread->metrics, 0, sizeof(udWorkerPoolThreadMetrics));
+    udMemoryBarrier();
+    pThread->metrics.generation = generation;
+  }
+  return &pThread->metrics;
+}
+
+// ----------------------------------------------------------------------------
+// As udWorkerPool_RunTask, recording the queue depth and the task's wait and run times
+static void udWorkerPool_RunRecordedTask(udWorkerPool *pPool, udWorkerPoolThread *pThread, udWorkerPoolTask *pTask)
+{
+  udWorkerPoolThreadMetrics *pMetrics = udWorkerPool_GetThreadMetrics(pPool, pThread);
+  int32_t queued = 0;
+  for (int lane = 0; lane < udWPP_Count; ++lane)
+    queued += pPool->lanes[lane].queuedTasks;
+  udWorkerPool_AddToHistogram(&pMetrics->queueDepth, (uint64_t)udMax(queued, 0));
+
+  uint64_t start = udPerfCounterStart();
+  if (pTask->queuedTime) // Not if queued before recording started
+    udWorkerPool_AddToHistogram(&pMetrics->waitMicroseconds, (uint64_t)(udPerfCounterMilliseconds(pTask->queuedTime, start) * 1000.f));
+  udWorkerPool_RunTask(pPool, pTask);
+  udWorkerPool_AddToHistogram(&pMetrics->runMicroseconds, (uint64_t)(udPerfCounterMilliseconds(start) * 1000.f));
+}
+
 // ----------------------------------------------------------------------------
 // Author: Paul Fox, May 2015
 uint32_t udWorkerPool_DoWork(void *pPoolPtr)
@@ -44,35 +517,36 @@ uint32_t udWorkerPool_DoWork(void *pPoolPtr)
 
   udWorkerPoolThread *pThreadData = (udWorkerPoolThread*)pPoolPtr;
   udWorkerPool *pPool = pThreadData->pPool;
+  int idleRounds = 0;
 
-  udWorkerPoolTask currentTask;
-  int waitValue;
-
+  t_pWorkerThread = pThreadData;
   while (pPool->isRunning)
   {
-    waitValue = udWaitSemaphore(pPool->pSemaphore, 100);
-
-    if (waitValue != 0)
-      continue;
-
-    udInterlockedPreIncrement(&pPool->activeThreads);
-
-    if (udSafeDeque_PopFront(pPool->pQueuedTasks, &currentTask) != udR_Success)
+    udWorkerPoolTask *pTask = udWorkerPool_FindTask(pPool, pThreadData, &pThreadData->randomState);
+    if (!pTask && ++idleRounds < UDWORKERPOOL_SPIN_ROUNDS)
     {
-      udInterlockedPreIncrement(&pPool->activeThreads);
+      udYield();
       continue;
     }
 
-    if (currentTask.function)
-      currentTask.function(currentTask.pDataBlock);
-
-    if (currentTask.postFunction)
-      udSafeDeque_PushBack(pPool->pQueuedPostTasks, currentTask);
-    else if (currentTask.freeDataBlock)
-      udFree(currentTask.pDataBlock);
+    if (!pTask)
+    {
+      // Announced before the last look, so a task queued after it is sure to wake this thread
+      udInterlockedPreIncrement(&pPool->sleepingThreads);
+      pTask = udWorkerPool_FindTask(pPool, pThreadData, &pThreadData->randomState);
+      if (!pTask && pPool->recordMetrics)
+        ++udWorkerPool_GetThreadMetrics(pPool, pThreadData)->sleeps;
+      if (pTask || udWaitSemaphore(pPool->pSemaphore, 100) != 0)
+        udWorkerPool_CancelSleep(pPool);
+    }
 
-    udInterlockedPreDecrement(&pPool->activeThreads);
+    idleRounds = 0;
+    if (pTask && pPool->recordMetrics)
+      udWorkerPool_RunRecordedTask(pPool, pThreadData, pTask);
+    else if (pTask)
+      udWorkerPool_RunTask(pPool, pTask);
   }
+  t_pWorkerThread = nullptr;
 
   return 0;
 }
@@ -91,22 +565,42 @@ udResult udWorkerPool_Create(udWorkerPool **ppPool, uint8_t totalThreads, const
   UD_ERROR_NULL(pPool, udR_MemoryAllocationFailure);
 
   pPool->pSemaphore = udCreateSemaphore();
-  UD_ERROR_NULL(pPool, udR_MemoryAllocationFailure);
+  UD_ERROR_NULL(pPool->pSemaphore, udR_MemoryAllocationFailure);
 
-  UD_ERROR_CHECK(udSafeDeque_Create(&pPool->pQueuedTasks, 32));
+  for (int lane = 0; lane < udWPP_Count; ++lane)
+    UD_ERROR_CHECK(udSafeDeque_Create(&pPool->lanes[lane].pInjectedTasks, 32));
   UD_ERROR_CHECK(udSafeDeque_Create(&pPool->pQueuedPostTasks, 32));
+  UD_ERROR_CHECK(udWorkerPool_SetSchedule(pPool, udWPS_Strict));
+  pPool->taskPool.Init(256, true);
+
+  pPool->pTimerMutex = udCreateMutex();
+  UD_ERROR_NULL(pPool->pTimerMutex, udR_MemoryAllocationFailure);
+  pPool->pTimersChanged = udCreateConditionVariable();
+  UD_ERROR_NULL(pPool->pTimersChanged, udR_MemoryAllocationFailure);
+  UD_ERROR_CHECK(pPool->timerNodes.Init(64));
+  pPool->timerWakeTick = UINT64_MAX;
+  pPool->timerClockStart = udPerfCounterStart();
 
   pPool->isRunning = true;
   pPool->totalThreads = totalThreads;
   pPool->pThreadData = udAllocType(udWorkerPoolThread, pPool->totalThreads, udAF_Zero);
   UD_ERROR_NULL(pPool->pThreadData, udR_MemoryAllocationFailure);
 
+  // Every deque must exist before any thread can try to steal from it
   for (int i = 0; i < pPool->totalThreads; ++i)
   {
     pPool->pThreadData[i].pPool = pPool;
-    UD_ERROR_CHECK(udThread_Create(&pPool->pThreadData[i].pThread, udWorkerPool_DoWork, &pPool->pThreadData[i], udTCF_None, udTempStr("%s%d", pThreadNamePrefix, i)));
+    pPool->pThreadData[i].randomState = 2654435761u * (i + 1);
+    for (int lane = 0; lane < udWPP_Count; ++lane)
+    {
+      pPool->pThreadData[i].deques[lane].pRing = udWorkerPool_CreateRing(UDWORKERPOOL_RING_INITIAL_SIZE);
+      UD_ERROR_NULL(pPool->pThreadData[i].deques[lane].pRing, udR_MemoryAllocationFailure);
+    }
   }
 
+  for (int i = 0; i < pPool->totalThreads; ++i)
+    UD_ERROR_CHECK(udThread_Create(&pPool->pThreadData[i].pThread, udWorkerPool_DoWork, &pPool->pThreadData[i], udTCF_None, udTempStr("%s%d", pThreadNamePrefix, i)));
+
   result = udR_Success;
   *ppPool = pPool;
   pPool = nullptr;
@@ -129,57 +623,293 @@ void udWorkerPool_Destroy(udWorkerPool **ppPool)
 
   pPool->isRunning = false;
 
-  for (int i = 0; i < pPool->totalThreads; i++)
+  // Stopped first so no more timed tasks are queued, its mutex is held while checking isRunning before each wait
+  if (pPool->pTimerThread)
   {
-    udThread_Join(pPool->pThreadData[i].pThread);
-    udThread_Destroy(&pPool->pThreadData[i].pThread);
+    udLockMutex(pPool->pTimerMutex);
+    udSignalConditionVariable(pPool->pTimersChanged);
+    udReleaseMutex(pPool->pTimerMutex);
+    udThread_Join(pPool->pTimerThread);
+    udThread_Destroy(&pPool->pTimerThread);
   }
 
-  udWorkerPoolTask currentTask;
-  while (udSafeDeque_PopFront(pPool->pQueuedTasks, &currentTask) == udR_Success)
+  if (pPool->pThreadData)
   {
-    if (currentTask.freeDataBlock)
-      udFree(currentTask.pDataBlock);
+    udIncrementSemaphore(pPool->pSemaphore, pPool->totalThreads);
+    for (int i = 0; i < pPool->totalThreads; i++)
+    {
+      udThread_Join(pPool->pThreadData[i].pThread);
+      udThread_Destroy(&pPool->pThreadData[i].pThread);
+    }
   }
 
+  // With the threads gone every remaining task can be taken from the top of the deques
+  udWorkerPoolTask *pTask = nullptr;
+  for (int lane = 0; lane < udWPP_Count; ++lane)
+  {
+    for (int i = 0; pPool->pThreadData && i < pPool->totalThreads; i++)
+    {
+      udWorkerPoolDeque *pDeque = &pPool->pThreadData[i].deques[lane];
+      while (pDeque->pRing && (pTask = udWorkerPool_DequeSteal(pDeque)) != nullptr)
+        udWorkerPool_DropTask(pPool, pTask);
+      udWorkerPool_DestroyRings(pDeque);
+    }
+
+    while (udSafeDeque_PopFront(pPool->lanes[lane].pInjectedTasks, &pTask) == udR_Success)
+      udWorkerPool_DropTask(pPool, pTask);
+    udSafeDeque_Destroy(&pPool->lanes[lane].pInjectedTasks);
+  }
+
+  udWorkerPoolTask currentTask;
   while (udSafeDeque_PopFront(pPool->pQueuedPostTasks, &currentTask) == udR_Success)
   {
     if (currentTask.freeDataBlock)
       udFree(currentTask.pDataBlock);
   }
 
-  udSafeDeque_Destroy(&pPool->pQueuedTasks);
   udSafeDeque_Destroy(&pPool->pQueuedPostTasks);
   udDestroySemaphore(&pPool->pSemaphore);
+  pPool->taskPool.Deinit();
+  pPool->timerNodes.Deinit();
+  if (pPool->pTimersChanged)
+    udDestroyConditionVariable(&pPool->pTimersChanged);
+  udDestroyMutex(&pPool->pTimerMutex);
 
   udFree(pPool->pThreadData);
   udFree(pPool);
 }
 
 // ----------------------------------------------------------------------------
-// Author: Paul Fox, May 2015
-udResult udWorkerPool_AddTask(udWorkerPool *pPool, udWorkerPoolCallback func, void *pUserData /*= nullptr*/, bool clearMemory /*= true*/, udWorkerPoolCallback postFunction /*= nullptr*/)
+static udResult udWorkerPool_QueueTask(udWorkerPool *pPool, udWorkerPoolGroup *pGroup, udCancelToken *pToken, udWorkerPoolPriority priority, udWorkerPoolCallback func, void *pUserData, bool clearMemory, udWorkerPoolCallback postFunction)
 {
   udResult result = udR_Failure_;
-  udWorkerPoolTask tempTask;
+  udWorkerPoolTask *pTask = nullptr;
+  udWorkerPoolThread *pThread = t_pWorkerThread;
+  udWorkerPoolLane *pLane = nullptr;
 
   UD_ERROR_NULL(pPool, udR_InvalidParameter_);
-  UD_ERROR_NULL(pPool->pQueuedTasks, udR_NotInitialized_);
+  UD_ERROR_IF(priority < 0 || priority >= udWPP_Count, udR_InvalidParameter_);
   UD_ERROR_NULL(pPool->pQueuedPostTasks, udR_NotInitialized_);
   UD_ERROR_NULL(pPool->pSemaphore, udR_NotInitialized_);
   UD_ERROR_IF(!pPool->isRunning, udR_NotAllowed);
 
-  tempTask.function = func;
-  tempTask.postFunction = postFunction;
-  tempTask.pDataBlock = pUserData;
-  tempTask.freeDataBlock = clearMemory;
+  pTask = pPool->taskPool.Alloc();
+  UD_ERROR_NULL(pTask, udR_MemoryAllocationFailure);
+  new (pTask) udWorkerPoolTask{ std::move(func), std::move(postFunction), pUserData, clearMemory, priority, pGroup, udCancelToken_AddReference(pToken), pPool->recordMetrics ? udPerfCounterStart() : 0 };
+  if (pGroup)
+    udInterlockedPreIncrement(&pGroup->outstandingTasks);
+
+  // Tasks added by one of the pool's own threads stay local to it unless stolen
+  pLane = &pPool->lanes[priority];
+  udInterlockedPreIncrement(&pPool->pendingTasks);
+  udInterlockedMax(&pLane->peakQueuedTasks, udInterlockedPreIncrement(&pLane->queuedTasks));
+  if (pThread && pThread->pPool == pPool)
+    result = udWorkerPool_DequePush(&pThread->deques[priority], pTask);
+  else
+    result = udSafeDeque_PushBack(pLane->pInjectedTasks, pTask);
+
+  if (result != udR_Success)
+  {
+    udInterlockedPreDecrement(&pLane->queuedTasks);
+    udInterlockedPreDecrement(&pPool->pendingTasks);
+    pTask->freeDataBlock = false; // The caller still owns pUserData when the task couldn't be added
+    udWorkerPool_DropTask(pPool, pTask);
+    UD_ERROR_HANDLE();
+  }
+  udInterlockedPreIncrement(&pLane->addedTasks);
+  udWorkerPool_WakeThread(pPool);
+
+epilogue:
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+// Author: Paul Fox, May 2015
+udResult udWorkerPool_AddTask(udWorkerPool *pPool, udWorkerPoolCallback func, void *pUserData /*= nullptr*/, bool clearMemory /*= true*/, udWorkerPoolCallback postFunction /*= nullptr*/)
+{
+  return udWorkerPool_AddPriorityTask(pPool, udWPP_Normal, std::move(func), pUserData, clearMemory, std::move(postFunction));
+}
+
+// ----------------------------------------------------------------------------
+udResult udWorkerPool_AddPriorityTask(udWorkerPool *pPool, udWorkerPoolPriority priority, udWorkerPoolCallback func, void *pUserData /*= nullptr*/, bool clearMemory /*= true*/, udWorkerPoolCallback postFunction /*= nullptr*/)
+{
+  return udWorkerPool_QueueTask(pPool, nullptr, nullptr, priority, std::move(func), pUserData, clearMemory, std::move(postFunction));
+}
+
+// ----------------------------------------------------------------------------
+udResult udWorkerPool_AddCancellableTask(udWorkerPool *pPool, udCancelToken *pToken, udWorkerPoolPriority priority, udWorkerPoolCallback func, void *pUserData /*= nullptr*/, bool clearMemory /*= true*/, udWorkerPoolCallback postFunction /*= nullptr*/)
+{
+  if (pToken == nullptr)
+    return udR_InvalidParameter_;
+
+  return udWorkerPool_QueueTask(pPool, nullptr, pToken, priority, std::move(func), pUserData, clearMemory, std::move(postFunction));
+}
+
+// ----------------------------------------------------------------------------
+udResult udWorkerPool_AddGroupTask(udWorkerPoolGroup *pGroup, udWorkerPoolPriority priority, udWorkerPoolCallback func, void *pUserData /*= nullptr*/, bool clearMemory /*= true*/, udWorkerPoolCallback postFunction /*= nullptr*/)
+{
+  if (pGroup == nullptr)
+    return udR_InvalidParameter_;
+
+  return udWorkerPool_QueueTask(pGroup->pPool, pGroup, nullptr, priority, std::move(func), pUserData, clearMemory, std::move(postFunction));
+}
+
+// ----------------------------------------------------------------------------
+udResult udWorkerPool_CreateGroup(udWorkerPoolGroup **ppGroup, udWorkerPool *pPool)
+{
+  udResult result;
+  udWorkerPoolGroup *pGroup = nullptr;
+
+  UD_ERROR_NULL(ppGroup, udR_InvalidParameter_);
+  UD_ERROR_NULL(pPool, udR_InvalidParameter_);
 
-  UD_ERROR_CHECK(udSafeDeque_PushBack(pPool->pQueuedTasks, tempTask));
-  udIncrementSemaphore(pPool->pSemaphore);
+  pGroup = udAllocType(udWorkerPoolGroup, 1, udAF_Zero);
+  UD_ERROR_NULL(pGroup, udR_MemoryAllocationFailure);
+  pGroup->pPool = pPool;
+  pGroup->pMutex = udCreateMutex();
+  UD_ERROR_NULL(pGroup->pMutex, udR_MemoryAllocationFailure);
+  pGroup->pFinished = udCreateConditionVariable();
+  UD_ERROR_NULL(pGroup->pFinished, udR_MemoryAllocationFailure);
 
+  *ppGroup = pGroup;
+  pGroup = nullptr;
   result = udR_Success;
 
 epilogue:
+  udWorkerPool_DestroyGroup(&pGroup);
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+void udWorkerPool_DestroyGroup(udWorkerPoolGroup **ppGroup)
+{
+  if (ppGroup == nullptr || *ppGroup == nullptr)
+    return;
+
+  udWorkerPoolGroup *pGroup = *ppGroup;
+  *ppGroup = nullptr;
+
+  if (pGroup->pMutex && pGroup->pFinished)
+    udWorkerPool_WaitGroup(pGroup);
+
+  if (pGroup->pFinished)
+    udDestroyConditionVariable(&pGroup->pFinished);
+  udDestroyMutex(&pGroup->pMutex);
+  udFree(pGroup);
+}
+
+// ----------------------------------------------------------------------------
+udResult udWorkerPool_WaitGroup(udWorkerPoolGroup *pGroup, int waitMs /*= UDTHREAD_WAIT_INFINITE*/, bool helpWithTasks /*= false*/)
+{
+  udResult result = udR_Success;
+  uint64_t start = udPerfCounterStart();
+
+  if (pGroup == nullptr)
+    return udR_InvalidParameter_;
+
+  // Run queued tasks while there are any, they may well be the group's own
+  while (helpWithTasks && pGroup->outstandingTasks > 0 && udWorkerPool_TryDoWork(pGroup->pPool) == udR_Success)
+  {
+    if (waitMs != UDTHREAD_WAIT_INFINITE && udPerfCounterMilliseconds(start) >= waitMs)
+      break;
+  }
+
+  udLockMutex(pGroup->pMutex);
+  while (pGroup->outstandingTasks > 0)
+  {
+    int remainingMs = waitMs;
+    if (waitMs != UDTHREAD_WAIT_INFINITE)
+    {
+      remainingMs = waitMs - (int)udPerfCounterMilliseconds(start);
+      if (remainingMs <= 0)
+      {
+        result = udR_Timeout;
+        break;
+      }
+    }
+
+    ++pGroup->waitingThreads;
+    udWaitConditionVariable(pGroup->pFinished, pGroup->pMutex, remainingMs); // Timeouts and spurious wakes are handled by the loop
+    --pGroup->waitingThreads;
+  }
+  udReleaseMutex(pGroup->pMutex);
+
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+int udWorkerPool_GetGroupTaskCount(udWorkerPoolGroup *pGroup)
+{
+  return pGroup ? pGroup->outstandingTasks : 0;
+}
+
+// ----------------------------------------------------------------------------
+static void udWorkerPool_RangeTask(void *pData);
+
+// ----------------------------------------------------------------------------
+// Queues the upper half of the range while it can be split further, then runs the rest
+static void udWorkerPool_RunRange(udWorkerPoolRange range)
+{
+  udWorkerPoolParallelFor *pJob = range.pJob;
+  udWorkerPoolThread *pThread = t_pWorkerThread;
+
+  // The owner's thread was busy enough for it to be taken, so split it more finely
+  if (range.pOwner != pThread)
+    range.splits += UDWORKERPOOL_STEAL_SPLITS;
+
+  while (range.splits > 0 && (range.end - range.begin) / 2 >= pJob->grain)
+  {
+    size_t middle = range.begin + (range.end - range.begin) / 2;
+    udWorkerPoolRange *pUpper = udAllocType(udWorkerPoolRange, 1, udAF_None);
+    if (pUpper == nullptr)
+      break;
+
+    --range.splits;
+    *pUpper = { pJob, middle, range.end, range.splits, pThread };
+    if (udWorkerPool_AddGroupTask(pJob->pGroup, udWPP_Normal, udWorkerPool_RangeTask, pUpper) != udR_Success)
+    {
+      udFree(pUpper);
+      break;
+    }
+    range.end = middle;
+  }
+
+  pJob->body(range.begin, range.end);
+}
+
+// ----------------------------------------------------------------------------
+static void udWorkerPool_RangeTask(void *pData)
+{
+  udWorkerPool_RunRange(*(udWorkerPoolRange*)pData);
+}
+
+// ----------------------------------------------------------------------------
+udResult udWorkerPool_ParallelFor(udWorkerPool *pPool, size_t begin, size_t end, size_t grain, udCallback<void(size_t, size_t)> body)
+{
+  udResult result;
+  udWorkerPoolParallelFor job; // Safe on the stack as the group is waited on before returning
+  int splits = 0;
+
+  job.pGroup = nullptr;
+  UD_ERROR_IF(begin >= end, udR_Success);
+  job.grain = udMax(grain, (size_t)1);
+
+  if (udWorkerPool_GetThreadCount(pPool) == 0 || (end - begin) / 2 < job.grain)
+  {
+    body(begin, end);
+    UD_ERROR_SET(udR_Success);
+  }
+
+  UD_ERROR_CHECK(udWorkerPool_CreateGroup(&job.pGroup, pPool));
+  job.body = std::move(body);
+  while ((1 << splits) < (udWorkerPool_GetThreadCount(pPool) + 1) * UDWORKERPOOL_RANGES_PER_THREAD)
+    ++splits;
+
+  udWorkerPool_RunRange({ &job, begin, end, splits, t_pWorkerThread });
+  result = udWorkerPool_WaitGroup(job.pGroup, UDTHREAD_WAIT_INFINITE, true);
+
+epilogue:
+  udWorkerPool_DestroyGroup(&job.pGroup);
   return result;
 }
 
@@ -192,7 +922,6 @@ udResult udWorkerPool_DoPostWork(udWorkerPool *pPool, int processLimit /*= 0*/)
   int processedItems = 0;
 
   UD_ERROR_NULL(pPool, udR_InvalidParameter_);
-  UD_ERROR_NULL(pPool->pQueuedTasks, udR_NotInitialized_);
   UD_ERROR_NULL(pPool->pQueuedPostTasks, udR_NotInitialized_);
   UD_ERROR_NULL(pPool->pSemaphore, udR_NotInitialized_);
   UD_ERROR_IF(!pPool->isRunning, udR_NotAllowed);
@@ -222,9 +951,485 @@ bool udWorkerPool_HasActiveWorkers(udWorkerPool *pPool)
   if (pPool == nullptr)
     return false;
 
-  udLockMutex(pPool->pQueuedTasks->pMutex);
-  bool isActive = (pPool->activeThreads > 0 || pPool->pQueuedTasks->chunkedArray.length > 0);
-  udReleaseMutex(pPool->pQueuedTasks->pMutex);
+  return pPool->pendingTasks > 0;
+}
+
+// ----------------------------------------------------------------------------
+udResult udWorkerPool_TryDoWork(udWorkerPool *pPool)
+{
+  if (pPool == nullptr || pPool->pQueuedPostTasks == nullptr)
+    return udR_InvalidParameter_;
+
+  udWorkerPoolThread *pThread = t_pWorkerThread;
+  uint32_t randomState = (uint32_t)(uintptr_t)&pThread | 1; // Only for threads outside the pool
+  if (pThread && pThread->pPool != pPool)
+    pThread = nullptr;
+
+  udWorkerPoolTask *pTask = udWorkerPool_FindTask(pPool, pThread, pThread ? &pThread->randomState : &randomState);
+  if (!pTask)
+    return udR_NothingToDo;
+
+  udWorkerPool_RunTask(pPool, pTask);
+  return udR_Success;
+}
+
+// ----------------------------------------------------------------------------
+int udWorkerPool_GetThreadCount(udWorkerPool *pPool)
+{
+  return pPool ? pPool->totalThreads : 0;
+}
+
+// ----------------------------------------------------------------------------
+udResult udWorkerPool_SetSchedule(udWorkerPool *pPool, udWorkerPoolSchedule schedule, const uint8_t pWeights[udWPP_Count] /*= nullptr*/)
+{
+  static const uint8_t defaultWeights[udWPP_Count] = { 16, 4, 1 };
+  udResult result;
+
+  UD_ERROR_NULL(pPool, udR_InvalidParameter_);
+  UD_ERROR_IF(schedule != udWPS_Strict && schedule != udWPS_Weighted, udR_InvalidParameter_);
+  if (pWeights == nullptr)
+    pWeights = defaultWeights;
+  for (int lane = 0; lane < udWPP_Count; ++lane)
+    UD_ERROR_IF(pWeights[lane] == 0, udR_InvalidParameter_);
+
+  // Threads pick the new weights up the next time their credits run out
+  for (int lane = 0; lane < udWPP_Count; ++lane)
+    pPool->lanes[lane].weight = pWeights[lane];
+  pPool->schedule = schedule;
+  result = udR_Success;
+
+epilogue:
+  return result;
+}
 
-  return isActive;
+// ----------------------------------------------------------------------------
+udResult udWorkerPool_GetLaneMetrics(udWorkerPool *pPool, udWorkerPoolPriority priority, udWorkerPoolLaneMetrics *pMetrics)
+{
+  udResult result;
+  udWorkerPoolLane *pLane;
+
+  UD_ERROR_NULL(pPool, udR_InvalidParameter_);
+  UD_ERROR_NULL(pMetrics, udR_InvalidParameter_);
+  UD_ERROR_IF(priority < 0 || priority >= udWPP_Count, udR_InvalidParameter_);
+
+  pLane = &pPool->lanes[priority];
+  pMetrics->queuedTasks = pLane->queuedTasks;
+  pMetrics->peakQueuedTasks = pLane->peakQueuedTasks;
+  pMetrics->addedTasks = (uint32_t)pLane->addedTasks;
+  pMetrics->completedTasks = (uint32_t)pLane->completedTasks;
+  pMetrics->cancelledTasks = (uint32_t)pLane->cancelledTasks;
+  result = udR_Success;
+
+epilogue:
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+// Milliseconds since the pool was created, with pTimerMutex held
+static uint64_t udWorkerPool_TimerNow(udWorkerPool *pPool)
+{
+  uint64_t now = udPerfCounterStart();
+  uint64_t elapsedMs = (uint64_t)udPerfCounterMilliseconds(pPool->timerClockStart, now);
+  uint64_t ticks = pPool->timerClockTicks + elapsedMs;
+
+  // Loses less than a millisecond an hour
+  if (elapsedMs >= UDWORKERPOOL_TIMER_REBASE_MS)
+  {
+    pPool->timerClockTicks = ticks;
+    pPool->timerClockStart = now;
+  }
+  return ticks;
+}
+
+// ----------------------------------------------------------------------------
+// Links the node into the lowest level whose slots reach its expiry from the current tick. Each level's slots are 64 times
+// longer than those of the level below, and a slot above level 0 is cascaded down into the levels below as the wheel reaches it
+static void udWorkerPool_InsertTimer(udWorkerPool *pPool, udWorkerPoolTimerNode *pNode)
+{
+  const uint64_t wheelTicks = (uint64_t)1 << (UDWORKERPOOL_TIMER_SLOT_BITS * UDWORKERPOOL_TIMER_LEVELS);
+  uint64_t placed = udMax(pNode->expiry, pPool->timerTick);
+  if (placed - pPool->timerTick >= wheelTicks)
+    placed = pPool->timerTick + wheelTicks - 1; // Beyond the wheel, so waits in the top level to be placed again
+
+  int level = 0;
+  while (((placed - pPool->timerTick) >> (UDWORKERPOOL_TIMER_SLOT_BITS * (level + 1))) != 0)
+    ++level;
+  int slot = (int)(placed >> (UDWORKERPOOL_TIMER_SLOT_BITS * level)) & (UDWORKERPOOL_TIMER_SLOTS - 1);
+
+  udWorkerPoolTimerNode **ppHead = &pPool->pTimerSlots[level][slot];
+  pNode->level = (uint8_t)level;
+  pNode->slot = (uint8_t)slot;
+  pNode->pPrevious = nullptr;
+  pNode->pNext = *ppHead;
+  if (*ppHead)
+    (*ppHead)->pPrevious = pNode;
+  *ppHead = pNode;
+  pNode->inWheel = true;
+  pPool->occupiedTimerSlots[level] |= (uint64_t)1 << slot;
+}
+
+// ----------------------------------------------------------------------------
+static void udWorkerPool_RemoveTimer(udWorkerPool *pPool, udWorkerPoolTimerNode *pNode)
+{
+  if (pNode->pPrevious)
+    pNode->pPrevious->pNext = pNode->pNext;
+  else
+    pPool->pTimerSlots[pNode->level][pNode->slot] = pNode->pNext;
+  if (pNode->pNext)
+    pNode->pNext->pPrevious = pNode->pPrevious;
+
+  if (pPool->pTimerSlots[pNode->level][pNode->slot] == nullptr)
+    pPool->occupiedTimerSlots[pNode->level] &= ~((uint64_t)1 << pNode->slot);
+  pNode->inWheel = false;
+}
+
+// ----------------------------------------------------------------------------
+// Unlinks every node in the slot, returning the first
+static udWorkerPoolTimerNode *udWorkerPool_TakeTimerSlot(udWorkerPool *pPool, int level, int slot)
+{
+  udWorkerPoolTimerNode *pFirst = pPool->pTimerSlots[level][slot];
+  pPool->pTimerSlots[level][slot] = nullptr;
+  pPool->occupiedTimerSlots[level] &= ~((uint64_t)1 << slot);
+  for (udWorkerPoolTimerNode *pNode = pFirst; pNode; pNode = pNode->pNext)
+    pNode->inWheel = false;
+  return pFirst;
+}
+
+// ----------------------------------------------------------------------------
+static void udWorkerPool_FreeTimer(udWorkerPool *pPool, udWorkerPoolTimerNode *pNode)
+{
+  pNode->function = udWorkerPoolCallback();
+  if (++pNode->generation == 0)
+    pNode->generation = 1;
+  pNode->pNext = pPool->pFreeTimers;
+  pPool->pFreeTimers = pNode;
+}
+
+// ----------------------------------------------------------------------------
+// Runs on a worker thread each time a timed task is due
+static void udWorkerPool_TimerTask(void *pData)
+{
+  udWorkerPoolTimerNode *pNode = (udWorkerPoolTimerNode*)pData;
+  udWorkerPool *pPool = pNode->pPool;
+
+  udLockMutex(pPool->pTimerMutex);
+  bool cancelled = pNode->cancelled;
+  udReleaseMutex(pPool->pTimerMutex);
+
+  // The node is kept until this run is finished, even if the task is cancelled meanwhile
+  if (!cancelled && pNode->function)
+    pNode->function(pNode->pUserData);
+
+  udLockMutex(pPool->pTimerMutex);
+  pNode->runQueued = false;
+  if (!pNode->inWheel)
+    udWorkerPool_FreeTimer(pPool, pNode);
+  udReleaseMutex(pPool->pTimerMutex);
+}
+
+// ----------------------------------------------------------------------------
+// Queues a run of a task taken from the wheel, putting a periodic task back for its next period
+static void udWorkerPool_FireTimer(udWorkerPool *pPool, udWorkerPoolTimerNode *pNode, uint64_t now)
+{
+  if (!pNode->runQueued)
+    pNode->runQueued = (udWorkerPool_QueueTask(pPool, pNode->pGroup, nullptr, pNode->priority, udWorkerPool_TimerTask, pNode, false, nullptr) == udR_Success);
+
+  if (pNode->periodMs > 0)
+  {
+    // Periods missed while the thread was held up are skipped rather than run back to back
+    pNode->expiry += pNode->periodMs;
+    if (pNode->expiry <= now)
+      pNode->expiry = now + pNode->periodMs;
+    udWorkerPool_InsertTimer(pPool, pNode);
+  }
+  else if (!pNode->runQueued)
+  {
+    udWorkerPool_FreeTimer(pPool, pNode);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Processes every tick up to now, skipping to the end of the level 0 slots when none of those left have timers in them
+static void udWorkerPool_AdvanceTimers(udWorkerPool *pPool, uint64_t now)
+{
+  const uint64_t slotMask = UDWORKERPOOL_TIMER_SLOTS - 1;
+
+  while (pPool->timerTick <= now)
+  {
+    uint64_t tick = pPool->timerTick;
+
+    int topLevel = 0;
+    while (topLevel + 1 < UDWORKERPOOL_TIMER_LEVELS && (tick & (((uint64_t)1 << (UDWORKERPOOL_TIMER_SLOT_BITS * (topLevel + 1))) - 1)) == 0)
+      ++topLevel;
+    for (int level = topLevel; level > 0; --level)
+    {
+      udWorkerPoolTimerNode *pNode = udWorkerPool_TakeTimerSlot(pPool, level, (int)((tick >> (UDWORKERPOOL_TIMER_SLOT_BITS * level)) & slotMask));
+      while (pNode)
+      {
+        udWorkerPoolTimerNode *pNext = pNode->pNext;
+        udWorkerPool_InsertTimer(pPool, pNode);
+        pNode = pNext;
+      }
+    }
+
+    udWorkerPoolTimerNode *pNode = udWorkerPool_TakeTimerSlot(pPool, 0, (int)(tick & slotMask));
+    while (pNode)
+    {
+      udWorkerPoolTimerNode *pNext = pNode->pNext;
+      udWorkerPool_FireTimer(pPool, pNode, now);
+      pNode = pNext;
+    }
+
+    uint64_t next = tick + 1;
+    if (((pPool->occupiedTimerSlots[0] >> (tick & slotMask)) >> 1) == 0)
+      next = (tick | slotMask) + 1;
+    pPool->timerTick = udMin(next, now + 1);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// The first tick at which a level 0 slot fires or a higher slot with timers in it cascades, UINT64_MAX if there are none
+static uint64_t udWorkerPool_NextTimerTick(udWorkerPool *pPool)
+{
+  uint64_t wakeTick = UINT64_MAX;
+
+  for (int level = 0; level < UDWORKERPOOL_TIMER_LEVELS; ++level)
+  {
+    uint64_t occupied = pPool->occupiedTimerSlots[level];
+    if (occupied == 0)
+      continue;
+
+    int shift = UDWORKERPOOL_TIMER_SLOT_BITS * level;
+    uint64_t slotTicks = (uint64_t)1 << shift;
+    uint64_t first = (pPool->timerTick + slotTicks - 1) & ~(slotTicks - 1);
+    int current = (int)(first >> shift) & (UDWORKERPOOL_TIMER_SLOTS - 1);
+    int distance = 0;
+    while ((occupied & ((uint64_t)1 << ((current + distance) & (UDWORKERPOOL_TIMER_SLOTS - 1)))) == 0)
+      ++distance;
+    wakeTick = udMin(wakeTick, first + ((uint64_t)distance << shift));
+  }
+
+  return wakeTick;
+}
+
+// ----------------------------------------------------------------------------
+static uint32_t udWorkerPool_TimerThread(void *pPoolPtr)
+{
+  udWorkerPool *pPool = (udWorkerPool*)pPoolPtr;
+
+  udLockMutex(pPool->pTimerMutex);
+  while (pPool->isRunning)
+  {
+    uint64_t now = udWorkerPool_TimerNow(pPool);
+    udWorkerPool_AdvanceTimers(pPool, now);
+
+    int waitMs = UDTHREAD_WAIT_INFINITE;
+    pPool->timerWakeTick = udWorkerPool_NextTimerTick(pPool);
+    if (pPool->timerWakeTick != UINT64_MAX)
+      waitMs = (int)udMin(pPool->timerWakeTick - now, (uint64_t)INT32_MAX);
+    udWaitConditionVariable(pPool->pTimersChanged, pPool->pTimerMutex, waitMs); // Signalled when an earlier task is added
+  }
+  udReleaseMutex(pPool->pTimerMutex);
+
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+udResult udWorkerPool_AddTimedTask(udWorkerPool *pPool, uint64_t *pTimer, uint32_t delayMs, uint32_t periodMs, udWorkerPoolCallback func, void *pUserData /*= nullptr*/, udWorkerPoolPriority priority /*= udWPP_Normal*/, udWorkerPoolGroup *pGroup /*= nullptr*/)
+{
+  udResult result;
+  udWorkerPoolTimerNode *pNode = nullptr;
+  bool locked = false;
+
+  UD_ERROR_NULL(pPool, udR_InvalidParameter_);
+  UD_ERROR_IF(priority < 0 || priority >= udWPP_Count, udR_InvalidParameter_);
+  UD_ERROR_IF(pGroup && pGroup->pPool != pPool, udR_InvalidParameter_);
+  UD_ERROR_NULL(pPool->pTimerMutex, udR_NotInitialized_);
+  UD_ERROR_IF(!pPool->isRunning, udR_NotAllowed);
+
+  udLockMutex(pPool->pTimerMutex);
+  locked = true;
+
+  if (pPool->pTimerThread == nullptr)
+    UD_ERROR_CHECK(udThread_Create(&pPool->pTimerThread, udWorkerPool_TimerThread, pPool, udTCF_None, "udWorkerPoolTimer"));
+
+  if (pPool->pFreeTimers)
+  {
+    pNode = pPool->pFreeTimers;
+    pPool->pFreeTimers = pNode->pNext;
+  }
+  else
+  {
+    UD_ERROR_IF(pPool->timerNodes.length >= UINT32_MAX, udR_CountExceeded);
+    UD_ERROR_CHECK(pPool->timerNodes.PushBack(&pNode));
+    pNode->pPool = pPool;
+    pNode->generation = 1;
+    pNode->index = (uint32_t)(pPool->timerNodes.length - 1);
+  }
+
+  pNode->expiry = udWorkerPool_TimerNow(pPool) + delayMs;
+  pNode->periodMs = periodMs;
+  pNode->runQueued = false;
+  pNode->cancelled = false;
+  pNode->priority = priority;
+  pNode->pGroup = pGroup;
+  pNode->function = std::move(func);
+  pNode->pUserData = pUserData;
+  udWorkerPool_InsertTimer(pPool, pNode);
+
+  if (pNode->expiry < pPool->timerWakeTick)
+    udSignalConditionVariable(pPool->pTimersChanged);
+  if (pTimer)
+    *pTimer = ((uint64_t)pNode->generation << 32) | pNode->index;
+  result = udR_Success;
+
+epilogue:
+  if (locked)
+    udReleaseMutex(pPool->pTimerMutex);
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+udResult udWorkerPool_CancelTimedTask(udWorkerPool *pPool, uint64_t timer)
+{
+  udResult result;
+  udWorkerPoolTimerNode *pNode = nullptr;
+  uint32_t index = (uint32_t)timer;
+  bool locked = false;
+
+  UD_ERROR_NULL(pPool, udR_InvalidParameter_);
+  UD_ERROR_NULL(pPool->pTimerMutex, udR_NotInitialized_);
+
+  udLockMutex(pPool->pTimerMutex);
+  locked = true;
+
+  UD_ERROR_IF(index >= pPool->timerNodes.length, udR_ObjectNotFound);
+  pNode = &pPool->timerNodes[index];
+  UD_ERROR_IF(pNode->generation != (uint32_t)(timer >> 32) || pNode->cancelled, udR_ObjectNotFound);
+
+  if (pNode->inWheel)
+    udWorkerPool_RemoveTimer(pPool, pNode);
+  if (pNode->runQueued)
+    pNode->cancelled = true; // Freed once the queued run finishes
+  else
+    udWorkerPool_FreeTimer(pPool, pNode);
+  result = udR_Success;
+
+epilogue:
+  if (locked)
+    udReleaseMutex(pPool->pTimerMutex);
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+udResult udWorkerPool_SetMetricsEnabled(udWorkerPool *pPool, bool enabled)
+{
+  udResult result;
+
+  UD_ERROR_NULL(pPool, udR_InvalidParameter_);
+  UD_ERROR_IF(enabled == pPool->recordMetrics, udR_Success);
+
+  // Nothing here writes to the threads' metrics, each clears its own as it next records and sees the new generation
+  if (enabled)
+  {
+    pPool->metricsStart = udPerfCounterStart();
+    udInterlockedPreIncrement(&pPool->metricsGeneration);
+  }
+  pPool->recordMetrics = enabled;
+  result = udR_Success;
+
+epilogue:
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+static udResult udWorkerPool_ReportHistogram(udJSON *pOut, const char *pName, const uint64_t counts[UDWORKERPOOL_HISTOGRAM_BUCKETS], uint64_t sum)
+{
+  udResult result;
+  uint64_t total = 0;
+  int used = 0;
+
+  for (int bucket = 0; bucket < UDWORKERPOOL_HISTOGRAM_BUCKETS; ++bucket)
+  {
+    total += counts[bucket];
+    if (counts[bucket])
+      used = bucket + 1;
+  }
+
+  // Empty buckets past the last used are left out
+  UD_ERROR_CHECK(pOut->Set("%s.count = %llu", pName, (unsigned long long)total));
+  UD_ERROR_CHECK(pOut->Set("%s.sum = %llu", pName, (unsigned long long)sum));
+  UD_ERROR_CHECK(pOut->Set("%s.buckets = []", pName));
+  for (int bucket = 0; bucket < used; ++bucket)
+    UD_ERROR_CHECK(pOut->Set("%s.buckets[] = %llu", pName, (unsigned long long)counts[bucket]));
+  result = udR_Success;
+
+epilogue:
+  return result;
+}
+
+// ----------------------------------------------------------------------------
+udResult udWorkerPool_ReportMetrics(udWorkerPool *pPool, udJSON *pReport)
+{
+  struct Totals
+  {
+    uint64_t counts[UDWORKERPOOL_HISTOGRAM_BUCKETS];
+    uint64_t sum;
+  };
+
+  static const char *pHistogramNames[] = { "queueDepth", "waitMicroseconds", "runMicroseconds" };
+  udResult result;
+  udJSON thread;
+  Totals totals[udLengthOf(pHistogramNames)] = {};
+  uint64_t totalSleeps = 0;
+  double elapsedMs = 0.0;
+
+  UD_ERROR_NULL(pPool, udR_InvalidParameter_);
+  UD_ERROR_NULL(pReport, udR_InvalidParameter_);
+
+  if (pPool->recordMetrics)
+    elapsedMs = udPerfCounterMilliseconds(pPool->metricsStart);
+
+  pReport->Destroy();
+  UD_ERROR_CHECK(pReport->Set("recording = %s", pPool->recordMetrics ? "true" : "false"));
+  UD_ERROR_CHECK(pReport->Set("elapsedMs = %f", elapsedMs));
+  UD_ERROR_CHECK(pReport->Set("threads = []"));
+  for (int i = 0; i < pPool->totalThreads; ++i)
+  {
+    // A thread yet to record since recording last started still holds the previous recording's counts
+    const udWorkerPoolThreadMetrics *pMetrics = &pPool->pThreadData[i].metrics;
+    const udWorkerPoolHistogram *pHistograms[udLengthOf(pHistogramNames)] = { &pMetrics->queueDepth, &pMetrics->waitMicroseconds, &pMetrics->runMicroseconds };
+    bool current = (pMetrics->generation == pPool->metricsGeneration);
+
+    thread.Destroy();
+    for (size_t h = 0; h < udLengthOf(pHistogramNames); ++h)
+    {
+      Totals copy;
+      for (int bucket = 0; bucket < UDWORKERPOOL_HISTOGRAM_BUCKETS; ++bucket)
+      {
+        copy.counts[bucket] = current ? pHistograms[h]->counts[bucket] : 0;
+        totals[h].counts[bucket] += copy.counts[bucket];
+      }
+      copy.sum = current ? pHistograms[h]->sum : 0;
+      totals[h].sum += copy.sum;
+      UD_ERROR_CHECK(udWorkerPool_ReportHistogram(&thread, pHistogramNames[h], copy.counts, copy.sum));
+    }
+
+    // Busy for the time spent running tasks, out of the time recorded
+    uint64_t runMicroseconds = current ? pMetrics->runMicroseconds.sum : 0;
+    uint64_t sleeps = current ? pMetrics->sleeps : 0;
+    UD_ERROR_CHECK(thread.Set("sleeps = %llu", (unsigned long long)sleeps));
+    UD_ERROR_CHECK(thread.Set("utilisation = %f", elapsedMs > 0.0 ? udMin(runMicroseconds / (elapsedMs * 1000.0), 1.0) : 0.0));
+    totalSleeps += sleeps;
+    UD_ERROR_CHECK(pReport->Set(&thread, "threads[]"));
+  }
+
+  for (size_t h = 0; h < udLengthOf(pHistogramNames); ++h)
+    UD_ERROR_CHECK(udWorkerPool_ReportHistogram(pReport, udTempStr("total.%s", pHistogramNames[h]), totals[h].counts, totals[h].sum));
+  UD_ERROR_CHECK(pReport->Set("total.sleeps = %llu", (unsigned long long)totalSleeps));
+  result = udR_Success;
+
+epilogue:
+  thread.Destroy();
+  return result;
 }
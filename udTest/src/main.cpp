@@ -1,6 +1,8 @@
 #include "gtest/gtest.h"
 
 #include "udPlatform.h"
+#include "udAllocator.h"
+#include "udScratch.h"
 #include "udThread.h"
 #include "udFile.h"
 
@@ -21,6 +23,8 @@ int main(int argc, char **argv)
   int testResult = 0;
   emscripten_set_main_loop_arg([](void *pArg) { int *pTestResult = (int*)pArg; *pTestResult = RUN_ALL_TESTS(); emscripten_cancel_main_loop(); }, &testResult, 60, 1);
   udThread_DestroyCached(); // Destroy cached threads to prevent reporting of memory leak
+  udScratch_ThreadExit(); // The main thread's scratch isn't released by the process ending
+  udAllocator_Deinit(); // Return what the allocator backend still holds to the system
 
   return testResult;
 }
@@ -40,6 +44,8 @@ int main(int argc, char **argv)
 
   int testResult = RUN_ALL_TESTS();
   udThread_DestroyCached(); // Destroy cached threads to prevent reporting of memory leak
+  udScratch_ThreadExit(); // The main thread's scratch isn't released by the process ending
+  udAllocator_Deinit(); // Return what the allocator backend still holds to the system
 
 #if UDPLATFORM_WINDOWS && UD_DEBUG
   udSleep(500); // A little extra time for threads to destroy
@@ -0,0 +1,91 @@
+#include "gtest/gtest.h"
+#include "udArena.h"
+#include "udChunkedArray.h"
+#include "udStringUtil.h"
+
+// ----------------------------------------------------------------------------
+TEST(udArenaTests, Validate)
+{
+  udArena *pArena = nullptr;
+  EXPECT_EQ(udR_InvalidParameter_, udArena_Create(nullptr));
+  ASSERT_EQ(udR_Success, udArena_Create(&pArena, 1024));
+
+  // Allocations are aligned and don't overlap
+  uint8_t *pA = (uint8_t*)udArena_Alloc(pArena, 3);
+  uint8_t *pB = (uint8_t*)udArena_Alloc(pArena, 100, udAF_Zero, 64);
+  ASSERT_NE(nullptr, pA);
+  ASSERT_NE(nullptr, pB);
+  EXPECT_EQ(0U, (uintptr_t)pA % (2 * sizeof(void*)));
+  EXPECT_EQ(0U, (uintptr_t)pB % 64);
+  EXPECT_TRUE(pB >= pA + 3);
+  for (int i = 0; i < 100; ++i)
+    EXPECT_EQ(0, pB[i]);
+  EXPECT_EQ(nullptr, udArena_Alloc(pArena, 8, udAF_None, 3)); // Alignment must be a power of 2
+
+  // Allocations larger than a block get a block of their own
+  uint8_t *pLarge = udArenaAllocType(pArena, uint8_t, 4096, udAF_Zero);
+  ASSERT_NE(nullptr, pLarge);
+  pLarge[4095] = 1;
+
+  const char *pStr = udArena_Strdup(pArena, "Hello World");
+  EXPECT_STREQ("Hello World", pStr);
+  EXPECT_STREQ("Hello", udArena_Strdup(pArena, "Hello World", 5));
+  EXPECT_EQ(nullptr, udArena_Strdup(pArena, nullptr));
+
+  size_t used, reserved;
+  udArena_GetUsage(pArena, &used, &reserved);
+  EXPECT_GE(used, 3U + 100 + 4096 + 12 + 6);
+  EXPECT_GE(reserved, used);
+
+  // Rewinding to a mark hands the same memory out again
+  udArenaMark mark = udArena_GetMark(pArena);
+  void *pMarked = udArena_Alloc(pArena, 16);
+  udArena_ResetToMark(pArena, mark);
+  EXPECT_EQ(pMarked, udArena_Alloc(pArena, 16));
+
+  // Reset keeps the blocks, so refilling the arena doesn't grow it
+  udArena_Reset(pArena);
+  udArena_GetUsage(pArena, &used, nullptr);
+  EXPECT_EQ(0U, used);
+  size_t reservedBefore = reserved;
+  for (int i = 0; i < 5; ++i)
+    EXPECT_NE(nullptr, udArena_Alloc(pArena, 100));
+  udArena_GetUsage(pArena, nullptr, &reserved);
+  EXPECT_EQ(reservedBefore, reserved);
+
+  udArena_Destroy(&pArena);
+  EXPECT_EQ(nullptr, pArena);
+  udArena_Destroy(&pArena); // Destroying null is safe
+}
+
+// ----------------------------------------------------------------------------
+TEST(udArenaTests, ChunkedArray)
+{
+  udArena *pArena = nullptr;
+  ASSERT_EQ(udR_Success, udArena_Create(&pArena));
+
+  udChunkedArray<int> array;
+  ASSERT_EQ(udR_Success, array.Init(16, pArena));
+  for (int i = 0; i < 1000; ++i)
+    EXPECT_EQ(udR_Success, array.PushBack(i));
+  for (int i = 1; i <= 100; ++i)
+    EXPECT_EQ(udR_Success, array.PushFront(-i));
+
+  EXPECT_EQ(1100U, array.length);
+  for (int i = 0; i < 1100; ++i)
+    EXPECT_EQ(i - 100, array[i]);
+
+  // Compacting storage owned by the arena leaves the elements where they are
+  size_t inset = array.inset;
+  EXPECT_EQ(udR_Success, array.Compact());
+  EXPECT_EQ(inset, array.inset);
+  EXPECT_EQ(-100, array[0]);
+  EXPECT_EQ(999, array[1099]);
+
+  size_t used;
+  udArena_GetUsage(pArena, &used, nullptr);
+  EXPECT_GE(used, 1100 * sizeof(int));
+
+  array.Deinit(); // Releases nothing back to the heap, the arena owns the storage
+  udArena_Destroy(&pArena);
+}
@@ -32,3 +32,45 @@ TEST(udAsyncJobTests, Validation)
 
   udAsyncJob_Destroy(&pAsyncJob);
 }
+
+udResult udAsyncJobTestsFuncPoll(udSemaphore *pStarted, udAsyncJob *pAsyncJob)
+{
+  UDASYNC_CALL1(udAsyncJobTestsFuncPoll, udSemaphore *, pStarted);
+
+  udIncrementSemaphore(pStarted);
+  while (!udCancelToken_IsCancelled(udCancelToken_GetCurrent()))
+    udYield();
+  return udR_Cancelled;
+}
+
+TEST(udAsyncJobTests, Cancel)
+{
+  udAsyncJob *pAsyncJob = nullptr;
+  udSemaphore *pStarted = udCreateSemaphore();
+
+  EXPECT_EQ(nullptr, udAsyncJob_GetCancelToken(nullptr));
+  udAsyncJob_Cancel(nullptr);
+
+  ASSERT_EQ(udR_Success, udAsyncJob_Create(&pAsyncJob));
+  EXPECT_NE(nullptr, udAsyncJob_GetCancelToken(pAsyncJob));
+
+  // Cancelled while running, the call polls its token
+  EXPECT_EQ(udR_Success, udAsyncJobTestsFuncPoll(pStarted, pAsyncJob));
+  EXPECT_EQ(0, udWaitSemaphore(pStarted));
+  udAsyncJob_Cancel(pAsyncJob);
+  EXPECT_EQ(udR_Cancelled, udAsyncJob_GetResult(pAsyncJob));
+
+  // The next call starts with the token reset
+  EXPECT_EQ(udR_Success, udAsyncJobTestsFuncOld(2, pAsyncJob));
+  EXPECT_EQ(udR_Count, udAsyncJob_GetResult(pAsyncJob));
+
+  // Cancelled before the call starts, the function isn't run
+  udAsyncJob_SetPending(pAsyncJob);
+  udAsyncJob_Cancel(pAsyncJob);
+  EXPECT_FALSE(udAsyncJob_BeginCall(pAsyncJob));
+  EXPECT_EQ(udR_Cancelled, udAsyncJob_GetResult(pAsyncJob));
+  EXPECT_EQ(nullptr, udCancelToken_GetCurrent());
+
+  udAsyncJob_Destroy(&pAsyncJob);
+  udDestroySemaphore(&pStarted);
+}
@@ -33,4 +33,9 @@ TEST(udCallbackTests, Validation)
 
   TestCallback copyFunc = basic;
   EXPECT_EQ(basic(2), copyFunc(2));
+
+  TestCallback moveFunc;
+  moveFunc = std::move(valCapture);
+  EXPECT_EQ(6, moveFunc(2));
+  EXPECT_FALSE(valCapture);
 }
@@ -0,0 +1,35 @@
+#include "gtest/gtest.h"
+#include "udCancelToken.h"
+
+TEST(udCancelTokenTests, Validate)
+{
+  udCancelToken *pToken = nullptr;
+
+  EXPECT_EQ(udR_InvalidParameter_, udCancelToken_Create(nullptr));
+  EXPECT_FALSE(udCancelToken_IsCancelled(nullptr));
+  udCancelToken_Cancel(nullptr);
+  EXPECT_EQ(nullptr, udCancelToken_AddReference(nullptr));
+
+  ASSERT_EQ(udR_Success, udCancelToken_Create(&pToken));
+  EXPECT_FALSE(udCancelToken_IsCancelled(pToken));
+  udCancelToken_Cancel(pToken);
+  EXPECT_TRUE(udCancelToken_IsCancelled(pToken));
+  udCancelToken_Reset(pToken);
+  EXPECT_FALSE(udCancelToken_IsCancelled(pToken));
+
+  // Current tokens nest
+  EXPECT_EQ(nullptr, udCancelToken_GetCurrent());
+  EXPECT_EQ(nullptr, udCancelToken_SetCurrent(pToken));
+  EXPECT_EQ(pToken, udCancelToken_GetCurrent());
+  EXPECT_EQ(pToken, udCancelToken_SetCurrent(nullptr));
+  EXPECT_EQ(nullptr, udCancelToken_GetCurrent());
+
+  // Still usable through a reference held after the creator's is released
+  udCancelToken *pHeld = udCancelToken_AddReference(pToken);
+  udCancelToken_Destroy(&pToken);
+  EXPECT_EQ(nullptr, pToken);
+  udCancelToken_Cancel(pHeld);
+  EXPECT_TRUE(udCancelToken_IsCancelled(pHeld));
+  udCancelToken_Destroy(&pHeld);
+  udCancelToken_Destroy(&pHeld);
+}
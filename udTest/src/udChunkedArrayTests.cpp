@@ -1,5 +1,6 @@
 #include "gtest/gtest.h"
 #include "udChunkedArray.h"
+#include "udStringUtil.h"
 
 TEST(udChunkedArrayTests, ToArray)
 {
@@ -187,3 +188,317 @@ TEST(udChunkedArrayTests, Iterator)
   array.Deinit();
 }
 
+
+TEST(udChunkedArrayTests, Ranges)
+{
+  udChunkedArray<int> array;
+  int values[100];
+  for (int i = 0; i < (int)udLengthOf(values); ++i)
+    values[i] = i;
+
+  array.Init(8);
+  array.PushBack(-1);
+  EXPECT_EQ(udR_Success, array.PushBackRange(values, udLengthOf(values)));
+  array.PopFront();
+  EXPECT_EQ(1U, array.inset);
+  ASSERT_EQ(100U, array.length);
+  for (int i = 0; i < 100; ++i)
+    EXPECT_EQ(i, array[i]);
+
+  // Spans never cross a chunk boundary, and together cover the range in order
+  size_t spanCount = 0;
+  int expected = 10;
+  for (udChunkedArraySpan<int> span : array.Spans(10, 50))
+  {
+    EXPECT_LE(span.count, array.GetElementRunLength(expected));
+    for (size_t i = 0; i < span.count; ++i)
+      EXPECT_EQ(expected++, span.pData[i]);
+    ++spanCount;
+  }
+  EXPECT_EQ(60, expected);
+  EXPECT_EQ(7U, spanCount);
+
+  const udChunkedArray<int> &constArray = array;
+  size_t total = 0;
+  for (udChunkedArraySpan<const int> span : constArray.Spans())
+    total += span.count;
+  EXPECT_EQ(100U, total);
+
+  // Pops return elements in array order, and no more than are available
+  int popped[100];
+  EXPECT_EQ(20U, array.PopFrontRange(popped, 20));
+  EXPECT_EQ(0, memcmp(popped, values, 20 * sizeof(int)));
+  EXPECT_EQ(5U, array.PopBackRange(popped, 5));
+  EXPECT_EQ(0, memcmp(popped, values + 95, 5 * sizeof(int)));
+  EXPECT_EQ(0U, array.PopFrontRange(popped, 0));
+  EXPECT_EQ(3U, array.PopFrontRange(nullptr, 3));
+  EXPECT_EQ(23, array[0]);
+  EXPECT_EQ(94, array[array.length - 1]);
+  EXPECT_EQ(72U, array.PopBackRange(popped, 1000));
+  EXPECT_EQ(0, memcmp(popped, values + 23, 72 * sizeof(int)));
+  EXPECT_EQ(0U, array.length);
+
+  // Used as a FIFO, emptied chunks are reused at the back
+  size_t chunkCount = array.chunkCount;
+  for (int i = 0; i < 100; ++i)
+  {
+    EXPECT_EQ(udR_Success, array.PushBackRange(values, 37));
+    EXPECT_EQ(37U, array.PopFrontRange(popped, 37));
+    EXPECT_EQ(0, memcmp(popped, values, 37 * sizeof(int)));
+  }
+  EXPECT_EQ(chunkCount, array.chunkCount);
+
+  array.Deinit();
+}
+
+TEST(udChunkedArrayTests, RecycleAndShrink)
+{
+  udChunkedArray<int> array;
+  array.Init(8);
+
+  // As a FIFO holding up to 20 elements, the same chunks are reused once the queue has been through its largest span
+  int next = 0, expected = 0;
+  int *pChunks[4] = {};
+  size_t chunkCount = 0;
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    for (int i = 0; i < 10000; ++i)
+    {
+      if (array.length < 5)
+      {
+        while (array.length < 20)
+          array.PushBack(next++);
+      }
+      int value;
+      EXPECT_TRUE(array.PopFront(&value));
+      EXPECT_EQ(expected++, value);
+      if ((i % 3) != 0)
+        array.PushBack(next++);
+    }
+    if (pass == 0)
+    {
+      chunkCount = array.chunkCount;
+      ASSERT_LE(chunkCount, udLengthOf(pChunks));
+      memcpy(pChunks, array.ppChunks, chunkCount * sizeof(int*));
+    }
+  }
+  EXPECT_EQ(chunkCount, array.chunkCount);
+  for (size_t c = 0; c < array.chunkCount; ++c)
+  {
+    bool found = false;
+    for (size_t o = 0; o < chunkCount; ++o)
+      found = found || (array.ppChunks[c] == pChunks[o]);
+    EXPECT_TRUE(found);
+  }
+
+  // Growing then popping leaves chunks that ShrinkToFit releases
+  for (int i = 0; i < 1000; ++i)
+    array.PushBack(next++);
+  array.PopBackRange(nullptr, 990);
+  EXPECT_GT(array.chunkCount, 100U);
+  EXPECT_EQ(udR_Success, array.ShrinkToFit());
+  EXPECT_EQ((array.inset + array.length + 7) / 8, array.chunkCount);
+  EXPECT_EQ((size_t)array.ptrArrayInc, array.ptrArraySize);
+
+  // Compact removes the inset too
+  int first = array[3];
+  array.PopFrontRange(nullptr, 3);
+  EXPECT_NE(0U, array.inset);
+  size_t length = array.length;
+  EXPECT_EQ(udR_Success, array.Compact());
+  EXPECT_EQ(0U, array.inset);
+  EXPECT_EQ(length, array.length);
+  EXPECT_EQ((length + 7) / 8, array.chunkCount);
+  for (size_t i = 0; i < array.length; ++i)
+    EXPECT_EQ(first + (int)i, array[i]);
+
+  array.Deinit();
+}
+
+struct udChunkedArrayTests_Keyed
+{
+  uint32_t key;
+  uint32_t value;
+};
+
+// ----------------------------------------------------------------------------
+// The hashed FindIndex matches a linear search through a random mix of every kind of modification
+TEST(udChunkedArrayTests, HashIndex)
+{
+  udChunkedArray<udChunkedArrayTests_Keyed> array;
+  array.Init(16);
+  for (uint32_t i = 0; i < 100; ++i)
+    array.PushBack(udChunkedArrayTests_Keyed{ i % 60, i });
+
+  EXPECT_EQ(udR_InvalidParameter_, array.EnableHashIndex(0));
+  EXPECT_EQ(udR_Success, array.EnableHashIndex(sizeof(uint32_t)));
+
+  uint32_t seed = 1;
+  auto random = [&seed](uint32_t range) { seed = seed * 1103515245 + 12345; return (seed >> 8) % range; };
+  for (int op = 0; op < 20000; ++op)
+  {
+    udChunkedArrayTests_Keyed element = { random(300), (uint32_t)op };
+    udChunkedArrayTests_Keyed *pElement = nullptr;
+    size_t index = array.length ? random((uint32_t)array.length) : 0;
+    switch (random(12))
+    {
+    case 0: case 1: case 2:
+      array.PushBack(element);
+      break;
+    case 3:
+      array.PushBack(&pElement);
+      *pElement = element;
+      break;
+    case 4: case 5:
+      if (array.length)
+        array.SetElement(index, element);
+      break;
+    case 6: case 7:
+      if (array.length)
+        array.RemoveSwapLast(index);
+      break;
+    case 8:
+      array.PopBackRange(nullptr, random(3));
+      break;
+    case 9:
+      if (random(4) == 0)
+        array.PopFront();
+      else
+        array.Insert(index, &element);
+      break;
+    case 10:
+      if (array.length)
+        array.RemoveAt(index);
+      break;
+    case 11:
+      if (random(500) == 0)
+        array.Clear();
+      else if (array.length)
+        array[index].value = element.value; // Outside the compared bytes, so no need to invalidate
+      break;
+    }
+
+    for (int k = 0; k < 4; ++k)
+    {
+      udChunkedArrayTests_Keyed search = { random(300), 0 };
+      size_t expected = 0;
+      while (expected < array.length && array[expected].key != search.key)
+        ++expected;
+      EXPECT_EQ(expected, array.FindIndex(search, sizeof(uint32_t)));
+    }
+    if (HasFailure())
+      break;
+  }
+
+  // A different compare length still searches linearly, and modifying the key in place needs the index invalidated
+  ASSERT_LT(2U, array.length);
+  udChunkedArrayTests_Keyed last = array[array.length - 1];
+  EXPECT_EQ(array.length - 1, array.FindIndex(last));
+  array[0].key = 1000;
+  array.InvalidateHashIndex();
+  EXPECT_EQ(0U, array.FindIndex(udChunkedArrayTests_Keyed{ 1000, 0 }, sizeof(uint32_t)));
+
+  array.DisableHashIndex();
+  EXPECT_EQ(0U, array.FindIndex(udChunkedArrayTests_Keyed{ 1000, 0 }, sizeof(uint32_t)));
+  array.Deinit();
+}
+
+struct udChunkedArrayTests_Tracked
+{
+  static int liveCount;
+  char *pName;
+
+  udChunkedArrayTests_Tracked() : pName(nullptr) { ++liveCount; }
+  udChunkedArrayTests_Tracked(int a, int b) : pName(udStrdup(udTempStr("%d.%d", a, b))) { ++liveCount; }
+  udChunkedArrayTests_Tracked(const udChunkedArrayTests_Tracked &other) : pName(udStrdup(other.pName)) { ++liveCount; }
+  udChunkedArrayTests_Tracked(udChunkedArrayTests_Tracked &&other) : pName(other.pName) { other.pName = nullptr; ++liveCount; }
+  ~udChunkedArrayTests_Tracked() { udFree(pName); --liveCount; }
+  udChunkedArrayTests_Tracked &operator=(const udChunkedArrayTests_Tracked &other) { if (this != &other) { udFree(pName); pName = udStrdup(other.pName); } return *this; }
+  udChunkedArrayTests_Tracked &operator=(udChunkedArrayTests_Tracked &&other) { if (this != &other) { udFree(pName); pName = other.pName; other.pName = nullptr; } return *this; }
+};
+int udChunkedArrayTests_Tracked::liveCount = 0;
+
+TEST(udChunkedArrayTests, NonTrivial)
+{
+  udChunkedArray<udChunkedArrayTests_Tracked> array;
+  array.Init(4);
+
+  // Build 0.0..0.9 using every way of adding elements, across several chunks and with an inset
+  udChunkedArrayTests_Tracked named(0, 5);
+  EXPECT_EQ(udR_Success, array.EmplaceBack(0, 2));
+  EXPECT_EQ(udR_Success, array.PushBack(udChunkedArrayTests_Tracked(0, 3)));
+  EXPECT_EQ(udR_Success, array.PushBack(named));
+  EXPECT_EQ(udR_Success, array.EmplaceFront(0, 1));
+  EXPECT_EQ(udR_Success, array.PushFront(udChunkedArrayTests_Tracked(0, 0)));
+  for (int i = 6; i < 10; ++i)
+    EXPECT_EQ(udR_Success, array.EmplaceBack(0, i));
+  udChunkedArrayTests_Tracked missing(0, 4);
+  EXPECT_EQ(udR_Success, array.Insert(4, &missing));
+  EXPECT_NE(0U, array.inset);
+
+  ASSERT_EQ(10U, array.length);
+  for (size_t i = 0; i < array.length; ++i)
+    EXPECT_STREQ(udTempStr("0.%d", (int)i), array[i].pName);
+  EXPECT_EQ(12, udChunkedArrayTests_Tracked::liveCount);
+
+  // Inserting near the front and back, and removing from the middle, moves elements rather than copying bits
+  EXPECT_EQ(udR_Success, array.Insert(1, &named));
+  EXPECT_EQ(udR_Success, array.Insert(10, &named));
+  EXPECT_EQ(udR_Success, array.Insert(12));
+  EXPECT_STREQ("0.5", array[1].pName);
+  EXPECT_STREQ("0.5", array[10].pName);
+  EXPECT_EQ(nullptr, array[12].pName);
+  array.RemoveAt(12);
+  array.RemoveAt(10);
+  array.RemoveAt(1);
+  for (size_t i = 0; i < array.length; ++i)
+    EXPECT_STREQ(udTempStr("0.%d", (int)i), array[i].pName);
+
+  // Popping moves out then destroys
+  udChunkedArrayTests_Tracked popped;
+  EXPECT_TRUE(array.PopFront(&popped));
+  EXPECT_STREQ("0.0", popped.pName);
+  EXPECT_TRUE(array.PopBack(&popped));
+  EXPECT_STREQ("0.9", popped.pName);
+  array.RemoveSwapLast(0);
+  EXPECT_STREQ("0.8", array[0].pName);
+  EXPECT_EQ(7U, array.length);
+  EXPECT_EQ(10, udChunkedArrayTests_Tracked::liveCount);
+
+  // Copies out are constructed, and grown elements are value constructed
+  udChunkedArrayTests_Tracked *pCopy = nullptr;
+  EXPECT_EQ(udR_Success, array.ToArray(&pCopy, 1, 2));
+  EXPECT_STREQ("0.2", pCopy[0].pName);
+  EXPECT_STREQ("0.3", pCopy[1].pName);
+  pCopy[0].~udChunkedArrayTests_Tracked();
+  pCopy[1].~udChunkedArrayTests_Tracked();
+  udFree(pCopy);
+  EXPECT_EQ(udR_Success, array.GrowBack(6));
+  EXPECT_EQ(nullptr, array[12].pName);
+  EXPECT_EQ(16, udChunkedArrayTests_Tracked::liveCount);
+
+  // Range pushes copy construct, range pops move out then destroy
+  udChunkedArrayTests_Tracked range[3];
+  EXPECT_EQ(13U, array.PopFrontRange(nullptr, 20));
+  EXPECT_EQ(6, udChunkedArrayTests_Tracked::liveCount);
+  EXPECT_EQ(udR_Success, array.PushBackRange(&named, 1));
+  EXPECT_EQ(1U, array.PopBackRange(range, 3));
+  EXPECT_STREQ("0.5", range[0].pName);
+  EXPECT_STREQ("0.5", named.pName);
+  EXPECT_EQ(udR_Success, array.GrowBack(6));
+  EXPECT_EQ(12, udChunkedArrayTests_Tracked::liveCount);
+
+  // Compacting moves elements into the slots before the inset
+  array.PopFrontRange(nullptr, 3);
+  EXPECT_EQ(udR_Success, array.Compact());
+  EXPECT_EQ(0U, array.inset);
+  EXPECT_EQ(3U, array.length);
+  EXPECT_EQ(9, udChunkedArrayTests_Tracked::liveCount);
+
+  // Everything in the array is destroyed by Clear and Deinit
+  array.Clear();
+  EXPECT_EQ(6, udChunkedArrayTests_Tracked::liveCount);
+  EXPECT_EQ(udR_Success, array.EmplaceBack(1, 1));
+  array.Deinit();
+  EXPECT_EQ(6, udChunkedArrayTests_Tracked::liveCount);
+}
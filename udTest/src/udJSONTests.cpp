@@ -2,6 +2,8 @@
 #include "udJSON.h"
 #include "udPlatformUtil.h"
 #include "udStringUtil.h"
+#include "udArena.h"
+#include "udMemoryProfiler.h"
 
 // First-pass most basic tests for udJSON
 // TODO: Fix udMemoryDebugTracking to be useful and test memory leaks
@@ -184,6 +186,35 @@ TEST(udJSONTests, CreateArray)
   EXPECT_EQ(4, json.Get("sequences").ArrayLength());
 }
 
+// ----------------------------------------------------------------------------
+TEST(udJSONTests, Move)
+{
+  udJSON source;
+  EXPECT_EQ(udR_Success, source.Set("list = [ 1, \"two\", { \"three\": 3 } ]"));
+
+  // Moving transfers the memory, leaving the source void
+  udJSON moved(std::move(source));
+  EXPECT_TRUE(source.IsVoid());
+  EXPECT_EQ(3U, moved.Get("list").ArrayLength());
+
+  udJSON assigned;
+  EXPECT_EQ(udR_Success, assigned.SetString("replaced"));
+  assigned = std::move(moved);
+  EXPECT_TRUE(moved.IsVoid());
+  EXPECT_STREQ("two", assigned.Get("list[1]").AsString());
+
+  // Array elements move as the array is rearranged
+  udJSONArray *pList = assigned.Get("list").AsArray();
+  udJSON value;
+  EXPECT_EQ(udR_Success, value.SetString("zero"));
+  EXPECT_EQ(udR_Success, pList->PushFront(std::move(value)));
+  EXPECT_TRUE(value.IsVoid());
+  pList->RemoveAt(2);
+  EXPECT_EQ(3U, assigned.Get("list").ArrayLength());
+  EXPECT_STREQ("zero", assigned.Get("list[0]").AsString());
+  EXPECT_EQ(3, assigned.Get("list[2].three").AsInt());
+}
+
 // ----------------------------------------------------------------------------
 // Author: Dave Pevreal, June 2017
 TEST(udJSONTests, RemoveKey)
@@ -472,3 +503,75 @@ TEST(udJSONTests, ExponentStr)
   EXPECT_TRUE(data.Get("46CDC.thumb").AsBool());
   EXPECT_TRUE(data.Get("46CDC.processed").AsBool());
 }
+
+// ----------------------------------------------------------------------------
+// Sum the allocations the profiler has recorded across all call sites
+static int64_t udJSONTests_CountAllocations()
+{
+  udJSON report;
+  int64_t count = 0;
+  udMemoryProfiler_Report(&report);
+  for (size_t i = 0; i < report.Get("sites").ArrayLength(); ++i)
+    count += report.Get("sites[%d].allocCount", (int)i).AsInt64();
+  return count;
+}
+
+// ----------------------------------------------------------------------------
+TEST(udJSONTests, ArenaParse)
+{
+  // A document with many keys, strings, arrays and objects
+  udJSON source;
+  for (int i = 0; i < 500; ++i)
+  {
+    source.Set("items[] = { \"name\": \"item%d\", \"tags\": [\"a\", \"b\", %d], \"pos\": { \"x\": %d.5, \"y\": null } }", i, i, i);
+    source.Set("index.key%d = 'value%d'", i, i);
+  }
+  const char *pText = nullptr;
+  ASSERT_EQ(udR_Success, source.Export(&pText));
+
+  size_t oldInterval = udMemoryProfiler_GetSampleInterval();
+  udMemoryProfiler_SetSampleInterval(1); // Sample every allocation to count them
+
+  udJSON heap;
+  udMemoryProfiler_Reset();
+  EXPECT_EQ(udR_Success, heap.Parse(pText));
+  int64_t heapAllocations = udJSONTests_CountAllocations();
+
+  udArena *pArena = nullptr;
+  udJSON arena;
+  udMemoryProfiler_Reset();
+  ASSERT_EQ(udR_Success, udArena_Create(&pArena, 256 * 1024));
+  EXPECT_EQ(udR_Success, arena.Parse(pText, nullptr, nullptr, pArena));
+  int64_t arenaAllocations = udJSONTests_CountAllocations();
+
+  udMemoryProfiler_SetSampleInterval(oldInterval);
+  udMemoryProfiler_Reset();
+
+  const char *pHeapText = nullptr;
+  const char *pArenaText = nullptr;
+  EXPECT_EQ(udR_Success, heap.Export(&pHeapText));
+  EXPECT_EQ(udR_Success, arena.Export(&pArenaText));
+  EXPECT_STREQ(pText, pHeapText);
+  EXPECT_STREQ(pText, pArenaText);
+  udFree(pHeapText);
+  udFree(pArenaText);
+  EXPECT_GT(heapAllocations, 5000);
+  EXPECT_LT(arenaAllocations, 32);
+
+  // Values from outside the arena can be mixed into an arena tree, and strings extracted from it are heap owned
+  EXPECT_EQ(udR_Success, arena.Set("items[0].extra = 'not in the arena'"));
+  EXPECT_EQ(udR_Success, arena.Set("index.added = 'also not in the arena'"));
+  EXPECT_EQ(udR_Success, arena.Set("index.key0"));
+  const char *pExtracted = nullptr;
+  udJSON *pName = nullptr;
+  EXPECT_EQ(udR_Success, arena.Get(&pName, "items[1].name"));
+  EXPECT_EQ(udR_Success, pName->ExtractAndVoid(&pExtracted));
+  EXPECT_STREQ("item1", pExtracted);
+  udFree(pExtracted);
+
+  arena.Destroy();
+  heap.Destroy();
+  source.Destroy();
+  udArena_Destroy(&pArena);
+  udFree(pText);
+}
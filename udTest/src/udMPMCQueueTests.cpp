@@ -0,0 +1,216 @@
+#include "gtest/gtest.h"
+#include "udMPMCQueue.h"
+#include "udSafeDeque.h"
+#include "udStringUtil.h"
+#include "udThread.h"
+
+struct udMPMCQueueTests_Named
+{
+  char *pName;
+
+  udMPMCQueueTests_Named(const char *pStr = nullptr) : pName(udStrdup(pStr)) {}
+  udMPMCQueueTests_Named(udMPMCQueueTests_Named &&other) : pName(other.pName) { other.pName = nullptr; }
+  ~udMPMCQueueTests_Named() { udFree(pName); }
+  udMPMCQueueTests_Named &operator=(udMPMCQueueTests_Named &&other) { if (this != &other) { udFree(pName); pName = other.pName; other.pName = nullptr; } return *this; }
+};
+
+// ----------------------------------------------------------------------------
+TEST(udMPMCQueueTests, Validate)
+{
+  udMPMCQueue<int> *pQueue = nullptr;
+  int value = -1;
+
+  EXPECT_EQ(udR_InvalidParameter_, udMPMCQueue_Create((udMPMCQueue<int>**)nullptr, 8));
+  EXPECT_EQ(udR_InvalidParameter_, udMPMCQueue_Create(&pQueue, 0));
+  EXPECT_EQ(udR_InvalidParameter_, udMPMCQueue_PushBack((udMPMCQueue<int>*)nullptr, 1));
+  EXPECT_EQ(udR_InvalidParameter_, udMPMCQueue_PopFront((udMPMCQueue<int>*)nullptr, &value));
+
+  ASSERT_EQ(udR_Success, udMPMCQueue_Create(&pQueue, 5));
+  EXPECT_EQ(8U, udMPMCQueue_GetCapacity(pQueue));
+  EXPECT_EQ(udR_ObjectNotFound, udMPMCQueue_PopFront(pQueue, &value));
+  EXPECT_EQ(-1, value);
+
+  // Fill and empty it many times so the positions lap the ring
+  int next = 0, expected = 0;
+  for (int lap = 0; lap < 100; ++lap)
+  {
+    for (int i = 0; i < 8; ++i)
+      EXPECT_EQ(udR_Success, udMPMCQueue_PushBack(pQueue, next++));
+    EXPECT_EQ(udR_CountExceeded, udMPMCQueue_PushBack(pQueue, next));
+    for (int i = 0; i < 5 + (lap % 4); ++i)
+    {
+      EXPECT_EQ(udR_Success, udMPMCQueue_PopFront(pQueue, &value));
+      EXPECT_EQ(expected++, value);
+    }
+    while (udMPMCQueue_PopFront(pQueue, &value) == udR_Success)
+      EXPECT_EQ(expected++, value);
+  }
+  EXPECT_EQ(next, expected);
+
+  udMPMCQueue_Destroy(&pQueue);
+  EXPECT_EQ(nullptr, pQueue);
+  udMPMCQueue_Destroy(&pQueue);
+
+  // Non trivial elements are moved through, and those left are destroyed with the queue
+  udMPMCQueue<udMPMCQueueTests_Named> *pNamed = nullptr;
+  ASSERT_EQ(udR_Success, udMPMCQueue_Create(&pNamed, 4));
+  EXPECT_EQ(udR_Success, udMPMCQueue_PushBack(pNamed, udMPMCQueueTests_Named("first")));
+  EXPECT_EQ(udR_Success, udMPMCQueue_PushBack(pNamed, udMPMCQueueTests_Named("second")));
+  udMPMCQueueTests_Named named;
+  EXPECT_EQ(udR_Success, udMPMCQueue_PopFront(pNamed, &named));
+  EXPECT_STREQ("first", named.pName);
+  udMPMCQueue_Destroy(&pNamed);
+}
+
+struct udMPMCQueueTests_ThreadData
+{
+  void *pQueue;
+  udSemaphore *pStart;
+  int producerCount;
+  int itemsPerProducer;
+  volatile int32_t nextThread;
+  volatile int32_t popped;
+  volatile int32_t errors;
+  volatile int64_t sum;
+};
+
+inline udResult udMPMCQueueTests_Push(udMPMCQueue<int> *pQueue, int value) { return udMPMCQueue_PushBack(pQueue, value); }
+inline udResult udMPMCQueueTests_Push(udSafeDeque<int> *pQueue, int value) { return udSafeDeque_PushBack(pQueue, value); }
+inline udResult udMPMCQueueTests_Pop(udMPMCQueue<int> *pQueue, int *pValue) { return udMPMCQueue_PopFront(pQueue, pValue); }
+inline udResult udMPMCQueueTests_Pop(udSafeDeque<int> *pQueue, int *pValue) { return udSafeDeque_PopFront(pQueue, pValue); }
+
+// ----------------------------------------------------------------------------
+// The first producerCount threads push their id in the high bits and a count in the low bits, the rest pop until every item
+// has been taken, checking the items from each producer arrive in order
+template <typename Q>
+static uint32_t udMPMCQueueTests_Thread(void *pDataPtr)
+{
+  udMPMCQueueTests_ThreadData *pData = (udMPMCQueueTests_ThreadData*)pDataPtr;
+  Q *pQueue = (Q*)pData->pQueue;
+  int thread = udInterlockedPostIncrement(&pData->nextThread);
+  int totalItems = pData->producerCount * pData->itemsPerProducer;
+
+  udWaitSemaphore(pData->pStart);
+  if (thread < pData->producerCount)
+  {
+    for (int i = 0; i < pData->itemsPerProducer; ++i)
+    {
+      while (udMPMCQueueTests_Push(pQueue, (thread << 20) | i) != udR_Success)
+        udYield();
+    }
+  }
+  else
+  {
+    int lastSeen[64];
+    for (int &last : lastSeen)
+      last = -1;
+    int64_t sum = 0;
+    int value;
+    while (pData->popped < totalItems)
+    {
+      if (udMPMCQueueTests_Pop(pQueue, &value) != udR_Success)
+      {
+        udYield();
+        continue;
+      }
+      udInterlockedPreIncrement(&pData->popped);
+      int producer = value >> 20;
+      int count = value & 0xFFFFF;
+      if (producer >= pData->producerCount || count <= lastSeen[producer])
+        udInterlockedPreIncrement(&pData->errors);
+      lastSeen[producer] = count;
+      sum += count;
+    }
+    int64_t prev;
+    do
+    {
+      prev = pData->sum;
+    } while (udInterlockedCompareExchange64(&pData->sum, prev + sum, prev) != prev);
+  }
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Returns the milliseconds taken to pass every item through the queue, a single thread alternately pushes and pops
+template <typename Q>
+static float udMPMCQueueTests_Run(Q *pQueue, int threadCount, int totalItems)
+{
+  udMPMCQueueTests_ThreadData data = {};
+  data.pQueue = pQueue;
+  data.pStart = udCreateSemaphore();
+  data.producerCount = udMax(threadCount / 2, 1);
+  data.itemsPerProducer = totalItems / data.producerCount;
+  float ms = 0.f;
+
+  if (threadCount == 1)
+  {
+    uint64_t start = udPerfCounterStart();
+    int value = 0;
+    for (int i = 0; i < data.itemsPerProducer; ++i)
+    {
+      udMPMCQueueTests_Push(pQueue, i);
+      if (udMPMCQueueTests_Pop(pQueue, &value) != udR_Success || value != i)
+        ++data.errors;
+      else
+        data.sum += value;
+    }
+    ms = udPerfCounterMilliseconds(start);
+  }
+  else
+  {
+    udThread *pThreads[64] = {};
+    for (int t = 0; t < threadCount; ++t)
+      EXPECT_EQ(udR_Success, udThread_Create(&pThreads[t], udMPMCQueueTests_Thread<Q>, &data));
+    while (data.nextThread < threadCount)
+      udYield();
+
+    uint64_t start = udPerfCounterStart();
+    udIncrementSemaphore(data.pStart, threadCount);
+    for (int t = 0; t < threadCount; ++t)
+      udThread_Join(pThreads[t]);
+    ms = udPerfCounterMilliseconds(start);
+
+    for (int t = 0; t < threadCount; ++t)
+      udThread_Destroy(&pThreads[t]);
+  }
+
+  EXPECT_EQ(0, data.errors);
+  EXPECT_EQ((int64_t)data.producerCount * data.itemsPerProducer * (data.itemsPerProducer - 1) / 2, data.sum);
+  udDestroySemaphore(&data.pStart);
+  return ms;
+}
+
+// ----------------------------------------------------------------------------
+TEST(udMPMCQueueTests, Threaded)
+{
+  udMPMCQueue<int> *pQueue = nullptr;
+  ASSERT_EQ(udR_Success, udMPMCQueue_Create(&pQueue, 64));
+  udMPMCQueueTests_Run(pQueue, 8, 200000);
+  int value;
+  EXPECT_EQ(udR_ObjectNotFound, udMPMCQueue_PopFront(pQueue, &value));
+  udMPMCQueue_Destroy(&pQueue);
+}
+
+// ----------------------------------------------------------------------------
+// Benchmark, the same items through udSafeDeque and udMPMCQueue with half the threads pushing and half popping.
+// Disabled by default, run with --gtest_also_run_disabled_tests
+TEST(udMPMCQueueTests, DISABLED_Throughput)
+{
+  const int totalItems = 1 << 18;
+  const int threadCounts[] = { 1, 2, 4, 8, 16, 32, 64 };
+
+  for (int threadCount : threadCounts)
+  {
+    udSafeDeque<int> *pDeque = nullptr;
+    udMPMCQueue<int> *pQueue = nullptr;
+    ASSERT_EQ(udR_Success, udSafeDeque_Create(&pDeque, 1024));
+    ASSERT_EQ(udR_Success, udMPMCQueue_Create(&pQueue, 1024));
+
+    float dequeMs = udMPMCQueueTests_Run(pDeque, threadCount, totalItems);
+    float queueMs = udMPMCQueueTests_Run(pQueue, threadCount, totalItems);
+    printf("%2d threads: udSafeDeque %8.2fms (%6.2f Mops/s), udMPMCQueue %8.2fms (%6.2f Mops/s)\n", threadCount, dequeMs, totalItems / (dequeMs * 1000.f), queueMs, totalItems / (queueMs * 1000.f));
+
+    udSafeDeque_Destroy(&pDeque);
+    udMPMCQueue_Destroy(&pQueue);
+  }
+}
@@ -1,6 +1,15 @@
 #include "gtest/gtest.h"
 #include "udPlatform.h"
+#include "udAllocator.h"
+#include "udJSON.h"
+#include "udMemoryProfiler.h"
+#include "udPlatformUtil.h"
 #include "udStringUtil.h"
+#include "udThread.h"
+
+#if !UDPLATFORM_WINDOWS
+# include <pthread.h>
+#endif
 
 // ----------------------------------------------------------------------------
 // Author: Paul Fox, January 2019
@@ -35,3 +44,450 @@ TEST(udMemoryTests, GetTotalPhysicalMemory)
   else
     EXPECT_EQ(0, mem);
 }
+
+// ----------------------------------------------------------------------------
+// The placement flags are hints, whether or not they're honoured the memory must behave the same
+TEST(udMemoryTests, PlacementFlags)
+{
+  const size_t largeSize = 3 * 1024 * 1024;
+  const udAllocationFlags flagSets[] = { udAF_HugePages, udAF_ExplicitHugePages | udAF_Zero, udAF_NUMALocal, udAF_NUMANode(0) | udAF_HugePages | udAF_Zero };
+
+  for (udAllocationFlags flags : flagSets)
+  {
+    uint8_t *pSmall = udAllocType(uint8_t, 100, flags);
+    uint8_t *pLarge = (uint8_t*)udAllocAligned(largeSize, 4096, flags); // Page alignment is honoured with the flags
+    ASSERT_NE(nullptr, pSmall);
+    ASSERT_NE(nullptr, pLarge);
+    EXPECT_EQ(0U, (uintptr_t)pLarge % 4096);
+    if (flags & udAF_Zero)
+    {
+      for (size_t i = 0; i < largeSize; i += 4093)
+        EXPECT_EQ(0, pLarge[i]);
+    }
+    for (size_t i = 0; i < largeSize; ++i)
+      pLarge[i] = (uint8_t)i;
+    memset(pSmall, 1, 100);
+
+    // Growing and shrinking keep the contents
+    pLarge = (uint8_t*)udRealloc(pLarge, largeSize * 2);
+    ASSERT_NE(nullptr, pLarge);
+    pLarge[largeSize * 2 - 1] = 1;
+    pLarge = (uint8_t*)udReallocAligned(pLarge, 1000, 32);
+    ASSERT_NE(nullptr, pLarge);
+    for (size_t i = 0; i < 1000; ++i)
+      EXPECT_EQ((uint8_t)i, pLarge[i]);
+    pSmall = (uint8_t*)udRealloc(pSmall, largeSize);
+    ASSERT_NE(nullptr, pSmall);
+    EXPECT_EQ(1, pSmall[99]);
+
+    udFree(pSmall);
+    udFree(pLarge);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Many blocks with placement flags live at once, on either side of the NUMA size threshold, freed and resized out of order
+TEST(udMemoryTests, PlacementFlagsManyBlocks)
+{
+  const size_t baseSize = 60 * 1024;
+  uint8_t *pBlocks[300];
+  for (int i = 0; i < (int)udLengthOf(pBlocks); ++i)
+  {
+    pBlocks[i] = udAllocType(uint8_t, baseSize + i * 64, udAF_NUMALocal);
+    ASSERT_NE(nullptr, pBlocks[i]);
+    memset(pBlocks[i], i & 0xFF, baseSize + i * 64);
+  }
+
+  for (int i = 0; i < (int)udLengthOf(pBlocks); i += 3)
+  {
+    pBlocks[i] = (uint8_t*)udRealloc(pBlocks[i], baseSize * 2 + i);
+    ASSERT_NE(nullptr, pBlocks[i]);
+  }
+
+  bool matched = true;
+  for (int step = 0; step < (int)udLengthOf(pBlocks); ++step)
+  {
+    int i = (step * 7) % (int)udLengthOf(pBlocks);
+    matched = matched && pBlocks[i][0] == (i & 0xFF) && pBlocks[i][baseSize - 1] == (i & 0xFF);
+    udFree(pBlocks[i]);
+  }
+  EXPECT_TRUE(matched);
+}
+
+// ----------------------------------------------------------------------------
+// Grows the way udFile_GenericLoad does for content of unknown length, through the size where blocks become mapped
+TEST(udMemoryTests, LargeRealloc)
+{
+  const size_t step = 64 * 1024;
+  const size_t maxSize = 16 * 1024 * 1024;
+
+  for (size_t alignment : { (size_t)0, (size_t)32 })
+  {
+    uint32_t *pData = nullptr;
+    size_t written = 0;
+    for (size_t size = step; size <= maxSize; size += step)
+    {
+      pData = (uint32_t*)(alignment ? udReallocAligned(pData, size, alignment) : udRealloc(pData, size));
+      ASSERT_NE(nullptr, pData);
+      if (alignment)
+      {
+        EXPECT_EQ(0U, (uintptr_t)pData % alignment);
+      }
+      for (; written < size / sizeof(uint32_t); ++written)
+        pData[written] = (uint32_t)written;
+    }
+
+    bool matched = true;
+    for (size_t i = 0; i < written; ++i)
+      matched = matched && (pData[i] == (uint32_t)i);
+    EXPECT_TRUE(matched);
+
+    // Shrinking keeps the start of the block
+    pData = (uint32_t*)udRealloc(pData, step);
+    ASSERT_NE(nullptr, pData);
+    for (size_t i = 0; i < step / sizeof(uint32_t); ++i)
+      matched = matched && (pData[i] == (uint32_t)i);
+    EXPECT_TRUE(matched);
+    udFree(pData);
+  }
+
+  // Large blocks are zeroed on request like any other
+  uint8_t *pLarge = udAllocType(uint8_t, maxSize, udAF_Zero);
+  ASSERT_NE(nullptr, pLarge);
+  EXPECT_EQ(0, pLarge[0]);
+  EXPECT_EQ(0, pLarge[maxSize - 1]);
+  udFree(pLarge);
+
+#if UDPLATFORM_LINUX
+  // Reallocating null to a large size maps the block just as udAlloc does, mappings start on a page
+  pLarge = (uint8_t*)udRealloc(nullptr, maxSize);
+  ASSERT_NE(nullptr, pLarge);
+  EXPECT_EQ(0U, (uintptr_t)pLarge % 4096);
+  pLarge[maxSize - 1] = 1;
+  udFree(pLarge);
+#endif
+}
+
+// ----------------------------------------------------------------------------
+TEST(udMemoryTests, AllocatorBackend)
+{
+  // Memory has already been allocated, so the backend can no longer be changed
+  EXPECT_EQ(udAllocator_SystemBackend(), udAllocator_GetBackend());
+  EXPECT_EQ(udR_NotAllowed, udAllocator_SetBackend(udAllocator_ThreadCacheBackend()));
+  EXPECT_EQ(udR_Success, udAllocator_SetBackend(nullptr)); // Already the system backend
+  EXPECT_EQ(udAllocator_SystemBackend(), udAllocator_GetBackend());
+
+  const udAllocatorBackend *pBackends[] = { udAllocator_SystemBackend(), udAllocator_ThreadCacheBackend() };
+  for (const udAllocatorBackend *pBackend : pBackends)
+  {
+    // Small zeroed blocks
+    uint8_t *pSmall = (uint8_t*)pBackend->pAlloc(24, 8, udAF_Zero, IF_MEMORY_DEBUG(__FILE__, __LINE__));
+    ASSERT_NE(nullptr, pSmall);
+    for (int i = 0; i < 24; ++i)
+      EXPECT_EQ(0, pSmall[i]);
+    memset(pSmall, 0xAB, 24);
+
+    // Growing across size classes and into large blocks retains the contents
+    pSmall = (uint8_t*)pBackend->pRealloc(pSmall, 100000, 8, IF_MEMORY_DEBUG(__FILE__, __LINE__));
+    ASSERT_NE(nullptr, pSmall);
+    for (int i = 0; i < 24; ++i)
+      EXPECT_EQ(0xAB, pSmall[i]);
+    pSmall = (uint8_t*)pBackend->pRealloc(pSmall, 12, 8, IF_MEMORY_DEBUG(__FILE__, __LINE__));
+    ASSERT_NE(nullptr, pSmall);
+    for (int i = 0; i < 12; ++i)
+      EXPECT_EQ(0xAB, pSmall[i]);
+    pBackend->pFree(pSmall, IF_MEMORY_DEBUG(__FILE__, __LINE__));
+
+    // Aligned blocks
+    void *pAligned = pBackend->pAlloc(1000, 256, udAF_None, IF_MEMORY_DEBUG(__FILE__, __LINE__));
+    ASSERT_NE(nullptr, pAligned);
+    EXPECT_EQ(0u, ((uintptr_t)pAligned) & 255);
+    memset(pAligned, 0xCD, 1000);
+    pAligned = pBackend->pRealloc(pAligned, 5000, 256, IF_MEMORY_DEBUG(__FILE__, __LINE__));
+    ASSERT_NE(nullptr, pAligned);
+    EXPECT_EQ(0u, ((uintptr_t)pAligned) & 255);
+    EXPECT_EQ(0xCD, ((uint8_t*)pAligned)[999]);
+    pBackend->pFree(pAligned, IF_MEMORY_DEBUG(__FILE__, __LINE__));
+
+    EXPECT_EQ(nullptr, pBackend->pRealloc(pBackend->pAlloc(64, 8, udAF_None, IF_MEMORY_DEBUG(__FILE__, __LINE__)), 0, 8, IF_MEMORY_DEBUG(__FILE__, __LINE__)));
+
+    // Large blocks with placement flags, which the system backend maps
+    const size_t largeSize = 5 * 1024 * 1024;
+    uint8_t *pLarge = (uint8_t*)pBackend->pAlloc(largeSize, 8, udAF_Zero | udAF_HugePages, IF_MEMORY_DEBUG(__FILE__, __LINE__));
+    ASSERT_NE(nullptr, pLarge);
+    EXPECT_EQ(0, pLarge[0]);
+    EXPECT_EQ(0, pLarge[largeSize - 1]);
+    pLarge[0] = 0x12;
+    pLarge[largeSize - 1] = 0x34;
+    pLarge = (uint8_t*)pBackend->pRealloc(pLarge, largeSize * 3, 8, IF_MEMORY_DEBUG(__FILE__, __LINE__));
+    ASSERT_NE(nullptr, pLarge);
+    EXPECT_EQ(0x12, pLarge[0]);
+    EXPECT_EQ(0x34, pLarge[largeSize - 1]);
+    EXPECT_LE(largeSize * 3, pBackend->pUsableSize ? pBackend->pUsableSize(pLarge) : largeSize * 3);
+    pBackend->pFree(pLarge, IF_MEMORY_DEBUG(__FILE__, __LINE__));
+
+    if (pBackend->pDeinit)
+      pBackend->pDeinit();
+  }
+  udAllocator_ThreadExit();
+}
+
+struct udMemoryTests_BackendThreadData
+{
+  const udAllocatorBackend *pBackend;
+  uint8_t *pBlocks[256];
+  int threadIndex;
+};
+
+// ----------------------------------------------------------------------------
+static uint32_t udMemoryTests_BackendThread(void *pDataPtr)
+{
+  udMemoryTests_BackendThreadData *pData = (udMemoryTests_BackendThreadData*)pDataPtr;
+  for (int i = 0; i < (int)udLengthOf(pData->pBlocks); ++i)
+  {
+    size_t size = 8 + (i * 37) % 2000;
+    pData->pBlocks[i] = (uint8_t*)pData->pBackend->pAlloc(size, 8, udAF_None, IF_MEMORY_DEBUG(__FILE__, __LINE__));
+    if (pData->pBlocks[i])
+      memset(pData->pBlocks[i], pData->threadIndex + 1, size);
+  }
+
+  // Free every other block here, the rest are freed by the main thread after this one has exited
+  for (int i = 0; i < (int)udLengthOf(pData->pBlocks); i += 2)
+    pData->pBackend->pFree(pData->pBlocks[i], IF_MEMORY_DEBUG(__FILE__, __LINE__));
+
+  // The backend under test isn't necessarily the active one, so udThread won't release its per-thread state
+  if (pData->pBackend->pThreadExit)
+    pData->pBackend->pThreadExit();
+
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Blocks allocated on one thread and freed on another, with every slab returned by the deinit
+TEST(udMemoryTests, AllocatorBackendThreads)
+{
+  const udAllocatorBackend *pBackends[] = { udAllocator_SystemBackend(), udAllocator_ThreadCacheBackend() };
+  for (const udAllocatorBackend *pBackend : pBackends)
+  {
+    for (int pass = 0; pass < 2; ++pass) // The backend must be usable again after a deinit
+    {
+      udMemoryTests_BackendThreadData data[4];
+      udThread *pThreads[udLengthOf(data)] = {};
+      for (int t = 0; t < (int)udLengthOf(data); ++t)
+      {
+        data[t].pBackend = pBackend;
+        data[t].threadIndex = t;
+        EXPECT_EQ(udR_Success, udThread_Create(&pThreads[t], udMemoryTests_BackendThread, &data[t]));
+      }
+
+      for (int t = 0; t < (int)udLengthOf(data); ++t)
+      {
+        udThread_Join(pThreads[t]);
+        udThread_Destroy(&pThreads[t]);
+
+        bool matched = true;
+        for (int i = 1; i < (int)udLengthOf(data[t].pBlocks); i += 2)
+        {
+          size_t size = 8 + (i * 37) % 2000;
+          ASSERT_NE(nullptr, data[t].pBlocks[i]);
+          matched = matched && data[t].pBlocks[i][0] == t + 1 && data[t].pBlocks[i][size - 1] == t + 1;
+          pBackend->pFree(data[t].pBlocks[i], IF_MEMORY_DEBUG(__FILE__, __LINE__));
+        }
+        EXPECT_TRUE(matched);
+      }
+
+      if (pBackend->pDeinit)
+        pBackend->pDeinit();
+    }
+  }
+}
+
+#if !UDPLATFORM_WINDOWS
+// ----------------------------------------------------------------------------
+static void *udMemoryTests_ForeignThread(void *pDataPtr)
+{
+  void **ppBlock = (void**)pDataPtr;
+  *ppBlock = udAllocator_ThreadCacheBackend()->pAlloc(64, 8, udAF_None, IF_MEMORY_DEBUG(__FILE__, __LINE__));
+  udAllocator_ThreadCacheBackend()->pFree(*ppBlock, IF_MEMORY_DEBUG(__FILE__, __LINE__));
+  return nullptr; // Exits without calling pThreadExit
+}
+
+// ----------------------------------------------------------------------------
+// A thread not started by udThread hands its cached blocks back as it exits, so the next thread to need one reuses them
+TEST(udMemoryTests, AllocatorBackendForeignThread)
+{
+  const udAllocatorBackend *pBackend = udAllocator_ThreadCacheBackend();
+  pBackend->pDeinit(); // Starts from empty bins
+
+  void *pForeignBlock = nullptr;
+  pthread_t thread;
+  ASSERT_EQ(0, pthread_create(&thread, nullptr, udMemoryTests_ForeignThread, &pForeignBlock));
+  pthread_join(thread, nullptr);
+  ASSERT_NE(nullptr, pForeignBlock);
+
+  void *pBlock = pBackend->pAlloc(64, 8, udAF_None, IF_MEMORY_DEBUG(__FILE__, __LINE__));
+  EXPECT_EQ(pForeignBlock, pBlock);
+  pBackend->pFree(pBlock, IF_MEMORY_DEBUG(__FILE__, __LINE__));
+  pBackend->pDeinit();
+}
+#endif
+
+// ----------------------------------------------------------------------------
+// The active backend's deinit, as called at shutdown, leaves it usable should anything allocate afterwards
+TEST(udMemoryTests, AllocatorDeinit)
+{
+  const size_t largeSize = 5 * 1024 * 1024;
+  uint8_t *pLarge = udAllocType(uint8_t, largeSize, udAF_Zero);
+  ASSERT_NE(nullptr, pLarge);
+  udFree(pLarge);
+  void *pSmall = udAlloc(100);
+  udFree(pSmall);
+
+  udAllocator_Deinit();
+
+  pLarge = udAllocType(uint8_t, largeSize, udAF_Zero);
+  ASSERT_NE(nullptr, pLarge);
+  EXPECT_EQ(0, pLarge[largeSize - 1]);
+  udFree(pLarge);
+}
+
+struct udMemoryTests_ThroughputData
+{
+  const udAllocatorBackend *pBackend;
+  udSemaphore *pStart;
+  int iterations;
+};
+
+// ----------------------------------------------------------------------------
+static uint32_t udMemoryTests_ThroughputThread(void *pDataPtr)
+{
+  udMemoryTests_ThroughputData *pData = (udMemoryTests_ThroughputData*)pDataPtr;
+  void *pLive[64] = {};
+  uint32_t seed = 12345;
+
+  udWaitSemaphore(pData->pStart);
+  for (int i = 0; i < pData->iterations; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    int slot = (seed >> 8) & 63;
+    pData->pBackend->pFree(pLive[slot], IF_MEMORY_DEBUG(__FILE__, __LINE__));
+    pLive[slot] = pData->pBackend->pAlloc(8 + ((seed >> 16) & 511), 8, udAF_None, IF_MEMORY_DEBUG(__FILE__, __LINE__));
+  }
+  for (void *pMemory : pLive)
+    pData->pBackend->pFree(pMemory, IF_MEMORY_DEBUG(__FILE__, __LINE__));
+
+  // The backend under test isn't necessarily the active one, so udThread won't release its per-thread state
+  if (pData->pBackend->pThreadExit)
+    pData->pBackend->pThreadExit();
+
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Benchmark, multi-threaded alloc/free throughput of each backend. Disabled by default, run with --gtest_also_run_disabled_tests
+TEST(udMemoryTests, DISABLED_AllocatorBackendThroughput)
+{
+  const int iterations = 200000;
+  const int threadCounts[] = { 1, 4, 16 };
+  const udAllocatorBackend *pBackends[] = { udAllocator_SystemBackend(), udAllocator_ThreadCacheBackend() };
+
+  for (int threadCount : threadCounts)
+  {
+    for (const udAllocatorBackend *pBackend : pBackends)
+    {
+      udMemoryTests_ThroughputData data = { pBackend, udCreateSemaphore(), iterations };
+      udThread *pThreads[16] = {};
+      for (int t = 0; t < threadCount; ++t)
+        EXPECT_EQ(udR_Success, udThread_Create(&pThreads[t], udMemoryTests_ThroughputThread, &data));
+
+      uint64_t start = udPerfCounterStart();
+      udIncrementSemaphore(data.pStart, threadCount);
+      for (int t = 0; t < threadCount; ++t)
+      {
+        udThread_Join(pThreads[t]);
+        udThread_Destroy(&pThreads[t]);
+      }
+      float ms = udPerfCounterMilliseconds(start);
+      printf("%-12s %2d threads: %s alloc/free pairs per second\n", pBackend->pName, threadCount, udTempStr_CommaInt((int64_t)(threadCount * (double)iterations * 1000.0 / udMax(ms, 0.001f))));
+      udDestroySemaphore(&data.pStart);
+      if (pBackend->pDeinit)
+        pBackend->pDeinit();
+    }
+  }
+}
+
+// ----------------------------------------------------------------------------
+TEST(udMemoryTests, AllocationProfiler)
+{
+  size_t oldInterval = udMemoryProfiler_GetSampleInterval();
+  udMemoryProfiler_SetSampleInterval(1); // Sample every allocation so the counts are exact
+  udMemoryProfiler_Reset();
+
+  void *pBlocks[10];
+  const int allocLine = __LINE__ + 2;
+  for (int i = 0; i < (int)udLengthOf(pBlocks); ++i)
+    pBlocks[i] = udAlloc(100);
+  for (int i = 0; i < 4; ++i)
+    udFree(pBlocks[i]);
+
+  udJSON report;
+  EXPECT_EQ(udR_Success, udMemoryProfiler_Report(&report, 0, udMPS_AllocCount));
+  EXPECT_EQ(1, report.Get("sampleInterval").AsInt());
+
+  const udJSON *pSite = nullptr;
+  const udJSON &sites = report.Get("sites");
+  for (size_t i = 0; i < sites.ArrayLength() && !pSite; ++i)
+  {
+    const udJSON &site = sites.Get("[%d]", (int)i);
+    if (udStrEqual(site.Get("file").AsString(), __FILE__) && site.Get("line").AsInt() == allocLine)
+      pSite = &site;
+  }
+  ASSERT_NE(nullptr, pSite);
+  EXPECT_EQ(10, pSite->Get("allocCount").AsInt());
+  EXPECT_EQ(1000, pSite->Get("allocBytes").AsInt());
+  EXPECT_EQ(4, pSite->Get("freeCount").AsInt());
+  EXPECT_EQ(6, pSite->Get("liveCount").AsInt());
+  EXPECT_EQ(600, pSite->Get("liveBytes").AsInt());
+
+  // A site recorded through another pointer to the same file name, as from a header included in several translation
+  // units, is reported as the same site
+  static const char fileCopy[] = __FILE__;
+  void *pCopySite = _udAlloc(100, udAF_None, fileCopy, allocLine);
+  EXPECT_EQ(udR_Success, udMemoryProfiler_Report(&report, 0, udMPS_AllocCount));
+  int matchingSites = 0;
+  for (size_t i = 0; i < report.Get("sites").ArrayLength(); ++i)
+  {
+    const udJSON &site = report.Get("sites[%d]", (int)i);
+    if (udStrEqual(site.Get("file").AsString(), __FILE__) && site.Get("line").AsInt() == allocLine)
+    {
+      ++matchingSites;
+      EXPECT_EQ(11, site.Get("allocCount").AsInt());
+    }
+  }
+  EXPECT_EQ(1, matchingSites);
+  udFree(pCopySite);
+
+  // Top-N limits the report
+  EXPECT_EQ(udR_Success, udMemoryProfiler_Report(&report, 1, udMPS_LiveBytes));
+  EXPECT_EQ(1U, report.Get("sites").ArrayLength());
+
+  // Disabled, nothing new is recorded but frees of sampled allocations still are
+  udMemoryProfiler_SetSampleInterval(0);
+  void *pUnsampled = udAlloc(100);
+  for (int i = 4; i < (int)udLengthOf(pBlocks); ++i)
+    udFree(pBlocks[i]);
+  udFree(pUnsampled);
+
+  EXPECT_EQ(udR_Success, udMemoryProfiler_Report(&report, 0, udMPS_LiveBytes));
+  for (size_t i = 0; i < report.Get("sites").ArrayLength(); ++i)
+  {
+    const udJSON &site = report.Get("sites[%d]", (int)i);
+    if (udStrEqual(site.Get("file").AsString(), __FILE__) && site.Get("line").AsInt() == allocLine)
+    {
+      EXPECT_EQ(0, site.Get("liveBytes").AsInt());
+    }
+  }
+
+  udMemoryProfiler_Reset();
+  udMemoryProfiler_SetSampleInterval(oldInterval);
+}
@@ -0,0 +1,255 @@
+#include "gtest/gtest.h"
+#include "udParallel.h"
+#include "udMath.h"
+#include "udPlatformUtil.h"
+#include "udStringUtil.h"
+
+struct udParallelTests_Record
+{
+  uint32_t key;
+  uint32_t order; // Original position, to check the sort is stable
+};
+
+// ----------------------------------------------------------------------------
+static void udParallelTests_Fill(udChunkedArray<udParallelTests_Record> *pArray, size_t count, uint32_t keyRange)
+{
+  uint32_t seed = 12345;
+  for (size_t i = 0; i < count; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    pArray->PushBack(udParallelTests_Record{ (seed >> 8) % keyRange, (uint32_t)i });
+  }
+}
+
+// ----------------------------------------------------------------------------
+TEST(udParallelTests, Validate)
+{
+  udWorkerPool *pPool = nullptr;
+  ASSERT_EQ(udR_Success, udWorkerPool_Create(&pPool, 3));
+
+  // Serially with no pool, then on the pool; sizes cover empty, partial chunks, and an inset
+  for (udWorkerPool *pRunPool : { (udWorkerPool*)nullptr, pPool })
+  {
+    for (size_t count : { 0, 1, 100, 5000, 100000 })
+    {
+      udChunkedArray<udParallelTests_Record> array;
+      array.Init(256);
+      array.PushBack(udParallelTests_Record{ 0, 0 });
+      udParallelTests_Fill(&array, count, 1000);
+      array.PopFront();
+
+      // ForEach visits every element once, with its index
+      EXPECT_EQ(udR_Success, udParallel_ForEach(pRunPool, array, [](udParallelTests_Record &record, size_t index) { record.order = (uint32_t)index; record.key += 1; }));
+      uint64_t expectedSum = 0;
+      for (size_t i = 0; i < array.length; ++i)
+      {
+        EXPECT_EQ(i, array[i].order);
+        expectedSum += array[i].key;
+      }
+
+      uint64_t sum = 0;
+      EXPECT_EQ(udR_Success, udParallel_Reduce(pRunPool, array, &sum, (uint64_t)0, [](uint64_t acc, const udParallelTests_Record &record) { return acc + record.key; }, [](uint64_t a, uint64_t b) { return a + b; }));
+      EXPECT_EQ(expectedSum, sum);
+
+      // Sorted by key, equal keys keep their original order
+      EXPECT_EQ(udR_Success, udParallel_Sort(pRunPool, array, [](const udParallelTests_Record &a, const udParallelTests_Record &b) { return a.key < b.key; }));
+      ASSERT_EQ(count, array.length);
+      for (size_t i = 1; i < array.length; ++i)
+      {
+        EXPECT_TRUE(array[i - 1].key < array[i].key || (array[i - 1].key == array[i].key && array[i - 1].order < array[i].order));
+        if (HasFailure())
+          break;
+      }
+      uint64_t sortedSum = 0;
+      for (size_t i = 0; i < array.length; ++i)
+        sortedSum += array[i].key;
+      EXPECT_EQ(expectedSum, sortedSum);
+
+      uint32_t keys[] = { 0, 1, 2, 500, 999, 1000, 1001, 5000 };
+      size_t indices[udLengthOf(keys)];
+      EXPECT_EQ(udR_Success, udParallel_LowerBound(pRunPool, array, keys, udLengthOf(keys), indices, [](const udParallelTests_Record &record, uint32_t key) { return record.key < key; }));
+      for (size_t k = 0; k < udLengthOf(keys); ++k)
+      {
+        size_t expected = 0;
+        while (expected < array.length && array[expected].key < keys[k])
+          ++expected;
+        EXPECT_EQ(expected, indices[k]);
+      }
+
+      array.Deinit();
+    }
+  }
+
+  udWorkerPool_Destroy(&pPool);
+}
+
+// ----------------------------------------------------------------------------
+// Calls made from tasks of the same pool complete, with the calling task doing the work if no other thread is free
+TEST(udParallelTests, Nested)
+{
+  udWorkerPool *pPool = nullptr;
+  ASSERT_EQ(udR_Success, udWorkerPool_Create(&pPool, 2));
+
+  udChunkedArray<int> array;
+  array.Init(64);
+  for (int i = 0; i < 10000; ++i)
+    array.PushBack(i);
+
+  volatile int32_t total = 0;
+  EXPECT_EQ(udR_Success, udParallel_RunBlocks(pPool, 8, [&](size_t)
+  {
+    int64_t sum = 0;
+    udParallel_Reduce(pPool, array, &sum, (int64_t)0, [](int64_t acc, int value) { return acc + value; }, [](int64_t a, int64_t b) { return a + b; });
+    if (sum == 10000LL * 9999 / 2)
+      udInterlockedPreIncrement(&total);
+  }));
+  EXPECT_EQ(8, total);
+
+  array.Deinit();
+  udWorkerPool_Destroy(&pPool);
+}
+
+// ----------------------------------------------------------------------------
+// Reductions and scans give the same results, to the bit for floating point, whatever the number of threads
+TEST(udParallelTests, ReduceScan)
+{
+  const size_t count = 100000;
+  double *pValues = udAllocType(double, count, udAF_None);
+  double *pScanned = udAllocType(double, count, udAF_None);
+  double *pExpected = udAllocType(double, count, udAF_None);
+  udDouble3 *pPoints = udAllocType(udDouble3, count, udAF_None);
+  int *pFlags = udAllocType(int, count, udAF_None);
+  int *pOffsets = udAllocType(int, count, udAF_None);
+
+  uint32_t seed = 12345;
+  for (size_t i = 0; i < count; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    pValues[i] = (seed >> 8) / 1024.0 - 4096.0 + 1.0 / (i + 1);
+    pPoints[i] = udDouble3::create(pValues[i], -pValues[i] * 0.5, (double)(seed % 1000));
+    pFlags[i] = (seed >> 12) & 1;
+  }
+
+  double sums[2] = {};
+  for (int threads : { 0, 1, 3, 7 })
+  {
+    udWorkerPool *pPool = nullptr;
+    if (threads)
+    {
+      ASSERT_EQ(udR_Success, udWorkerPool_Create(&pPool, (uint8_t)threads));
+    }
+
+    // Floating point sums match the first run exactly
+    double sum = 0.0;
+    EXPECT_EQ(udR_Success, udParallel_Reduce(pPool, pValues, count, &sum, 0.0, [](double acc, double value) { return acc + value; }, [](double a, double b) { return a + b; }));
+    if (threads == 0)
+      sums[0] = sum;
+    EXPECT_EQ(sums[0], sum);
+
+    // A bounding box of the points
+    struct Bounds { udDouble3 minimum, maximum; };
+    Bounds identity = { udDouble3::create(DBL_MAX), udDouble3::create(-DBL_MAX) };
+    Bounds bounds = {};
+    udResult result = udParallel_Reduce(pPool, pPoints, count, &bounds, identity,
+      [](Bounds acc, const udDouble3 &point) { return Bounds{ udMin(acc.minimum, point), udMax(acc.maximum, point) }; },
+      [](Bounds a, Bounds b) { return Bounds{ udMin(a.minimum, b.minimum), udMax(a.maximum, b.maximum) }; });
+    EXPECT_EQ(udR_Success, result);
+    Bounds expected = identity;
+    for (size_t i = 0; i < count; ++i)
+      expected = Bounds{ udMin(expected.minimum, pPoints[i]), udMax(expected.maximum, pPoints[i]) };
+    EXPECT_EQ(expected.minimum, bounds.minimum);
+    EXPECT_EQ(expected.maximum, bounds.maximum);
+
+    // The inclusive scan matches the first run exactly, and its total is the reduction
+    double total = 0.0;
+    EXPECT_EQ(udR_Success, udParallel_InclusiveScan(pPool, pValues, pScanned, count, 0.0, [](double a, double b) { return a + b; }, &total));
+    if (threads == 0)
+    {
+      memcpy(pExpected, pScanned, count * sizeof(double));
+      sums[1] = total;
+    }
+    EXPECT_EQ(0, memcmp(pExpected, pScanned, count * sizeof(double)));
+    EXPECT_EQ(sums[1], total);
+    EXPECT_EQ(pScanned[count - 1], total);
+
+    // Compacting with an exclusive scan of the flags, in place
+    memcpy(pOffsets, pFlags, count * sizeof(int));
+    int kept = -1;
+    EXPECT_EQ(udR_Success, udParallel_ExclusiveScan(pPool, pOffsets, pOffsets, count, 0, [](int a, int b) { return a + b; }, &kept));
+    int errors = 0;
+    int expectedOffset = 0;
+    for (size_t i = 0; i < count; ++i)
+    {
+      errors += (pOffsets[i] != expectedOffset);
+      expectedOffset += pFlags[i];
+    }
+    EXPECT_EQ(0, errors);
+    EXPECT_EQ(expectedOffset, kept);
+
+    EXPECT_EQ(udR_Success, udParallel_ExclusiveScan(pPool, (int*)nullptr, (int*)nullptr, 0, 0, [](int a, int b) { return a + b; }, &kept));
+    EXPECT_EQ(0, kept);
+    EXPECT_EQ(udR_InvalidParameter_, udParallel_InclusiveScan(pPool, (int*)nullptr, pOffsets, 10, 0, [](int a, int b) { return a + b; }));
+
+    udWorkerPool_Destroy(&pPool);
+  }
+
+  udFree(pValues);
+  udFree(pScanned);
+  udFree(pExpected);
+  udFree(pPoints);
+  udFree(pFlags);
+  udFree(pOffsets);
+}
+
+// ----------------------------------------------------------------------------
+// Benchmark, each operation over a large array as the number of threads grows. Disabled by default, run with
+// --gtest_also_run_disabled_tests
+TEST(udParallelTests, DISABLED_Throughput)
+{
+  const size_t count = 4 * 1024 * 1024;
+  const int threadCounts[] = { 1, 2, 4, 8, 16 };
+
+  for (int threadCount : threadCounts)
+  {
+    udWorkerPool *pPool = nullptr;
+    if (threadCount > 1)
+    {
+      ASSERT_EQ(udR_Success, udWorkerPool_Create(&pPool, (uint8_t)(threadCount - 1)));
+    }
+
+    udChunkedArray<udParallelTests_Record> array;
+    array.Init(4096);
+    udParallelTests_Fill(&array, count, UINT32_MAX);
+
+    uint64_t start = udPerfCounterStart();
+    udParallel_ForEach(pPool, array, [](udParallelTests_Record &record, size_t) { record.order = record.key * 2654435761u; });
+    float forEachMs = udPerfCounterMilliseconds(start);
+
+    uint64_t sum = 0;
+    start = udPerfCounterStart();
+    udParallel_Reduce(pPool, array, &sum, (uint64_t)0, [](uint64_t acc, const udParallelTests_Record &record) { return acc + record.order; }, [](uint64_t a, uint64_t b) { return a + b; });
+    float reduceMs = udPerfCounterMilliseconds(start);
+
+    start = udPerfCounterStart();
+    EXPECT_EQ(udR_Success, udParallel_Sort(pPool, array, [](const udParallelTests_Record &a, const udParallelTests_Record &b) { return a.key < b.key; }));
+    float sortMs = udPerfCounterMilliseconds(start);
+
+    const size_t keyCount = 65536;
+    uint32_t *pKeys = udAllocType(uint32_t, keyCount, udAF_None);
+    size_t *pIndices = udAllocType(size_t, keyCount, udAF_None);
+    for (size_t k = 0; k < keyCount; ++k)
+      pKeys[k] = (uint32_t)(k * 65537);
+    start = udPerfCounterStart();
+    udParallel_LowerBound(pPool, array, pKeys, keyCount, pIndices, [](const udParallelTests_Record &record, uint32_t key) { return record.key < key; });
+    float lowerBoundMs = udPerfCounterMilliseconds(start);
+    udFree(pKeys);
+    udFree(pIndices);
+
+    printf("%2d threads: ForEach %7.2fms, Reduce %7.2fms, Sort %8.2fms, LowerBound(%d) %7.2fms\n", threadCount, forEachMs, reduceMs, sortMs, (int)keyCount, lowerBoundMs);
+    for (size_t i = 1; i < array.length; i += array.length / 64)
+      EXPECT_LE(array[i - 1].key, array[i].key);
+
+    array.Deinit();
+    udWorkerPool_Destroy(&pPool);
+  }
+}
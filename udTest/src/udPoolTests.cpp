@@ -0,0 +1,183 @@
+#include "gtest/gtest.h"
+#include "udPool.h"
+#include "udPlatformUtil.h"
+#include "udStringUtil.h"
+#include "udThread.h"
+
+struct udPoolTests_Element
+{
+  double value;
+  int32_t id;
+};
+
+// ----------------------------------------------------------------------------
+TEST(udPoolTests, Validate)
+{
+  udPool<udPoolTests_Element> pool;
+  pool.Init(4);
+
+  udPoolTests_Element *pElements[20];
+  for (int i = 0; i < (int)udLengthOf(pElements); ++i)
+  {
+    pElements[i] = pool.Alloc(i == 0 ? udAF_Zero : udAF_None);
+    ASSERT_NE(nullptr, pElements[i]);
+    EXPECT_EQ(0U, (uintptr_t)pElements[i] % alignof(udPoolTests_Element));
+    pElements[i]->id = i;
+  }
+  for (int i = 0; i < (int)udLengthOf(pElements); ++i)
+    EXPECT_EQ(i, pElements[i]->id);
+
+  // Slabs of 4, 8 and 16 elements were needed for 20
+  size_t capacity, freeCount;
+  udPool_GetUsage(&pool, &capacity, &freeCount);
+  EXPECT_EQ(28U, capacity);
+  EXPECT_EQ(8U, freeCount);
+
+  // Freed elements are reused before the pool grows
+  udPoolTests_Element *pFreed = pElements[7];
+  pool.Free(pElements[7]);
+  EXPECT_EQ(nullptr, pElements[7]);
+  pElements[7] = pool.Alloc(udAF_Zero);
+  EXPECT_EQ(pFreed, pElements[7]);
+  EXPECT_EQ(0, pElements[7]->id);
+  EXPECT_EQ(0.0, pElements[7]->value);
+
+  for (udPoolTests_Element *&pElement : pElements)
+    pool.Free(pElement);
+  udPool_GetUsage(&pool, &capacity, &freeCount);
+  EXPECT_EQ(28U, capacity);
+  EXPECT_EQ(28U, freeCount);
+
+  pool.Deinit();
+  udPool_GetUsage(&pool, &capacity, &freeCount);
+  EXPECT_EQ(0U, capacity);
+
+  // A default constructed pool needs no Init, and is usable again after Deinit
+  udPool<uint8_t> bytePool;
+  uint8_t *pByte = bytePool.Alloc();
+  ASSERT_NE(nullptr, pByte);
+  bytePool.Free(pByte);
+  bytePool.Deinit();
+}
+
+struct udPoolTests_ThreadData
+{
+  udPoolBase *pPool; // Null to benchmark udAllocType instead
+  udSemaphore *pStart;
+  int iterations;
+  volatile int32_t errors;
+};
+
+// ----------------------------------------------------------------------------
+static uint32_t udPoolTests_Thread(void *pDataPtr)
+{
+  udPoolTests_ThreadData *pData = (udPoolTests_ThreadData*)pDataPtr;
+  udPool<udPoolTests_Element> *pPool = (udPool<udPoolTests_Element>*)pData->pPool;
+  udPoolTests_Element *pLive[64] = {};
+  int32_t id = (int32_t)(uintptr_t)&pLive; // Unique to this thread
+  uint32_t seed = 12345;
+
+  udWaitSemaphore(pData->pStart);
+  for (int i = 0; i < pData->iterations; ++i)
+  {
+    seed = seed * 1103515245 + 12345;
+    int slot = (seed >> 8) & 63;
+    if (pLive[slot])
+    {
+      // Another thread being handed the same element would have overwritten this
+      if (pLive[slot]->id != id + slot)
+        udInterlockedPreIncrement(&pData->errors);
+      if (pPool)
+        pPool->Free(pLive[slot]);
+      else
+        udFree(pLive[slot]);
+    }
+    else
+    {
+      pLive[slot] = pPool ? pPool->Alloc() : udAllocType(udPoolTests_Element, 1, udAF_None);
+      pLive[slot]->id = id + slot;
+    }
+  }
+  for (udPoolTests_Element *&pElement : pLive)
+  {
+    if (pPool)
+      pPool->Free(pElement);
+    else
+      udFree(pElement);
+  }
+
+  // udThread may keep this thread cached rather than exiting, so return the magazines now
+  udPool_ThreadExit();
+
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Stress the lock-free list, every element must end up back on it
+TEST(udPoolTests, Threaded)
+{
+  for (bool useMagazines : { false, true })
+  {
+    udPool<udPoolTests_Element> pool;
+    pool.Init(8, useMagazines);
+
+    udPoolTests_ThreadData data = { &pool, udCreateSemaphore(), 100000, 0 };
+    udThread *pThreads[8] = {};
+    for (udThread *&pThread : pThreads)
+      EXPECT_EQ(udR_Success, udThread_Create(&pThread, udPoolTests_Thread, &data));
+    udIncrementSemaphore(data.pStart, (int)udLengthOf(pThreads));
+    for (udThread *&pThread : pThreads)
+    {
+      udThread_Join(pThread);
+      udThread_Destroy(&pThread);
+    }
+    EXPECT_EQ(0, data.errors);
+
+    // The threads returned their magazines as they exited
+    size_t capacity, freeCount;
+    udPool_GetUsage(&pool, &capacity, &freeCount);
+    EXPECT_EQ(capacity, freeCount);
+    EXPECT_LE(capacity, udLengthOf(pThreads) * (64 + UDPOOL_MAGAZINE_SIZE) * 2);
+
+    pool.Deinit();
+    udDestroySemaphore(&data.pStart);
+  }
+}
+
+// ----------------------------------------------------------------------------
+// Benchmark, multi-threaded alloc/free throughput of the pool against udAllocType. Disabled by default, run with
+// --gtest_also_run_disabled_tests
+TEST(udPoolTests, DISABLED_Throughput)
+{
+  const int iterations = 200000;
+  const int threadCounts[] = { 1, 2, 4, 8, 16, 32, 64 };
+  const char *pNames[] = { "udAllocType", "udPool", "udPool+mag" };
+
+  for (int threadCount : threadCounts)
+  {
+    for (int mode = 0; mode < (int)udLengthOf(pNames); ++mode)
+    {
+      udPool<udPoolTests_Element> pool;
+      pool.Init(0, mode == 2);
+
+      udPoolTests_ThreadData data = { mode ? &pool : nullptr, udCreateSemaphore(), iterations, 0 };
+      udThread *pThreads[64] = {};
+      for (int t = 0; t < threadCount; ++t)
+        EXPECT_EQ(udR_Success, udThread_Create(&pThreads[t], udPoolTests_Thread, &data));
+
+      uint64_t start = udPerfCounterStart();
+      udIncrementSemaphore(data.pStart, threadCount);
+      for (int t = 0; t < threadCount; ++t)
+      {
+        udThread_Join(pThreads[t]);
+        udThread_Destroy(&pThreads[t]);
+      }
+      float ms = udPerfCounterMilliseconds(start);
+      printf("%-12s %2d threads: %s alloc/free per second\n", pNames[mode], threadCount, udTempStr_CommaInt((int64_t)(threadCount * (double)iterations * 1000.0 / udMax(ms, 0.001f))));
+      EXPECT_EQ(0, data.errors);
+
+      pool.Deinit();
+      udDestroySemaphore(&data.pStart);
+    }
+  }
+}
@@ -0,0 +1,210 @@
+#include "gtest/gtest.h"
+#include "udSPSCQueue.h"
+#include "udSafeDeque.h"
+#include "udStringUtil.h"
+
+struct udSPSCQueueTests_Named
+{
+  char *pName;
+
+  udSPSCQueueTests_Named(const char *pStr = nullptr) : pName(udStrdup(pStr)) {}
+  udSPSCQueueTests_Named(const udSPSCQueueTests_Named &other) : pName(udStrdup(other.pName)) {}
+  ~udSPSCQueueTests_Named() { udFree(pName); }
+  udSPSCQueueTests_Named &operator=(udSPSCQueueTests_Named &&other) { if (this != &other) { udFree(pName); pName = other.pName; other.pName = nullptr; } return *this; }
+};
+
+// ----------------------------------------------------------------------------
+TEST(udSPSCQueueTests, Validate)
+{
+  udSPSCQueue<int> *pQueue = nullptr;
+  int value = -1;
+
+  EXPECT_EQ(udR_InvalidParameter_, udSPSCQueue_Create((udSPSCQueue<int>**)nullptr, 8));
+  EXPECT_EQ(udR_InvalidParameter_, udSPSCQueue_Create(&pQueue, 0));
+  EXPECT_EQ(udR_InvalidParameter_, udSPSCQueue_PushBack((udSPSCQueue<int>*)nullptr, 1));
+  EXPECT_EQ(udR_InvalidParameter_, udSPSCQueue_PopFront((udSPSCQueue<int>*)nullptr, &value));
+
+  ASSERT_EQ(udR_Success, udSPSCQueue_Create(&pQueue, 6));
+  EXPECT_EQ(8U, udSPSCQueue_GetCapacity(pQueue));
+  EXPECT_EQ(udR_ObjectNotFound, udSPSCQueue_PopFront(pQueue, &value));
+  EXPECT_EQ(udR_Timeout, udSPSCQueue_PopFrontWait(pQueue, &value, 0));
+  EXPECT_EQ(udR_Timeout, udSPSCQueue_PopFrontWait(pQueue, &value, 10));
+  EXPECT_EQ(-1, value);
+
+  // Single and batched, lapping the ring many times
+  int values[8];
+  int next = 0, expected = 0;
+  for (int lap = 0; lap < 100; ++lap)
+  {
+    EXPECT_EQ(udR_Success, udSPSCQueue_PushBack(pQueue, next++));
+    for (int i = 0; i < 8; ++i)
+      values[i] = next + i;
+    uint32_t pushed = udSPSCQueue_PushBackRange(pQueue, values, 8);
+    EXPECT_EQ(7U, pushed);
+    next += (int)pushed;
+    EXPECT_EQ(udR_CountExceeded, udSPSCQueue_PushBack(pQueue, next));
+    EXPECT_EQ(udR_Timeout, udSPSCQueue_PushBackWait(pQueue, next, 0));
+
+    EXPECT_EQ(udR_Success, udSPSCQueue_PopFrontWait(pQueue, &value));
+    EXPECT_EQ(expected++, value);
+    uint32_t popped = udSPSCQueue_PopFrontRange(pQueue, values, 3 + lap % 5);
+    EXPECT_EQ(3U + lap % 5, popped);
+    for (uint32_t i = 0; i < popped; ++i)
+      EXPECT_EQ(expected++, values[i]);
+    popped = udSPSCQueue_PopFrontRange(pQueue, values, 8);
+    for (uint32_t i = 0; i < popped; ++i)
+      EXPECT_EQ(expected++, values[i]);
+    EXPECT_EQ(0U, udSPSCQueue_PopFrontRange(pQueue, values, 8));
+  }
+  EXPECT_EQ(next, expected);
+
+  udSPSCQueue_Destroy(&pQueue);
+  EXPECT_EQ(nullptr, pQueue);
+  udSPSCQueue_Destroy(&pQueue);
+
+  // Non trivial elements are copied in and moved out, and those left are destroyed with the queue
+  udSPSCQueue<udSPSCQueueTests_Named> *pNamed = nullptr;
+  ASSERT_EQ(udR_Success, udSPSCQueue_Create(&pNamed, 4));
+  udSPSCQueueTests_Named names[3] = { "first", "second", "third" };
+  EXPECT_EQ(3U, udSPSCQueue_PushBackRange(pNamed, names, 3));
+  udSPSCQueueTests_Named named;
+  EXPECT_EQ(udR_Success, udSPSCQueue_PopFront(pNamed, &named));
+  EXPECT_STREQ("first", named.pName);
+  udSPSCQueue_Destroy(&pNamed);
+}
+
+struct udSPSCQueueTests_StreamData
+{
+  udSPSCQueue<int> *pQueue;
+  int count;
+  int batchSize;
+};
+
+// ----------------------------------------------------------------------------
+static uint32_t udSPSCQueueTests_Producer(void *pDataPtr)
+{
+  udSPSCQueueTests_StreamData *pData = (udSPSCQueueTests_StreamData*)pDataPtr;
+  if (pData->batchSize <= 1)
+  {
+    for (int i = 0; i < pData->count; ++i)
+      udSPSCQueue_PushBackWait(pData->pQueue, i);
+  }
+  else
+  {
+    int batch[256];
+    for (int i = 0; i < pData->count; )
+    {
+      int batchCount = udMin(pData->batchSize, pData->count - i);
+      for (int b = 0; b < batchCount; ++b)
+        batch[b] = i + b;
+      uint32_t pushed = udSPSCQueue_PushBackRange(pData->pQueue, batch, (uint32_t)batchCount);
+      if (pushed == 0 && udSPSCQueue_PushBackWait(pData->pQueue, batch[0]) == udR_Success) // Full, so block until there is space
+        pushed = 1;
+      i += (int)pushed;
+    }
+  }
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Streams count items from another thread, returning the milliseconds taken and counting any that arrive out of order
+static float udSPSCQueueTests_Stream(udSPSCQueue<int> *pQueue, int count, int batchSize, int *pErrors)
+{
+  udSPSCQueueTests_StreamData data = { pQueue, count, batchSize };
+  udThread *pThread = nullptr;
+  int expected = 0;
+
+  uint64_t start = udPerfCounterStart();
+  EXPECT_EQ(udR_Success, udThread_Create(&pThread, udSPSCQueueTests_Producer, &data));
+  int batch[256];
+  while (expected < count)
+  {
+    if (batchSize <= 1)
+    {
+      if (udSPSCQueue_PopFrontWait(pQueue, &batch[0]) != udR_Success || batch[0] != expected)
+        ++*pErrors;
+      ++expected;
+    }
+    else
+    {
+      uint32_t popped = udSPSCQueue_PopFrontRange(pQueue, batch, (uint32_t)batchSize);
+      if (popped == 0 && udSPSCQueue_PopFrontWait(pQueue, &batch[0]) == udR_Success)
+        popped = 1;
+      for (uint32_t i = 0; i < popped; ++i)
+      {
+        if (batch[i] != expected++)
+          ++*pErrors;
+      }
+    }
+  }
+  udThread_Join(pThread);
+  float ms = udPerfCounterMilliseconds(start);
+  udThread_Destroy(&pThread);
+  return ms;
+}
+
+// ----------------------------------------------------------------------------
+TEST(udSPSCQueueTests, Stream)
+{
+  udSPSCQueue<int> *pQueue = nullptr;
+  ASSERT_EQ(udR_Success, udSPSCQueue_Create(&pQueue, 16));
+  int errors = 0;
+  udSPSCQueueTests_Stream(pQueue, 100000, 1, &errors);
+  udSPSCQueueTests_Stream(pQueue, 100000, 7, &errors);
+  EXPECT_EQ(0, errors);
+  EXPECT_EQ(udR_ObjectNotFound, udSPSCQueue_PopFront(pQueue, (int*)nullptr));
+  udSPSCQueue_Destroy(&pQueue);
+}
+
+struct udSPSCQueueTests_DequeData
+{
+  udSafeDeque<int> *pDeque;
+  int count;
+};
+
+// ----------------------------------------------------------------------------
+static uint32_t udSPSCQueueTests_DequeProducer(void *pDataPtr)
+{
+  udSPSCQueueTests_DequeData *pData = (udSPSCQueueTests_DequeData*)pDataPtr;
+  for (int i = 0; i < pData->count; ++i)
+    udSafeDeque_PushBack(pData->pDeque, i);
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Benchmark, streaming from one thread to another through udSafeDeque and through udSPSCQueue singly and in batches.
+// Disabled by default, run with --gtest_also_run_disabled_tests
+TEST(udSPSCQueueTests, DISABLED_Throughput)
+{
+  const int count = 1 << 20;
+  int errors = 0;
+
+  udSafeDeque<int> *pDeque = nullptr;
+  ASSERT_EQ(udR_Success, udSafeDeque_Create(&pDeque, 1024));
+  udSPSCQueueTests_DequeData dequeData = { pDeque, count };
+  udThread *pThread = nullptr;
+  uint64_t start = udPerfCounterStart();
+  EXPECT_EQ(udR_Success, udThread_Create(&pThread, udSPSCQueueTests_DequeProducer, &dequeData));
+  for (int expected = 0, value; expected < count; )
+  {
+    if (udSafeDeque_PopFront(pDeque, &value) != udR_Success)
+      udYield();
+    else if (value != expected++)
+      ++errors;
+  }
+  udThread_Join(pThread);
+  float dequeMs = udPerfCounterMilliseconds(start);
+  udThread_Destroy(&pThread);
+  udSafeDeque_Destroy(&pDeque);
+  printf("udSafeDeque:            %8.2fms (%6.2f Mops/s)\n", dequeMs, count / (dequeMs * 1000.f));
+
+  udSPSCQueue<int> *pQueue = nullptr;
+  ASSERT_EQ(udR_Success, udSPSCQueue_Create(&pQueue, 1024));
+  for (int batchSize : { 1, 16, 256 })
+  {
+    float ms = udSPSCQueueTests_Stream(pQueue, count, batchSize, &errors);
+    printf("udSPSCQueue (batch %3d): %8.2fms (%6.2f Mops/s)\n", batchSize, ms, count / (ms * 1000.f));
+  }
+  udSPSCQueue_Destroy(&pQueue);
+  EXPECT_EQ(0, errors);
+}
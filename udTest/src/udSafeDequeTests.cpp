@@ -1,5 +1,6 @@
 #include "gtest/gtest.h"
 #include "udSafeDeque.h"
+#include "udThread.h"
 
 TEST(udSafeDequeTests, ValidationTests)
 {
@@ -44,3 +45,173 @@ TEST(udSafeDequeTests, ValidationTests)
   udSafeDeque_Destroy(&pQueue);
   udSafeDeque_Destroy((udSafeDeque<int> **)nullptr);
 }
+
+struct udSafeDequeTests_ThreadData
+{
+  udSafeDeque<int> *pQueue;
+  int itemsPerProducer;
+  volatile int32_t received;
+  volatile int32_t sum;
+};
+
+// ----------------------------------------------------------------------------
+static uint32_t udSafeDequeTests_Producer(void *pDataPtr)
+{
+  udSafeDequeTests_ThreadData *pData = (udSafeDequeTests_ThreadData*)pDataPtr;
+  int batch[10];
+  for (int i = 0; i < pData->itemsPerProducer; i += (int)udLengthOf(batch))
+  {
+    for (int b = 0; b < (int)udLengthOf(batch); ++b)
+      batch[b] = i + b;
+    udSafeDeque_PushBackBatch(pData->pQueue, batch, udLengthOf(batch));
+    udYield();
+  }
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Consumers block until there are items, stopping when a -1 (which is pushed last) arrives
+static uint32_t udSafeDequeTests_Consumer(void *pDataPtr)
+{
+  udSafeDequeTests_ThreadData *pData = (udSafeDequeTests_ThreadData*)pDataPtr;
+  int batch[4];
+  size_t count;
+  for (;;)
+  {
+    if (udSafeDeque_PopFrontBatch(pData->pQueue, batch, udLengthOf(batch), &count, UDTHREAD_WAIT_INFINITE) != udR_Success)
+      break;
+    for (size_t i = 0; i < count; ++i)
+    {
+      if (batch[i] == -1)
+      {
+        // Any other stop markers taken in the same batch belong to the other consumers
+        for (size_t j = i + 1; j < count; ++j)
+          udSafeDeque_PushBack(pData->pQueue, batch[j]);
+        return 0;
+      }
+      udInterlockedPreIncrement(&pData->received);
+      udInterlockedAdd(&pData->sum, batch[i]);
+    }
+  }
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+TEST(udSafeDequeTests, Blocking)
+{
+  udSafeDeque<int> *pQueue = nullptr;
+  int value = -1;
+  size_t count = 99;
+
+  ASSERT_EQ(udR_Success, udSafeDeque_Create(&pQueue, 32));
+
+  // Empty, with and without a timeout
+  EXPECT_EQ(udR_ObjectNotFound, udSafeDeque_PopFrontWait(pQueue, &value, 0));
+  EXPECT_EQ(udR_Timeout, udSafeDeque_PopBackWait(pQueue, &value, 10));
+  EXPECT_EQ(udR_ObjectNotFound, udSafeDeque_PopFrontBatch(pQueue, &value, 1, &count, 0));
+  EXPECT_EQ(0U, count);
+  EXPECT_EQ(-1, value);
+
+  int values[] = { 1, 2, 3, 4, 5 };
+  int popped[8];
+  EXPECT_EQ(udR_Success, udSafeDeque_PushBackBatch(pQueue, values, udLengthOf(values)));
+  EXPECT_EQ(udR_Success, udSafeDeque_PopBackWait(pQueue, &value, 0));
+  EXPECT_EQ(5, value);
+  EXPECT_EQ(udR_Success, udSafeDeque_PopFrontWait(pQueue, &value));
+  EXPECT_EQ(1, value);
+  EXPECT_EQ(udR_Success, udSafeDeque_PopFrontBatch(pQueue, popped, udLengthOf(popped), &count, 10));
+  ASSERT_EQ(3U, count);
+  EXPECT_EQ(2, popped[0]);
+  EXPECT_EQ(4, popped[2]);
+
+  // Consumers blocked on an empty deque are woken by the producers' batches
+  udSafeDequeTests_ThreadData data = { pQueue, 1000, 0, 0 };
+  udThread *pConsumers[3] = {};
+  udThread *pProducers[2] = {};
+  for (udThread *&pThread : pConsumers)
+    EXPECT_EQ(udR_Success, udThread_Create(&pThread, udSafeDequeTests_Consumer, &data));
+  udSleep(10);
+  for (udThread *&pThread : pProducers)
+    EXPECT_EQ(udR_Success, udThread_Create(&pThread, udSafeDequeTests_Producer, &data));
+  for (udThread *&pThread : pProducers)
+  {
+    udThread_Join(pThread);
+    udThread_Destroy(&pThread);
+  }
+  for (size_t i = 0; i < udLengthOf(pConsumers); ++i)
+    EXPECT_EQ(udR_Success, udSafeDeque_PushBack(pQueue, -1));
+  for (udThread *&pThread : pConsumers)
+  {
+    udThread_Join(pThread);
+    udThread_Destroy(&pThread);
+  }
+  EXPECT_EQ(2 * data.itemsPerProducer, data.received);
+  EXPECT_EQ(data.itemsPerProducer * (data.itemsPerProducer - 1), data.sum);
+
+  udSafeDeque_Destroy(&pQueue);
+}
+
+struct udSafeDequeTests_BoundedData
+{
+  udSafeDeque<int> *pQueue;
+  int count;
+  volatile int32_t maxLength;
+};
+
+// ----------------------------------------------------------------------------
+static uint32_t udSafeDequeTests_BoundedProducer(void *pDataPtr)
+{
+  udSafeDequeTests_BoundedData *pData = (udSafeDequeTests_BoundedData*)pDataPtr;
+  for (int i = 0; i < pData->count; ++i)
+  {
+    EXPECT_EQ(udR_Success, udSafeDeque_PushBackWait(pData->pQueue, i));
+    udInterlockedMax(&pData->maxLength, (int32_t)pData->pQueue->chunkedArray.length);
+  }
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+TEST(udSafeDequeTests, Bounded)
+{
+  udSafeDeque<int> *pQueue = nullptr;
+  int value = -1;
+
+  ASSERT_EQ(udR_Success, udSafeDeque_Create(&pQueue, 32, 4));
+  for (int i = 0; i < 3; ++i)
+    EXPECT_EQ(udR_Success, udSafeDeque_PushBack(pQueue, i));
+  int values[] = { 10, 11 };
+  EXPECT_EQ(udR_CountExceeded, udSafeDeque_PushBackBatch(pQueue, values, 2));
+  EXPECT_EQ(udR_Success, udSafeDeque_PushFront(pQueue, -1));
+  EXPECT_EQ(udR_CountExceeded, udSafeDeque_PushBack(pQueue, 4));
+  EXPECT_EQ(udR_CountExceeded, udSafeDeque_PushFront(pQueue, 4));
+  EXPECT_EQ(udR_CountExceeded, udSafeDeque_PushBackWait(pQueue, 4, 0));
+  EXPECT_EQ(udR_Timeout, udSafeDeque_PushBackWait(pQueue, 4, 10));
+  EXPECT_EQ(4U, pQueue->chunkedArray.length);
+
+  EXPECT_EQ(udR_Success, udSafeDeque_PopFront(pQueue, &value));
+  EXPECT_EQ(-1, value);
+  EXPECT_EQ(udR_Success, udSafeDeque_PushBackWait(pQueue, 3, 0));
+  EXPECT_EQ(udR_Success, udSafeDeque_PopFront(pQueue, &value));
+  EXPECT_EQ(0, value);
+
+  // A producer faster than the consumer is held to the capacity, without losing or reordering anything
+  size_t count = 0;
+  while (udSafeDeque_PopFrontBatch(pQueue, values, udLengthOf(values), &count, 0) == udR_Success)
+    ;
+  udSafeDequeTests_BoundedData data = { pQueue, 2000, 0 };
+  udThread *pThread = nullptr;
+  EXPECT_EQ(udR_Success, udThread_Create(&pThread, udSafeDequeTests_BoundedProducer, &data));
+  for (int i = 0; i < data.count; ++i)
+  {
+    EXPECT_EQ(udR_Success, udSafeDeque_PopFrontWait(pQueue, &value));
+    EXPECT_EQ(i, value);
+    if ((i % 100) == 0)
+      udSleep(1);
+  }
+  udThread_Join(pThread);
+  udThread_Destroy(&pThread);
+  EXPECT_GE(4, data.maxLength);
+  EXPECT_EQ(0U, pQueue->chunkedArray.length);
+
+  udSafeDeque_Destroy(&pQueue);
+}
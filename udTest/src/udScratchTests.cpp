@@ -0,0 +1,136 @@
+#include "gtest/gtest.h"
+#include "udJSON.h"
+#include "udMemoryProfiler.h"
+#include "udScratch.h"
+#include "udStringUtil.h"
+#include "udThread.h"
+
+#if !UDPLATFORM_WINDOWS
+# include <pthread.h>
+#endif
+
+// ----------------------------------------------------------------------------
+TEST(udScratchTests, Validate)
+{
+  uint8_t *pOuter = udScratchAllocType(uint8_t, 100, udAF_Zero);
+  ASSERT_NE(nullptr, pOuter);
+  EXPECT_EQ(0, pOuter[99]);
+
+  uint8_t *pFirst;
+  {
+    udScratchScope scope;
+    pFirst = (uint8_t*)udScratch_Alloc(1000, udAF_None, 64);
+    ASSERT_NE(nullptr, pFirst);
+    EXPECT_EQ(0U, (uintptr_t)pFirst % 64);
+    EXPECT_TRUE(pFirst >= pOuter + 100);
+
+    // Larger than a block, and nested scopes
+    {
+      udScratchScope inner;
+      uint8_t *pLarge = udScratchAllocType(uint8_t, 100000, udAF_Zero);
+      ASSERT_NE(nullptr, pLarge);
+      pLarge[99999] = 1;
+    }
+  }
+
+  // The scope ending released its memory for reuse, the outer allocation remains
+  {
+    udScratchScope scope;
+    EXPECT_EQ(pFirst, udScratch_Alloc(1000, udAF_None, 64));
+  }
+
+  // Ring allocations don't overlap until the ring wraps
+  char *pA = udScratch_RingAlloc(100);
+  char *pB = udScratch_RingAlloc(100);
+  ASSERT_NE(nullptr, pA);
+  ASSERT_NE(nullptr, pB);
+  EXPECT_TRUE(pB >= pA + 100 || pB + 100 <= pA);
+}
+
+struct udScratchTests_ThreadData
+{
+  udSemaphore *pStart;
+  volatile int32_t errors;
+};
+
+// ----------------------------------------------------------------------------
+static uint32_t udScratchTests_TempStrThread(void *pDataPtr)
+{
+  udScratchTests_ThreadData *pData = (udScratchTests_ThreadData*)pDataPtr;
+  int32_t id = (int32_t)(uintptr_t)&pData; // Unique to this thread
+
+  udWaitSemaphore(pData->pStart);
+  for (int i = 0; i < 20000; ++i)
+  {
+    const char *pShort = udTempStr("%d.%d", id, i);
+    const char *pLong = udTempStr("%d.%*d", id, 2000 + (i & 255), i);
+    if (!udStrEqual(pShort, udTempStr("%d.%d", id, i)) || udStrlen(pLong) != udStrlen(udTempStr("%d.", id)) + 2000 + (i & 255))
+      udInterlockedPreIncrement(&pData->errors);
+  }
+  udScratch_ThreadExit();
+
+  return 0;
+}
+
+// ----------------------------------------------------------------------------
+// Temporary strings from different threads never overwrite each other
+TEST(udScratchTests, TempStrThreaded)
+{
+  udScratchTests_ThreadData data = { udCreateSemaphore(), 0 };
+  udThread *pThreads[8] = {};
+  for (udThread *&pThread : pThreads)
+    EXPECT_EQ(udR_Success, udThread_Create(&pThread, udScratchTests_TempStrThread, &data));
+  udIncrementSemaphore(data.pStart, (int)udLengthOf(pThreads));
+  for (udThread *&pThread : pThreads)
+  {
+    udThread_Join(pThread);
+    udThread_Destroy(&pThread);
+  }
+  EXPECT_EQ(0, data.errors);
+  udDestroySemaphore(&data.pStart);
+}
+
+#if !UDPLATFORM_WINDOWS
+// ----------------------------------------------------------------------------
+static void *udScratchTests_PThread(void *pErrors)
+{
+  const char *pLong = udTempStr("%*d", 3000, 1);
+  if (udStrlen(pLong) != 3000 || !udScratch_Alloc(100))
+    ++*(int*)pErrors;
+  return nullptr;
+}
+
+// ----------------------------------------------------------------------------
+// Threads not started by udThread release their scratch memory as they exit
+TEST(udScratchTests, ForeignThreadExit)
+{
+  size_t oldInterval = udMemoryProfiler_GetSampleInterval();
+  udMemoryProfiler_SetSampleInterval(1); // Sample every allocation so the scratch memory is seen
+  udMemoryProfiler_Reset();
+
+  int errors = 0;
+  pthread_t thread;
+  ASSERT_EQ(0, pthread_create(&thread, nullptr, udScratchTests_PThread, &errors));
+  pthread_join(thread, nullptr);
+  EXPECT_EQ(0, errors);
+
+  udJSON report;
+  EXPECT_EQ(udR_Success, udMemoryProfiler_Report(&report, 0, udMPS_LiveBytes));
+  int64_t scratchSites = 0;
+  int64_t liveBytes = 0;
+  for (size_t i = 0; i < report.Get("sites").ArrayLength(); ++i)
+  {
+    const udJSON &site = report.Get("sites[%d]", (int)i);
+    if (udStrEndsWith(site.Get("file").AsString(), "udScratch.cpp") || udStrEndsWith(site.Get("file").AsString(), "udArena.cpp"))
+    {
+      ++scratchSites;
+      liveBytes += site.Get("liveBytes").AsInt64();
+    }
+  }
+  EXPECT_LT(0, scratchSites);
+  EXPECT_EQ(0, liveBytes);
+
+  udMemoryProfiler_Reset();
+  udMemoryProfiler_SetSampleInterval(oldInterval);
+}
+#endif
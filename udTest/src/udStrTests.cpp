@@ -259,7 +259,7 @@ TEST(udStrTests, udTempStr)
   EXPECT_STREQ("123", udTempStr_TrimDouble(123.666666667, 0, 0, true));
   EXPECT_STREQ("124", udTempStr_TrimDouble(123.666666667, 0, 0, false));
 
-  // These tests assume 32 buffers of 64 characters each
+  // At least 32 short strings are kept before the thread's ring wraps
   const char *pBuffers[32];
   const int bufferLen = 64;
   size_t index;
@@ -278,17 +278,18 @@ TEST(udStrTests, udTempStr)
   udStrchr(pMediumString2, "*", &index);
   EXPECT_EQ(3 * bufferLen - 3, index);
 
-  // Test a single string the size of all the buffers (force a wrap)
+  // Test a single string as large as the ring, this doesn't disturb the short strings
   const char *pLongString = udTempStr("%*s", int(udLengthOf(pBuffers)) * bufferLen - 2, "!");
   udStrchr(pLongString, "!", &index);
   EXPECT_EQ(32 * bufferLen - 3, index);
-  // Make sure it is the lowest pointer of all of them
   for (index = 0; index < udLengthOf(pBuffers); ++index)
-    EXPECT_TRUE(pLongString <= pBuffers[index]);
+    EXPECT_EQ(index, udStrAtoi(pBuffers[index]));
 
-  // Test a string longer than all the buffers
-  pLongString = udTempStr("%*s", int(udLengthOf(pBuffers) + 1) * bufferLen, "!");
-  EXPECT_EQ(nullptr, udStrchr(pLongString, "!"));
+  // Strings of any length are complete
+  pLongString = udTempStr("%*s", 100000, "!");
+  EXPECT_EQ(100000U, udStrlen(pLongString));
+  udStrchr(pLongString, "!", &index);
+  EXPECT_EQ(100000U - 1, index);
 
   // Test strings of varying lengths
   for (size_t i = 0; i < udStrlen(s_pTestParagraph); ++i)
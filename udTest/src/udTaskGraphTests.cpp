@@ -0,0 +1,112 @@
+#include "gtest/gtest.h"
+#include "udTaskGraph.h"
+#include "udPlatformUtil.h"
+
+// ----------------------------------------------------------------------------
+TEST(udTaskGraphTests, Validate)
+{
+  udWorkerPool *pPool = nullptr;
+  udTaskGraph *pGraph = nullptr;
+  uint32_t a, b, c;
+
+  ASSERT_EQ(udR_Success, udWorkerPool_Create(&pPool, 2));
+  EXPECT_EQ(udR_InvalidParameter_, udTaskGraph_Create(nullptr, pPool));
+  EXPECT_EQ(udR_InvalidParameter_, udTaskGraph_Create(&pGraph, nullptr));
+  EXPECT_EQ(udR_InvalidParameter_, udTaskGraph_Run(nullptr));
+  EXPECT_EQ(udR_InvalidParameter_, udTaskGraph_Wait(nullptr));
+
+  ASSERT_EQ(udR_Success, udTaskGraph_Create(&pGraph, pPool));
+  EXPECT_EQ(udR_Success, udTaskGraph_Run(pGraph)); // Empty
+  EXPECT_EQ(udR_Success, udTaskGraph_Wait(pGraph));
+
+  EXPECT_EQ(udR_InvalidParameter_, udTaskGraph_AddNode(pGraph, nullptr, nullptr));
+  EXPECT_EQ(udR_Success, udTaskGraph_AddNode(pGraph, &a, nullptr));
+  EXPECT_EQ(udR_Success, udTaskGraph_AddNode(pGraph, &b, nullptr));
+  EXPECT_EQ(udR_Success, udTaskGraph_AddNode(pGraph, &c, nullptr));
+  EXPECT_EQ(0U, a);
+  EXPECT_EQ(2U, c);
+  EXPECT_EQ(udR_OutOfRange, udTaskGraph_AddDependency(pGraph, a, 3));
+  EXPECT_EQ(udR_InvalidParameter_, udTaskGraph_AddDependency(pGraph, b, b));
+
+  // A cycle can't run, and is only found when the graph is run
+  EXPECT_EQ(udR_Success, udTaskGraph_AddDependency(pGraph, a, b));
+  EXPECT_EQ(udR_Success, udTaskGraph_AddDependency(pGraph, b, c));
+  EXPECT_EQ(udR_Success, udTaskGraph_AddDependency(pGraph, c, a));
+  EXPECT_EQ(udR_InvalidConfiguration, udTaskGraph_Run(pGraph));
+  EXPECT_EQ(udR_Success, udTaskGraph_Wait(pGraph, 0));
+
+  udTaskGraph_Destroy(&pGraph);
+  EXPECT_EQ(nullptr, pGraph);
+  udTaskGraph_Destroy(&pGraph);
+  udWorkerPool_Destroy(&pPool);
+}
+
+struct udTaskGraphTests_Tile
+{
+  udSemaphore *pGate; // Holds the first stage when set
+  volatile int32_t step;
+  int32_t stamps[8]; // The step at which each stage ran
+  int64_t value;
+  int64_t parts[4];
+};
+
+// ----------------------------------------------------------------------------
+// A pipeline read -> decode -> 4 parallel transforms -> combine -> write, run once per tile on the same graph
+TEST(udTaskGraphTests, Pipeline)
+{
+  const int TileCount = 200;
+  udWorkerPool *pPool = nullptr;
+  udTaskGraph *pGraph = nullptr;
+  uint32_t read, decode, transforms[4], combine, write;
+
+  ASSERT_EQ(udR_Success, udWorkerPool_Create(&pPool, 4));
+  ASSERT_EQ(udR_Success, udTaskGraph_Create(&pGraph, pPool));
+
+  auto stamp = [](udTaskGraphTests_Tile *pTile, int stage) { pTile->stamps[stage] = udInterlockedPreIncrement(&pTile->step); };
+  EXPECT_EQ(udR_Success, udTaskGraph_AddNode(pGraph, &read, [stamp](void *pData) { udTaskGraphTests_Tile *pTile = (udTaskGraphTests_Tile*)pData; if (pTile->pGate) udWaitSemaphore(pTile->pGate); stamp(pTile, 0); pTile->value = 3; }));
+  EXPECT_EQ(udR_Success, udTaskGraph_AddNode(pGraph, &decode, [stamp](void *pData) { udTaskGraphTests_Tile *pTile = (udTaskGraphTests_Tile*)pData; stamp(pTile, 1); pTile->value *= 7; }, udWPP_Interactive));
+  for (int i = 0; i < 4; ++i)
+  {
+    EXPECT_EQ(udR_Success, udTaskGraph_AddNode(pGraph, &transforms[i], [stamp, i](void *pData) { udTaskGraphTests_Tile *pTile = (udTaskGraphTests_Tile*)pData; stamp(pTile, 2 + i); pTile->parts[i] = pTile->value + i; }));
+    EXPECT_EQ(udR_Success, udTaskGraph_AddDependency(pGraph, decode, transforms[i]));
+  }
+  EXPECT_EQ(udR_Success, udTaskGraph_AddNode(pGraph, &combine, nullptr)); // Only joins the transforms
+  EXPECT_EQ(udR_Success, udTaskGraph_AddNode(pGraph, &write, [stamp](void *pData) { udTaskGraphTests_Tile *pTile = (udTaskGraphTests_Tile*)pData; stamp(pTile, 6); pTile->value = pTile->parts[0] + pTile->parts[1] + pTile->parts[2] + pTile->parts[3]; }));
+  EXPECT_EQ(udR_Success, udTaskGraph_AddDependency(pGraph, read, decode));
+  for (int i = 0; i < 4; ++i)
+    EXPECT_EQ(udR_Success, udTaskGraph_AddDependency(pGraph, transforms[i], combine));
+  EXPECT_EQ(udR_Success, udTaskGraph_AddDependency(pGraph, combine, write));
+
+  udTaskGraphTests_Tile tiles[TileCount] = {};
+  tiles[0].pGate = udCreateSemaphore();
+  for (int t = 0; t < TileCount; ++t)
+  {
+    EXPECT_EQ(udR_Success, udTaskGraph_Run(pGraph, &tiles[t]));
+    if (tiles[t].pGate)
+    {
+      uint32_t extra;
+      EXPECT_EQ(udR_NotAllowed, udTaskGraph_Run(pGraph, &tiles[t]));
+      EXPECT_EQ(udR_NotAllowed, udTaskGraph_AddNode(pGraph, &extra, nullptr));
+      EXPECT_EQ(udR_Timeout, udTaskGraph_Wait(pGraph, 10));
+      udIncrementSemaphore(tiles[t].pGate);
+    }
+    EXPECT_EQ(udR_Success, udTaskGraph_Wait(pGraph, UDTHREAD_WAIT_INFINITE, (t % 2) == 1));
+  }
+
+  int errors = 0;
+  for (const udTaskGraphTests_Tile &tile : tiles)
+  {
+    if (tile.value != 4 * 21 + 6 || tile.step != 7 || tile.stamps[0] != 1 || tile.stamps[1] != 2 || tile.stamps[6] != 7)
+      ++errors;
+    for (int i = 0; i < 4; ++i)
+    {
+      if (tile.stamps[2 + i] < 3 || tile.stamps[2 + i] > 6)
+        ++errors;
+    }
+  }
+  EXPECT_EQ(0, errors);
+  udDestroySemaphore(&tiles[0].pGate);
+
+  udTaskGraph_Destroy(&pGraph);
+  udWorkerPool_Destroy(&pPool);
+}
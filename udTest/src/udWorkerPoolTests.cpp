@@ -1,6 +1,8 @@
 #include "gtest/gtest.h"
 
 #include "udWorkerPool.h"
+#include "udCancelToken.h"
+#include "udJSON.h"
 #include "udPlatformUtil.h"
 #include "udThread.h"
 
@@ -116,3 +118,535 @@ TEST(udWorkerPoolTests, Validate)
   udWorkerPool_Destroy(&pPool);
   udWorkerPool_Destroy(nullptr);
 }
+
+struct WorkerTestSpawnData
+{
+  udWorkerPool *pPool;
+  int depth;
+  volatile int32_t *pCount;
+};
+
+// Each task adds two more from the worker running it until the depth runs out, so most tasks start on a worker's own queue
+void SpawnTasks(void *pDataPtr)
+{
+  WorkerTestSpawnData *pData = (WorkerTestSpawnData*)pDataPtr;
+  udInterlockedPreIncrement(pData->pCount);
+
+  if (pData->depth == 0)
+    return;
+
+  for (int i = 0; i < 2; ++i)
+  {
+    WorkerTestSpawnData *pChild = udAllocType(WorkerTestSpawnData, 1, udAF_None);
+    *pChild = *pData;
+    --pChild->depth;
+    if (udWorkerPool_AddTask(pData->pPool, SpawnTasks, pChild) != udR_Success) // Fails once the pool is being destroyed
+      udFree(pChild);
+  }
+}
+
+TEST(udWorkerPoolTests, NestedTasks)
+{
+  udWorkerPool *pPool = nullptr;
+  volatile int32_t count = 0;
+  const int Depth = 12;
+  const int Roots = 4;
+
+  ASSERT_EQ(udR_Success, udWorkerPool_Create(&pPool, 4));
+
+  for (int i = 0; i < Roots; ++i)
+  {
+    WorkerTestSpawnData *pRoot = udAllocType(WorkerTestSpawnData, 1, udAF_None);
+    *pRoot = { pPool, Depth, &count };
+    EXPECT_EQ(udR_Success, udWorkerPool_AddTask(pPool, SpawnTasks, pRoot));
+  }
+
+  // Helping from outside the pool takes queued and stolen tasks
+  while (udWorkerPool_HasActiveWorkers(pPool))
+    udWorkerPool_TryDoWork(pPool);
+
+  EXPECT_EQ(Roots * ((2 << Depth) - 1), count);
+  EXPECT_EQ(udR_NothingToDo, udWorkerPool_TryDoWork(pPool));
+
+  // Tasks still queued when the pool is destroyed are freed without running
+  for (int i = 0; i < Roots; ++i)
+  {
+    WorkerTestSpawnData *pRoot = udAllocType(WorkerTestSpawnData, 1, udAF_None);
+    *pRoot = { pPool, Depth, &count };
+    EXPECT_EQ(udR_Success, udWorkerPool_AddTask(pPool, SpawnTasks, pRoot));
+  }
+  udWorkerPool_Destroy(&pPool);
+}
+
+struct WorkerTestOrderData
+{
+  udSemaphore *pStarted;
+  udSemaphore *pRelease;
+  char order[32];
+  volatile int32_t count;
+};
+
+void BlockWorker(void *pDataPtr)
+{
+  WorkerTestOrderData *pData = (WorkerTestOrderData*)pDataPtr;
+  udIncrementSemaphore(pData->pStarted);
+  udWaitSemaphore(pData->pRelease);
+}
+
+void RecordInteractive(void *pDataPtr)
+{
+  WorkerTestOrderData *pData = (WorkerTestOrderData*)pDataPtr;
+  pData->order[udInterlockedPostIncrement(&pData->count)] = 'I';
+}
+
+void RecordBackground(void *pDataPtr)
+{
+  WorkerTestOrderData *pData = (WorkerTestOrderData*)pDataPtr;
+  pData->order[udInterlockedPostIncrement(&pData->count)] = 'B';
+}
+
+// Holds the only worker while the tasks are queued, then returns the order they ran in
+static const char *QueueInLanes(udWorkerPool *pPool, WorkerTestOrderData *pData, int interactiveCount, int backgroundCount)
+{
+  memset(pData->order, 0, sizeof(pData->order));
+  pData->count = 0;
+
+  EXPECT_EQ(udR_Success, udWorkerPool_AddTask(pPool, BlockWorker, pData, false));
+  udWaitSemaphore(pData->pStarted);
+
+  // Queue the bulk work first so it is already waiting when the interactive work arrives
+  for (int i = 0; i < backgroundCount; ++i)
+    EXPECT_EQ(udR_Success, udWorkerPool_AddPriorityTask(pPool, udWPP_Background, RecordBackground, pData, false));
+  for (int i = 0; i < interactiveCount; ++i)
+    EXPECT_EQ(udR_Success, udWorkerPool_AddPriorityTask(pPool, udWPP_Interactive, RecordInteractive, pData, false));
+
+  udWorkerPoolLaneMetrics metrics;
+  EXPECT_EQ(udR_Success, udWorkerPool_GetLaneMetrics(pPool, udWPP_Background, &metrics));
+  EXPECT_EQ(backgroundCount, metrics.queuedTasks);
+  EXPECT_EQ(udR_Success, udWorkerPool_GetLaneMetrics(pPool, udWPP_Interactive, &metrics));
+  EXPECT_EQ(interactiveCount, metrics.queuedTasks);
+
+  udIncrementSemaphore(pData->pRelease);
+  while (udWorkerPool_HasActiveWorkers(pPool))
+    udYield();
+
+  return pData->order;
+}
+
+TEST(udWorkerPoolTests, Priorities)
+{
+  udWorkerPool *pPool = nullptr;
+  WorkerTestOrderData data = {};
+  udWorkerPoolLaneMetrics metrics;
+  data.pStarted = udCreateSemaphore();
+  data.pRelease = udCreateSemaphore();
+
+  ASSERT_EQ(udR_Success, udWorkerPool_Create(&pPool, 1));
+
+  EXPECT_EQ(udR_InvalidParameter_, udWorkerPool_AddPriorityTask(pPool, udWPP_Count, RecordInteractive, &data, false));
+  EXPECT_EQ(udR_InvalidParameter_, udWorkerPool_GetLaneMetrics(pPool, udWPP_Normal, nullptr));
+  const uint8_t zeroWeight[udWPP_Count] = { 1, 0, 1 };
+  EXPECT_EQ(udR_InvalidParameter_, udWorkerPool_SetSchedule(pPool, udWPS_Weighted, zeroWeight));
+
+  // Strict, none of the bulk work runs while interactive work is queued
+  EXPECT_STREQ("IIIIIBBBBB", QueueInLanes(pPool, &data, 5, 5));
+
+  // Weighted 2:1, the background lane keeps moving
+  const uint8_t weights[udWPP_Count] = { 2, 1, 1 };
+  EXPECT_EQ(udR_Success, udWorkerPool_SetSchedule(pPool, udWPS_Weighted, weights));
+  EXPECT_STREQ("IIBIIBIIBBBB", QueueInLanes(pPool, &data, 6, 6));
+
+  EXPECT_EQ(udR_Success, udWorkerPool_GetLaneMetrics(pPool, udWPP_Interactive, &metrics));
+  EXPECT_EQ(0, metrics.queuedTasks);
+  EXPECT_EQ(6, metrics.peakQueuedTasks);
+  EXPECT_EQ(11U, metrics.addedTasks);
+  EXPECT_EQ(11U, metrics.completedTasks);
+  EXPECT_EQ(udR_Success, udWorkerPool_GetLaneMetrics(pPool, udWPP_Normal, &metrics));
+  EXPECT_EQ(2U, metrics.completedTasks); // The blocking tasks
+
+  udWorkerPool_Destroy(&pPool);
+  udDestroySemaphore(&data.pStarted);
+  udDestroySemaphore(&data.pRelease);
+}
+
+struct WorkerTestGroupData
+{
+  udWorkerPool *pPool;
+  udSemaphore *pRelease;
+  volatile int32_t count;
+};
+
+void CountTask(void *pDataPtr)
+{
+  udInterlockedPreIncrement(&((WorkerTestGroupData*)pDataPtr)->count);
+}
+
+void WaitForRelease(void *pDataPtr)
+{
+  udWaitSemaphore(((WorkerTestGroupData*)pDataPtr)->pRelease);
+}
+
+// Forks a batch of its own from a worker thread and joins it, helping so it doesn't wait on tasks queued behind itself
+void ForkJoinTask(void *pDataPtr)
+{
+  WorkerTestGroupData *pData = (WorkerTestGroupData*)pDataPtr;
+  udWorkerPoolGroup *pGroup = nullptr;
+  EXPECT_EQ(udR_Success, udWorkerPool_CreateGroup(&pGroup, pData->pPool));
+  for (int i = 0; i < 50; ++i)
+    EXPECT_EQ(udR_Success, udWorkerPool_AddGroupTask(pGroup, udWPP_Normal, CountTask, pData, false));
+  EXPECT_EQ(udR_Success, udWorkerPool_WaitGroup(pGroup, UDTHREAD_WAIT_INFINITE, true));
+  EXPECT_EQ(0, udWorkerPool_GetGroupTaskCount(pGroup));
+  udWorkerPool_DestroyGroup(&pGroup);
+}
+
+TEST(udWorkerPoolTests, Groups)
+{
+  udWorkerPoolGroup *pGroup = nullptr;
+  WorkerTestGroupData data = {};
+  data.pRelease = udCreateSemaphore();
+
+  ASSERT_EQ(udR_Success, udWorkerPool_Create(&data.pPool, 2));
+  EXPECT_EQ(udR_InvalidParameter_, udWorkerPool_CreateGroup(nullptr, data.pPool));
+  EXPECT_EQ(udR_InvalidParameter_, udWorkerPool_CreateGroup(&pGroup, nullptr));
+  EXPECT_EQ(udR_InvalidParameter_, udWorkerPool_AddGroupTask(nullptr, udWPP_Normal, CountTask, &data, false));
+  EXPECT_EQ(udR_InvalidParameter_, udWorkerPool_WaitGroup(nullptr));
+
+  ASSERT_EQ(udR_Success, udWorkerPool_CreateGroup(&pGroup, data.pPool));
+  EXPECT_EQ(udR_Success, udWorkerPool_WaitGroup(pGroup)); // Nothing added yet
+
+  // A task still running keeps the group waiting
+  EXPECT_EQ(udR_Success, udWorkerPool_AddGroupTask(pGroup, udWPP_Normal, WaitForRelease, &data, false));
+  EXPECT_EQ(1, udWorkerPool_GetGroupTaskCount(pGroup));
+  EXPECT_EQ(udR_Timeout, udWorkerPool_WaitGroup(pGroup, 0));
+  EXPECT_EQ(udR_Timeout, udWorkerPool_WaitGroup(pGroup, 20));
+  udIncrementSemaphore(data.pRelease);
+  EXPECT_EQ(udR_Success, udWorkerPool_WaitGroup(pGroup));
+  EXPECT_EQ(0, udWorkerPool_GetGroupTaskCount(pGroup));
+
+  // Reused for a fork/join batch, parked then helping
+  for (int pass = 0; pass < 2; ++pass)
+  {
+    data.count = 0;
+    for (int i = 0; i < 1000; ++i)
+      EXPECT_EQ(udR_Success, udWorkerPool_AddGroupTask(pGroup, (udWorkerPoolPriority)(i % udWPP_Count), CountTask, &data, false));
+    EXPECT_EQ(udR_Success, udWorkerPool_WaitGroup(pGroup, UDTHREAD_WAIT_INFINITE, pass == 1));
+    EXPECT_EQ(1000, data.count);
+  }
+
+  // Nested fork/join from the workers, more than there are workers so some wait while others are queued
+  data.count = 0;
+  for (int i = 0; i < 8; ++i)
+    EXPECT_EQ(udR_Success, udWorkerPool_AddGroupTask(pGroup, udWPP_Normal, ForkJoinTask, &data, false));
+  EXPECT_EQ(udR_Success, udWorkerPool_WaitGroup(pGroup, UDTHREAD_WAIT_INFINITE, true));
+  EXPECT_EQ(8 * 50, data.count);
+
+  udWorkerPool_DestroyGroup(&pGroup);
+  EXPECT_EQ(nullptr, pGroup);
+  udWorkerPool_DestroyGroup(&pGroup);
+
+  udWorkerPool_Destroy(&data.pPool);
+  udDestroySemaphore(&data.pRelease);
+}
+
+struct WorkerTestTimedData
+{
+  uint64_t start;
+  float ranAfterMs;
+  udSemaphore *pRan;
+};
+
+void TimedTask(void *pDataPtr)
+{
+  WorkerTestTimedData *pData = (WorkerTestTimedData*)pDataPtr;
+  pData->ranAfterMs = udPerfCounterMilliseconds(pData->start);
+  udIncrementSemaphore(pData->pRan);
+}
+
+TEST(udWorkerPoolTests, TimedTasks)
+{
+  WorkerTestGroupData data = {};
+  udWorkerPoolGroup *pGroup = nullptr;
+  uint64_t timer = 0;
+
+  ASSERT_EQ(udR_Success, udWorkerPool_Create(&data.pPool, 2));
+  EXPECT_EQ(udR_InvalidParameter_, udWorkerPool_AddTimedTask(nullptr, &timer, 0, 0, CountTask, &data));
+  EXPECT_EQ(udR_InvalidParameter_, udWorkerPool_AddTimedTask(data.pPool, &timer, 0, 0, CountTask, &data, udWPP_Count));
+  EXPECT_EQ(udR_InvalidParameter_, udWorkerPool_CancelTimedTask(nullptr, timer));
+  EXPECT_EQ(udR_ObjectNotFound, udWorkerPool_CancelTimedTask(data.pPool, 0));
+
+  // A delayed task runs once, no earlier than its delay
+  WorkerTestTimedData timed = { udPerfCounterStart(), 0.f, udCreateSemaphore() };
+  EXPECT_EQ(udR_Success, udWorkerPool_AddTimedTask(data.pPool, &timer, 50, 0, TimedTask, &timed));
+  EXPECT_EQ(0, udWaitSemaphore(timed.pRan, 5000));
+  EXPECT_LE(49.f, timed.ranAfterMs);
+  udSleep(10);
+  EXPECT_EQ(udR_ObjectNotFound, udWorkerPool_CancelTimedTask(data.pPool, timer));
+
+  // Thousands of timers spread over the wheel, half of them cancelled before they are due
+  uint64_t timers[2000];
+  for (int i = 0; i < 2000; ++i)
+    EXPECT_EQ(udR_Success, udWorkerPool_AddTimedTask(data.pPool, &timers[i], (uint32_t)(i % 200) + (i & 1) * 200, 0, CountTask, &data, udWPP_Background));
+  for (int i = 1; i < 2000; i += 2)
+    EXPECT_EQ(udR_Success, udWorkerPool_CancelTimedTask(data.pPool, timers[i]));
+  EXPECT_EQ(udR_ObjectNotFound, udWorkerPool_CancelTimedTask(data.pPool, timers[1]));
+  for (int waitedMs = 0; data.count < 1000 && waitedMs < 5000; waitedMs += 10)
+    udSleep(10);
+  udSleep(250);
+  EXPECT_EQ(1000, data.count);
+
+  // A periodic task keeps running until cancelled, and waiting on its group after cancelling leaves none in progress
+  ASSERT_EQ(udR_Success, udWorkerPool_CreateGroup(&pGroup, data.pPool));
+  data.count = 0;
+  EXPECT_EQ(udR_Success, udWorkerPool_AddTimedTask(data.pPool, &timer, 0, 10, CountTask, &data, udWPP_Normal, pGroup));
+  for (int waitedMs = 0; data.count < 5 && waitedMs < 5000; waitedMs += 10)
+    udSleep(10);
+  EXPECT_EQ(udR_Success, udWorkerPool_CancelTimedTask(data.pPool, timer));
+  EXPECT_EQ(udR_Success, udWorkerPool_WaitGroup(pGroup));
+  int32_t periodicCount = data.count;
+  EXPECT_LE(5, periodicCount);
+  udSleep(50);
+  EXPECT_EQ(periodicCount, data.count);
+  EXPECT_EQ(udR_ObjectNotFound, udWorkerPool_CancelTimedTask(data.pPool, timer));
+  udWorkerPool_DestroyGroup(&pGroup);
+
+  // Delays beyond the wheel, and tasks still waiting when the pool is destroyed
+  EXPECT_EQ(udR_Success, udWorkerPool_AddTimedTask(data.pPool, &timer, 5 * 60 * 60 * 1000, 0, CountTask, &data));
+  EXPECT_EQ(udR_Success, udWorkerPool_CancelTimedTask(data.pPool, timer));
+  EXPECT_EQ(udR_Success, udWorkerPool_AddTimedTask(data.pPool, nullptr, UINT32_MAX, 1000, CountTask, &data));
+  EXPECT_EQ(udR_Success, udWorkerPool_AddTimedTask(data.pPool, nullptr, 10000, 0, CountTask, &data));
+
+  udWorkerPool_Destroy(&data.pPool);
+  EXPECT_EQ(periodicCount, data.count);
+  udDestroySemaphore(&timed.pRan);
+}
+
+// Runs until the thread's current token is cancelled
+void PollCancelTask(void *pDataPtr)
+{
+  WorkerTestGroupData *pData = (WorkerTestGroupData*)pDataPtr;
+  udIncrementSemaphore(pData->pRelease);
+  while (!udCancelToken_IsCancelled(udCancelToken_GetCurrent()))
+    udYield();
+  udInterlockedPreIncrement(&pData->count);
+}
+
+TEST(udWorkerPoolTests, Cancellation)
+{
+  WorkerTestGroupData data = {};
+  udCancelToken *pToken = nullptr;
+  udWorkerPoolLaneMetrics metrics;
+  data.pRelease = udCreateSemaphore();
+
+  ASSERT_EQ(udR_Success, udWorkerPool_Create(&data.pPool, 1));
+  ASSERT_EQ(udR_Success, udCancelToken_Create(&pToken));
+  EXPECT_EQ(udR_InvalidParameter_, udWorkerPool_AddCancellableTask(data.pPool, nullptr, udWPP_Normal, CountTask, &data, false));
+
+  // Queued behind a blocked task, then cancelled before the worker reaches them. The token may go before its tasks do
+  EXPECT_EQ(udR_Success, udWorkerPool_AddTask(data.pPool, WaitForRelease, &data, false));
+  for (int i = 0; i < 100; ++i)
+    EXPECT_EQ(udR_Success, udWorkerPool_AddCancellableTask(data.pPool, pToken, udWPP_Background, CountTask, udAllocType(int, 1, udAF_Zero), true, CountTask));
+  EXPECT_EQ(udR_Success, udWorkerPool_AddCancellableTask(data.pPool, pToken, udWPP_Background, CountTask, &data, false));
+  udCancelToken_Cancel(pToken);
+  udCancelToken_Destroy(&pToken);
+  udIncrementSemaphore(data.pRelease);
+  while (udWorkerPool_HasActiveWorkers(data.pPool))
+    udYield();
+  EXPECT_EQ(0, data.count);
+  EXPECT_EQ(udR_NothingToDo, udWorkerPool_DoPostWork(data.pPool));
+  EXPECT_EQ(udR_Success, udWorkerPool_GetLaneMetrics(data.pPool, udWPP_Background, &metrics));
+  EXPECT_EQ(101U, metrics.cancelledTasks);
+  EXPECT_EQ(0U, metrics.completedTasks);
+
+  // A running task polls its token
+  ASSERT_EQ(udR_Success, udCancelToken_Create(&pToken));
+  EXPECT_EQ(udR_Success, udWorkerPool_AddCancellableTask(data.pPool, pToken, udWPP_Normal, PollCancelTask, &data, false));
+  EXPECT_EQ(0, udWaitSemaphore(data.pRelease));
+  EXPECT_EQ(0, data.count);
+  udCancelToken_Cancel(pToken);
+  while (udWorkerPool_HasActiveWorkers(data.pPool))
+    udYield();
+  EXPECT_EQ(1, data.count);
+
+  // Reset, so tasks queued with it run again
+  udCancelToken_Reset(pToken);
+  EXPECT_EQ(udR_Success, udWorkerPool_AddCancellableTask(data.pPool, pToken, udWPP_Normal, CountTask, &data, false));
+  while (udWorkerPool_HasActiveWorkers(data.pPool))
+    udYield();
+  EXPECT_EQ(2, data.count);
+
+  udCancelToken_Destroy(&pToken);
+  udWorkerPool_Destroy(&data.pPool);
+  udDestroySemaphore(&data.pRelease);
+}
+
+void SleepTask(void *)
+{
+  udSleep(2);
+}
+
+TEST(udWorkerPoolTests, Metrics)
+{
+  WorkerTestGroupData data = {};
+  udWorkerPoolGroup *pGroup = nullptr;
+  udJSON report;
+
+  ASSERT_EQ(udR_Success, udWorkerPool_Create(&data.pPool, 2));
+  EXPECT_EQ(udR_InvalidParameter_, udWorkerPool_SetMetricsEnabled(nullptr, true));
+  EXPECT_EQ(udR_InvalidParameter_, udWorkerPool_ReportMetrics(nullptr, &report));
+  EXPECT_EQ(udR_InvalidParameter_, udWorkerPool_ReportMetrics(data.pPool, nullptr));
+
+  // Nothing is recorded until enabled
+  ASSERT_EQ(udR_Success, udWorkerPool_CreateGroup(&pGroup, data.pPool));
+  for (int i = 0; i < 100; ++i)
+    EXPECT_EQ(udR_Success, udWorkerPool_AddGroupTask(pGroup, udWPP_Normal, CountTask, &data, false));
+  EXPECT_EQ(udR_Success, udWorkerPool_WaitGroup(pGroup));
+  EXPECT_EQ(udR_Success, udWorkerPool_ReportMetrics(data.pPool, &report));
+  EXPECT_FALSE(report.Get("recording").AsBool());
+  EXPECT_EQ(2U, report.Get("threads").ArrayLength());
+  EXPECT_EQ(0, report.Get("total.runMicroseconds.count").AsInt64());
+
+  EXPECT_EQ(udR_Success, udWorkerPool_SetMetricsEnabled(data.pPool, true));
+  for (int i = 0; i < 1000; ++i)
+    EXPECT_EQ(udR_Success, udWorkerPool_AddGroupTask(pGroup, (udWorkerPoolPriority)(i % udWPP_Count), CountTask, &data, false));
+  for (int i = 0; i < 10; ++i)
+    EXPECT_EQ(udR_Success, udWorkerPool_AddGroupTask(pGroup, udWPP_Normal, SleepTask, nullptr, false));
+  EXPECT_EQ(udR_Success, udWorkerPool_WaitGroup(pGroup));
+  // A task's run time is recorded after its group hears it has finished
+  for (int waitedMs = 0; waitedMs < 5000; waitedMs += 5)
+  {
+    EXPECT_EQ(udR_Success, udWorkerPool_ReportMetrics(data.pPool, &report));
+    if (report.Get("total.runMicroseconds.count").AsInt64() == 1010)
+      break;
+    udSleep(5);
+  }
+
+  EXPECT_TRUE(report.Get("recording").AsBool());
+  EXPECT_LT(0.0, report.Get("elapsedMs").AsDouble());
+  EXPECT_EQ(1010, report.Get("total.runMicroseconds.count").AsInt64());
+  EXPECT_EQ(1010, report.Get("total.waitMicroseconds.count").AsInt64());
+  EXPECT_EQ(1010, report.Get("total.queueDepth.count").AsInt64());
+  EXPECT_LE(10 * 2000, report.Get("total.runMicroseconds.sum").AsInt64());
+  int64_t threadRuns = 0;
+  for (size_t i = 0; i < report.Get("threads").ArrayLength(); ++i)
+  {
+    const udJSON &thread = report.Get("threads[%d]", (int)i);
+    threadRuns += thread.Get("runMicroseconds.count").AsInt64();
+    int64_t bucketTotal = 0;
+    for (size_t b = 0; b < thread.Get("runMicroseconds.buckets").ArrayLength(); ++b)
+      bucketTotal += thread.Get("runMicroseconds.buckets[%d]", (int)b).AsInt64();
+    EXPECT_EQ(thread.Get("runMicroseconds.count").AsInt64(), bucketTotal);
+    EXPECT_LE(0.0, thread.Get("utilisation").AsDouble());
+    EXPECT_GE(1.0, thread.Get("utilisation").AsDouble());
+  }
+  EXPECT_EQ(1010, threadRuns);
+
+  // Re-enabling starts again
+  EXPECT_EQ(udR_Success, udWorkerPool_SetMetricsEnabled(data.pPool, false));
+  EXPECT_EQ(udR_Success, udWorkerPool_SetMetricsEnabled(data.pPool, true));
+  EXPECT_EQ(udR_Success, udWorkerPool_ReportMetrics(data.pPool, &report));
+  EXPECT_EQ(0, report.Get("total.runMicroseconds.count").AsInt64());
+
+  report.Destroy();
+  udWorkerPool_DestroyGroup(&pGroup);
+  udWorkerPool_Destroy(&data.pPool);
+}
+
+TEST(udWorkerPoolTests, ParallelFor)
+{
+  udWorkerPool *pPool = nullptr;
+  const size_t Count = 100000;
+  uint8_t *pHits = udAllocType(uint8_t, Count, udAF_Zero);
+  volatile int32_t calls = 0;
+
+  ASSERT_EQ(udR_Success, udWorkerPool_Create(&pPool, 4));
+
+  // Serially without a pool, then split across the pool with a range of grains, every index is visited once
+  for (udWorkerPool *pRunPool : { (udWorkerPool*)nullptr, pPool })
+  {
+    for (size_t grain : { 0, 1, 64, 5000, 200000 })
+    {
+      memset(pHits, 0, Count);
+      calls = 0;
+      EXPECT_EQ(udR_Success, udWorkerPool_ParallelFor(pRunPool, 10, Count, grain, [&](size_t begin, size_t end)
+      {
+        udInterlockedPreIncrement(&calls);
+        if (end - begin < udMin(grain, Count - 10))
+          ADD_FAILURE() << "Range smaller than the grain";
+        for (size_t i = begin; i < end; ++i)
+          ++pHits[i];
+      }));
+
+      int errors = 0;
+      for (size_t i = 0; i < Count; ++i)
+        errors += (pHits[i] != (i >= 10 ? 1 : 0));
+      EXPECT_EQ(0, errors);
+      if (pRunPool == nullptr || grain >= Count)
+      {
+        EXPECT_EQ(1, calls);
+      }
+    }
+  }
+
+  EXPECT_EQ(udR_Success, udWorkerPool_ParallelFor(pPool, 5, 5, 1, [&](size_t, size_t) { ADD_FAILURE() << "Empty range"; }));
+
+  // Nested from the pool's own threads, with the cost of an index growing with it
+  volatile int32_t total = 0;
+  EXPECT_EQ(udR_Success, udWorkerPool_ParallelFor(pPool, 0, 64, 1, [&](size_t begin, size_t end)
+  {
+    for (size_t outer = begin; outer < end; ++outer)
+    {
+      udWorkerPool_ParallelFor(pPool, 0, outer * 10, 8, [&](size_t innerBegin, size_t innerEnd)
+      {
+        udInterlockedAdd(&total, (int32_t)(innerEnd - innerBegin));
+      });
+    }
+  }));
+  EXPECT_EQ(10 * 64 * 63 / 2, total);
+
+  udWorkerPool_Destroy(&pPool);
+  udFree(pHits);
+}
+
+// ----------------------------------------------------------------------------
+// Benchmark, the cost per index of a trivial body split by ParallelFor against a task per block of indices. Disabled
+// by default, run with --gtest_also_run_disabled_tests
+TEST(udWorkerPoolTests, DISABLED_ParallelForThroughput)
+{
+  udWorkerPool *pPool = nullptr;
+  const size_t Count = 1 << 24;
+  const size_t BlockSize = 1024;
+  volatile int32_t sum = 0;
+
+  ASSERT_EQ(udR_Success, udWorkerPool_Create(&pPool, 4));
+
+  uint64_t start = udPerfCounterStart();
+  EXPECT_EQ(udR_Success, udWorkerPool_ParallelFor(pPool, 0, Count, 256, [&](size_t begin, size_t end)
+  {
+    int32_t local = 0;
+    for (size_t i = begin; i < end; ++i)
+      local += (int32_t)(i & 1);
+    udInterlockedAdd(&sum, local);
+  }));
+  float forMs = udPerfCounterMilliseconds(start);
+  EXPECT_EQ((int32_t)(Count / 2), sum);
+
+  sum = 0;
+  start = udPerfCounterStart();
+  for (size_t block = 0; block < Count / BlockSize; ++block)
+  {
+    udWorkerPool_AddTask(pPool, [&sum, block, BlockSize](void *)
+    {
+      int32_t local = 0;
+      for (size_t i = block * BlockSize; i < (block + 1) * BlockSize; ++i)
+        local += (int32_t)(i & 1);
+      udInterlockedAdd(&sum, local);
+    }, nullptr, false);
+  }
+  while (udWorkerPool_HasActiveWorkers(pPool))
+    udWorkerPool_TryDoWork(pPool);
+  float tasksMs = udPerfCounterMilliseconds(start);
+  EXPECT_EQ((int32_t)(Count / 2), sum);
+
+  printf("ParallelFor: %6.2fms (%5.2fns/index), task per %d indices: %6.2fms (%5.2fns/index)\n", forMs, forMs * 1e6f / Count, (int)BlockSize, tasksMs, tasksMs * 1e6f / Count);
+  udWorkerPool_Destroy(&pPool);
+}